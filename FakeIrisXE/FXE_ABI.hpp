@@ -3,7 +3,7 @@
 #include <stdint.h>
 
 #define FXE_ABI_MAJOR 1u
-#define FXE_ABI_MINOR 0u
+#define FXE_ABI_MINOR 3u
 #define FXE_KEXT_VERSION_PACKED 0x0001009Au
 
 enum {
@@ -12,9 +12,18 @@ enum {
     FXE_SEL_ATTACH_SHARED = 2,
     FXE_SEL_BIND_SURFACE  = 3,
     FXE_SEL_PRESENT       = 4,
+    FXE_SEL_USERPTR_CREATE  = 5,
+    FXE_SEL_USERPTR_RELEASE = 6,
     FXE_SEL_FENCE_TEST    = 7,
 };
 
+// FXE_VersionInfo.features
+enum {
+    FXE_FEATURE_IOSURFACE = 0x1u,
+    FXE_FEATURE_USERPTR   = 0x2u,   // abi 1.1
+    FXE_FEATURE_PPGTT     = 0x4u,   // abi 1.2
+};
+
 enum FXE_Result {
     FXE_OK         = 0,
     FXE_EINVAL     = 0xE001,
@@ -23,6 +32,7 @@ enum FXE_Result {
     FXE_EINTERNAL  = 0xE004,
     FXE_ETIMEOUT   = 0xE005,
     FXE_ENOENT     = 0xE006,
+    FXE_EQUOTA     = 0xE007,    // abi 1.3: the connection's GPU memory quota
 };
 
 #pragma pack(push, 1)
@@ -80,6 +90,44 @@ typedef struct FXE_Present_Out {
     uint32_t reserved;
 } FXE_Present_Out;
 
+// Wrap a page-aligned range of the caller's memory as a GPU buffer with no
+// copy. The pages stay wired and GGTT-mapped until FXE_SEL_USERPTR_RELEASE
+// or until the connection closes; release before unmapping the range.
+// Non-zero width/height also register it as a blit surface (rows packed,
+// 4 bytes per pixel).
+// With FXE_USERPTR_FLAG_PPGTT the range is mapped into the connection's
+// own address space (the one its contexts run in) instead of the GGTT;
+// gpuAddr is then an address in that space and width/height must be 0.
+enum {
+    FXE_USERPTR_FLAG_PPGTT = 0x1u,  // abi 1.2
+};
+
+typedef struct FXE_UserptrCreate_In {
+    uint64_t address;
+    uint64_t length;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelFormat;
+    uint32_t flags;
+} FXE_UserptrCreate_In;
+
+typedef struct FXE_UserptrCreate_Out {
+    uint64_t handle;
+    uint64_t gpuAddr;
+    uint64_t surfaceId;     // 0 unless width/height were given
+    uint32_t rc;
+    uint32_t reserved;
+} FXE_UserptrCreate_Out;
+
+typedef struct FXE_UserptrRelease_In {
+    uint64_t handle;
+} FXE_UserptrRelease_In;
+
+typedef struct FXE_UserptrRelease_Out {
+    uint32_t rc;
+    uint32_t reserved;
+} FXE_UserptrRelease_Out;
+
 typedef struct FXE_FenceTest_In {
     uint32_t engine;
     uint32_t timeoutMs;
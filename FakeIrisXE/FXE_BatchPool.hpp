@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "FXE_Timeline.hpp"
+
+//
+// Per-engine batch-buffer sub-allocator.
+//
+// Small command buffers (one blit, a clip rectangle, a handful of batched
+// blits) are carved out of a few large, pinned and GGTT-mapped chunks by
+// bumping an offset, so a batch costs a pointer increment instead of a
+// GEM allocation, pin and GGTT map of its own.
+//
+// A chunk fills front to back. Every slice taken from it is either
+// committed with the fence of the request that reads it, or aborted when
+// the submit fails; the chunk remembers its last committed fence. Once
+// the current chunk is full the pool moves to the next chunk with no
+// uncommitted slices whose last fence is done and rewinds it to offset 0.
+// If none is idle it grows, up to kMaxChunks; past that alloc() fails and
+// the caller falls back to a standalone GEM.
+//
+// Fences committed to one pool must come from a single timeline (the
+// engine's kernel context), so a chunk's last fence covers every earlier
+// slice in it.
+//
+// Driven by FakeIrisXEExeclist under its scheduler lock, and by
+// FakeIrisXEFramebuffer's RCS chain pool under the ring lock.
+//
+
+class FXE_BatchPoolPlatform {
+public:
+    virtual ~FXE_BatchPoolPlatform() {}
+    // A pinned, GGTT-mapped buffer of `bytes`; *cookie goes back to releaseChunk().
+    virtual bool allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu) = 0;
+    virtual void releaseChunk(void* cookie) = 0;
+    // True once the engine is done with the fence's request (signaled or failed).
+    virtual bool fenceDone(const FXE_Fence& f) = 0;
+};
+
+struct FXE_BatchSlice {
+    void*    cpu;
+    uint64_t gpu;
+    uint32_t chunk;
+    uint32_t offset;
+    uint32_t bytes;         // after alignment
+};
+
+struct FXE_BatchPoolStats {
+    uint64_t allocs;
+    uint64_t bytes;
+    uint64_t aborts;
+    uint64_t rewinds;       // a chunk reused once its last fence was done
+    uint64_t chunkAllocs;
+    uint64_t exhausted;     // every chunk busy and no room to grow
+    uint64_t tooLarge;
+    uint32_t chunks;
+};
+
+class FXE_BatchPool {
+public:
+    static const uint32_t kMaxChunks = 4;
+    static const uint32_t kAlign     = 64;     // one cache line per batch start
+
+    void init(FXE_BatchPoolPlatform* platform, uint32_t chunkBytes) {
+        mPlatform = platform;
+        mChunkBytes = chunkBytes;
+        mCount = 0;
+        mCur = 0;
+        memset(mChunk, 0, sizeof(mChunk));
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    // Carve `bytes` (rounded up to kAlign) from the current chunk.
+    bool alloc(uint32_t bytes, FXE_BatchSlice* out) {
+        const uint32_t need = (bytes + kAlign - 1) & ~(kAlign - 1);
+        if (!out || !need || need > mChunkBytes) {
+            mStats.tooLarge++;
+            return false;
+        }
+        if ((!mCount || mChunk[mCur].head + need > mChunkBytes) && !advance()) {
+            mStats.exhausted++;
+            return false;
+        }
+        Chunk& c = mChunk[mCur];
+        out->cpu = (uint8_t*)c.cpu + c.head;
+        out->gpu = c.gpu + c.head;
+        out->chunk = mCur;
+        out->offset = c.head;
+        out->bytes = need;
+        c.head += need;
+        c.open++;
+        mStats.allocs++;
+        mStats.bytes += need;
+        return true;
+    }
+
+    // The slice was submitted; the engine reads it until `fence` is done.
+    void commit(const FXE_BatchSlice& s, const FXE_Fence& fence) {
+        Chunk& c = mChunk[s.chunk];
+        if (c.open) c.open--;
+        if (fence.seqno >= c.last.seqno) c.last = fence;
+    }
+
+    // The submit failed: the slice is unused. The latest one is given back.
+    void abort(const FXE_BatchSlice& s) {
+        Chunk& c = mChunk[s.chunk];
+        if (c.open) c.open--;
+        if (s.offset + s.bytes == c.head) c.head = s.offset;
+        mStats.aborts++;
+    }
+
+    // Release every chunk. The engine must be idle.
+    void drain() {
+        for (uint32_t i = 0; i < mCount; ++i)
+            if (mPlatform) mPlatform->releaseChunk(mChunk[i].cookie);
+        memset(mChunk, 0, sizeof(mChunk));
+        mCount = 0;
+        mCur = 0;
+        mStats.chunks = 0;
+    }
+
+    uint32_t chunkCount() const { return mCount; }
+    const FXE_BatchPoolStats& stats() const { return mStats; }
+
+private:
+    struct Chunk {
+        void*     cookie;
+        void*     cpu;
+        uint64_t  gpu;
+        uint32_t  head;
+        uint32_t  open;     // slices handed out, not yet committed or aborted
+        FXE_Fence last;
+    };
+
+    bool idle(uint32_t i) const {
+        return !mChunk[i].open && mPlatform->fenceDone(mChunk[i].last);
+    }
+
+    // Move to an idle chunk (oldest-filled first, the current one last),
+    // else a new one.
+    bool advance() {
+        for (uint32_t k = 1; k <= mCount; ++k) {
+            const uint32_t i = (mCur + k) % mCount;
+            if (idle(i)) {
+                mChunk[i].head = 0;
+                mChunk[i].last = FXE_Fence();
+                mCur = i;
+                mStats.rewinds++;
+                return true;
+            }
+        }
+        if (mCount == kMaxChunks || !mPlatform)
+            return false;
+        Chunk& c = mChunk[mCount];
+        if (!mPlatform->allocChunk(mChunkBytes, &c.cookie, &c.cpu, &c.gpu))
+            return false;
+        c.head = 0;
+        c.open = 0;
+        c.last = FXE_Fence();
+        mCur = mCount++;
+        mStats.chunkAllocs++;
+        mStats.chunks = mCount;
+        return true;
+    }
+
+    FXE_BatchPoolPlatform* mPlatform;
+    uint32_t               mChunkBytes;
+    uint32_t               mCount;
+    uint32_t               mCur;
+    Chunk                  mChunk[kMaxChunks];
+    FXE_BatchPoolStats     mStats;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// Buffer-object cache.
+//
+// Freed GEMs are parked in power-of-two size buckets (4 KB .. 1 MB) and
+// handed back out instead of allocating, pinning and mapping a fresh one.
+// Each bucket is a small LIFO stack so the most recently used (cache- and
+// TLB-warm) object goes out first; the oldest sits at the bottom and is
+// the first to age out.
+//
+// Entries leave the cache when they are older than maxAgeNs (reap(), run
+// from a timer), when the total would exceed the byte budget (put()
+// drops the globally oldest) and on trim(), which the kext calls when an
+// allocation fails. Every dropped object goes to the platform's release().
+//
+// Driven by FakeIrisXEFramebuffer::boAlloc/boRecycle under fBoCacheLock.
+//
+
+class FXE_BoCachePlatform {
+public:
+    virtual ~FXE_BoCachePlatform() {}
+    virtual void release(void* obj) = 0;
+};
+
+struct FXE_BoCacheStats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t puts;
+    uint64_t rejects;          // not a bucket size, or the cache is off
+    uint64_t evictedBudget;
+    uint64_t evictedAge;
+    uint64_t evictedTrim;
+    uint64_t bytesCached;
+    uint64_t peakBytesCached;
+};
+
+class FXE_BoCache {
+public:
+    static const uint32_t kMinShift  = 12;     // 4 KB
+    static const uint32_t kBuckets   = 9;      // .. 1 MB
+    static const uint32_t kPerBucket = 16;
+
+    void init(FXE_BoCachePlatform* platform, uint64_t budgetBytes, uint64_t maxAgeNs) {
+        mPlatform = platform;
+        mBudget = budgetBytes;
+        mMaxAgeNs = maxAgeNs;
+        memset(mCount, 0, sizeof(mCount));
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    // Bucket whose objects hold `size` bytes, -1 if larger than any.
+    static int32_t bucketFor(uint64_t size) {
+        for (uint32_t b = 0; b < kBuckets; ++b)
+            if (size <= bucketBytes(b)) return (int32_t)b;
+        return -1;
+    }
+
+    static uint64_t bucketBytes(uint32_t b) { return 1ULL << (kMinShift + b); }
+
+    // Allocation size to use for `size` so the object can come back here.
+    static uint64_t roundUp(uint64_t size) {
+        const int32_t b = bucketFor(size);
+        return b < 0 ? size : bucketBytes((uint32_t)b);
+    }
+
+    // A cached object of at least `size` bytes (its bucket), or null.
+    void* get(uint64_t size) {
+        mStats.lookups++;
+        const int32_t b = bucketFor(size);
+        if (b < 0 || !mCount[b]) return nullptr;
+        Entry& e = mEntry[b][--mCount[b]];
+        mStats.hits++;
+        mStats.bytesCached -= bucketBytes((uint32_t)b);
+        return e.obj;
+    }
+
+    // Park obj, which holds exactly `bytes`. Returns false (obj untouched,
+    // the caller frees it) if that is not a bucket size or the budget is 0.
+    bool put(void* obj, uint64_t bytes, uint64_t nowNs) {
+        const int32_t b = bucketFor(bytes);
+        if (!obj || b < 0 || bucketBytes((uint32_t)b) != bytes || bytes > mBudget) {
+            mStats.rejects++;
+            return false;
+        }
+        if (mCount[b] == kPerBucket) {
+            dropOldest((uint32_t)b);
+            mStats.evictedBudget++;
+        }
+        while (mStats.bytesCached + bytes > mBudget && dropOldest()) mStats.evictedBudget++;
+
+        Entry& e = mEntry[b][mCount[b]++];
+        e.obj = obj;
+        e.parkedNs = nowNs;
+        mStats.puts++;
+        mStats.bytesCached += bytes;
+        if (mStats.bytesCached > mStats.peakBytesCached) mStats.peakBytesCached = mStats.bytesCached;
+        return true;
+    }
+
+    // Drop everything parked for longer than maxAgeNs. Returns the count.
+    uint32_t reap(uint64_t nowNs) {
+        uint32_t n = 0;
+        for (uint32_t b = 0; b < kBuckets; ++b) {
+            while (mCount[b] && nowNs - mEntry[b][0].parkedNs > mMaxAgeNs) {
+                dropOldest(b);
+                n++;
+            }
+        }
+        mStats.evictedAge += n;
+        return n;
+    }
+
+    // Drop oldest-first until at most `keepBytes` stay cached (0 = all).
+    uint32_t trim(uint64_t keepBytes) {
+        uint32_t n = 0;
+        while (mStats.bytesCached > keepBytes && dropOldest()) n++;
+        mStats.evictedTrim += n;
+        return n;
+    }
+
+    uint32_t count() const {
+        uint32_t n = 0;
+        for (uint32_t b = 0; b < kBuckets; ++b) n += mCount[b];
+        return n;
+    }
+
+    uint32_t hitRatePermille() const {
+        return mStats.lookups ? (uint32_t)(mStats.hits * 1000 / mStats.lookups) : 0;
+    }
+
+    const FXE_BoCacheStats& stats() const { return mStats; }
+
+private:
+    struct Entry { void* obj; uint64_t parkedNs; };
+
+    void dropOldest(uint32_t b) {
+        void* obj = mEntry[b][0].obj;
+        memmove(&mEntry[b][0], &mEntry[b][1], (size_t)(mCount[b] - 1) * sizeof(Entry));
+        mCount[b]--;
+        mStats.bytesCached -= bucketBytes(b);
+        if (mPlatform) mPlatform->release(obj);
+    }
+
+    // Oldest entry across all buckets; false if the cache is empty.
+    bool dropOldest() {
+        int32_t oldest = -1;
+        for (uint32_t b = 0; b < kBuckets; ++b)
+            if (mCount[b] && (oldest < 0 || mEntry[b][0].parkedNs < mEntry[oldest][0].parkedNs))
+                oldest = (int32_t)b;
+        if (oldest < 0) return false;
+        dropOldest((uint32_t)oldest);
+        return true;
+    }
+
+    FXE_BoCachePlatform* mPlatform;
+    uint64_t             mBudget;
+    uint64_t             mMaxAgeNs;
+    Entry                mEntry[kBuckets][kPerBucket];
+    uint32_t             mCount[kBuckets];
+    FXE_BoCacheStats     mStats;
+};
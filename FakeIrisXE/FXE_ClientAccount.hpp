@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// Per-client GPU memory accounting.
+//
+// One account per user-client connection. Every GEM the client creates
+// charges its size to `allocated` for as long as it lives, and every GGTT
+// binding of such a GEM charges its range to `mapped` until it is unbound;
+// contexts and surfaces are counted too. Peaks are kept so a client that
+// spiked and released is still visible.
+//
+// Optional quotas apply to each byte counter separately. Going over the
+// soft limit still succeeds but tells the caller to evict the client's
+// own idle mappings; a charge that would go over the hard limit is
+// refused and nothing is charged.
+//
+// Counters are atomic: GEMs are freed and unbound from whatever thread
+// drops the last reference, and the kext publishes them from a timer.
+// Owned by FakeIrisXEClientAccount, which also owns its lifetime.
+//
+
+enum FXE_Charge {
+    FXE_CHARGE_OK       = 0,
+    FXE_CHARGE_SOFT     = 1,    // charged, over the soft quota
+    FXE_CHARGE_DENIED   = 2,    // over the hard quota, not charged
+};
+
+struct FXE_AccountStats {
+    uint64_t allocated;         // bytes of live GEMs
+    uint64_t mapped;            // bytes bound in the GGTT
+    uint64_t peakAllocated;
+    uint64_t peakMapped;
+    uint64_t softHits;          // charges that went over the soft quota
+    uint64_t denied;            // charges refused by the hard quota
+    uint32_t objects;
+    uint32_t contexts;
+    uint32_t surfaces;
+};
+
+class FXE_ClientAccount {
+public:
+    enum Counter { kAllocated = 0, kMapped = 1 };
+
+    void init(uint32_t pid, const char* name) {
+        memset(&mStats, 0, sizeof(mStats));
+        mSoft = 0;
+        mHard = 0;
+        mPid = pid;
+        memset(mName, 0, sizeof(mName));
+        if (name) strncpy(mName, name, sizeof(mName) - 1);
+    }
+
+    // 0 disables a limit. A soft limit at or above the hard one is unused.
+    void setQuota(uint64_t softBytes, uint64_t hardBytes) {
+        mSoft = softBytes;
+        mHard = hardBytes;
+    }
+
+    FXE_Charge chargeAlloc(uint64_t bytes) {
+        const FXE_Charge r = charge(kAllocated, bytes);
+        if (r != FXE_CHARGE_DENIED) __atomic_fetch_add(&mStats.objects, 1, __ATOMIC_RELAXED);
+        return r;
+    }
+    void unchargeAlloc(uint64_t bytes) {
+        uncharge(kAllocated, bytes);
+        __atomic_fetch_sub(&mStats.objects, 1, __ATOMIC_RELAXED);
+    }
+
+    FXE_Charge chargeMap(uint64_t bytes) { return charge(kMapped, bytes); }
+    void unchargeMap(uint64_t bytes) { uncharge(kMapped, bytes); }
+
+    void addContext()    { __atomic_fetch_add(&mStats.contexts, 1, __ATOMIC_RELAXED); }
+    void removeContext() { __atomic_fetch_sub(&mStats.contexts, 1, __ATOMIC_RELAXED); }
+    void addSurface()    { __atomic_fetch_add(&mStats.surfaces, 1, __ATOMIC_RELAXED); }
+    void removeSurface() { __atomic_fetch_sub(&mStats.surfaces, 1, __ATOMIC_RELAXED); }
+
+    // How far the mapped bytes are above the soft quota (0 if not).
+    uint64_t mappedOverSoft() const {
+        const uint64_t m = __atomic_load_n(&mStats.mapped, __ATOMIC_RELAXED);
+        return mSoft && m > mSoft ? m - mSoft : 0;
+    }
+
+    // A consistent-enough copy for publishing.
+    FXE_AccountStats stats() const {
+        FXE_AccountStats s;
+        s.allocated     = __atomic_load_n(&mStats.allocated, __ATOMIC_RELAXED);
+        s.mapped        = __atomic_load_n(&mStats.mapped, __ATOMIC_RELAXED);
+        s.peakAllocated = __atomic_load_n(&mStats.peakAllocated, __ATOMIC_RELAXED);
+        s.peakMapped    = __atomic_load_n(&mStats.peakMapped, __ATOMIC_RELAXED);
+        s.softHits      = __atomic_load_n(&mStats.softHits, __ATOMIC_RELAXED);
+        s.denied        = __atomic_load_n(&mStats.denied, __ATOMIC_RELAXED);
+        s.objects       = __atomic_load_n(&mStats.objects, __ATOMIC_RELAXED);
+        s.contexts      = __atomic_load_n(&mStats.contexts, __ATOMIC_RELAXED);
+        s.surfaces      = __atomic_load_n(&mStats.surfaces, __ATOMIC_RELAXED);
+        return s;
+    }
+
+    uint32_t pid() const { return mPid; }
+    const char* name() const { return mName; }
+    uint64_t softQuota() const { return mSoft; }
+    uint64_t hardQuota() const { return mHard; }
+
+private:
+    uint64_t* counter(Counter c) { return c == kAllocated ? &mStats.allocated : &mStats.mapped; }
+    uint64_t* peak(Counter c) { return c == kAllocated ? &mStats.peakAllocated : &mStats.peakMapped; }
+
+    FXE_Charge charge(Counter c, uint64_t bytes) {
+        uint64_t* v = counter(c);
+        uint64_t cur = __atomic_load_n(v, __ATOMIC_RELAXED);
+        uint64_t next;
+        do {
+            next = cur + bytes;
+            if (mHard && next > mHard) {
+                __atomic_fetch_add(&mStats.denied, 1, __ATOMIC_RELAXED);
+                return FXE_CHARGE_DENIED;
+            }
+        } while (!__atomic_compare_exchange_n(v, &cur, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+        uint64_t* p = peak(c);
+        uint64_t pk = __atomic_load_n(p, __ATOMIC_RELAXED);
+        while (next > pk && !__atomic_compare_exchange_n(p, &pk, next, true, __ATOMIC_RELAXED,
+                                                         __ATOMIC_RELAXED)) {}
+        if (mSoft && next > mSoft && (!mHard || mSoft < mHard)) {
+            __atomic_fetch_add(&mStats.softHits, 1, __ATOMIC_RELAXED);
+            return FXE_CHARGE_SOFT;
+        }
+        return FXE_CHARGE_OK;
+    }
+
+    void uncharge(Counter c, uint64_t bytes) {
+        __atomic_fetch_sub(counter(c), bytes, __ATOMIC_RELAXED);
+    }
+
+    FXE_AccountStats mStats;
+    uint64_t mSoft;
+    uint64_t mHard;
+    uint32_t mPid;
+    char     mName[32];
+};
@@ -0,0 +1,529 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "FXE_ExecCore.hpp"
+
+//
+// Deterministic software model of one execlist engine, for driving
+// FXE_ExecCore / FakeIrisXEExeclist without Tiger Lake hardware.
+//
+// - MMIO: a small register file; writes to the ELSP/preempt/CSB address
+//   registers of the configured FXE_EngineRegs have engine side effects.
+// - GGTT: ggttMap() hands out 4 KB aligned addresses for CPU buffers and
+//   resolve() maps them back, so descriptors, LRCs and the CSB live in
+//   ordinary host memory.
+// - Execution: two ELSP elements in flight, only the head executes; each
+//   runs for execNs(ctxId, seqno) of simulated time (minus what it had
+//   already done before a preemption), then the descriptor's post-sync
+//   value is stored (if it has an address) and a COMPLETE CSB is written.
+//   Rings are not parsed: the descriptor repeats the batch and breadcrumb
+//   of the request's ring commands (FXE_RequestCmds).
+// - Semaphore: the descriptor copy of the ring's MI_SEMAPHORE_WAIT holds
+//   the head element, polled every kSemaphorePollNs, until the qword at
+//   its address is >= its value.
+//   ggttMapAt() places a buffer at a fixed address, e.g. another model's
+//   timeline page, so two models can wait on each other's breadcrumbs.
+// - Preempt-to-idle: after preemptLatencyNs every in-flight element is
+//   switched out, its progress saved to the LRC ring head (µs units at
+//   LRC+0x100) and a PREEMPTED CSB written.
+// - Faults: injectFault() makes the next runs of a context fault halfway.
+// - Hangs: injectHang() makes the next runs of a context stop halfway;
+//   RING_HEAD (progress of the running element, µs) freezes, nothing
+//   completes and preempt-to-idle is never acknowledged.
+// - CSB: entries are written after the last one the driver's read pointer
+//   (CSB pointer register, 11:8) released; the write pointer (3:0) names
+//   the newest entry and is mirrored to the status page at HWS_PGA.
+// - Reset: RESET_CTL request reports ready at once; setting the engine's
+//   GDRST bit drops everything in flight, restarts the CSB write pointer
+//   and self-clears.
+//
+// Time only moves in advanceTo(); nothing here reads a real clock.
+//
+
+struct FXE_EngineModelStats {
+    uint64_t elspSubmits;
+    uint64_t elspOverflow;     // submit with both elements already in flight
+    uint64_t completed;
+    uint64_t faulted;
+    uint64_t preempted;        // elements switched out
+    uint64_t preemptRequests;
+    uint64_t csbWrites;
+    uint64_t csbOverflow;      // CSB full (driver read pointer behind) when written
+    uint64_t badDescriptor;
+    uint64_t hung;
+    uint64_t resets;
+    uint64_t postSyncs;
+    uint64_t badPostSync;      // post-sync address not mapped
+    uint64_t semaphoreWaits;   // elements that had to wait on their semaphore
+    uint64_t badSemaphore;     // semaphore address not mapped (treated as met)
+    uint64_t busyNs;
+};
+
+class FXE_EngineModel : public FXE_EngineIO {
+public:
+    static const uint32_t kLrcRingHeadOffset = 0x100;
+    static const uint32_t kMaxRegs     = 64;
+    static const uint32_t kMaxMappings = 512;
+    static const uint32_t kMaxContexts = 64;
+    static const uint32_t kInflight    = 2;
+    static const uint64_t kGgttBase    = 0x100000;
+    static const uint64_t kSemaphorePollNs = 1000;
+
+    void init(const FXE_EngineRegs& regs, uint64_t ggttBase = kGgttBase) {
+        mRegs = regs;
+        memset(mReg, 0, sizeof(mReg));
+        mRegCount = 0;
+        memset(mMap, 0, sizeof(mMap));
+        mMapCount = 0;
+        mNextGGTT = ggttBase;
+        memset(mCtx, 0, sizeof(mCtx));
+        memset(mElem, 0, sizeof(mElem));
+        mElemCount = 0;
+        memset(&mStats, 0, sizeof(mStats));
+        mNow = 0;
+        mIrq = 0;
+        setCsbEntries(16);
+        mPreemptAt = UINT64_MAX;
+        mInjectPreemptAt = UINT64_MAX;
+        mDefaultExecNs = 100000;
+        mSwitchNs = 2000;
+        mPreemptLatencyNs = 20000;
+    }
+
+    virtual ~FXE_EngineModel() {}
+
+    // ---- configuration ----
+    void setDefaultExecNs(uint64_t ns) { mDefaultExecNs = ns; }
+    void setSwitchNs(uint64_t ns) { mSwitchNs = ns; }
+    void setPreemptLatencyNs(uint64_t ns) { mPreemptLatencyNs = ns; }
+    void setCsbEntries(uint32_t n) {
+        mCsbEntries = n < FXE_CSB_MAX_ENTRIES ? n : FXE_CSB_MAX_ENTRIES;
+        resetCsbPointers();
+    }
+    void setExecNs(uint32_t ctxId, uint64_t ns) {
+        if (Ctx* c = context(ctxId, true)) c->execNs = ns;
+    }
+    // The next `count` runs of ctxId fault halfway through.
+    void injectFault(uint32_t ctxId, uint32_t count) {
+        if (Ctx* c = context(ctxId, true)) c->faultsPending += count;
+    }
+    // The next `count` runs of ctxId stop making progress halfway.
+    void injectHang(uint32_t ctxId, uint32_t count) {
+        if (Ctx* c = context(ctxId, true)) c->hangsPending += count;
+    }
+    // Preempt-to-idle at an absolute time, as if another agent requested it.
+    void injectPreemptAt(uint64_t ns) { mInjectPreemptAt = ns; }
+
+    // Simulated execution time of one request; override for per-request work.
+    virtual uint64_t execNs(uint32_t ctxId, uint32_t /*seqno*/) {
+        Ctx* c = context(ctxId, false);
+        return (c && c->execNs) ? c->execNs : mDefaultExecNs;
+    }
+
+    // ---- FXE_EngineIO ----
+    uint32_t read32(uint32_t off) override {
+        if (off == mRegs.ringHead)
+            return liveHead();
+        if (off == mRegs.csbPtr)
+            return (mCsbRd << CSB_PTR_READ_SHIFT) | mCsbWp;
+        uint32_t* r = reg(off, false);
+        return r ? *r : 0;
+    }
+
+    void write32(uint32_t off, uint32_t val) override {
+        if (uint32_t* r = reg(off, true)) *r = val;
+
+        if (off == mRegs.sqContents && (val & 1)) {
+            const uint64_t desc = ((uint64_t)read32(mRegs.submitHi) << 32) | read32(mRegs.submitLo);
+            submit(desc);
+            if (uint32_t* r = reg(off, false)) *r = 0;   // consumed
+        } else if (off == mRegs.preempt && (val & EXECLIST_PREEMPT_TO_IDLE)) {
+            mStats.preemptRequests++;
+            if (mPreemptAt == UINT64_MAX)
+                mPreemptAt = mNow + mPreemptLatencyNs;
+            if (uint32_t* r = reg(off, false)) *r = 0;
+        } else if (off == mRegs.csbPtr) {
+            // masked; only the read pointer is driver-writable
+            if ((val >> 16) & (CSB_PTR_WRITE_MASK << CSB_PTR_READ_SHIFT)) {
+                const uint32_t rd = (val >> CSB_PTR_READ_SHIFT) & CSB_PTR_WRITE_MASK;
+                if (rd < mCsbEntries) {
+                    mCsbPending -= (rd + mCsbEntries - mCsbRd) % mCsbEntries;
+                    mCsbRd = rd;
+                }
+            }
+        } else if (off == mRegs.hwsPga) {
+            publishCsbWritePointer();
+        } else if (off == mRegs.resetCtl) {
+            // masked register: high half selects the bits to change
+            uint32_t* r = reg(off, true);
+            if ((val >> 16) & RESET_CTL_REQUEST_RESET)
+                *r = (val & RESET_CTL_REQUEST_RESET) ? RESET_CTL_READY_TO_RESET : 0;
+        } else if (off == GEN6_GDRST && (val & mRegs.resetDomain)) {
+            reset();
+            if (uint32_t* r = reg(off, false)) *r &= ~mRegs.resetDomain;
+        }
+    }
+
+    uint64_t ggttMap(void* cpu, uint64_t bytes) override {
+        if (!cpu || !bytes) return 0;
+        for (uint32_t i = 0; i < mMapCount; ++i) {
+            if (mMap[i].cpu == cpu && mMap[i].bytes >= bytes) return mMap[i].ggtt;
+        }
+        if (mMapCount >= kMaxMappings) return 0;
+        Mapping& m = mMap[mMapCount++];
+        m.cpu = (uint8_t*)cpu;
+        m.bytes = bytes;
+        m.ggtt = mNextGGTT;
+        mNextGGTT += (bytes + 0xFFFULL) & ~0xFFFULL;
+        return m.ggtt;
+    }
+
+    // Map `cpu` at a caller-chosen address (outside the range ggttMap()
+    // hands out).
+    bool ggttMapAt(void* cpu, uint64_t bytes, uint64_t ggtt) {
+        if (!cpu || !bytes || mMapCount >= kMaxMappings) return false;
+        Mapping& m = mMap[mMapCount++];
+        m.cpu = (uint8_t*)cpu;
+        m.bytes = bytes;
+        m.ggtt = ggtt;
+        return true;
+    }
+
+    void* resolve(uint64_t ggtt, uint64_t bytes) const {
+        for (uint32_t i = 0; i < mMapCount; ++i) {
+            const Mapping& m = mMap[i];
+            if (ggtt >= m.ggtt && ggtt + bytes <= m.ggtt + m.bytes)
+                return m.cpu + (ggtt - m.ggtt);
+        }
+        return nullptr;
+    }
+
+    // ---- time ----
+    uint64_t now() const { return mNow; }
+
+    uint64_t nextEventNs() const {
+        uint64_t t = mPreemptAt < mInjectPreemptAt ? mPreemptAt : mInjectPreemptAt;
+        if (mElemCount && mElem[0].semWait) {
+            if (mNow + kSemaphorePollNs < t) t = mNow + kSemaphorePollNs;
+        } else if (mElemCount && !mElem[0].hung) {
+            const Elem& h = mElem[0];
+            uint64_t done = h.startAt + h.remainingNs;
+            if (h.faultAt != UINT64_MAX) done = h.faultAt;
+            if (h.hangAt != UINT64_MAX) done = h.hangAt;
+            if (done < t) t = done;
+        }
+        return t;
+    }
+
+    // Run every engine event up to and including `ns`.
+    void advanceTo(uint64_t ns) {
+        for (;;) {
+            const uint64_t t = nextEventNs();
+            if (t == UINT64_MAX || t > ns) break;
+            mNow = t > mNow ? t : mNow;
+            step();
+        }
+        if (ns > mNow) {
+            accountBusy(ns);
+            mNow = ns;
+        }
+    }
+
+    // Pending interrupt bits (RCS_INTR_*), cleared on read.
+    uint32_t takeIrq() {
+        uint32_t v = mIrq;
+        mIrq = 0;
+        return v;
+    }
+
+    bool idle() const { return mElemCount == 0 && mPreemptAt == UINT64_MAX; }
+    uint32_t inflight() const { return mElemCount; }
+    const FXE_EngineModelStats& stats() const { return mStats; }
+
+private:
+    struct Reg { uint32_t off; uint32_t val; };
+    struct Mapping { uint8_t* cpu; uint64_t bytes; uint64_t ggtt; };
+    struct Ctx { uint32_t ctxId; uint32_t faultsPending; uint32_t hangsPending; uint64_t execNs; bool used; };
+    struct Elem {
+        uint32_t ctxId;
+        uint32_t seqno;
+        uint64_t lrcGGTT;
+        uint64_t postGGTT;      // completion breadcrumb, 0 = none
+        uint64_t postValue;
+        uint64_t execNs;
+        uint64_t doneNs;        // progress restored from the LRC on submit
+        uint64_t remainingNs;
+        uint64_t startAt;       // valid for the head element only
+        uint64_t faultAt;       // UINT64_MAX = no fault this run
+        uint64_t hangAt;        // UINT64_MAX = no hang this run
+        uint64_t busyFrom;
+        uint64_t semGGTT;       // 0 = no semaphore
+        uint64_t semValue;
+        bool     semWait;       // head, waiting for the semaphore
+        bool     hung;
+    };
+
+    uint32_t* reg(uint32_t off, bool create) {
+        for (uint32_t i = 0; i < mRegCount; ++i)
+            if (mReg[i].off == off) return &mReg[i].val;
+        if (!create || mRegCount >= kMaxRegs) return nullptr;
+        mReg[mRegCount].off = off;
+        mReg[mRegCount].val = 0;
+        return &mReg[mRegCount++].val;
+    }
+
+    Ctx* context(uint32_t ctxId, bool create) {
+        Ctx* freeEntry = nullptr;
+        for (uint32_t i = 0; i < kMaxContexts; ++i) {
+            if (mCtx[i].used && mCtx[i].ctxId == ctxId) return &mCtx[i];
+            if (!mCtx[i].used && !freeEntry) freeEntry = &mCtx[i];
+        }
+        if (!create || !freeEntry) return nullptr;
+        memset(freeEntry, 0, sizeof(*freeEntry));
+        freeEntry->used = true;
+        freeEntry->ctxId = ctxId;
+        return freeEntry;
+    }
+
+    uint32_t* lrcHead(uint64_t lrcGGTT) {
+        return (uint32_t*)resolve(lrcGGTT + kLrcRingHeadOffset, sizeof(uint32_t));
+    }
+
+    void submit(uint64_t descGGTT) {
+        const uint32_t* d = (const uint32_t*)resolve(descGGTT, FXE_ELSP_DESC_DWORDS * 4);
+        if (!d || !(d[3] & FXE_ELSP_DESC_VALID)) {
+            mStats.badDescriptor++;
+            return;
+        }
+        if (mElemCount >= kInflight) {
+            mStats.elspOverflow++;
+            return;
+        }
+        mStats.elspSubmits++;
+
+        Elem& e = mElem[mElemCount];
+        memset(&e, 0, sizeof(e));
+        e.lrcGGTT = ((uint64_t)d[1] << 32) | d[0];
+        e.ctxId   = d[2];
+        e.seqno   = d[6];
+        e.postGGTT  = ((uint64_t)d[9] << 32) | d[8];
+        e.postValue = ((uint64_t)d[11] << 32) | d[10];
+        e.semGGTT   = ((uint64_t)d[13] << 32) | d[12];
+        e.semValue  = ((uint64_t)d[15] << 32) | d[14];
+        e.execNs  = execNs(e.ctxId, e.seqno);
+
+        uint32_t* head = lrcHead(e.lrcGGTT);
+        e.doneNs = head ? (uint64_t)*head * 1000 : 0;
+        if (e.doneNs > e.execNs) e.doneNs = e.execNs;
+        e.remainingNs = e.execNs - e.doneNs;
+        e.faultAt = UINT64_MAX;
+        e.hangAt = UINT64_MAX;
+
+        if (mElemCount++ == 0)
+            begin(mNow);
+    }
+
+    void begin(uint64_t at) {
+        Elem& h = mElem[0];
+        if (!semaphoreMet(h)) {
+            if (!h.semWait) mStats.semaphoreWaits++;
+            h.semWait = true;
+            h.startAt = h.busyFrom = UINT64_MAX;
+            h.faultAt = h.hangAt = UINT64_MAX;
+            return;
+        }
+        h.semWait = false;
+        h.startAt = at + mSwitchNs;
+        h.busyFrom = h.startAt;
+        h.faultAt = UINT64_MAX;
+        h.hangAt = UINT64_MAX;
+        Ctx* c = context(h.ctxId, false);
+        if (c && c->hangsPending)
+            h.hangAt = h.startAt + h.remainingNs / 2;
+        else if (c && c->faultsPending)
+            h.faultAt = h.startAt + h.remainingNs / 2;
+    }
+
+    bool semaphoreMet(const Elem& e) {
+        if (!e.semGGTT) return true;
+        const volatile uint64_t* p = (const volatile uint64_t*)resolve(e.semGGTT, sizeof(uint64_t));
+        if (!p) {
+            mStats.badSemaphore++;
+            return true;
+        }
+        return *p >= e.semValue;
+    }
+
+    // Progress of the running element in µs; frozen while hung.
+    uint32_t liveHead() const {
+        if (!mElemCount) return 0;
+        const Elem& h = mElem[0];
+        uint64_t at = mNow;
+        if (h.hangAt != UINT64_MAX && at > h.hangAt) at = h.hangAt;
+        uint64_t done = h.doneNs;
+        if (at > h.startAt) {
+            const uint64_t ran = at - h.startAt;
+            done += ran < h.remainingNs ? ran : h.remainingNs;
+        }
+        return (uint32_t)(done / 1000);
+    }
+
+    void reset() {
+        accountBusy(mNow);
+        mElemCount = 0;
+        mPreemptAt = UINT64_MAX;
+        resetCsbPointers();
+        mIrq = 0;
+        mStats.resets++;
+    }
+
+    void accountBusy(uint64_t until) {
+        if (!mElemCount) return;
+        Elem& h = mElem[0];
+        if (until > h.busyFrom) {
+            mStats.busyNs += until - h.busyFrom;
+            h.busyFrom = until;
+        }
+    }
+
+    void step() {
+        const uint64_t preemptAt = mPreemptAt < mInjectPreemptAt ? mPreemptAt : mInjectPreemptAt;
+
+        if (mElemCount && mElem[0].semWait) {
+            begin(mNow);    // poll; preemption below still applies
+        } else if (mElemCount) {
+            Elem& h = mElem[0];
+            const uint64_t doneAt = h.startAt + h.remainingNs;
+            if (h.hangAt != UINT64_MAX && h.hangAt <= mNow && !h.hung) {
+                accountBusy(h.hangAt);
+                if (Ctx* c = context(h.ctxId, false)) c->hangsPending--;
+                h.hung = true;
+                mStats.hung++;
+            }
+            if (h.hung) {
+                // Wedged: no completion and preempt requests go unanswered
+                if (preemptAt <= mNow) {
+                    if (mPreemptAt <= mNow) mPreemptAt = UINT64_MAX;
+                    if (mInjectPreemptAt <= mNow) mInjectPreemptAt = UINT64_MAX;
+                }
+                return;
+            }
+            if (h.faultAt != UINT64_MAX && h.faultAt <= mNow && h.faultAt <= preemptAt) {
+                accountBusy(mNow);
+                if (Ctx* c = context(h.ctxId, false)) c->faultsPending--;
+                if (uint32_t* head = lrcHead(h.lrcGGTT)) *head = 0;
+                writeCsb(h.ctxId, FXE_CSB_FAULT);
+                mStats.faulted++;
+                mIrq |= RCS_INTR_FAULT;
+                pop();
+                return;
+            }
+            if (h.faultAt == UINT64_MAX && doneAt <= mNow && doneAt <= preemptAt) {
+                accountBusy(mNow);
+                if (uint32_t* head = lrcHead(h.lrcGGTT)) *head = 0;
+                postSync(h);
+                writeCsb(h.ctxId, FXE_CSB_COMPLETE);
+                mStats.completed++;
+                mIrq |= RCS_INTR_COMPLETE;
+                pop();
+                return;
+            }
+        }
+
+        if (preemptAt <= mNow) {
+            if (mPreemptAt <= mNow) mPreemptAt = UINT64_MAX;
+            if (mInjectPreemptAt <= mNow) mInjectPreemptAt = UINT64_MAX;
+            preemptAll();
+        }
+    }
+
+    void pop() {
+        for (uint32_t i = 1; i < mElemCount; ++i) mElem[i - 1] = mElem[i];
+        if (--mElemCount)
+            begin(mNow);
+    }
+
+    // Save progress of everything in flight to its LRC and go idle.
+    void preemptAll() {
+        if (!mElemCount) return;
+        accountBusy(mNow);
+        for (uint32_t i = 0; i < mElemCount; ++i) {
+            Elem& e = mElem[i];
+            uint64_t done = e.doneNs;
+            if (i == 0 && mNow > e.startAt) {
+                const uint64_t ran = mNow - e.startAt;
+                done += ran < e.remainingNs ? ran : e.remainingNs;
+            }
+            if (uint32_t* head = lrcHead(e.lrcGGTT)) *head = (uint32_t)(done / 1000);
+            writeCsb(e.ctxId, FXE_CSB_PREEMPTED);
+            mStats.preempted++;
+        }
+        mElemCount = 0;
+        mIrq |= RCS_INTR_CTX_SWITCH;
+    }
+
+    void postSync(const Elem& e) {
+        if (!e.postGGTT) return;
+        volatile uint64_t* p = (volatile uint64_t*)resolve(e.postGGTT, sizeof(uint64_t));
+        if (!p) {
+            mStats.badPostSync++;
+            return;
+        }
+        *p = e.postValue;
+        mStats.postSyncs++;
+    }
+
+    void resetCsbPointers() {
+        mCsbWp = mCsbRd = mCsbEntries ? mCsbEntries - 1 : 0;
+        mCsbPending = 0;
+        publishCsbWritePointer();
+    }
+
+    void publishCsbWritePointer() {
+        const uint64_t hws = read32(mRegs.hwsPga) & ~0xFFFu;
+        if (!hws) return;
+        if (volatile uint32_t* p = (volatile uint32_t*)resolve(hws + HWS_CSB_WRITE_INDEX * 4, 4))
+            *p = mCsbWp;
+    }
+
+    void writeCsb(uint32_t ctxId, uint32_t status) {
+        const uint64_t base = ((uint64_t)read32(mRegs.csbAddrHi) << 32) | read32(mRegs.csbAddrLo);
+        const uint32_t slot = mCsbWp + 1 == mCsbEntries ? 0 : mCsbWp + 1;
+        volatile uint64_t* e = (volatile uint64_t*)resolve(base + (uint64_t)slot * 16, 16);
+        if (!e || mCsbPending >= mCsbEntries) {
+            mStats.csbOverflow++;
+            return;
+        }
+        e[1] = status;
+        e[0] = ctxId;
+        mCsbWp = slot;
+        mCsbPending++;
+        publishCsbWritePointer();
+        mStats.csbWrites++;
+    }
+
+    FXE_EngineRegs       mRegs;
+    Reg                  mReg[kMaxRegs];
+    uint32_t             mRegCount;
+    Mapping              mMap[kMaxMappings];
+    uint32_t             mMapCount;
+    uint64_t             mNextGGTT;
+    Ctx                  mCtx[kMaxContexts];
+    Elem                 mElem[kInflight];
+    uint32_t             mElemCount;
+    FXE_EngineModelStats mStats;
+    uint64_t             mNow;
+    uint32_t             mIrq;
+    uint32_t             mCsbEntries;
+    uint32_t             mCsbWp;          // last entry written
+    uint32_t             mCsbRd;          // driver's read pointer
+    uint32_t             mCsbPending;     // written, not yet released
+    uint64_t             mPreemptAt;
+    uint64_t             mInjectPreemptAt;
+    uint64_t             mDefaultExecNs;
+    uint64_t             mSwitchNs;
+    uint64_t             mPreemptLatencyNs;
+};
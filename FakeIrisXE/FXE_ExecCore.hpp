@@ -0,0 +1,851 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "FXE_Sched.hpp"
+#include "FXE_Timeline.hpp"
+#include "i915_reg.h"
+
+//
+// Execlist control logic for one engine: ELSP submission, CSB drain,
+// completion / preemption / fault handling, context banning and the hang
+// watchdog (per-engine reset with replay of innocent requests).
+//
+// Everything that touches the platform (MMIO, clock, LRC memory, buffer
+// lifetime, logging) goes through FXE_ExecPlatform, so the same code runs
+// inside FakeIrisXEExeclist against real hardware and on a host against
+// FXE_EngineModel. The caller serialises all calls.
+//
+
+// Register block of one execlist engine.
+struct FXE_EngineRegs {
+    uint32_t submitLo;
+    uint32_t submitHi;
+    uint32_t sqContents;
+    uint32_t preempt;
+    uint32_t csbAddrLo;
+    uint32_t csbAddrHi;
+    uint32_t csbPtr;
+    uint32_t hwsPga;
+    uint32_t ringHead;      // progress probe for the hang watchdog
+    uint32_t resetCtl;
+    uint32_t resetDomain;   // GEN6_GDRST bit of this engine
+    bool     pipeControl;   // breadcrumb by PIPE_CONTROL (render), else MI_FLUSH_DW
+
+    static FXE_EngineRegs rcs0() {
+        FXE_EngineRegs r;
+        r.submitLo   = RCS0_EXECLIST_SUBMITPORT_LO;
+        r.submitHi   = RCS0_EXECLIST_SUBMITPORT_HI;
+        r.sqContents = RCS0_EXECLIST_SQ_CONTENTS;
+        r.preempt    = RCS0_EXECLIST_PREEMPT;
+        r.csbAddrLo  = RCS0_CSB_ADDR_LO;
+        r.csbAddrHi  = RCS0_CSB_ADDR_HI;
+        r.csbPtr     = RCS0_CSB_PTR;
+        r.hwsPga     = RCS0_HWS_PGA;
+        r.ringHead   = RCS0_RING_HEAD;
+        r.resetCtl   = RING_RESET_CTL(TGL_RCS0_BASE);
+        r.resetDomain = GEN11_GRDOM_RENDER;
+        r.pipeControl = true;
+        return r;
+    }
+
+    static FXE_EngineRegs bcs0() {
+        FXE_EngineRegs r;
+        r.submitLo   = BCS0_EXECLIST_SUBMITPORT_LO;
+        r.submitHi   = BCS0_EXECLIST_SUBMITPORT_HI;
+        r.sqContents = BCS0_EXECLIST_SQ_CONTENTS;
+        r.preempt    = BCS0_EXECLIST_PREEMPT;
+        r.csbAddrLo  = BCS0_CSB_ADDR_LO;
+        r.csbAddrHi  = BCS0_CSB_ADDR_HI;
+        r.csbPtr     = BCS0_CSB_PTR;
+        r.hwsPga     = BCS0_HWS_PGA;
+        r.ringHead   = BCS0_RING_HEAD;
+        r.resetCtl   = RING_RESET_CTL(TGL_BCS0_BASE);
+        r.resetDomain = GEN11_GRDOM_BLT;
+        r.pipeControl = false;
+        return r;
+    }
+};
+
+// CSB entry: 16 bytes, low qword = ctxId, high qword = status. At most
+// FXE_CSB_MAX_ENTRIES (the width of the write pointer field).
+enum : uint32_t {
+    FXE_CSB_COMPLETE  = 1u << 0,
+    FXE_CSB_PREEMPTED = 1u << 1,
+    FXE_CSB_FAULT     = 1u << 2,
+    FXE_EXEC_DEP_ERROR = 1u << 29,   // with CANCELLED: an input fence failed
+    FXE_EXEC_HANG      = 1u << 30,   // retire() status for the request an engine reset skipped
+    FXE_EXEC_CANCELLED = 1u << 31,   // retire() status for work dropped before it ran
+    FXE_CSB_MAX_ENTRIES = CSB_PTR_WRITE_MASK + 1,
+};
+
+// ELSP descriptor written to the per-port slot of the descriptor page:
+// d[0..1] LRC, d[2] ctxId, d[3] flags, d[4..5] batch, d[6] seqno,
+// d[8..9] post-sync GGTT address, d[10..11] 64-bit post-sync value,
+// d[12..13] semaphore GGTT address, d[14..15] semaphore value.
+// From d[4] on these only repeat what the request's ring commands
+// (FXE_RequestCmds) do, for FXE_EngineModel, which does not parse rings:
+// with a non-zero semaphore address the model holds the batch until the
+// qword there is >= the value, and it stores the post-sync value when the
+// request completes, before writing the COMPLETE CSB (no store on fault
+// or preemption).
+enum : uint32_t {
+    FXE_ELSP_DESC_DWORDS = 16,
+    FXE_ELSP_DESC_STRIDE = 64,
+    FXE_ELSP_DESC_VALID  = 1u << 0,
+    FXE_ELSP_DESC_ACTIVE = 1u << 1,
+};
+
+// Ring commands of one request, emitted into its context's ring before
+// the ELSP write: an optional semaphore wait on another engine's
+// breadcrumb, the batch, then a qword post-sync write of the breadcrumb
+// once the batch is done (PIPE_CONTROL with a CS stall on the render
+// engine, MI_FLUSH_DW on the copy engine). Padded to a qword so the ring
+// tail stays aligned.
+struct FXE_RequestCmds {
+    static const uint32_t kMaxDwords = 14;
+
+    // Poll the dword at addr until it is >= value. The engine compares the
+    // low dword only, so the caller must know the breadcrumb's high dword
+    // already matches (see FXE_ExecPlatform::semaphoreFor).
+    static uint32_t emitSemaphoreWait(uint32_t* cs, uint64_t addr, uint64_t value) {
+        cs[0] = MI_SEMAPHORE_WAIT | MI_SEMAPHORE_GLOBAL_GTT | MI_SEMAPHORE_POLL |
+                MI_SEMAPHORE_SAD_GTE_SDD;
+        cs[1] = (uint32_t)value;
+        cs[2] = (uint32_t)addr;
+        cs[3] = (uint32_t)(addr >> 32);
+        return 4;
+    }
+
+    static uint32_t emitBatchStart(uint32_t* cs, uint64_t batchGGTT) {
+        cs[0] = MI_BATCH_BUFFER_START;          // GGTT, 64-bit address
+        cs[1] = (uint32_t)batchGGTT;
+        cs[2] = (uint32_t)(batchGGTT >> 32);
+        return 3;
+    }
+
+    static uint32_t emitPostSync(uint32_t* cs, bool pipeControl, uint64_t addr, uint64_t value) {
+        if (pipeControl) {
+            cs[0] = GFX_OP_PIPE_CONTROL(6);
+            cs[1] = PIPE_CONTROL_CS_STALL | PIPE_CONTROL_RENDER_TARGET_CACHE_FLUSH |
+                    PIPE_CONTROL_DEPTH_CACHE_FLUSH | PIPE_CONTROL_DC_FLUSH_ENABLE |
+                    PIPE_CONTROL_POST_SYNC_WRITE | PIPE_CONTROL_GLOBAL_GTT_IVB;
+            cs[2] = (uint32_t)addr;
+            cs[3] = (uint32_t)(addr >> 32);
+            cs[4] = (uint32_t)value;
+            cs[5] = (uint32_t)(value >> 32);
+            return 6;
+        }
+        cs[0] = MI_FLUSH_DW | MI_FLUSH_DW_OP_STOREDW | 3;   // qword store: 5 dwords
+        cs[1] = (uint32_t)addr | MI_FLUSH_DW_USE_GTT;
+        cs[2] = (uint32_t)(addr >> 32);
+        cs[3] = (uint32_t)value;
+        cs[4] = (uint32_t)(value >> 32);
+        return 5;
+    }
+
+    // Whole request; semAddr 0 = no wait, postAddr 0 = no breadcrumb.
+    // Returns the dword count (even, at most kMaxDwords).
+    static uint32_t emit(uint32_t* cs, bool pipeControl, uint64_t semAddr, uint64_t semValue,
+                         uint64_t batchGGTT, uint64_t postAddr, uint64_t postValue) {
+        uint32_t n = 0;
+        if (semAddr)
+            n += emitSemaphoreWait(cs, semAddr, semValue);
+        n += emitBatchStart(cs + n, batchGGTT);
+        if (postAddr)
+            n += emitPostSync(cs + n, pipeControl, postAddr, postValue);
+        if (n & 1)
+            cs[n++] = MI_NOOP;
+        return n;
+    }
+};
+
+// Events reported to the platform for logging/accounting.
+enum : uint32_t {
+    FXE_EXEC_EV_QUEUED = 0,
+    FXE_EXEC_EV_SUBMIT,
+    FXE_EXEC_EV_RESUBMIT,
+    FXE_EXEC_EV_COMPLETE,
+    FXE_EXEC_EV_PREEMPT_QUANTUM,
+    FXE_EXEC_EV_PREEMPT_PRIORITY,
+    FXE_EXEC_EV_PREEMPTED,
+    FXE_EXEC_EV_FAULT,
+    FXE_EXEC_EV_BANNED,
+    FXE_EXEC_EV_CANCELLED,
+    FXE_EXEC_EV_STALE_CSB,
+    FXE_EXEC_EV_HANG,           // no progress for the hang timeout; engine reset follows
+    FXE_EXEC_EV_REPLAYED,       // innocent in-flight request requeued after the reset
+    FXE_EXEC_EV_RECOVERED,      // engine running again (stats().lastRecoveryNs)
+    FXE_EXEC_EV_HELD,           // queued behind unsignaled input fences
+    FXE_EXEC_EV_READY,          // last input fence signaled (or became a semaphore)
+    FXE_EXEC_EV_DEP_FAILED,     // an input fence failed; request dropped
+};
+
+class FXE_ExecPlatform {
+public:
+    virtual ~FXE_ExecPlatform() {}
+
+    virtual uint32_t read32(uint32_t off) = 0;
+    virtual void     write32(uint32_t off, uint32_t val) = 0;
+    virtual uint64_t nowNs() = 0;
+
+    // LRC ring state of the context owning request slot `slot`.
+    virtual uint32_t savedRingHead(int32_t slot) = 0;
+    virtual void     restoreRingHead(int32_t slot, uint32_t head) = 0;
+
+    // Append a request's commands (FXE_RequestCmds) to its context's ring
+    // and move the LRC ring tail past them; *outTail is that tail. Called
+    // once per request, before its first ELSP write; false leaves it
+    // queued. The default has no ring (FXE_EngineModel reads the
+    // descriptor instead).
+    virtual bool emitRequest(int32_t /*slot*/, const uint32_t* /*cs*/, uint32_t /*dwords*/,
+                             uint32_t* outTail) {
+        *outTail = 0;
+        return true;
+    }
+
+    // Request slot finished (CSB status bits, or FXE_EXEC_CANCELLED).
+    virtual void retire(int32_t slot, uint32_t status) = 0;
+
+    // Absolute deadline for the next kick(); UINT64_MAX cancels.
+    virtual void armTimer(uint64_t deadlineNs) = 0;
+
+    // Reset only this engine; everything in flight on it is lost. The
+    // platform reprograms what the reset clears (CSB address).
+    virtual bool resetEngine(const FXE_EngineRegs& regs) = 0;
+
+    // Input fences of a request (FXE_ExecCore::enqueue), possibly from
+    // another engine. kick() polls them; the platform calls kick() again
+    // when a fence it was asked about may have changed.
+    virtual int32_t fenceState(const FXE_Fence& /*f*/) { return FXE_FENCE_SIGNALED; }
+
+    // GGTT address of f's breadcrumb when the engine may poll it instead
+    // of holding the request (f's request is already running on another
+    // engine), else 0. MI_SEMAPHORE_WAIT compares the low dword only: also
+    // 0 unless the breadcrumb's high dword already equals f.seqno's.
+    virtual uint64_t semaphoreFor(const FXE_Fence& /*f*/) { return 0; }
+
+    virtual void event(uint32_t /*ev*/, uint32_t /*ctxId*/, uint32_t /*seqno*/, int32_t /*port*/) {}
+};
+
+// MMIO/GGTT backend that can stand in for the real engine behind
+// FakeIrisXEExeclist::mmioRead32/mmioWrite32/ggttMapGem (FXE_EngineModel).
+class FXE_EngineIO {
+public:
+    virtual ~FXE_EngineIO() {}
+    virtual uint32_t read32(uint32_t off) = 0;
+    virtual void     write32(uint32_t off, uint32_t val) = 0;
+    virtual uint64_t ggttMap(void* cpu, uint64_t bytes) = 0;
+};
+
+struct FXE_ExecStats {
+    uint64_t elspWrites;
+    uint64_t csbEntries;
+    uint64_t csbBatches;        // drains that found at least one entry
+    uint64_t staleCsb;
+    uint64_t preemptRequests;
+    uint64_t faults;
+    uint64_t bans;
+    uint64_t hangs;
+    uint64_t engineResets;
+    uint64_t resetFailures;
+    uint64_t replayed;
+    uint64_t lastRecoveryNs;    // last progress seen -> engine running again
+    uint64_t maxRecoveryNs;
+    uint64_t totalRecoveryNs;
+    uint64_t depHeld;           // requests queued behind input fences
+    uint64_t depSemaphores;     // input fences turned into engine-side waits
+    uint64_t depFailed;
+};
+
+class FXE_ExecCore {
+public:
+    static const uint32_t kMaxContexts = 16;
+    static const uint32_t kMaxBanScore = 3;
+    static const uint64_t kDefaultHangTimeoutNs = 1000000000ULL;
+    static const uint32_t kMaxDeps = 4;
+
+    struct CtxState {
+        uint32_t ctxId;
+        uint32_t banScore;
+        bool     used;
+        bool     banned;
+    };
+
+    void init(FXE_ExecPlatform* platform, const FXE_EngineRegs& regs) {
+        mPlat = platform;
+        mRegs = regs;
+        mSched.init();
+        memset(mLrc, 0, sizeof(mLrc));
+        memset(mBatch, 0, sizeof(mBatch));
+        memset(mPostAddr, 0, sizeof(mPostAddr));
+        memset(mPostValue, 0, sizeof(mPostValue));
+        memset(mSemAddr, 0, sizeof(mSemAddr));
+        memset(mSemValue, 0, sizeof(mSemValue));
+        memset(mEmitted, 0, sizeof(mEmitted));
+        memset(mRingTail, 0, sizeof(mRingTail));
+        memset(mDepCount, 0, sizeof(mDepCount));
+        mHeld = 0;
+        memset(mCtx, 0, sizeof(mCtx));
+        memset(&mStats, 0, sizeof(mStats));
+        mDescCpu = nullptr;
+        mDescGGTT = 0;
+        mCsb = nullptr;
+        mCsbWritePtr = nullptr;
+        mCsbEntries = 0;
+        mCsbHead = 0;
+        mCsbRead = 0;
+        mNextSeqno = 1;
+        mHangTimeoutNs = kDefaultHangTimeoutNs;
+        mWatch.slot = -1;
+        mRecovering = false;
+        mRecoverFromNs = 0;
+    }
+
+    // The oldest in-flight request must move RING_HEAD or retire within
+    // this long; 0 disables the watchdog. Batches that legitimately run
+    // longer without the head moving need a larger value.
+    void setHangTimeoutNs(uint64_t ns) { mHangTimeoutNs = ns; }
+    uint64_t hangTimeoutNs() const { return mHangTimeoutNs; }
+
+    // One GGTT-visible page holding a descriptor slot per ELSP port.
+    void setDescriptorPage(void* cpu, uint64_t ggtt) {
+        mDescCpu = (uint8_t*)cpu;
+        mDescGGTT = ggtt;
+    }
+
+    // CPU view of the CSB ring (up to FXE_CSB_MAX_ENTRIES). writePtr is the
+    // engine's status-page mirror of the CSB write pointer; without it
+    // every drain reads the CSB pointer register instead.
+    void setCsb(volatile uint64_t* base, uint32_t entries,
+                const volatile uint32_t* writePtr = nullptr) {
+        if (entries > FXE_CSB_MAX_ENTRIES) entries = FXE_CSB_MAX_ENTRIES;
+        mCsb = base;
+        mCsbWritePtr = writePtr;
+        mCsbEntries = entries;
+        mCsbHead = entries ? entries - 1 : 0;   // pointer reset value
+        mCsbRead = 0;
+    }
+
+    // Queue a batch for ctxId. Returns the request slot (the platform's key
+    // for savedRingHead/retire) or -1 when banned or full. Call kick() after
+    // the platform has recorded its per-slot state. postGGTT/postValue are
+    // the completion breadcrumb (0 address = none), see FXE_Timeline.hpp.
+    //
+    // deps: up to kMaxDeps input fences. The request is held until they
+    // have signaled, while ready requests of other contexts run ahead of
+    // it; one fence already running on another engine may instead become a
+    // semaphore wait in the request's ring commands. If one fails, the request is
+    // retired with FXE_EXEC_CANCELLED | FXE_EXEC_DEP_ERROR (a semaphore on
+    // a request that faults is released by the timeline's next breadcrumb,
+    // or by the hang watchdog).
+    int32_t enqueue(uint32_t ctxId, uint32_t priority, uint64_t lrcGGTT,
+                    uint64_t batchGGTT, uint32_t* outSeqno,
+                    uint64_t postGGTT = 0, uint64_t postValue = 0,
+                    const FXE_Fence* deps = nullptr, uint32_t depCount = 0) {
+        CtxState* c = context(ctxId, true);
+        if (!c || c->banned || depCount > kMaxDeps || (depCount && !deps))
+            return -1;
+
+        const uint32_t seqno = mNextSeqno;
+        int32_t slot = mSched.enqueue(ctxId, priority, seqno, 0, 0);
+        if (slot < 0)
+            return -1;
+        mNextSeqno++;
+        mLrc[slot] = lrcGGTT;
+        mBatch[slot] = batchGGTT;
+        mPostAddr[slot] = postGGTT;
+        mPostValue[slot] = postValue;
+        mSemAddr[slot] = 0;
+        mSemValue[slot] = 0;
+        mEmitted[slot] = false;
+        mRingTail[slot] = 0;
+        mDepCount[slot] = 0;
+        for (uint32_t i = 0; i < depCount; ++i) {
+            if (deps[i].seqno)
+                mDeps[slot][mDepCount[slot]++] = deps[i];
+        }
+        if (outSeqno) *outSeqno = seqno;
+        mPlat->event(FXE_EXEC_EV_QUEUED, ctxId, seqno, -1);
+        if (mDepCount[slot]) {
+            mSched.setBlocked(slot, true);
+            mHeld++;
+            mStats.depHeld++;
+            mPlat->event(FXE_EXEC_EV_HELD, ctxId, seqno, -1);
+        }
+        return slot;
+    }
+
+    // Check the watchdog, release requests whose inputs are ready, fill
+    // free ports, then issue any preemption the scheduler wants.
+    void kick() {
+        uint64_t now = mPlat->nowNs();
+        if (checkHang(now))
+            now = mPlat->nowNs();
+        resolveDeps();
+
+        for (;;) {
+            int port = mSched.freePort();
+            if (port < 0)
+                break;
+            int32_t slot = mSched.pickNext();
+            if (slot < 0)
+                break;
+
+            const FXE_SchedRequest& r = mSched.request(slot);
+            if (!mEmitted[slot] && !emitRequest(slot))
+                break;
+            if (r.preemptions)
+                mPlat->restoreRingHead(slot, r.ringHead);
+            if (!writeElsp(port, slot))
+                break;
+
+            mSched.start((uint32_t)port, slot, now);
+            mPlat->event(r.preemptions ? FXE_EXEC_EV_RESUBMIT : FXE_EXEC_EV_SUBMIT,
+                         r.ctxId, r.seqno, port);
+        }
+
+        uint32_t mask = mSched.collectPreemptions(now);
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            if (!(mask & (1u << p)))
+                continue;
+            const FXE_SchedPort& sp = mSched.port(p);
+            const FXE_SchedRequest& r = mSched.request(sp.req);
+            mPlat->event(sp.preemptReason == FXE_PREEMPT_PRIORITY ? FXE_EXEC_EV_PREEMPT_PRIORITY
+                                                                  : FXE_EXEC_EV_PREEMPT_QUANTUM,
+                         r.ctxId, r.seqno, (int32_t)p);
+            // Engine saves the context (RING_HEAD lands in the LRC) and
+            // reports CSB PREEMPTED for everything it switched out.
+            mPlat->write32(mRegs.preempt, EXECLIST_PREEMPT_TO_IDLE);
+            mStats.preemptRequests++;
+        }
+
+        if (mRecovering) {
+            const uint64_t ns = mPlat->nowNs() - mRecoverFromNs;
+            mRecovering = false;
+            mStats.lastRecoveryNs = ns;
+            mStats.totalRecoveryNs += ns;
+            if (ns > mStats.maxRecoveryNs) mStats.maxRecoveryNs = ns;
+            mPlat->event(FXE_EXEC_EV_RECOVERED, 0, 0, -1);
+        }
+
+        watch(now);     // start watching what was just submitted
+        const uint64_t deadline = mSched.nextDeadlineNs();
+        const uint64_t watchdog = watchdogDeadlineNs();
+        mPlat->armTimer(watchdog < deadline ? watchdog : deadline);
+    }
+
+    // Drain every valid CSB entry, then refill the ports.
+    uint32_t processCsb() {
+        const uint32_t n = drainCsb();
+        kick();
+        return n;
+    }
+
+    // Hang watchdog. Tracks the oldest request on a port; progress is the
+    // engine's RING_HEAD moving or the request leaving the port. Returns
+    // true when the engine was reset.
+    bool checkHang(uint64_t now) {
+        const int32_t port = watch(now);
+        return port >= 0 && recoverHang((uint32_t)port);
+    }
+
+    uint64_t watchdogDeadlineNs() const {
+        if (!mHangTimeoutNs || mWatch.slot < 0)
+            return UINT64_MAX;
+        return mWatch.progressNs + mHangTimeoutNs;
+    }
+
+    // Consume every entry between the cached read pointer and the engine's
+    // write pointer in one pass, publish the read pointer once, then hand
+    // the whole batch to the handlers. Entries are never written by the CPU.
+    uint32_t drainCsb() {
+        if (!mCsb || !mCsbEntries)
+            return 0;
+
+        const uint32_t wp = (mCsbWritePtr ? *mCsbWritePtr : mPlat->read32(mRegs.csbPtr))
+                            & CSB_PTR_WRITE_MASK;
+        if (wp >= mCsbEntries || wp == mCsbHead)
+            return 0;
+        // Entries land before the pointer that covers them
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        CsbEvent batch[FXE_CSB_MAX_ENTRIES];
+        uint32_t n = 0;
+        uint32_t head = mCsbHead;
+        do {
+            head = head + 1 == mCsbEntries ? 0 : head + 1;
+            const volatile uint64_t* e = mCsb + (size_t)head * 2;
+            batch[n].low = e[0];
+            batch[n].high = e[1];
+            n++;
+        } while (head != wp);
+
+        mCsbHead = head;
+        mCsbRead += n;
+        mPlat->write32(mRegs.csbPtr, (CSB_PTR_WRITE_MASK << (CSB_PTR_READ_SHIFT + 16)) |
+                                     (head << CSB_PTR_READ_SHIFT));
+        mStats.csbBatches++;
+
+        for (uint32_t i = 0; i < n; ++i)
+            dispatch(batch[i].low, batch[i].high);
+        return n;
+    }
+
+    void handleCsbEntry(uint64_t low, uint64_t high) {
+        dispatch(low, high);
+    }
+
+    void onComplete(uint32_t ctxId, uint32_t status) {
+        int port = mSched.portForCtx(ctxId);
+        if (port < 0) {
+            stale(ctxId);
+            return;
+        }
+        const uint32_t seqno = mSched.request(mSched.port((uint32_t)port).req).seqno;
+        int32_t slot = mSched.complete((uint32_t)port);
+        mPlat->event(FXE_EXEC_EV_COMPLETE, ctxId, seqno, port);
+        mPlat->retire(slot, status | FXE_CSB_COMPLETE);
+    }
+
+    void onPreempted(uint32_t ctxId, uint32_t /*status*/) {
+        int port = mSched.portForCtx(ctxId);
+        if (port < 0) {
+            stale(ctxId);
+            return;
+        }
+        const int32_t slot = mSched.port((uint32_t)port).req;
+        const uint32_t head = mPlat->savedRingHead(slot);
+        mSched.preempted((uint32_t)port, head);
+        mPlat->event(FXE_EXEC_EV_PREEMPTED, ctxId, mSched.request(slot).seqno, port);
+    }
+
+    void onFault(uint32_t ctxId, uint32_t status) {
+        mStats.faults++;
+        CtxState* c = context(ctxId, false);
+        int port = mSched.portForCtx(ctxId);
+        uint32_t seqno = port >= 0 ? mSched.request(mSched.port((uint32_t)port).req).seqno : 0;
+        if (c && !c->banned)
+            c->banScore++;
+        mPlat->event(FXE_EXEC_EV_FAULT, ctxId, seqno, port);
+
+        if (port >= 0)
+            mPlat->retire(mSched.fault((uint32_t)port), status | FXE_CSB_FAULT);
+
+        if (c && !c->banned && c->banScore >= kMaxBanScore) {
+            c->banned = true;
+            mStats.bans++;
+            mPlat->event(FXE_EXEC_EV_BANNED, ctxId, seqno, port);
+            cancelContext(ctxId);
+        }
+    }
+
+    // Drop every queued (not running) request of ctxId, oldest first.
+    uint32_t cancelContext(uint32_t ctxId) {
+        uint32_t n = 0;
+        for (;;) {
+            int32_t oldest = -1;
+            for (uint32_t i = 0; i < FXE_Scheduler::kCapacity; ++i) {
+                const FXE_SchedRequest& r = mSched.request((int32_t)i);
+                if (r.state != FXE_REQ_QUEUED || r.ctxId != ctxId)
+                    continue;
+                if (oldest < 0 || (int32_t)(r.seqno - mSched.request(oldest).seqno) < 0)
+                    oldest = (int32_t)i;
+            }
+            if (oldest < 0 || !mSched.cancel(oldest))
+                break;
+            dropDeps(oldest);
+            mPlat->event(FXE_EXEC_EV_CANCELLED, ctxId, mSched.request(oldest).seqno, -1);
+            mPlat->retire(oldest, FXE_EXEC_CANCELLED);
+            n++;
+        }
+        return n;
+    }
+
+    // Forget ban state, e.g. when a context id is recycled.
+    void resetContext(uint32_t ctxId) {
+        CtxState* c = context(ctxId, false);
+        if (c) memset(c, 0, sizeof(*c));
+    }
+
+    bool isBanned(uint32_t ctxId) {
+        CtxState* c = context(ctxId, false);
+        return c && c->banned;
+    }
+
+    uint32_t banScore(uint32_t ctxId) {
+        CtxState* c = context(ctxId, false);
+        return c ? c->banScore : 0;
+    }
+
+    FXE_Scheduler& sched() { return mSched; }
+    const FXE_Scheduler& sched() const { return mSched; }
+    const FXE_ExecStats& stats() const { return mStats; }
+    uint32_t csbReadIndex() const { return mCsbRead; }
+    uint32_t csbReadPointer() const { return mCsbHead; }
+    uint32_t held() const { return mHeld; }
+
+private:
+    struct CsbEvent { uint64_t low; uint64_t high; };
+
+    // Re-check the input fences of held requests: signaled ones are
+    // dropped, the first pending one the platform can name a breadcrumb
+    // for becomes the request's semaphore wait, a failed one fails the
+    // request.
+    void resolveDeps() {
+        if (!mHeld)
+            return;
+        for (uint32_t i = 0; i < FXE_Scheduler::kCapacity; ++i) {
+            const int32_t slot = (int32_t)i;
+            const FXE_SchedRequest& r = mSched.request(slot);
+            if (r.state != FXE_REQ_QUEUED || !r.blocked)
+                continue;
+
+            uint32_t left = 0;
+            bool failed = false;
+            for (uint32_t d = 0; d < mDepCount[slot]; ++d) {
+                const FXE_Fence& f = mDeps[slot][d];
+                const int32_t st = mPlat->fenceState(f);
+                if (st == FXE_FENCE_SIGNALED)
+                    continue;
+                if (st == FXE_FENCE_ERROR) {
+                    failed = true;
+                    break;
+                }
+                if (!mSemAddr[slot]) {
+                    if (const uint64_t addr = mPlat->semaphoreFor(f)) {
+                        mSemAddr[slot] = addr;
+                        mSemValue[slot] = f.seqno;
+                        mStats.depSemaphores++;
+                        continue;
+                    }
+                }
+                mDeps[slot][left++] = f;
+            }
+
+            if (failed) {
+                mSched.cancel(slot);
+                dropDeps(slot);
+                mStats.depFailed++;
+                mPlat->event(FXE_EXEC_EV_DEP_FAILED, r.ctxId, r.seqno, -1);
+                mPlat->retire(slot, FXE_EXEC_CANCELLED | FXE_EXEC_DEP_ERROR);
+            } else if (!left) {
+                dropDeps(slot);
+                mSched.setBlocked(slot, false);
+                mPlat->event(FXE_EXEC_EV_READY, r.ctxId, r.seqno, -1);
+            } else {
+                mDepCount[slot] = left;
+            }
+            if (!mHeld)
+                break;
+        }
+    }
+
+    void dropDeps(int32_t slot) {
+        if (mDepCount[slot]) {
+            mDepCount[slot] = 0;
+            mHeld--;
+        }
+    }
+
+    // Refresh the watchdog's view; returns the port of a request that made
+    // no progress for the hang timeout, else -1.
+    int32_t watch(uint64_t now) {
+        if (!mHangTimeoutNs)
+            return -1;
+
+        int32_t oldest = -1;
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            const FXE_SchedPort& sp = mSched.port(p);
+            if (sp.req >= 0 && (oldest < 0 || sp.startNs < mSched.port((uint32_t)oldest).startNs))
+                oldest = (int32_t)p;
+        }
+        if (oldest < 0) {
+            mWatch.slot = -1;
+            return -1;
+        }
+
+        const FXE_SchedPort& sp = mSched.port((uint32_t)oldest);
+        const uint32_t head = mPlat->read32(mRegs.ringHead);
+        if (sp.req != mWatch.slot || sp.startNs != mWatch.startNs) {
+            mWatch.slot = sp.req;
+            mWatch.startNs = sp.startNs;
+            mWatch.head = head;
+            mWatch.progressNs = now;
+            return -1;
+        }
+        if (head != mWatch.head) {
+            mWatch.head = head;
+            mWatch.progressNs = now;
+            return -1;
+        }
+        return now - mWatch.progressNs >= mHangTimeoutNs ? oldest : -1;
+    }
+
+    // Reset the engine under a hung request: the guilty request is retired
+    // with FXE_EXEC_HANG (scored like a fault), the other port's request is
+    // requeued in place and queued work is replayed by the following kick.
+    bool recoverHang(uint32_t guiltyPort) {
+        // Anything the engine reported before it stopped counts
+        drainCsb();
+        const int32_t gslot = mSched.port(guiltyPort).req;
+        if (gslot != mWatch.slot)
+            return false;
+
+        const uint32_t ctxId = mSched.request(gslot).ctxId;
+        const uint32_t seqno = mSched.request(gslot).seqno;
+        CtxState* c = context(ctxId, false);
+        mStats.hangs++;
+        if (c && !c->banned)
+            c->banScore++;
+        mPlat->event(FXE_EXEC_EV_HANG, ctxId, seqno, (int32_t)guiltyPort);
+
+        if (!mPlat->resetEngine(mRegs))
+            mStats.resetFailures++;
+        mStats.engineResets++;
+        mRecovering = true;
+        mRecoverFromNs = mWatch.progressNs;
+        mWatch.slot = -1;
+
+        // The CSB pointers restart with the engine; stale entries stay
+        // behind the reset write pointer and are never read.
+        mCsbHead = mCsbEntries ? mCsbEntries - 1 : 0;
+
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            if (p == guiltyPort || mSched.port(p).req < 0)
+                continue;
+            const int32_t s = mSched.unwind(p);
+            mStats.replayed++;
+            mPlat->event(FXE_EXEC_EV_REPLAYED, mSched.request(s).ctxId, mSched.request(s).seqno, (int32_t)p);
+        }
+
+        // Skipped, not resumed: the context's next request starts after
+        // this one's commands
+        mPlat->restoreRingHead(gslot, mRingTail[gslot]);
+        mPlat->retire(mSched.fault(guiltyPort), FXE_EXEC_HANG);
+
+        if (c && !c->banned && c->banScore >= kMaxBanScore) {
+            c->banned = true;
+            mStats.bans++;
+            mPlat->event(FXE_EXEC_EV_BANNED, ctxId, seqno, (int32_t)guiltyPort);
+            cancelContext(ctxId);
+        }
+        return true;
+    }
+
+    void dispatch(uint64_t low, uint64_t high) {
+        const uint32_t ctxId  = (uint32_t)(low & 0xFFFFFFFFu);
+        const uint32_t status = (uint32_t)(high & 0xFFFFFFFFu);
+        mStats.csbEntries++;
+
+        if (status & FXE_CSB_FAULT)
+            onFault(ctxId, status);
+        else if (status & FXE_CSB_COMPLETE)
+            onComplete(ctxId, status);
+        else if (status & FXE_CSB_PREEMPTED)
+            onPreempted(ctxId, status);
+        // "switch only" or other: nothing to do
+    }
+
+    void stale(uint32_t ctxId) {
+        mStats.staleCsb++;
+        mPlat->event(FXE_EXEC_EV_STALE_CSB, ctxId, 0, -1);
+    }
+
+    // The request's ring commands, on its first trip to a port: its input
+    // fences are settled by then, and work dropped before it runs never
+    // reaches the ring.
+    bool emitRequest(int32_t slot) {
+        uint32_t cs[FXE_RequestCmds::kMaxDwords];
+        const uint32_t n = FXE_RequestCmds::emit(cs, mRegs.pipeControl,
+                                                 mSemAddr[slot], mSemValue[slot], mBatch[slot],
+                                                 mPostAddr[slot], mPostValue[slot]);
+        if (!mPlat->emitRequest(slot, cs, n, &mRingTail[slot]))
+            return false;
+        mEmitted[slot] = true;
+        return true;
+    }
+
+    bool writeElsp(int port, int32_t slot) {
+        if (!mDescCpu || !mDescGGTT)
+            return false;
+
+        const FXE_SchedRequest& r = mSched.request(slot);
+        uint32_t* d = (uint32_t*)(mDescCpu + (size_t)port * FXE_ELSP_DESC_STRIDE);
+        d[0] = (uint32_t)(mLrc[slot] & 0xFFFFFFFFu);
+        d[1] = (uint32_t)(mLrc[slot] >> 32);
+        d[2] = r.ctxId;                                   // SW context id, echoed in the CSB
+        d[3] = FXE_ELSP_DESC_VALID | FXE_ELSP_DESC_ACTIVE;
+        d[4] = (uint32_t)(mBatch[slot] & 0xFFFFFFFFu);
+        d[5] = (uint32_t)(mBatch[slot] >> 32);
+        d[6] = r.seqno;
+        d[7] = 0;
+        d[8] = (uint32_t)(mPostAddr[slot] & 0xFFFFFFFFu);
+        d[9] = (uint32_t)(mPostAddr[slot] >> 32);
+        d[10] = (uint32_t)(mPostValue[slot] & 0xFFFFFFFFu);
+        d[11] = (uint32_t)(mPostValue[slot] >> 32);
+        d[12] = (uint32_t)(mSemAddr[slot] & 0xFFFFFFFFu);
+        d[13] = (uint32_t)(mSemAddr[slot] >> 32);
+        d[14] = (uint32_t)(mSemValue[slot] & 0xFFFFFFFFu);
+        d[15] = (uint32_t)(mSemValue[slot] >> 32);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        const uint64_t desc = mDescGGTT + (uint64_t)port * FXE_ELSP_DESC_STRIDE;
+        mPlat->write32(mRegs.submitLo, (uint32_t)(desc & 0xFFFFFFFFu));
+        mPlat->write32(mRegs.submitHi, (uint32_t)(desc >> 32));
+        mPlat->write32(mRegs.sqContents, 0x1);
+        mStats.elspWrites++;
+        return true;
+    }
+
+    CtxState* context(uint32_t ctxId, bool create) {
+        CtxState* freeEntry = nullptr;
+        for (uint32_t i = 0; i < kMaxContexts; ++i) {
+            if (mCtx[i].used && mCtx[i].ctxId == ctxId) return &mCtx[i];
+            if (!mCtx[i].used && !freeEntry) freeEntry = &mCtx[i];
+        }
+        if (!create || !freeEntry) return nullptr;
+        memset(freeEntry, 0, sizeof(*freeEntry));
+        freeEntry->used = true;
+        freeEntry->ctxId = ctxId;
+        return freeEntry;
+    }
+
+    FXE_ExecPlatform* mPlat;
+    FXE_EngineRegs    mRegs;
+    FXE_Scheduler     mSched;
+    uint64_t          mLrc[FXE_Scheduler::kCapacity];
+    uint64_t          mBatch[FXE_Scheduler::kCapacity];
+    uint64_t          mPostAddr[FXE_Scheduler::kCapacity];
+    uint64_t          mPostValue[FXE_Scheduler::kCapacity];
+    uint64_t          mSemAddr[FXE_Scheduler::kCapacity];
+    uint64_t          mSemValue[FXE_Scheduler::kCapacity];
+    bool              mEmitted[FXE_Scheduler::kCapacity];   // ring commands written
+    uint32_t          mRingTail[FXE_Scheduler::kCapacity];  // LRC ring tail after them
+    FXE_Fence         mDeps[FXE_Scheduler::kCapacity][kMaxDeps];
+    uint32_t          mDepCount[FXE_Scheduler::kCapacity];  // non-zero = held
+    uint32_t          mHeld;
+    CtxState          mCtx[kMaxContexts];
+    FXE_ExecStats     mStats;
+    uint8_t*          mDescCpu;
+    uint64_t          mDescGGTT;
+    volatile uint64_t* mCsb;
+    const volatile uint32_t* mCsbWritePtr;
+    uint32_t          mCsbEntries;
+    uint32_t          mCsbHead;       // last entry consumed (read pointer)
+    uint32_t          mCsbRead;       // entries consumed in total
+    uint32_t          mNextSeqno;
+
+    struct Watch {
+        int32_t  slot;          // oldest in-flight request, -1 = none
+        uint64_t startNs;       // its port start time (new run = new watch)
+        uint32_t head;
+        uint64_t progressNs;
+    };
+    Watch             mWatch;
+    uint64_t          mHangTimeoutNs;
+    bool              mRecovering;      // set until the kick after a reset
+    uint64_t          mRecoverFromNs;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Seqno fence page.
+//
+// One page the GPU writes completions into: a 64-byte slot per engine
+// holding the last seqno that engine completed, as a 64-bit value. Every
+// submission's tail batch stores its own seqno there with a qword
+// MI_STORE_DATA_IMM. Seqnos are issued in ring order and never reused, so
+// a slot only ever grows and "is N done" is slot >= N. The CPU never
+// writes a slot back: an interrupt that covers several completions reads
+// the latest one and everything at or below it retires.
+//
+// The page is zeroed once when it is created; seqnos start at 1.
+//
+
+struct FXE_FencePage {
+    static const uint32_t kSlotBytes    = 64;   // one cache line per engine
+    static const uint32_t kStoreDwords  = 5;    // see emitStore()
+
+    enum Slot {
+        kRcs    = 0,    // legacy RCS ring (appendFenceAndSubmit)
+        kBcs    = 1,    // reserved: BCS0 retires through its execlist timeline
+        kSlots  = 2,
+    };
+
+    static uint32_t offset(uint32_t slot) { return slot * kSlotBytes; }
+
+    static uint64_t completed(const void* page, uint32_t slot) {
+        const uint64_t* p = (const uint64_t*)((const uint8_t*)page + offset(slot));
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    static bool passed(uint64_t completed, uint64_t seqno) { return completed >= seqno; }
+
+    // MI_STORE_DATA_IMM, GGTT, qword: `seqno` to the slot at `slotGpu`.
+    // Writes kStoreDwords dwords at `cs` and returns the count.
+    static uint32_t emitStore(uint32_t* cs, uint64_t slotGpu, uint64_t seqno) {
+        cs[0] = (0x20u << 23) | (1u << 22) | (1u << 21) | (kStoreDwords - 2);
+        cs[1] = (uint32_t)slotGpu;
+        cs[2] = (uint32_t)(slotGpu >> 32);
+        cs[3] = (uint32_t)seqno;
+        cs[4] = (uint32_t)(seqno >> 32);
+        return kStoreDwords;
+    }
+};
@@ -0,0 +1,615 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// GGTT address-space allocator.
+//
+// Free and allocated ranges are kept in two address-sorted tables. Freed
+// ranges merge with their free neighbours, so the table holds one entry
+// per hole. Allocation scans the holes once; first fit (default) takes the
+// lowest address that fits, best fit the smallest hole (lowest address on
+// ties). On driver-shaped traces both fragment about the same and first
+// fit is cheaper (TestApp/fxe_ggtt_host_test.cpp).
+//
+// Every allocation may ask for an alignment (power of two, at least one
+// page), a window [lo, hi) (GuC firmware must sit at or above WOPCM) or an
+// exact address. Ranges are page granular; an allocation is freed by its
+// start address alone and may carry a caller-defined tag (the kext stores
+// the owning GEM, so an unmap by address can find the object).
+//
+// Driven by FakeIrisXEFramebuffer::ggttMap* under fGgttLock.
+// Fixed-size tables, no allocation after init().
+//
+
+struct FXE_GgttSpaceStats {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failures;         // no hole fits (or a table is full)
+    uint64_t badFrees;         // address not allocated
+    uint64_t bytesUsed;
+    uint64_t peakBytesUsed;
+    uint64_t holesScanned;
+};
+
+class FXE_GgttSpace {
+public:
+    static const uint64_t kPage      = 4096;
+    static const uint32_t kMaxRanges = 2048;
+
+    enum Policy : uint32_t {
+        kFirstFit = 0,
+        kBestFit  = 1,
+    };
+
+    // Manage [base, end). Both are rounded inward to pages.
+    void init(uint64_t base, uint64_t end, Policy policy = kFirstFit) {
+        mBase = (base + kPage - 1) & ~(kPage - 1);
+        mEnd = end & ~(kPage - 1);
+        mPolicy = policy;
+        mFreeCount = 0;
+        mUsedCount = 0;
+        memset(&mStats, 0, sizeof(mStats));
+        if (mEnd > mBase) {
+            mFree[0].start = mBase;
+            mFree[0].end = mEnd;
+            mFreeCount = 1;
+        }
+    }
+
+    void setPolicy(Policy policy) { mPolicy = policy; }
+
+    // size bytes (rounded up to pages) at an align-aligned address inside
+    // [lo, hi). Returns false if nothing fits.
+    bool alloc(uint64_t size, uint64_t align, uint64_t lo, uint64_t hi, uint64_t* outAddr) {
+        size = roundUp(size);
+        if (align < kPage) align = kPage;
+        if (!size || (align & (align - 1)) || !outAddr || mUsedCount >= kMaxRanges) {
+            mStats.failures++;
+            return false;
+        }
+
+        int32_t best = -1;
+        uint64_t bestAddr = 0, bestHole = 0;
+        for (uint32_t i = firstEndingAfter(lo); i < mFreeCount; ++i) {
+            const Range& r = mFree[i];
+            if (r.start >= hi) break;
+            mStats.holesScanned++;
+            const uint64_t from = r.start > lo ? r.start : lo;
+            const uint64_t a = (from + align - 1) & ~(align - 1);
+            const uint64_t limit = r.end < hi ? r.end : hi;
+            if (a < from || a + size < a || a + size > limit) continue;
+            if (!canCarve(i, a, size)) continue;
+            const uint64_t hole = r.end - r.start;
+            if (best < 0 || hole < bestHole) {
+                best = (int32_t)i;
+                bestAddr = a;
+                bestHole = hole;
+            }
+            if (mPolicy == kFirstFit || hole == size) break;
+        }
+        if (best < 0) {
+            mStats.failures++;
+            return false;
+        }
+        carve((uint32_t)best, bestAddr, size);
+        *outAddr = bestAddr;
+        return true;
+    }
+
+    bool alloc(uint64_t size, uint64_t* outAddr) {
+        return alloc(size, kPage, 0, UINT64_MAX, outAddr);
+    }
+
+    // Anywhere at or above lo (GuC firmware must sit above WOPCM).
+    bool allocAtOrAbove(uint64_t size, uint64_t lo, uint64_t* outAddr) {
+        return alloc(size, kPage, lo, UINT64_MAX, outAddr);
+    }
+
+    // Exactly [addr, addr + size); fails if any of it is taken.
+    bool allocAt(uint64_t addr, uint64_t size) {
+        size = roundUp(size);
+        if (!size || (addr & (kPage - 1)) || mUsedCount >= kMaxRanges) {
+            mStats.failures++;
+            return false;
+        }
+        const uint32_t i = firstEndingAfter(addr);
+        if (i >= mFreeCount || mFree[i].start > addr || addr + size > mFree[i].end ||
+            !canCarve(i, addr, size)) {
+            mStats.failures++;
+            return false;
+        }
+        carve(i, addr, size);
+        return true;
+    }
+
+    // Give back the allocation starting at addr; returns its size (0 if
+    // addr is not the start of an allocation).
+    uint64_t free(uint64_t addr) {
+        const int32_t u = findUsed(addr);
+        if (u < 0) {
+            mStats.badFrees++;
+            return 0;
+        }
+        const Range r = mUsed[u];
+        removeAt(mUsed, mUsedCount, (uint32_t)u);
+
+        // Merge with the hole before and/or after
+        const uint32_t i = firstEndingAfter(r.start);   // first hole after r
+        const bool joinPrev = i > 0 && mFree[i - 1].end == r.start;
+        const bool joinNext = i < mFreeCount && mFree[i].start == r.end;
+        if (joinPrev && joinNext) {
+            mFree[i - 1].end = mFree[i].end;
+            removeAt(mFree, mFreeCount, i);
+        } else if (joinPrev) {
+            mFree[i - 1].end = r.end;
+        } else if (joinNext) {
+            mFree[i].start = r.start;
+        } else {
+            // fits: there are never more holes than allocations + 1
+            insertAt(mFree, mFreeCount, i, r);
+        }
+
+        mStats.frees++;
+        mStats.bytesUsed -= r.end - r.start;
+        return r.end - r.start;
+    }
+
+    // Size of the allocation starting at addr, 0 if none.
+    uint64_t sizeOf(uint64_t addr) const {
+        const int32_t u = findUsed(addr);
+        return u < 0 ? 0 : mUsed[u].end - mUsed[u].start;
+    }
+
+    // Tag of the allocation starting at addr (0 until set, or if none).
+    bool setTag(uint64_t addr, uint64_t tag) {
+        const int32_t u = findUsed(addr);
+        if (u < 0) return false;
+        mUsed[u].tag = tag;
+        return true;
+    }
+
+    uint64_t tagOf(uint64_t addr) const {
+        const int32_t u = findUsed(addr);
+        return u < 0 ? 0 : mUsed[u].tag;
+    }
+
+    uint64_t base() const { return mBase; }
+    uint64_t end() const { return mEnd; }
+    uint32_t holes() const { return mFreeCount; }
+    uint32_t allocations() const { return mUsedCount; }
+    uint64_t freeBytes() const { return (mEnd - mBase) - mStats.bytesUsed; }
+
+    uint64_t largestHole() const {
+        uint64_t best = 0;
+        for (uint32_t i = 0; i < mFreeCount; ++i)
+            if (mFree[i].end - mFree[i].start > best) best = mFree[i].end - mFree[i].start;
+        return best;
+    }
+
+    // Share of free space outside the largest hole, in 1/1000 (0 = one hole).
+    uint32_t fragmentationPermille() const {
+        const uint64_t f = freeBytes();
+        return f ? (uint32_t)(((f - largestHole()) * 1000) / f) : 0;
+    }
+
+    const FXE_GgttSpaceStats& stats() const { return mStats; }
+
+private:
+    struct Range { uint64_t start; uint64_t end; uint64_t tag; };
+
+    static uint64_t roundUp(uint64_t size) {
+        const uint64_t r = (size + kPage - 1) & ~(kPage - 1);
+        return r < size ? 0 : r;
+    }
+
+    // Index of the first hole with end > addr.
+    uint32_t firstEndingAfter(uint64_t addr) const {
+        uint32_t lo = 0, hi = mFreeCount;
+        while (lo < hi) {
+            const uint32_t mid = (lo + hi) / 2;
+            if (mFree[mid].end <= addr) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    int32_t findUsed(uint64_t addr) const {
+        uint32_t lo = 0, hi = mUsedCount;
+        while (lo < hi) {
+            const uint32_t mid = (lo + hi) / 2;
+            if (mUsed[mid].start < addr) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < mUsedCount && mUsed[lo].start == addr ? (int32_t)lo : -1;
+    }
+
+    // Taking [a, a + size) out of the middle of hole i needs a table entry.
+    bool canCarve(uint32_t i, uint64_t a, uint64_t size) const {
+        return !(a > mFree[i].start && a + size < mFree[i].end) || mFreeCount < kMaxRanges;
+    }
+
+    void carve(uint32_t i, uint64_t a, uint64_t size) {
+        const Range r = mFree[i];
+        const bool left = a > r.start;
+        const bool right = a + size < r.end;
+        if (left && right) {
+            mFree[i].end = a;
+            insertAt(mFree, mFreeCount, i + 1, Range{ a + size, r.end, 0 });
+        } else if (left) {
+            mFree[i].end = a;
+        } else if (right) {
+            mFree[i].start = a + size;
+        } else {
+            removeAt(mFree, mFreeCount, i);
+        }
+
+        uint32_t lo = 0, hi = mUsedCount;
+        while (lo < hi) {
+            const uint32_t mid = (lo + hi) / 2;
+            if (mUsed[mid].start < a) lo = mid + 1;
+            else hi = mid;
+        }
+        insertAt(mUsed, mUsedCount, lo, Range{ a, a + size, 0 });
+
+        mStats.allocs++;
+        mStats.bytesUsed += size;
+        if (mStats.bytesUsed > mStats.peakBytesUsed) mStats.peakBytesUsed = mStats.bytesUsed;
+    }
+
+    static void insertAt(Range* t, uint32_t& count, uint32_t i, const Range& r) {
+        memmove(&t[i + 1], &t[i], (size_t)(count - i) * sizeof(Range));
+        t[i] = r;
+        count++;
+    }
+
+    static void removeAt(Range* t, uint32_t& count, uint32_t i) {
+        memmove(&t[i], &t[i + 1], (size_t)(count - i - 1) * sizeof(Range));
+        count--;
+    }
+
+    uint64_t           mBase;
+    uint64_t           mEnd;
+    Policy             mPolicy;
+    Range              mFree[kMaxRanges];
+    uint32_t           mFreeCount;
+    Range              mUsed[kMaxRanges];
+    uint32_t           mUsedCount;
+    FXE_GgttSpaceStats mStats;
+};
+
+//
+// Batched GGTT PTE updates.
+//
+// Every PTE store must be followed by a GTT_WRITE_FLUSH before the GPU may
+// use the entry, and the flush (an uncached MMIO write that also drains the
+// GPU's GGTT TLB) costs far more than the stores. FXE_PteBatch queues the
+// PTEs of several mappings/unmappings, writes each object's entries as one
+// ascending run of plain 64-bit stores, then issues a single barrier and a
+// single flush on commit().
+//
+// Runs are written in the order they were added, so an unmap followed by
+// a map of the same range in one batch ends with the map.
+//
+// addRun() maps a physically contiguous piece of an object. Where the
+// table takes large entries (FXE_GgttIO::pageSizes()) and both the PTE
+// index and the physical address are aligned, one 64 KB or 2 MB entry
+// replaces 16 or 512 4 KB ones. A large entry sits in the first slot of
+// the range it covers; the slots behind it are not written (unmap clears
+// them all, which is harmless).
+//
+
+// GPU page sizes an entry can map (FXE_GgttIO::pageSizes() mask)
+enum : uint32_t {
+    FXE_PAGE_4K  = 1u << 12,
+    FXE_PAGE_64K = 1u << 16,
+    FXE_PAGE_2M  = 1u << 21,
+};
+
+// Where a PTE batch lands: the GGTT PTE array and its flush.
+class FXE_GgttIO {
+public:
+    virtual ~FXE_GgttIO() {}
+    virtual volatile uint64_t* ptes() = 0;     // entry 0
+    virtual uint64_t entries() = 0;
+    virtual void flush() = 0;                   // GTT_WRITE_FLUSH after the stores
+    // Entry sizes the table accepts and the entry mapping `size` bytes at phys
+    virtual uint32_t pageSizes() { return FXE_PAGE_4K; }
+    virtual uint64_t encode(uint64_t phys, uint32_t size) = 0;
+};
+
+struct FXE_PteBatchStats {
+    uint64_t ptes;          // entries written
+    uint64_t runs;          // contiguous store runs
+    uint64_t commits;       // = flushes
+    uint64_t fullCommits;   // forced by a full batch
+    uint64_t dropped;       // index outside the table
+    uint64_t large64K;      // 64 KB entries queued by addRun()
+    uint64_t large2M;       // 2 MB entries queued by addRun()
+    uint64_t ptesSaved;     // 4 KB entries those replaced, minus themselves
+};
+
+// What addRun() queued for one mapping; accumulates over its segments.
+struct FXE_PteMapInfo {
+    uint32_t segments;
+    uint32_t ptes;
+    uint32_t ptesSaved;
+    uint32_t pageSize;      // largest entry used
+};
+
+class FXE_PteBatch {
+public:
+    static const uint32_t kMaxPtes = 512;
+    static const uint32_t kMaxRuns = 64;
+
+    void init(FXE_GgttIO* io) {
+        mIO = io;
+        mCount = 0;
+        mRunCount = 0;
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    // Queue one entry; `step` slots after the previous one keeps a run of
+    // large entries together. A full batch is committed first.
+    void add(uint64_t index, uint64_t pte, uint32_t step = 1) {
+        Run* last = mRunCount ? &mRun[mRunCount - 1] : nullptr;
+        bool extends = last && last->step == step &&
+                       last->index + (uint64_t)last->count * step == index;
+        if (mCount == kMaxPtes || (!extends && mRunCount == kMaxRuns)) {
+            mStats.fullCommits++;
+            commit();
+            extends = false;
+        }
+        if (!extends) {
+            last = &mRun[mRunCount++];
+            last->index = index;
+            last->first = mCount;
+            last->count = 0;
+            last->step = step;
+        }
+        mPte[mCount++] = pte;
+        last->count++;
+    }
+
+    // Queue `pages` 4 KB pages at PTE index `index`, backed by contiguous
+    // memory at phys (page aligned), with the largest entries that fit.
+    // Returns the number of entries queued.
+    uint32_t addRun(uint64_t index, uint64_t phys, uint64_t pages, FXE_PteMapInfo* info = nullptr) {
+        const uint32_t sizes = mIO ? mIO->pageSizes() : FXE_PAGE_4K;
+        uint32_t queued = 0;
+        while (pages) {
+            uint32_t size = FXE_PAGE_4K;
+            if ((sizes & FXE_PAGE_2M) && fits(index, phys, pages, FXE_PAGE_2M))
+                size = FXE_PAGE_2M;
+            else if ((sizes & FXE_PAGE_64K) && fits(index, phys, pages, FXE_PAGE_64K))
+                size = FXE_PAGE_64K;
+            const uint32_t span = size >> 12;
+            add(index, mIO ? mIO->encode(phys, size) : 0, span);
+            if (size == FXE_PAGE_2M) mStats.large2M++;
+            if (size == FXE_PAGE_64K) mStats.large64K++;
+            mStats.ptesSaved += span - 1;
+            if (info) {
+                info->ptes++;
+                info->ptesSaved += span - 1;
+                if (size > info->pageSize) info->pageSize = size;
+            }
+            index += span;
+            phys += size;
+            pages -= span;
+            queued++;
+        }
+        if (info) info->segments++;
+        return queued;
+    }
+
+    // GGTT alignment that lets an object of `bytes` use its largest entries.
+    static uint64_t alignFor(uint32_t sizes, uint64_t bytes) {
+        if ((sizes & FXE_PAGE_2M) && bytes >= FXE_PAGE_2M) return FXE_PAGE_2M;
+        if ((sizes & FXE_PAGE_64K) && bytes >= FXE_PAGE_64K) return FXE_PAGE_64K;
+        return FXE_PAGE_4K;
+    }
+
+    // Queue `count` invalid entries from index.
+    void clear(uint64_t index, uint64_t count) {
+        for (uint64_t i = 0; i < count; ++i) add(index + i, 0);
+    }
+
+    uint32_t pending() const { return mCount; }
+
+    // Store everything queued, then one barrier and one flush. Returns the
+    // number of entries written (no flush when nothing was queued).
+    uint32_t commit() {
+        if (!mCount) return 0;
+        volatile uint64_t* t = mIO ? mIO->ptes() : nullptr;
+        const uint64_t n = mIO ? mIO->entries() : 0;
+        uint32_t written = 0;
+        for (uint32_t r = 0; r < mRunCount; ++r) {
+            const Run& run = mRun[r];
+            uint64_t count = run.count;
+            if (run.index >= n) count = 0;
+            else if (run.index + (count - 1) * run.step >= n) count = (n - run.index - 1) / run.step + 1;
+            mStats.dropped += run.count - count;
+            volatile uint64_t* dst = t + run.index;
+            const uint64_t* src = &mPte[run.first];
+            for (uint64_t i = 0; i < count; ++i)
+                dst[i * run.step] = src[i];
+            written += (uint32_t)count;
+            mStats.runs++;
+        }
+        __sync_synchronize();
+        if (mIO) mIO->flush();
+        mStats.ptes += written;
+        mStats.commits++;
+        mCount = 0;
+        mRunCount = 0;
+        return written;
+    }
+
+    const FXE_PteBatchStats& stats() const { return mStats; }
+
+private:
+    struct Run { uint64_t index; uint32_t first; uint32_t count; uint32_t step; };
+
+    static bool fits(uint64_t index, uint64_t phys, uint64_t pages, uint32_t size) {
+        const uint64_t span = size >> 12;
+        return pages >= span && !(index & (span - 1)) && !(phys & (size - 1));
+    }
+
+    FXE_GgttIO*       mIO;
+    uint64_t          mPte[kMaxPtes];
+    uint32_t          mCount;
+    Run               mRun[kMaxRuns];
+    uint32_t          mRunCount;
+    FXE_PteBatchStats mStats;
+};
+
+//
+// LRU eviction of idle GGTT mappings.
+//
+// A mapping whose object drops its last pin stays bound (pinning it again
+// costs nothing) and joins the idle list, least recently used first. When
+// FXE_GgttSpace has no room for a new mapping, alloc() unbinds idle
+// mappings oldest first, retrying after each, until the request fits or
+// nothing idle is left; mappings that lie wholly outside the requested
+// window are skipped. A mapping leaves the list when its object is pinned
+// or mapped again, or unmapped.
+//
+// Pins stand in for fences: a submitted request holds its objects pinned
+// until it retires, so nothing on the list is still read by the GPU.
+// The platform's evict() rechecks that under the kext's locks.
+//
+// The list is intrusive (the kext embeds the node in the GEM's VMA) and
+// the evictor allocates nothing; the kext serialises it under the GGTT
+// lock.
+//
+
+struct FXE_LruNode {
+    FXE_LruNode* prev;      // null: not on the list
+    FXE_LruNode* next;
+    void*        obj;
+    uint64_t     addr;      // start of the object's mapping
+};
+
+class FXE_GgttEvictPlatform {
+public:
+    virtual ~FXE_GgttEvictPlatform() {}
+    // Unbind obj (already off the list). Returns the bytes given back to
+    // the space, 0 if it is in use again and keeps its mapping.
+    virtual uint64_t evict(void* obj) = 0;
+    // Whose obj is (for evictOwned); null when not tracked.
+    virtual const void* ownerOf(void* obj) { (void)obj; return nullptr; }
+};
+
+struct FXE_GgttEvictStats {
+    uint64_t evictions;
+    uint64_t evictedBytes;
+    uint64_t passes;        // allocations that had to evict
+    uint64_t failures;      // no room even after evicting everything eligible
+    uint64_t busy;          // reached on the list but pinned again
+    uint32_t idle;          // mappings on the list now
+};
+
+class FXE_GgttEvictor {
+public:
+    void init(FXE_GgttSpace* space, FXE_GgttEvictPlatform* platform) {
+        mSpace = space;
+        mPlatform = platform;
+        mHead.prev = mHead.next = &mHead;
+        mHead.obj = nullptr;
+        mHead.addr = 0;
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    static bool linked(const FXE_LruNode* n) { return n->prev != nullptr; }
+
+    // obj, mapped at addr, went idle (again): it becomes the most recent.
+    void touch(FXE_LruNode* n, void* obj, uint64_t addr) {
+        remove(n);
+        n->obj = obj;
+        n->addr = addr;
+        n->prev = mHead.prev;
+        n->next = &mHead;
+        mHead.prev->next = n;
+        mHead.prev = n;
+        mStats.idle++;
+    }
+
+    void remove(FXE_LruNode* n) {
+        if (!linked(n)) return;
+        n->prev->next = n->next;
+        n->next->prev = n->prev;
+        n->prev = n->next = nullptr;
+        mStats.idle--;
+    }
+
+    // Least recently idled object, null if none.
+    void* oldest() const { return mHead.next != &mHead ? mHead.next->obj : nullptr; }
+
+    // FXE_GgttSpace::alloc(), evicting idle mappings when it does not fit.
+    bool alloc(uint64_t size, uint64_t align, uint64_t lo, uint64_t hi, uint64_t* outAddr) {
+        if (mSpace->alloc(size, align, lo, hi, outAddr)) return true;
+        if (mHead.next == &mHead || !mPlatform) {
+            mStats.failures++;
+            return false;
+        }
+        mStats.passes++;
+        FXE_LruNode* n = mHead.next;
+        while (n != &mHead) {
+            FXE_LruNode* next = n->next;
+            const uint64_t end = n->addr + mSpace->sizeOf(n->addr);
+            if (end <= lo || n->addr >= hi) {       // cannot make room in [lo, hi)
+                n = next;
+                continue;
+            }
+            void* obj = n->obj;
+            remove(n);
+            const uint64_t freed = mPlatform->evict(obj);
+            if (!freed) {
+                mStats.busy++;
+            } else {
+                mStats.evictions++;
+                mStats.evictedBytes += freed;
+                if (mSpace->alloc(size, align, lo, hi, outAddr)) return true;
+            }
+            n = next;
+        }
+        mStats.failures++;
+        return false;
+    }
+
+    // Evict owner's idle mappings, oldest first, until `bytes` have been
+    // given back or none are left. Others' mappings are not touched: a
+    // client over its soft quota pays with its own working set. Returns
+    // the bytes freed.
+    uint64_t evictOwned(const void* owner, uint64_t bytes) {
+        uint64_t freed = 0;
+        FXE_LruNode* n = mHead.next;
+        while (n != &mHead && freed < bytes && mPlatform) {
+            FXE_LruNode* next = n->next;
+            void* obj = n->obj;
+            if (mPlatform->ownerOf(obj) == owner) {
+                remove(n);
+                const uint64_t got = mPlatform->evict(obj);
+                if (!got) {
+                    mStats.busy++;
+                } else {
+                    mStats.evictions++;
+                    mStats.evictedBytes += got;
+                    freed += got;
+                }
+            }
+            n = next;
+        }
+        return freed;
+    }
+
+    const FXE_GgttEvictStats& stats() const { return mStats; }
+
+private:
+    FXE_GgttSpace*         mSpace;
+    FXE_GgttEvictPlatform* mPlatform;
+    FXE_LruNode            mHead;
+    FXE_GgttEvictStats     mStats;
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "FXE_Ggtt.hpp"
+
+//
+// Per-process GPU address spaces: Gen12 4-level PPGTT, 48-bit VA.
+//
+// PML4 -> PDP -> PD -> PT, 512 64-bit entries per 4 KB table, one 4 KB
+// page per PT entry. Only the PML4 exists up front; the directories and
+// page tables under it are allocated the first time a mapping reaches
+// their range and go back as soon as their last entry is cleared, so a
+// client pays for tables in proportion to what it has mapped.
+//
+// Entries are written straight into the table pages. A new entry needs
+// no flush (the GPU never cached an invalid one), a cleared or replaced
+// one does: clears only mark the space dirty and commit() issues one
+// barrier and one TLB invalidation for everything since the last commit.
+// Tables emptied by those clears are held back until then, so the GPU can
+// not walk a stale directory entry into a page that has been reused.
+//
+// Table pages come from an FXE_PtPool shared by every address space; VA
+// ranges from an FXE_GgttSpace over [kVaBase, kVaEnd), so each client has
+// its own 256 TB instead of a slice of the GGTT.
+//
+// Driven by FakeIrisXEPpgtt, which owns the locking.
+//
+
+struct FXE_PtPage {
+    void*     cookie;
+    uint64_t* cpu;          // 512 entries
+    uint64_t  phys;
+};
+
+// Zeroed 4 KB table pages.
+class FXE_PtPagePlatform {
+public:
+    virtual ~FXE_PtPagePlatform() {}
+    virtual bool allocPage(FXE_PtPage* out) = 0;
+    virtual void freePage(const FXE_PtPage& page) = 0;
+};
+
+struct FXE_PtPoolStats {
+    uint64_t gets;
+    uint64_t hits;
+    uint64_t allocs;        // from the backing platform
+    uint64_t frees;         // to the backing platform
+    uint64_t failures;
+    uint32_t cached;
+    uint32_t outstanding;   // handed out, not yet returned
+};
+
+//
+// Free table pages, shared between address spaces. Tables are only given
+// back once every entry has been cleared, so a cached page is still zero
+// and goes out again as is.
+//
+class FXE_PtPool : public FXE_PtPagePlatform {
+public:
+    static const uint32_t kMaxCached = 256;
+
+    void init(FXE_PtPagePlatform* backing, uint32_t maxCached = kMaxCached) {
+        mBacking = backing;
+        mMax = maxCached;
+        if (mMax > kMaxCached) mMax = kMaxCached;
+        mCount = 0;
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    bool allocPage(FXE_PtPage* out) override {
+        mStats.gets++;
+        if (mCount) {
+            *out = mPage[--mCount];
+            mStats.hits++;
+        } else if (!mBacking || !mBacking->allocPage(out)) {
+            mStats.failures++;
+            return false;
+        } else {
+            mStats.allocs++;
+        }
+        mStats.outstanding++;
+        mStats.cached = mCount;
+        return true;
+    }
+
+    void freePage(const FXE_PtPage& page) override {
+        if (mStats.outstanding) mStats.outstanding--;
+        if (mCount < mMax) {
+            mPage[mCount++] = page;
+        } else {
+            if (mBacking) mBacking->freePage(page);
+            mStats.frees++;
+        }
+        mStats.cached = mCount;
+    }
+
+    // Give every cached page back (outstanding ones stay with their tables).
+    void drain() {
+        while (mCount) {
+            if (mBacking) mBacking->freePage(mPage[--mCount]);
+            else --mCount;
+            mStats.frees++;
+        }
+        mStats.cached = 0;
+    }
+
+    const FXE_PtPoolStats& stats() const { return mStats; }
+
+private:
+    FXE_PtPagePlatform* mBacking;
+    FXE_PtPage          mPage[kMaxCached];
+    uint32_t            mCount;
+    uint32_t            mMax;
+    FXE_PtPoolStats     mStats;
+};
+
+class FXE_PpgttPlatform {
+public:
+    virtual ~FXE_PpgttPlatform() {}
+    // Zeroed host memory for table bookkeeping
+    virtual void* allocMeta(size_t bytes) = 0;
+    virtual void freeMeta(void* p, size_t bytes) = 0;
+    // Drop the engines' PPGTT TLBs after cleared entries were stored
+    virtual void invalidateTlb() = 0;
+};
+
+struct FXE_PpgttStats {
+    uint64_t ptesWritten;
+    uint64_t ptesCleared;
+    uint64_t tableAllocs;
+    uint64_t tableFrees;
+    uint64_t commits;
+    uint64_t invalidations;
+    uint64_t failures;      // no VA or no table page
+    uint32_t tables;        // live, the PML4 included
+    uint32_t peakTables;
+};
+
+class FXE_Ppgtt {
+public:
+    static const uint32_t kLevels  = 4;
+    static const uint32_t kEntries = 512;
+    static const uint64_t kVaBase  = 1ULL << 16;    // keep page 0 and friends unmapped
+    static const uint64_t kVaEnd   = 1ULL << 48;
+    static const uint32_t kMaxDeferred = 64;
+
+    // Entry bits (Gen8+ PPGTT): present, writable
+    static const uint64_t kPresent  = 1ULL << 0;
+    static const uint64_t kWritable = 1ULL << 1;
+    static const uint64_t kAddrMask = 0x0000FFFFFFFFF000ULL;
+
+    static uint64_t encode(uint64_t phys) { return (phys & kAddrMask) | kPresent | kWritable; }
+
+    // Index into the level-`level` table (3 = PML4 .. 0 = PT) for va.
+    static uint32_t indexAt(uint64_t va, uint32_t level) {
+        return (uint32_t)((va >> (12 + 9 * level)) & (kEntries - 1));
+    }
+
+    bool init(FXE_PtPagePlatform* pages, FXE_PpgttPlatform* platform) {
+        mPages = pages;
+        mPlatform = platform;
+        mRoot = nullptr;
+        mDeferred = 0;
+        mDirty = false;
+        mSpace.init(kVaBase, kVaEnd);
+        memset(&mStats, 0, sizeof(mStats));
+        mRoot = newTable(kLevels - 1);
+        return mRoot != nullptr;
+    }
+
+    // Free every table. The space must be idle on the GPU.
+    void destroy() {
+        mDirty = true;
+        if (mRoot) {
+            freeTree(mRoot, kLevels - 1);
+            mRoot = nullptr;
+        }
+        commit();
+    }
+
+    // PML4 address for the context image; 0 before init().
+    uint64_t root() const { return mRoot ? mRoot->page.phys : 0; }
+
+    // Reserve a VA range (page granular); the tables come with map().
+    bool bind(uint64_t size, uint64_t align, uint64_t* outVa) {
+        const uint64_t page = 4096;
+        if (!mSpace.alloc(size, align < page ? page : align, kVaBase, kVaEnd, outVa)) {
+            mStats.failures++;
+            return false;
+        }
+        return true;
+    }
+
+    // Point `pages` 4 KB pages from va at contiguous memory at phys,
+    // allocating the tables on the way. False when a table page is not
+    // available; entries already written stay until unbind().
+    bool map(uint64_t va, uint64_t phys, uint64_t pages) {
+        while (pages) {
+            Table* pt = walk(va, true);
+            if (!pt) {
+                mStats.failures++;
+                return false;
+            }
+            uint32_t i = indexAt(va, 0);
+            for (; i < kEntries && pages; ++i, --pages, va += 4096, phys += 4096) {
+                if (!pt->page.cpu[i]) pt->used++;
+                else mDirty = true;         // replaced: the old one may be cached
+                pt->page.cpu[i] = encode(phys);
+                mStats.ptesWritten++;
+            }
+        }
+        return true;
+    }
+
+    // Clear the range reserved at va and give it back. Returns its size,
+    // 0 if nothing was reserved there.
+    uint64_t unbind(uint64_t va) {
+        const uint64_t bytes = mSpace.sizeOf(va);
+        if (!bytes) return 0;
+        clear(va, bytes >> 12);
+        mSpace.free(va);
+        return bytes;
+    }
+
+    // The caller's tag (the kext keeps the mapped GEM) for the range at va.
+    bool setTag(uint64_t va, uint64_t tag) { return mSpace.setTag(va, tag); }
+    uint64_t tagOf(uint64_t va) const { return mSpace.tagOf(va); }
+
+    // Make everything since the last commit visible: one barrier and, if
+    // an entry was cleared or replaced, one TLB invalidation; then the
+    // tables emptied meanwhile go back to the pool. Returns true if it
+    // invalidated.
+    bool commit() {
+        __sync_synchronize();
+        const bool flush = mDirty;
+        if (flush) {
+            if (mPlatform) mPlatform->invalidateTlb();
+            mStats.invalidations++;
+            mDirty = false;
+        }
+        for (uint32_t i = 0; i < mDeferred; ++i)
+            if (mPages) mPages->freePage(mDeferredPage[i]);
+        mDeferred = 0;
+        mStats.commits++;
+        return flush;
+    }
+
+    // Physical address va translates to, 0 if unmapped.
+    uint64_t translate(uint64_t va) const {
+        const Table* t = mRoot;
+        for (uint32_t level = kLevels - 1; t && level > 0; --level)
+            t = t->child[indexAt(va, level)];
+        if (!t) return 0;
+        const uint64_t e = t->page.cpu[indexAt(va, 0)];
+        return e ? (e & kAddrMask) | (va & 0xFFF) : 0;
+    }
+
+    uint64_t freeBytes() const { return mSpace.freeBytes(); }
+    const FXE_PpgttStats& stats() const { return mStats; }
+
+private:
+    struct Table {
+        FXE_PtPage page;
+        uint32_t   used;        // non-zero entries
+        Table**    child;       // kEntries, directories only
+    };
+
+    Table* newTable(uint32_t level) {
+        if (!mPlatform) return nullptr;
+        Table* t = (Table*)mPlatform->allocMeta(sizeof(Table));
+        if (!t) return nullptr;
+        if (level && !(t->child = (Table**)mPlatform->allocMeta(kEntries * sizeof(Table*)))) {
+            mPlatform->freeMeta(t, sizeof(Table));
+            return nullptr;
+        }
+        if (!mPages || !mPages->allocPage(&t->page)) {
+            if (t->child) mPlatform->freeMeta(t->child, kEntries * sizeof(Table*));
+            mPlatform->freeMeta(t, sizeof(Table));
+            return nullptr;
+        }
+        t->used = 0;
+        mStats.tableAllocs++;
+        if (++mStats.tables > mStats.peakTables) mStats.peakTables = mStats.tables;
+        return t;
+    }
+
+    // Hand t's page back at the next commit (now if the batch is full).
+    void dropTable(Table* t, uint32_t level) {
+        if (mDeferred == kMaxDeferred) commit();
+        mDeferredPage[mDeferred++] = t->page;
+        if (level) mPlatform->freeMeta(t->child, kEntries * sizeof(Table*));
+        mPlatform->freeMeta(t, sizeof(Table));
+        mStats.tableFrees++;
+        mStats.tables--;
+    }
+
+    // Page table covering va, creating the directories down to it.
+    Table* walk(uint64_t va, bool create) {
+        Table* t = mRoot;
+        for (uint32_t level = kLevels - 1; t && level > 0; --level) {
+            const uint32_t i = indexAt(va, level);
+            if (!t->child[i] && create) {
+                Table* c = newTable(level - 1);
+                if (!c) return nullptr;
+                t->child[i] = c;
+                t->page.cpu[i] = encode(c->page.phys);
+                t->used++;
+            }
+            t = t->child[i];
+        }
+        return t;
+    }
+
+    // Clear `pages` entries from va and drop tables that end up empty.
+    void clear(uint64_t va, uint64_t pages) {
+        while (pages) {
+            Table* path[kLevels] = {};
+            path[kLevels - 1] = mRoot;
+            for (uint32_t level = kLevels - 1; path[level] && level > 0; --level)
+                path[level - 1] = path[level]->child[indexAt(va, level)];
+
+            // entries left in this page table
+            const uint64_t span = kEntries - indexAt(va, 0);
+            const uint64_t n = pages < span ? pages : span;
+            Table* pt = path[0];
+            if (pt) {
+                for (uint64_t k = 0, i = indexAt(va, 0); k < n; ++k, ++i) {
+                    if (!pt->page.cpu[i]) continue;
+                    pt->page.cpu[i] = 0;
+                    pt->used--;
+                    mStats.ptesCleared++;
+                    mDirty = true;
+                }
+                // empty tables leave their parent, bottom up
+                for (uint32_t level = 0; level < kLevels - 1 && path[level] && !path[level]->used; ++level) {
+                    Table* parent = path[level + 1];
+                    const uint32_t i = indexAt(va, level + 1);
+                    parent->page.cpu[i] = 0;
+                    parent->child[i] = nullptr;
+                    parent->used--;
+                    dropTable(path[level], level);
+                    mDirty = true;
+                }
+            }
+            va += n << 12;
+            pages -= n;
+        }
+    }
+
+    void freeTree(Table* t, uint32_t level) {
+        if (level) {
+            for (uint32_t i = 0; i < kEntries; ++i) {
+                if (!t->child[i]) continue;
+                freeTree(t->child[i], level - 1);
+                t->page.cpu[i] = 0;
+            }
+        } else {
+            memset(t->page.cpu, 0, kEntries * sizeof(uint64_t));   // back to the pool zeroed
+        }
+        dropTable(t, level);
+    }
+
+    FXE_PtPagePlatform* mPages;
+    FXE_PpgttPlatform*  mPlatform;
+    Table*              mRoot;
+    FXE_GgttSpace       mSpace;
+    FXE_PtPage          mDeferredPage[kMaxDeferred];
+    uint32_t            mDeferred;
+    bool                mDirty;
+    FXE_PpgttStats      mStats;
+};
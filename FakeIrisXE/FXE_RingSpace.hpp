@@ -0,0 +1,219 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// Legacy ring-buffer space accounting.
+//
+// The CPU writes commands at the tail, the command streamer consumes them
+// at the head. A packet is reserved whole before any of it is written:
+// reserve() waits until the engine has consumed enough to make room and
+// hands back a contiguous run of dwords, and commit() publishes the tail
+// once for everything reserved since the last commit.
+//
+// The head is cached. Space is computed against the cached value first
+// and the hardware head is read only when that is not enough, so a ring
+// that keeps up costs no MMIO reads at all. The ring is never filled
+// completely (kGap): head == tail always means empty.
+//
+// A packet never straddles the end of the ring; the rest of the ring is
+// padded with MI_NOOP and the packet starts at offset 0. Reservations are
+// rounded up to an even dword count (padded with MI_NOOP) since the tail
+// register is qword aligned.
+//
+// Tail writes can be coalesced. commitDeferred() publishes at once when
+// the ring has been quiet for the coalescing window, otherwise it leaves
+// the packet for a later tail write, due at most a window after the last
+// one; the caller arms a timer for deadline() and calls flushDue(). While
+// plugged (plug()/unplug() around a loop of submissions) every commit is
+// deferred and the last unplug publishes. commit() is the flush-now path
+// for latency-critical work and publishes everything pending with it. A
+// reservation that has to wait for room publishes what is pending first,
+// since the engine cannot consume it otherwise.
+//
+// Driven by FakeIrisXERing under its ring lock.
+//
+
+class FXE_RingPlatform {
+public:
+    virtual ~FXE_RingPlatform() {}
+    // Byte offset of the command streamer's head.
+    virtual uint32_t readHead() = 0;
+    // Make [.., tail) visible to the engine.
+    virtual void writeTail(uint32_t tail) = 0;
+    // Not enough room yet: back off before the next head read. `attempt`
+    // counts from 0 for each reservation; false gives up.
+    virtual bool waitForSpace(uint32_t attempt) = 0;
+};
+
+enum FXE_RingCommit {
+    FXE_RING_NOTHING    = 0,
+    FXE_RING_PUBLISHED  = 1,
+    FXE_RING_DEFERRED   = 2,    // tail write due by deadline()
+};
+
+struct FXE_RingStats {
+    uint64_t reserves;
+    uint64_t commits;       // tail writes
+    uint64_t coalesced;     // commits that left the tail write for later
+    uint64_t flushedByWait; // deferred tails published to make room
+    uint64_t headReads;     // the cached head was not enough
+    uint64_t waits;
+    uint64_t wraps;
+    uint64_t padDwords;     // MI_NOOPs at the wrap and for qword alignment
+    uint64_t timeouts;      // the engine did not make room in time
+    uint64_t tooLarge;
+    uint32_t peakUsed;      // bytes between head and tail, high-water mark
+};
+
+class FXE_RingSpace {
+public:
+    static const uint32_t kGap  = 64;
+    static const uint32_t kNoop = 0;           // MI_NOOP
+
+    void init(FXE_RingPlatform* platform, uint32_t* cpu, uint32_t bytes) {
+        mPlatform = platform;
+        mCpu = cpu;
+        mSize = bytes & ~7u;
+        mHead = 0;
+        mTail = 0;
+        mEmit = 0;
+        mPlug = 0;
+        mDeferred = 0;
+        mDeadline = 0;
+        mLastPublish = 0;
+        mPublished = false;
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    // A window of 0 disables coalescing outside plug()/unplug(); a tail
+    // write is forced every `maxDeferred` commits (0: no limit).
+    void setCoalesce(uint64_t windowNs, uint32_t maxDeferred) {
+        mWindow = windowNs;
+        mMaxDeferred = maxDeferred;
+    }
+
+    // `dwords` contiguous dwords to fill before commit(), or nullptr if the
+    // engine did not make room (nothing is written then).
+    uint32_t* reserve(uint32_t dwords) {
+        const uint32_t bytes = ((dwords + 1) & ~1u) * 4;
+        if (!mCpu || !dwords || bytes + kGap > mSize) {
+            mStats.tooLarge++;
+            return nullptr;
+        }
+        const uint32_t toEnd = mSize - mEmit;
+        const uint32_t wrap = bytes > toEnd ? toEnd : 0;
+        if (!waitFor(wrap + bytes)) {
+            mStats.timeouts++;
+            return nullptr;
+        }
+        if (wrap) {
+            fillNoop(mEmit, wrap);
+            mEmit = 0;
+            mStats.wraps++;
+        }
+        uint32_t* p = mCpu + (mEmit >> 2);
+        if (bytes != dwords * 4) fillNoop(mEmit + dwords * 4, 4);
+        mEmit += bytes;
+        if (mEmit == mSize) mEmit = 0;
+        mStats.reserves++;
+        const uint32_t u = used();
+        if (u > mStats.peakUsed) mStats.peakUsed = u;
+        return p;
+    }
+
+    // Publish everything reserved so far. False if there was nothing.
+    bool commit(uint64_t nowNs = 0) {
+        if (mEmit == mTail) return false;
+        publish(nowNs);
+        return true;
+    }
+
+    // Publish now or leave it for flushDue()/unplug(), see above.
+    FXE_RingCommit commitDeferred(uint64_t nowNs) {
+        if (mEmit == mTail) return FXE_RING_NOTHING;
+        const bool recent = mPublished && nowNs - mLastPublish < mWindow;
+        if ((mPlug || recent) && (!mMaxDeferred || mDeferred + 1 < mMaxDeferred)) {
+            if (!mDeferred) mDeadline = (recent ? mLastPublish : nowNs) + mWindow;
+            mDeferred++;
+            mStats.coalesced++;
+            return FXE_RING_DEFERRED;
+        }
+        publish(nowNs);
+        return FXE_RING_PUBLISHED;
+    }
+
+    // The deferred tail write is due.
+    bool flushDue(uint64_t nowNs) {
+        if (mEmit == mTail || nowNs < mDeadline) return false;
+        publish(nowNs);
+        return true;
+    }
+
+    void plug() { mPlug++; }
+    bool unplug(uint64_t nowNs) {
+        if (!mPlug || --mPlug) return false;
+        return commit(nowNs);
+    }
+
+    bool pending() const { return mEmit != mTail; }
+    uint32_t deferred() const { return mDeferred; }
+    uint64_t deadline() const { return mDeadline; }
+
+    // Bytes between the cached head and the emit point.
+    uint32_t used() const { return mEmit >= mHead ? mEmit - mHead : mSize - mHead + mEmit; }
+    uint32_t space() const { return mSize - used() > kGap ? mSize - used() - kGap : 0; }
+
+    uint32_t size() const { return mSize; }
+    uint32_t tail() const { return mTail; }
+    uint32_t cachedHead() const { return mHead; }
+    const FXE_RingStats& stats() const { return mStats; }
+
+private:
+    void publish(uint64_t nowNs) {
+        mTail = mEmit;
+        mPlatform->writeTail(mTail);
+        mStats.commits++;
+        mLastPublish = nowNs;
+        mPublished = true;
+        mDeferred = 0;
+        mDeadline = 0;
+    }
+
+    bool waitFor(uint32_t bytes) {
+        for (uint32_t attempt = 0; space() < bytes; ++attempt) {
+            if (attempt == 1 && mEmit != mTail) {
+                publish(mLastPublish);
+                mStats.flushedByWait++;
+            }
+            if (attempt && !mPlatform->waitForSpace(attempt - 1))
+                return false;
+            if (attempt) mStats.waits++;
+            mHead = (mPlatform->readHead() & ~7u) % mSize;
+            mStats.headReads++;
+        }
+        return true;
+    }
+
+    void fillNoop(uint32_t offset, uint32_t bytes) {
+        for (uint32_t i = 0; i < bytes / 4; ++i) mCpu[(offset >> 2) + i] = kNoop;
+        mStats.padDwords += bytes / 4;
+    }
+
+    FXE_RingPlatform* mPlatform;
+    uint32_t*         mCpu;
+    uint32_t          mSize;
+    uint32_t          mHead;      // cached hardware head
+    uint32_t          mTail;      // last published tail
+    uint32_t          mEmit;      // end of the last reservation
+    uint32_t          mPlug;
+    uint32_t          mDeferred;  // commits since the last tail write
+    uint32_t          mMaxDeferred = 0;
+    uint64_t          mWindow = 0;
+    uint64_t          mDeadline;
+    uint64_t          mLastPublish;
+    bool              mPublished;
+    FXE_RingStats     mStats;
+};
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Execlist scheduling core: priority bands, per-band timeslice quantum and
+// preempt-to-idle decisions for the two ELSP ports.
+//
+// FXE_*.hpp headers hold pure logic with no IOKit dependencies, so the
+// same code runs inside the kext and in the host tests under TestApp/.
+// Anything platform-specific (memory, MMIO, fences, locks) comes from the
+// kext through a small platform interface or from the caller; each header
+// only names which kext class drives it and under which lock.
+//
+// The kext (FakeIrisXEExeclist) owns the locking and the clock here; every
+// time input is in ns.
+//
+
+enum : uint32_t {
+    FXE_SCHED_PRIO_LOW      = 0,
+    FXE_SCHED_PRIO_NORMAL   = 1,
+    FXE_SCHED_PRIO_HIGH     = 2,
+    FXE_SCHED_PRIO_REALTIME = 3,
+    FXE_SCHED_PRIO_COUNT    = 4,
+};
+
+enum : uint8_t {
+    FXE_REQ_FREE       = 0,
+    FXE_REQ_QUEUED     = 1,   // waiting for a port
+    FXE_REQ_RUNNING    = 2,   // owns a port
+    FXE_REQ_PREEMPTING = 3,   // preempt-to-idle requested, CSB not seen yet
+};
+
+enum : uint32_t {
+    FXE_PREEMPT_NONE     = 0,
+    FXE_PREEMPT_QUANTUM  = 1,  // timeslice expired and an equal/higher band waits
+    FXE_PREEMPT_PRIORITY = 2,  // a higher band arrived and no port is free
+};
+
+struct FXE_SchedRequest {
+    uint32_t ctxId;
+    uint32_t band;
+    uint32_t seqno;
+    uint32_t ringHead;      // resume point, refreshed from the LRC on preemption
+    uint32_t ringTail;
+    uint64_t order;         // FIFO key inside a band, bumped on requeue
+    uint32_t preemptions;
+    uint8_t  state;
+    int8_t   port;
+    bool     blocked;       // queued but waiting on input fences
+};
+
+struct FXE_SchedPort {
+    int32_t  req;           // request slot, -1 when idle
+    uint64_t startNs;
+    uint64_t quantumNs;     // 0 = never sliced
+    uint32_t preemptReason;
+};
+
+struct FXE_SchedStats {
+    uint64_t submitted;
+    uint64_t started;
+    uint64_t completed;
+    uint64_t faulted;
+    uint64_t cancelled;
+    uint64_t preemptQuantum;
+    uint64_t preemptPriority;
+    uint64_t resubmitted;
+    uint64_t replayed;
+};
+
+class FXE_Scheduler {
+public:
+    static const uint32_t kCapacity = 16;
+    static const uint32_t kPorts    = 2;
+
+    // Default quantum per band. Background work is sliced hardest so that
+    // interactive contexts get onto the engine quickly; realtime is never
+    // sliced and can only be displaced by completion.
+    static uint64_t defaultQuantumNs(uint32_t band) {
+        switch (band) {
+            case FXE_SCHED_PRIO_LOW:      return 1000000ULL;
+            case FXE_SCHED_PRIO_NORMAL:   return 2000000ULL;
+            case FXE_SCHED_PRIO_HIGH:     return 4000000ULL;
+            default:                      return 0;
+        }
+    }
+
+    static uint32_t bandForPriority(uint32_t priority) {
+        return priority >= FXE_SCHED_PRIO_COUNT ? FXE_SCHED_PRIO_REALTIME : priority;
+    }
+
+    void init() {
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            mReq[i] = FXE_SchedRequest();
+            mReq[i].state = FXE_REQ_FREE;
+            mReq[i].port = -1;
+        }
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            mPort[p] = FXE_SchedPort();
+            mPort[p].req = -1;
+        }
+        for (uint32_t b = 0; b < FXE_SCHED_PRIO_COUNT; ++b) {
+            mQuantumNs[b] = defaultQuantumNs(b);
+        }
+        mStats = FXE_SchedStats();
+        mNextOrder = 1;
+        mQueued = 0;
+        mUsed = 0;
+    }
+
+    void setQuantumNs(uint32_t band, uint64_t ns) {
+        if (band < FXE_SCHED_PRIO_COUNT) mQuantumNs[band] = ns;
+    }
+    uint64_t quantumNs(uint32_t band) const {
+        return band < FXE_SCHED_PRIO_COUNT ? mQuantumNs[band] : 0;
+    }
+
+    // Returns the request slot, or -1 when the table is full.
+    int32_t enqueue(uint32_t ctxId, uint32_t priority, uint32_t seqno,
+                    uint32_t ringHead, uint32_t ringTail) {
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            FXE_SchedRequest& r = mReq[i];
+            if (r.state != FXE_REQ_FREE) continue;
+            r.ctxId       = ctxId;
+            r.band        = bandForPriority(priority);
+            r.seqno       = seqno;
+            r.ringHead    = ringHead;
+            r.ringTail    = ringTail;
+            r.order       = mNextOrder++;
+            r.preemptions = 0;
+            r.state       = FXE_REQ_QUEUED;
+            r.port        = -1;
+            r.blocked     = false;
+            mQueued++;
+            mUsed++;
+            mStats.submitted++;
+            return (int32_t)i;
+        }
+        return -1;
+    }
+
+    // Highest band first, oldest first inside a band. A context's requests
+    // stay in seqno order and never occupy both ports, so a requeued
+    // (preempted) request is not overtaken by its own successors. Blocked
+    // requests are skipped (and hold back their context's later requests);
+    // ready work from other contexts goes ahead of them.
+    int32_t pickNext() const {
+        int32_t best = -1;
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            const FXE_SchedRequest& r = mReq[i];
+            if (r.state != FXE_REQ_QUEUED || r.blocked) continue;
+            if (!isContextHead((int32_t)i)) continue;
+            if (best < 0 ||
+                r.band > mReq[best].band ||
+                (r.band == mReq[best].band && r.order < mReq[best].order)) {
+                best = (int32_t)i;
+            }
+        }
+        return best;
+    }
+
+    int32_t freePort() const {
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            if (mPort[p].req < 0) return (int32_t)p;
+        }
+        return -1;
+    }
+
+    void start(uint32_t port, int32_t slot, uint64_t nowNs) {
+        if (port >= kPorts || !validSlot(slot)) return;
+        FXE_SchedRequest& r = mReq[slot];
+        if (r.state != FXE_REQ_QUEUED) return;
+        r.state = FXE_REQ_RUNNING;
+        r.port  = (int8_t)port;
+        mQueued--;
+        mPort[port].req           = slot;
+        mPort[port].startNs       = nowNs;
+        mPort[port].quantumNs     = mQuantumNs[r.band];
+        mPort[port].preemptReason = FXE_PREEMPT_NONE;
+        mStats.started++;
+        if (r.preemptions) mStats.resubmitted++;
+    }
+
+    // Decide which running ports should be preempted to idle. Marks them
+    // PREEMPTING and returns a port bitmask; the caller issues the
+    // hardware preempt and later reports the CSB via preempted().
+    uint32_t collectPreemptions(uint64_t nowNs) {
+        if (mQueued == 0) return 0;
+        // One preempt at a time: a pending one already frees a port.
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            if (mPort[p].preemptReason != FXE_PREEMPT_NONE) return 0;
+        }
+        const int32_t next = pickNext();
+        if (next < 0) return 0;
+        const uint32_t waitBand = mReq[next].band;
+
+        const bool havePort = freePort() >= 0;
+
+        // Priority: evict the lowest band running below the waiter, only
+        // when no port is free to take the waiter.
+        if (!havePort) {
+            int32_t victim = -1;
+            for (uint32_t p = 0; p < kPorts; ++p) {
+                const int32_t s = mPort[p].req;
+                if (s < 0 || mReq[s].state != FXE_REQ_RUNNING) continue;
+                if (mReq[s].band >= waitBand) continue;
+                if (victim < 0 || mReq[s].band < mReq[mPort[victim].req].band) victim = (int32_t)p;
+            }
+            if (victim >= 0) {
+                markPreempt((uint32_t)victim, FXE_PREEMPT_PRIORITY);
+                mStats.preemptPriority++;
+                return 1u << victim;
+            }
+        }
+
+        // Timeslice: a port that used its quantum yields to an equal or
+        // higher band waiter.
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            const int32_t s = mPort[p].req;
+            if (s < 0 || mReq[s].state != FXE_REQ_RUNNING) continue;
+            if (!mPort[p].quantumNs) continue;
+            if (nowNs - mPort[p].startNs < mPort[p].quantumNs) continue;
+            if (waitBand < mReq[s].band) continue;
+            markPreempt(p, FXE_PREEMPT_QUANTUM);
+            mStats.preemptQuantum++;
+            return 1u << p;
+        }
+        return 0;
+    }
+
+    // Absolute time of the next quantum expiry that could matter, or
+    // UINT64_MAX when no timer is needed.
+    // Mirrors collectPreemptions(): no timer while a preempt is in flight
+    // (its CSB re-runs the scheduler) or for ports the waiter cannot slice.
+    uint64_t nextDeadlineNs() const {
+        if (mQueued == 0) return UINT64_MAX;
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            if (mPort[p].preemptReason != FXE_PREEMPT_NONE) return UINT64_MAX;
+        }
+        const int32_t next = pickNext();
+        if (next < 0) return UINT64_MAX;
+        uint64_t when = UINT64_MAX;
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            const int32_t s = mPort[p].req;
+            if (s < 0 || mReq[s].state != FXE_REQ_RUNNING || !mPort[p].quantumNs) continue;
+            if (mReq[next].band < mReq[s].band) continue;
+            const uint64_t t = mPort[p].startNs + mPort[p].quantumNs;
+            if (t < when) when = t;
+        }
+        return when;
+    }
+
+    int32_t portForCtx(uint32_t ctxId) const {
+        for (uint32_t p = 0; p < kPorts; ++p) {
+            const int32_t s = mPort[p].req;
+            if (s >= 0 && mReq[s].ctxId == ctxId) return (int32_t)p;
+        }
+        return -1;
+    }
+
+    // Completion: frees the request, returns its slot (-1 if port was idle).
+    int32_t complete(uint32_t port) {
+        const int32_t s = releasePort(port);
+        if (s < 0) return -1;
+        mReq[s].state = FXE_REQ_FREE;
+        mUsed--;
+        mStats.completed++;
+        return s;
+    }
+
+    int32_t fault(uint32_t port) {
+        const int32_t s = releasePort(port);
+        if (s < 0) return -1;
+        mReq[s].state = FXE_REQ_FREE;
+        mUsed--;
+        mStats.faulted++;
+        return s;
+    }
+
+    // Preempted to idle: the request goes back to the tail of its band with
+    // the ring head the hardware saved, so it resumes where it stopped.
+    int32_t preempted(uint32_t port, uint32_t savedRingHead) {
+        const int32_t s = releasePort(port);
+        if (s < 0) return -1;
+        FXE_SchedRequest& r = mReq[s];
+        r.state    = FXE_REQ_QUEUED;
+        r.ringHead = savedRingHead;
+        r.order    = mNextOrder++;
+        r.preemptions++;
+        mQueued++;
+        return s;
+    }
+
+    // Engine was reset under the request (it was not the guilty one): put
+    // it back unchanged, keeping its place at the front of its band.
+    int32_t unwind(uint32_t port) {
+        const int32_t s = releasePort(port);
+        if (s < 0) return -1;
+        mReq[s].state = FXE_REQ_QUEUED;
+        mQueued++;
+        mStats.replayed++;
+        return s;
+    }
+
+    // Hold a queued request back from pickNext() until its dependencies
+    // are met.
+    void setBlocked(int32_t slot, bool blocked) {
+        if (validSlot(slot) && mReq[slot].state == FXE_REQ_QUEUED) mReq[slot].blocked = blocked;
+    }
+
+    // Drop a queued (not running) request, e.g. its context was banned.
+    bool cancel(int32_t slot) {
+        if (!validSlot(slot) || mReq[slot].state != FXE_REQ_QUEUED) return false;
+        mReq[slot].state = FXE_REQ_FREE;
+        mQueued--;
+        mUsed--;
+        mStats.cancelled++;
+        return true;
+    }
+
+    const FXE_SchedRequest& request(int32_t slot) const { return mReq[slot]; }
+    FXE_SchedRequest& request(int32_t slot) { return mReq[slot]; }
+    const FXE_SchedPort& port(uint32_t p) const { return mPort[p]; }
+    const FXE_SchedStats& stats() const { return mStats; }
+    uint32_t queued() const { return mQueued; }
+    uint32_t used() const { return mUsed; }
+    bool idle() const { return mUsed == 0; }
+
+private:
+    bool validSlot(int32_t slot) const { return slot >= 0 && (uint32_t)slot < kCapacity; }
+
+    bool isContextHead(int32_t slot) const {
+        const FXE_SchedRequest& r = mReq[slot];
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            const FXE_SchedRequest& o = mReq[i];
+            if ((int32_t)i == slot || o.state == FXE_REQ_FREE || o.ctxId != r.ctxId) continue;
+            if (o.state != FXE_REQ_QUEUED) return false;          // context already on a port
+            if ((int32_t)(o.seqno - r.seqno) < 0) return false;   // older request pending
+        }
+        return true;
+    }
+
+    void markPreempt(uint32_t port, uint32_t reason) {
+        mReq[mPort[port].req].state = FXE_REQ_PREEMPTING;
+        mPort[port].preemptReason = reason;
+    }
+
+    int32_t releasePort(uint32_t port) {
+        if (port >= kPorts) return -1;
+        const int32_t s = mPort[port].req;
+        if (s < 0) return -1;
+        mPort[port].req = -1;
+        mPort[port].preemptReason = FXE_PREEMPT_NONE;
+        mReq[s].port = -1;
+        return s;
+    }
+
+    FXE_SchedRequest mReq[kCapacity];
+    FXE_SchedPort    mPort[kPorts];
+    uint64_t         mQuantumNs[FXE_SCHED_PRIO_COUNT];
+    FXE_SchedStats   mStats;
+    uint64_t         mNextOrder;
+    uint32_t         mQueued;
+    uint32_t         mUsed;
+};
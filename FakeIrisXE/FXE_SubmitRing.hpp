@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// In-flight submissions of one ring, in seqno order.
+//
+// A fixed-capacity ring of plain entries: push() appends at the back in
+// O(1) and retire() pops from the front every entry whose seqno the
+// engine has completed (FXE_FencePage), in order. Nothing is allocated
+// per submission. Seqnos must be pushed in increasing order, which the
+// kext guarantees by issuing and pushing them under the ring lock; gaps
+// (a skipped seqno) are fine.
+//
+// Each entry owns what the engine reads until its seqno completes: the
+// caller's batch and, when they could not be carved from the chain pool
+// (FXE_BatchPool), standalone master/tail GEMs.
+//
+// A full ring refuses the push; the caller retires or fails the
+// submission rather than lose track of it.
+//
+// Driven by FakeIrisXEFramebuffer under fPendingLock; what retire() hands
+// back is recycled outside it.
+//
+
+struct FXE_Submission {
+    uint64_t seq;
+    void*    batch;         // the caller's batch: a reference and a pin
+    void*    master;        // standalone chain batch, or null
+    void*    tail;          // standalone fence-store batch, or null
+};
+
+struct FXE_SubmitRingStats {
+    uint64_t pushed;
+    uint64_t retired;
+    uint64_t full;          // pushes refused
+    uint64_t outOfOrder;    // pushes refused: seq not above the last one
+    uint32_t peak;
+};
+
+class FXE_SubmitRing {
+public:
+    static const uint32_t kCapacity = 256;     // power of two
+
+    void init() {
+        mHead = 0;
+        mTail = 0;
+        mLastSeq = 0;
+        memset(&mStats, 0, sizeof(mStats));
+    }
+
+    bool push(uint64_t seq, void* batch, void* master, void* tail) {
+        if (count() == kCapacity) {
+            mStats.full++;
+            return false;
+        }
+        if (seq <= mLastSeq) {
+            mStats.outOfOrder++;
+            return false;
+        }
+        FXE_Submission& s = mEntry[mTail & (kCapacity - 1)];
+        s.seq = seq;
+        s.batch = batch;
+        s.master = master;
+        s.tail = tail;
+        mTail++;
+        mLastSeq = seq;
+        mStats.pushed++;
+        if (count() > mStats.peak) mStats.peak = count();
+        return true;
+    }
+
+    // Take back the entry just pushed (its submission never reached the
+    // engine); its seqno may be pushed again.
+    bool popBack(FXE_Submission* out) {
+        if (mHead == mTail) return false;
+        mTail--;
+        if (out) *out = mEntry[mTail & (kCapacity - 1)];
+        mLastSeq = mEntry[mTail & (kCapacity - 1)].seq - 1;
+        mStats.pushed--;
+        return true;
+    }
+
+    // Pop up to `max` entries with seq <= completed into `out`, oldest
+    // first. Fewer than `max` means none are left to retire.
+    uint32_t retire(uint64_t completed, FXE_Submission* out, uint32_t max) {
+        uint32_t n = 0;
+        while (n < max && mHead != mTail && mEntry[mHead & (kCapacity - 1)].seq <= completed)
+            out[n++] = mEntry[mHead++ & (kCapacity - 1)];
+        mStats.retired += n;
+        return n;
+    }
+
+    // Pop up to `max` entries whatever their seqno (teardown, engine idle).
+    uint32_t drain(FXE_Submission* out, uint32_t max) {
+        return retire(~0ULL, out, max);
+    }
+
+    uint32_t count() const { return mTail - mHead; }
+    bool full() const { return count() == kCapacity; }
+    // Oldest seqno still in flight, 0 if none.
+    uint64_t oldest() const { return mHead != mTail ? mEntry[mHead & (kCapacity - 1)].seq : 0; }
+    const FXE_SubmitRingStats& stats() const { return mStats; }
+
+private:
+    FXE_Submission      mEntry[kCapacity];
+    uint32_t            mHead;      // free-running; masked on access
+    uint32_t            mTail;
+    uint64_t            mLastSeq;
+    FXE_SubmitRingStats mStats;
+};
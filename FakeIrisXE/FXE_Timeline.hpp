@@ -0,0 +1,162 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//
+// Per-context 64-bit seqno timelines in a shared, GGTT-visible status page.
+//
+// Every timeline owns a 64-byte slot; the engine writes the seqno of each
+// finished request to the first qword of its slot (post-sync, see
+// FXE_ExecCore::enqueue) before raising the completion CSB, so a waiter can
+// test a fence with a single memory read.
+//
+// Seqnos are allocated here, per timeline, and never reused: a timeline
+// slot keeps counting when the context owning it is destroyed and the slot
+// is handed to a new one, so fences of the old context stay signaled.
+//
+// Requests that never reach the breadcrumb (fault, cancel) are recorded by
+// the CPU with markError(). The breadcrumb of a later request moves past
+// them, so failures are remembered as the last few seqno ranges (a ban
+// cancels a contiguous run). Older failures read as signaled once a later
+// request has completed, and as failed until then.
+//
+// No locking: the caller serialises alloc/markError; state() may race
+// with the engine's write and only ever sees the value move forward.
+//
+// Each engine has its own page; a fence records the engine class that
+// issued it so it is evaluated against the right one.
+//
+
+struct FXE_Fence {
+    uint32_t timeline;
+    uint64_t seqno;     // 0 = no fence (always signaled)
+    uint32_t engine;    // engine class of the issuing execlist (0 = render)
+};
+
+enum : int32_t {
+    FXE_FENCE_PENDING  = 0,
+    FXE_FENCE_SIGNALED = 1,
+    FXE_FENCE_ERROR    = -1,
+};
+
+class FXE_TimelinePage {
+public:
+    static const uint32_t kStride        = 64;
+    static const uint32_t kMaxTimelines  = 64;     // 4 KB page
+    static const uint32_t kErrorRanges   = 4;
+
+    void init(void* cpu, uint64_t ggtt, uint32_t bytes) {
+        mCpu = (uint8_t*)cpu;
+        mGGTT = ggtt;
+        mCount = bytes / kStride;
+        if (mCount > kMaxTimelines) mCount = kMaxTimelines;
+        if (mCpu) memset(mCpu, 0, (size_t)mCount * kStride);
+        memset(mTl, 0, sizeof(mTl));
+    }
+
+    bool valid(uint32_t tl) const { return mCpu && tl < mCount; }
+    uint32_t count() const { return mCount; }
+
+    // Where the engine stores the 64-bit seqno of timeline `tl`.
+    uint64_t breadcrumbGGTT(uint32_t tl) const {
+        return valid(tl) ? mGGTT + (uint64_t)tl * kStride : 0;
+    }
+
+    // Next seqno for a request on `tl`; 0 if the page is not set up.
+    uint64_t alloc(uint32_t tl) {
+        if (!valid(tl)) return 0;
+        return ++mTl[tl].next;
+    }
+
+    // Give back the seqno just returned by alloc() when the submit failed.
+    void unalloc(uint32_t tl, uint64_t seqno) {
+        if (valid(tl) && seqno && mTl[tl].next == seqno) mTl[tl].next--;
+    }
+
+    uint64_t lastAllocated(uint32_t tl) const { return valid(tl) ? mTl[tl].next : 0; }
+
+    // Last seqno written by the engine.
+    uint64_t hwSeqno(uint32_t tl) const {
+        if (!valid(tl)) return 0;
+        return *(volatile const uint64_t*)(mCpu + (size_t)tl * kStride);
+    }
+
+    // Request `seqno` on `tl` finished without its breadcrumb.
+    void markError(uint32_t tl, uint64_t seqno) {
+        if (!valid(tl) || !seqno) return;
+        Timeline& t = mTl[tl];
+
+        Range* last = t.errCount ? &t.err[(t.errHead + t.errCount - 1) % kErrorRanges] : nullptr;
+        if (last && seqno >= last->first && seqno <= last->last + 1) {
+            if (seqno > last->last) last->last = seqno;
+            return;
+        }
+        if (t.errCount == kErrorRanges) {
+            if (t.err[t.errHead].last > t.errFloor) t.errFloor = t.err[t.errHead].last;
+            t.errHead = (t.errHead + 1) % kErrorRanges;
+            t.errCount--;
+        }
+        Range& r = t.err[(t.errHead + t.errCount) % kErrorRanges];
+        r.first = r.last = seqno;
+        t.errCount++;
+    }
+
+    bool failed(uint32_t tl, uint64_t seqno) const {
+        if (!valid(tl)) return false;
+        const Timeline& t = mTl[tl];
+        for (uint32_t i = 0; i < t.errCount; ++i) {
+            const Range& r = t.err[(t.errHead + i) % kErrorRanges];
+            if (seqno >= r.first && seqno <= r.last) return true;
+        }
+        return false;
+    }
+
+    int32_t state(const FXE_Fence& f) const {
+        if (!f.seqno) return FXE_FENCE_SIGNALED;
+        if (!valid(f.timeline) || f.seqno > mTl[f.timeline].next) return FXE_FENCE_ERROR;
+        if (failed(f.timeline, f.seqno)) return FXE_FENCE_ERROR;
+        if (hwSeqno(f.timeline) >= f.seqno) return FXE_FENCE_SIGNALED;
+        return f.seqno <= mTl[f.timeline].errFloor ? FXE_FENCE_ERROR : FXE_FENCE_PENDING;
+    }
+
+    // Evaluate N fences. waitAny: done as soon as one has finished (its
+    // index goes to *outIndex). Otherwise done when all have finished;
+    // *outIndex is the first failed fence, if any. Returns PENDING,
+    // SIGNALED or ERROR (some finished fence that counts has failed).
+    int32_t evaluate(const FXE_Fence* fences, uint32_t count, bool waitAny,
+                     uint32_t* outIndex) const {
+        int32_t result = waitAny ? FXE_FENCE_PENDING : FXE_FENCE_SIGNALED;
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t s = state(fences[i]);
+            if (waitAny) {
+                if (s != FXE_FENCE_PENDING) {
+                    if (outIndex) *outIndex = i;
+                    return s;
+                }
+            } else if (s == FXE_FENCE_PENDING) {
+                return FXE_FENCE_PENDING;
+            } else if (s == FXE_FENCE_ERROR && result != FXE_FENCE_ERROR) {
+                if (outIndex) *outIndex = i;
+                result = FXE_FENCE_ERROR;
+            }
+        }
+        return count ? result : FXE_FENCE_SIGNALED;
+    }
+
+private:
+    struct Range { uint64_t first; uint64_t last; };
+    struct Timeline {
+        uint64_t next;          // last seqno handed out
+        uint64_t errFloor;      // last seqno of the newest forgotten range
+        Range    err[kErrorRanges];
+        uint32_t errHead;
+        uint32_t errCount;
+    };
+
+    uint8_t* mCpu;
+    uint64_t mGGTT;
+    uint32_t mCount;
+    Timeline mTl[kMaxTimelines];
+};
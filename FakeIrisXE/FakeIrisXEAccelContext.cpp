@@ -2,6 +2,7 @@
 #include "FakeIrisXEAccelContext.h"
 #include "FakeIrisXEAccelerator.hpp"
 #include "FakeIrisXEFramebuffer.hpp"
+#include "FakeIrisXEGEM.hpp"
 #include <IOKit/IOLib.h>
 #include <IOKit/IOTimerEventSource.h>
 #include <IOKit/IOLib.h>
@@ -19,7 +20,8 @@ bool FakeIrisXEAccelContext::init() {
     if (!super::init()) return false;
     mCtxId = 0;
     mOwner = nullptr;
-    surf_vaddr = 0; surf_bytes = 0; surf_rowbytes = 0; surf_w = surf_h = 0;
+    surf_bytes = 0; surf_rowbytes = 0; surf_w = surf_h = 0;
+    surfGem = nullptr;
     return true;
 }
 
@@ -35,26 +37,32 @@ void FakeIrisXEAccelContext::stop(IOService* provider) {
 }
 
 void FakeIrisXEAccelContext::free() {
+    if (surfGem) {
+        surfGem->release();
+        surfGem = nullptr;
+    }
     super::free();
 }
 
-bool FakeIrisXEAccelContext::bindSurface_UserMapped(
-    const void* cpuPtr,
-    size_t bytes,
+bool FakeIrisXEAccelContext::bindSurface_Userptr(
+    FakeIrisXEGEM* gem,
     uint32_t rowBytes,
     uint32_t w,
     uint32_t h)
 {
-    if (!cpuPtr || w == 0 || h == 0)
+    if (!gem || !gem->isUserptr() || w == 0 || h == 0)
         return false;
 
-    surfCPU      = (void*)cpuPtr;
+    gem->retain();
+    if (surfGem) surfGem->release();
+    surfGem      = gem;
+    surf_bytes   = (size_t)gem->pageCount() << 12;
     surfRowBytes = rowBytes;
     surfWidth    = w;
     surfHeight   = h;
 
-    IOLog("Context %u: bound surface %ux%u rowBytes=%u cpuPtr=%p\n",
-         w, h, rowBytes, cpuPtr);
+    IOLog("Context %u: bound surface %ux%u rowBytes=%u gem=%p\n",
+         mCtxId, w, h, rowBytes, gem);
 
     return true;
 }
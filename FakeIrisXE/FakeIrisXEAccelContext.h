@@ -5,6 +5,7 @@
 #include <IOKit/IOService.h>
 
 class FakeIrisXEAccelerator;
+class FakeIrisXEGEM;
 
 #define super IOService
 class FakeIrisXEAccelContext : public IOService {
@@ -23,7 +24,8 @@ public:
     void setOwner(FakeIrisXEAccelerator* a) { mOwner = a; }
 
     // Bind and present APIs used by Shared
-    bool bindSurface_UserMapped(const void* userPtr, size_t bytes, uint32_t rowbytes, uint32_t w, uint32_t h);
+    // gem: a userptr GEM over the client's pixels, retained until rebound or freed
+    bool bindSurface_Userptr(FakeIrisXEGEM* gem, uint32_t rowbytes, uint32_t w, uint32_t h);
     bool presentContext();
 
 protected:
@@ -31,12 +33,11 @@ protected:
     FakeIrisXEAccelerator* mOwner;
 
     // surface metadata
-    uintptr_t surf_vaddr;
     size_t surf_bytes;
     uint32_t surf_rowbytes;
     uint32_t surf_w, surf_h;
 
-    void* surfCPU;
+    FakeIrisXEGEM* surfGem;
     uint32_t surfWidth;
     uint32_t surfHeight;
     uint32_t surfRowBytes;
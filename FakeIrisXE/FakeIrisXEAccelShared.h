@@ -22,10 +22,12 @@ enum {
     kFakeIrisXE_KextVersion_u32 = FXE_KEXT_VERSION_PACKED
 };
 
+class FakeIrisXEGEM;
+
 struct XECtx {
     uint32_t ctxId;
     bool alive;
-    uintptr_t surf_vaddr;   // kernel-side pointer (mapped via clientMemory / IOConnectMapMemory64)
+    FakeIrisXEGEM* surf_gem; // userptr GEM over the client's pixels (retained)
     size_t surf_bytes;
     uint32_t surf_rowbytes; // bytes per row in source
     uint32_t surf_w;
@@ -1,7 +1,9 @@
 #include "FakeIrisXEAccelerator.hpp"
 #include "FakeIrisXEAccelShared.h"
+#include "FakeIrisXEClientAccount.hpp"
 #include "FakeIrisXEFramebuffer.hpp"
 #include "FakeIrisXEIosurfaceCompat.hpp"
+#include "FakeIrisXEPpgtt.hpp"
 #include "FakeIrisXETrace.hpp"
 #include <IOKit/IOLib.h>
 #include <IOKit/IOTimerEventSource.h>
@@ -161,7 +163,23 @@ void FakeIrisXEAccelerator::stop(IOService* provider) {
         fRingBase = nullptr;
     }
 
-    if (fContexts) { fContexts->release(); fContexts = nullptr; }
+    if (fContexts) {
+        for (unsigned i = 0; i < fContexts->getCount(); ++i) {
+            OSData* d = OSDynamicCast(OSData, fContexts->getObject(i));
+            XEContext* ctx = d ? (XEContext*)d->getBytesNoCopy() : nullptr;
+            if (ctx && ctx->vm) {
+                ctx->vm->release();
+                ctx->vm = nullptr;
+            }
+            if (ctx && ctx->account) {
+                ctx->account->account().removeContext();
+                ctx->account->release();
+                ctx->account = nullptr;
+            }
+        }
+        fContexts->release();
+        fContexts = nullptr;
+    }
     if (fCtxLock) { IOLockFree(fCtxLock); fCtxLock = nullptr; }
 
     fFB = nullptr;
@@ -225,17 +243,26 @@ FakeIrisXEAccelerator::XEContext* FakeIrisXEAccelerator::lookupContext(uint32_t
 }
 
 
-uint32_t FakeIrisXEAccelerator::createContext(uint64_t sharedPtr, uint32_t flags)
+uint32_t FakeIrisXEAccelerator::createContext(uint64_t sharedPtr, uint32_t flags, FakeIrisXEPpgtt* vm,
+                                              FakeIrisXEClientAccount* account)
 {
     FXE_PHASE("ACCEL", 300, "createContext enter flags=0x%08x", flags);
     XEContext ctx{};
     ctx.ctxId = fNextCtxId++;
     ctx.active = true;
     ctx.sharedGPUPtr = sharedPtr;
+    ctx.vm = vm;
+    ctx.account = account;
 
     // Wrap context struct in OSData
     OSData* data = OSData::withBytes(&ctx, sizeof(ctx));
     if (!data) return 0;
+    if (vm)
+        vm->retain();
+    if (account) {
+        account->retain();
+        account->account().addContext();
+    }
 
     fContexts->setObject(data);
     data->release(); // OSArray retains it
@@ -281,6 +308,10 @@ void FakeIrisXEAccelerator::pollRing(IOTimerEventSource* sender)
 
     IOLog("(FakeIrisXEFramebuffer) [Accel] pollRing(): head=%u tail=%u cap=%u\n", head, tail, cap);
 
+    // ring submissions from this pass share one tail write
+    if (fRcsRingFromFB)
+        fRcsRingFromFB->beginBatch();
+
     uint32_t processed = 0;
     while (tail != head && processed < MAX_PROC_PER_TICK) {
         // read header safely (handle wrap)
@@ -333,6 +364,9 @@ void FakeIrisXEAccelerator::pollRing(IOTimerEventSource* sender)
         ++processed;
     }
 
+    if (fRcsRingFromFB)
+        fRcsRingFromFB->endBatch();
+
     // If more work remains, reschedule quickly; otherwise use normal poll interval
     head = fHdr->head;
     if (tail != head) {
@@ -658,6 +692,7 @@ void FakeIrisXEAccelerator::freeContexts()
         if (!d) continue;
         XECtx *c = (XECtx*)d->getBytesNoCopy();
         if (c) {
+            if (c->surf_gem) c->surf_gem->release();
             IOFree(c, sizeof(XECtx));
         }
     }
@@ -683,7 +718,7 @@ uint32_t FakeIrisXEAccelerator::createContext()
     IOLockLock(contextsLock);
     c->ctxId = nextCtxId++;
     c->alive = true;
-    c->surf_vaddr = 0;
+    c->surf_gem = nullptr;
     c->surf_bytes = 0;
     c->surf_rowbytes = 0;
     c->surf_w = 0;
@@ -719,9 +754,20 @@ bool FakeIrisXEAccelerator::destroyContext(uint32_t ctxId)
             ctx->surfRowBytes = 0;
             ctx->surfIOSurfaceID = 0;
             ctx->hasSurface = false;
+            FakeIrisXEPpgtt* vm = ctx->vm;
+            FakeIrisXEClientAccount* account = ctx->account;
             fContexts->removeObject(i);
             // Note: OSData will free the bytes when released
             IOLockUnlock(fCtxLock);
+            // Return the engine context's LRC/ring to the execlist pool
+            if (fFB && fFB->fExeclist)
+                fFB->fExeclist->destroyHwContext(ctxId);
+            if (vm)
+                vm->release();
+            if (account) {
+                account->account().removeContext();
+                account->release();
+            }
             IOLog("(FakeIrisXEFramebuffer) [Accel] destroyContext %u\n", ctxId);
             FXE_PHASE("ACCEL", 311, "destroyContext done ctx=%u", ctxId);
             return true;
@@ -750,33 +796,35 @@ XECtx* FakeIrisXEAccelerator::findCtx(uint32_t ctxId)
     return res;
 }
 
-// ---------- bind surface: user mapped fallback ----------
-bool FakeIrisXEAccelerator::bindSurface_UserMapped(uint32_t ctxId,
-                                                   const void* userPtr,
-                                                   size_t bytes,
-                                                   uint32_t rowbytes,
-                                                   uint32_t w,
-                                                   uint32_t h)
+// ---------- bind surface: client memory through a userptr GEM ----------
+// The GEM (FakeIrisXEGEM::withUserRange) is retained; present reads the
+// client's pages through its kernel mapping, which stops working once the
+// client releases the range or exits.
+bool FakeIrisXEAccelerator::bindSurface_Userptr(uint32_t ctxId,
+                                                FakeIrisXEGEM* gem,
+                                                uint32_t rowbytes,
+                                                uint32_t w,
+                                                uint32_t h)
 {
     XECtx *c = findCtx(ctxId);
     if (!c) { IOLog("(FakeIrisXEFramebuffer) [Accel] bindSurface: no ctx %u\n", ctxId); return false; }
 
-    // The user must have already mapped the memory into kernel addressable memory via clientMemory mapping.
-    // We accept the userPtr as kernel-visible pointer. Validate basic fields.
-    if (!userPtr || bytes == 0 || rowbytes == 0 || w == 0 || h == 0) {
+    if (!gem || !gem->isUserptr() || rowbytes == 0 || w == 0 || h == 0) {
         IOLog("(FakeIrisXEFramebuffer) [Accel] bindSurface: bad args\n");
         return false;
     }
 
     // store mapping
-    c->surf_vaddr = (uintptr_t)userPtr;
-    c->surf_bytes = bytes;
+    gem->retain();
+    if (c->surf_gem) c->surf_gem->release();
+    c->surf_gem = gem;
+    c->surf_bytes = (size_t)gem->pageCount() << 12;
     c->surf_rowbytes = rowbytes;
     c->surf_w = w;
     c->surf_h = h;
 
-    IOLog("(FakeIrisXEFramebuffer) [Accel] bindSurface_UserMapped ctx=%u vaddr=%p bytes=%zu rowbytes=%u %ux%u\n",
-          ctxId, (void*)c->surf_vaddr, c->surf_bytes, c->surf_rowbytes, c->surf_w, c->surf_h);
+    IOLog("(FakeIrisXEFramebuffer) [Accel] bindSurface_Userptr ctx=%u gem=%p bytes=%zu rowbytes=%u %ux%u\n",
+          ctxId, gem, c->surf_bytes, c->surf_rowbytes, c->surf_w, c->surf_h);
 
     return true;
 }
@@ -787,7 +835,8 @@ bool FakeIrisXEAccelerator::presentContext(uint32_t ctxId)
     XECtx *c = findCtx(ctxId);
     if (!c) { IOLog("(FakeIrisXEFramebuffer) [Accel] present: no ctx %u\n", ctxId); return false; }
 
-    if (!c->surf_vaddr || c->surf_bytes == 0) {
+    const uint8_t *srcBase = c->surf_gem ? (const uint8_t*)c->surf_gem->cpuAddress() : nullptr;
+    if (!srcBase || c->surf_bytes == 0) {
         IOLog("(FakeIrisXEFramebuffer) [Accel] present: no surface bound for ctx %u\n", ctxId);
         return false;
     }
@@ -799,7 +848,6 @@ bool FakeIrisXEAccelerator::presentContext(uint32_t ctxId)
     }
 
     // Perform safe line-by-line copy (clamped)
-    const uint8_t *srcBase = (const uint8_t*)(uintptr_t)c->surf_vaddr;
     uint8_t *dstBase = (uint8_t*)fPixels;
 
     uint32_t copy_w = (c->surf_w < fW) ? c->surf_w : fW;
@@ -845,7 +893,10 @@ bool FakeIrisXEAccelerator::presentContext(uint32_t ctxId)
 
 bool FakeIrisXEAccelerator::submitGpuBatchForCtx(uint32_t ctxId,
                                                  FakeIrisXEGEM* batchGem,
-                                                 uint32_t priority)
+                                                 uint32_t priority,
+                                                 FXE_Fence* outFence,
+                                                 const FXE_Fence* inFences,
+                                                 uint32_t inCount)
 {
     if (!fFB || !fFB->fExeclist || !batchGem)
         return false;
@@ -854,14 +905,26 @@ bool FakeIrisXEAccelerator::submitGpuBatchForCtx(uint32_t ctxId,
 
     FakeIrisXEExeclist::XEHWContext* hw = ex->lookupHwContext(ctxId);
     if (!hw) {
-        hw = ex->createHwContextFor(ctxId, priority);
+        // a client context runs in its own address space
+        FakeIrisXEPpgtt* vm = nullptr;
+        if (fCtxLock) {
+            IOLockLock(fCtxLock);
+            XEContext* ctx = lookupContext(ctxId);
+            if (ctx && (vm = ctx->vm))
+                vm->retain();
+            IOLockUnlock(fCtxLock);
+        }
+        hw = ex->createHwContextFor(ctxId, priority, vm);
+        if (vm)
+            vm->release();
         if (!hw) {
             IOLog("(FakeIrisXEFramebuffer) [Accel] submitGpuBatchForCtx: createHwContextFor FAILED\n");
             return false;
         }
     }
 
-    return ex->submitForContext(hw, batchGem);
+    // inFences may come from any engine (e.g. a blit writing a texture)
+    return ex->submitForContext(hw, batchGem, outFence, inFences, inCount);
 }
 
 
@@ -19,6 +19,8 @@
 
 // Forward-declare the framebuffer class
 class FakeIrisXEFramebuffer;
+class FakeIrisXEPpgtt;
+class FakeIrisXEClientAccount;
 
 // Include the shared structures used in public methods
 #include "FakeIrisXEAccelShared.h"
@@ -50,6 +52,9 @@ public:
         uint32_t surfIOSurfaceID{0};
         uint32_t surfID{0};
         void* surfCPU{nullptr}; // user-space mapped CPU pointer
+
+        FakeIrisXEPpgtt* vm{nullptr}; // client address space (retained), null: GGTT
+        FakeIrisXEClientAccount* account{nullptr}; // owning client (retained)
     };
 
     // --- IOService Overrides ---
@@ -71,9 +76,12 @@ public:
      * @brief Creates a new accelerator context.
      * @param sharedPtr Client-space pointer to shared data.
      * @param flags Creation flags.
+     * @param vm The client's address space; its HW contexts use these page tables.
+     * @param account The owning client's account; counts the context.
      * @return A non-zero context ID on success, 0 on failure.
      */
-    uint32_t createContext(uint64_t sharedPtr, uint32_t flags);
+    uint32_t createContext(uint64_t sharedPtr, uint32_t flags, FakeIrisXEPpgtt* vm = nullptr,
+                           FakeIrisXEClientAccount* account = nullptr);
 
     /**
      * @brief Destroys an accelerator context.
@@ -177,7 +185,7 @@ public:
         uint32_t createContext();
         XECtx* findCtx(uint32_t ctxId);
 
-        bool bindSurface_UserMapped(uint32_t ctxId, const void* userPtr, size_t bytes, uint32_t rowbytes, uint32_t w, uint32_t h);
+        bool bindSurface_Userptr(uint32_t ctxId, FakeIrisXEGEM* gem, uint32_t rowbytes, uint32_t w, uint32_t h);
         bool presentContext(uint32_t ctxId);
 
 
@@ -191,7 +199,10 @@ public:
 
     bool submitGpuBatchForCtx(uint32_t ctxId,
                                                      FakeIrisXEGEM* batchGem,
-                                                     uint32_t priority);
+                                                     uint32_t priority,
+                                                     FXE_Fence* outFence = nullptr,
+                                                     const FXE_Fence* inFences = nullptr,
+                                                     uint32_t inCount = 0);
     
     
     FakeIrisXEFramebuffer* getFramebufferOwner() { return fFB; }
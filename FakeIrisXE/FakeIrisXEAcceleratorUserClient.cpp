@@ -2,14 +2,18 @@
 
 #include "FakeIrisXEAccelShared.h"
 #include "FakeIrisXEAccelerator.hpp"
+#include "FakeIrisXEClientAccount.hpp"
 #include "FakeIrisXEExeclist.hpp"
 #include "FakeIrisXEFramebuffer.hpp"
+#include "FakeIrisXEGEM.hpp"
 #include "FakeIrisXEIosurfaceCompat.hpp"
+#include "FakeIrisXEPpgtt.hpp"
 #include "FakeIrisXETrace.hpp"
 
 #include <IOKit/IOLib.h>
 #include <IOKit/IOMemoryDescriptor.h>
 #include <string.h>
+#include <sys/proc.h>
 
 volatile int32_t gFakeIrisXEGlobalPhase = 0;
 
@@ -51,14 +55,17 @@ const IOExternalMethodDispatch FakeIrisXEAcceleratorUserClient::sDispatchTable[8
     {&FakeIrisXEAcceleratorUserClient::sAttachShared, 0, sizeof(FXE_AttachShared_In), 0, sizeof(FXE_AttachShared_Out)},
     {&FakeIrisXEAcceleratorUserClient::sBindSurface, 0, sizeof(FXE_BindSurface_In), 0, sizeof(FXE_BindSurface_Out)},
     {&FakeIrisXEAcceleratorUserClient::sPresent, 0, sizeof(FXE_Present_In), 0, sizeof(FXE_Present_Out)},
-    {nullptr, 0, 0, 0, 0},
-    {nullptr, 0, 0, 0, 0},
+    {&FakeIrisXEAcceleratorUserClient::sUserptrCreate, 0, sizeof(FXE_UserptrCreate_In), 0, sizeof(FXE_UserptrCreate_Out)},
+    {&FakeIrisXEAcceleratorUserClient::sUserptrRelease, 0, sizeof(FXE_UserptrRelease_In), 0, sizeof(FXE_UserptrRelease_Out)},
     {&FakeIrisXEAcceleratorUserClient::sFenceTest, 0, sizeof(FXE_FenceTest_In), 0, sizeof(FXE_FenceTest_Out)},
 };
 
 bool FakeIrisXEAcceleratorUserClient::initWithTask(task_t task, void* secID, UInt32 type) {
     if (!super::initWithTask(task, secID, type)) return false;
     fTask = task;
+    // opened from the client's own thread
+    fPid = (uint32_t)proc_selfpid();
+    proc_selfname(fProcName, sizeof(fProcName));
     return true;
 }
 
@@ -82,6 +89,16 @@ bool FakeIrisXEAcceleratorUserClient::start(IOService* provider) {
         return false;
     }
 
+    bzero(fUserptrs, sizeof(fUserptrs));
+    fUserptrLock = IOLockAlloc();
+    if (!fUserptrLock) {
+        FXE_LOG("[UC] allocation failure userptrLock");
+        return false;
+    }
+
+    if (FakeIrisXEFramebuffer* fb = fOwner->getFramebufferOwner())
+        fAccount = fb->openClientAccount(fPid, fProcName);
+
     if (mIOSurfaceEnabled) {
         FXE_LOG("[IOSurface] ENABLED lookupOK=1");
     } else {
@@ -107,6 +124,23 @@ void FakeIrisXEAcceleratorUserClient::stop(IOService* provider) {
     fSurfaceStore.clearAll();
     fSurfaceStore.free();
 
+    releaseAllUserptrs();
+    if (fUserptrLock) {
+        IOLockFree(fUserptrLock);
+        fUserptrLock = nullptr;
+    }
+    // contexts still running in it hold their own reference
+    if (fVm) {
+        fVm->release();
+        fVm = nullptr;
+    }
+    if (fAccount) {
+        if (FakeIrisXEFramebuffer* fb = fOwner ? fOwner->getFramebufferOwner() : nullptr)
+            fb->closeClientAccount(fAccount);
+        fAccount->release();
+        fAccount = nullptr;
+    }
+
     if (fOwner) {
         fOwner->setProperty("FakeIrisXEUCReady", kOSBooleanFalse);
     }
@@ -119,6 +153,8 @@ void FakeIrisXEAcceleratorUserClient::stop(IOService* provider) {
 IOReturn FakeIrisXEAcceleratorUserClient::clientClose() {
     FXE_PHASE("UC", 910, "clientClose");
     fSurfaceStore.clearAll();
+    // also reached when the client task dies: no GPU access to its pages after this
+    releaseAllUserptrs();
     terminate();
     return kIOReturnSuccess;
 }
@@ -199,6 +235,16 @@ IOReturn FakeIrisXEAcceleratorUserClient::sPresent(OSObject* target, void*, IOEx
     return uc ? uc->methodPresent(args) : kIOReturnBadArgument;
 }
 
+IOReturn FakeIrisXEAcceleratorUserClient::sUserptrCreate(OSObject* target, void*, IOExternalMethodArguments* args) {
+    FakeIrisXEAcceleratorUserClient* uc = OSDynamicCast(FakeIrisXEAcceleratorUserClient, target);
+    return uc ? uc->methodUserptrCreate(args) : kIOReturnBadArgument;
+}
+
+IOReturn FakeIrisXEAcceleratorUserClient::sUserptrRelease(OSObject* target, void*, IOExternalMethodArguments* args) {
+    FakeIrisXEAcceleratorUserClient* uc = OSDynamicCast(FakeIrisXEAcceleratorUserClient, target);
+    return uc ? uc->methodUserptrRelease(args) : kIOReturnBadArgument;
+}
+
 IOReturn FakeIrisXEAcceleratorUserClient::sFenceTest(OSObject* target, void*, IOExternalMethodArguments* args) {
     FakeIrisXEAcceleratorUserClient* uc = OSDynamicCast(FakeIrisXEAcceleratorUserClient, target);
     return uc ? uc->methodFenceTest(args) : kIOReturnBadArgument;
@@ -213,7 +259,7 @@ IOReturn FakeIrisXEAcceleratorUserClient::methodGetCaps(IOExternalMethodArgument
     out.abiMajor = FXE_ABI_MAJOR;
     out.abiMinor = FXE_ABI_MINOR;
     out.kextVersionPacked = FXE_KEXT_VERSION_PACKED;
-    out.features = mIOSurfaceEnabled ? 0x1u : 0u;
+    out.features = (mIOSurfaceEnabled ? FXE_FEATURE_IOSURFACE : 0u) | FXE_FEATURE_USERPTR | FXE_FEATURE_PPGTT;
 
     bcopy(&out, args->structureOutput, sizeof(out));
     args->structureOutputSize = sizeof(out);
@@ -234,7 +280,7 @@ IOReturn FakeIrisXEAcceleratorUserClient::methodCreateContext(IOExternalMethodAr
 
     const FXE_CreateCtx_In* in = (const FXE_CreateCtx_In*)args->structureInput;
     FXE_CreateCtx_Out out = {};
-    out.ctxId = fOwner ? fOwner->createContext(0, in->flags) : mNextCtxId++;
+    out.ctxId = fOwner ? fOwner->createContext(0, in->flags, addressSpace(), fAccount) : mNextCtxId++;
     out.rc = out.ctxId ? FXE_OK : FXE_EINTERNAL;
 
     bcopy(&out, args->structureOutput, sizeof(out));
@@ -355,6 +401,169 @@ IOReturn FakeIrisXEAcceleratorUserClient::methodPresent(IOExternalMethodArgument
     return kIOReturnSuccess;
 }
 
+IOReturn FakeIrisXEAcceleratorUserClient::methodUserptrCreate(IOExternalMethodArguments* args) {
+    if (!args || !args->structureInput || !args->structureOutput ||
+        args->structureInputSize != sizeof(FXE_UserptrCreate_In) ||
+        args->structureOutputSize != sizeof(FXE_UserptrCreate_Out)) {
+        return kIOReturnBadArgument;
+    }
+
+    const FXE_UserptrCreate_In* in = (const FXE_UserptrCreate_In*)args->structureInput;
+    FXE_UserptrCreate_Out out = {};
+    FakeIrisXEFramebuffer* fb = fOwner ? fOwner->getFramebufferOwner() : nullptr;
+    IOReturn kr = kIOReturnSuccess;
+    FakeIrisXEGEM* gem = nullptr;
+    uint32_t slot = kMaxUserptrs;
+    const bool ppgtt = (in->flags & FXE_USERPTR_FLAG_PPGTT) != 0;
+    FakeIrisXEPpgtt* vm = nullptr;
+    uint64_t vmAddr = 0;
+
+    if (!fb || !fUserptrLock) {
+        out.rc = FXE_ENOTREADY;
+        kr = kIOReturnNotReady;
+    } else if (!in->address || !in->length || ((in->address | in->length) & 0xFFFULL) ||
+               (!in->width != !in->height) || (ppgtt && in->width) ||
+               (in->flags & ~(uint32_t)FXE_USERPTR_FLAG_PPGTT)) {
+        out.rc = FXE_EINVAL;
+        kr = kIOReturnBadArgument;
+    } else if (!(gem = FakeIrisXEGEM::withUserRange(fTask, (mach_vm_address_t)in->address,
+                                                    (size_t)in->length))) {
+        out.rc = FXE_EINTERNAL;
+        kr = kIOReturnNoMemory;
+    } else if (fAccount && !gem->setAccount(fAccount)) {
+        out.rc = FXE_EQUOTA;
+        kr = kIOReturnNoSpace;
+    } else {
+        // the pin keeps the mapping (and so the wiring) until release
+        gem->pin();
+        const uint64_t denied = fAccount ? fAccount->account().stats().denied : 0;
+        if (!ppgtt)
+            out.gpuAddr = fb->mapGEMToGGTT(gem);
+        else if ((vm = addressSpace()))
+            out.gpuAddr = vmAddr = vm->map(gem);
+        if (!out.gpuAddr) {
+            const bool quota = fAccount && fAccount->account().stats().denied != denied;
+            out.rc = quota ? FXE_EQUOTA : FXE_EINTERNAL;
+            kr = quota ? kIOReturnNoSpace : kIOReturnNoResources;
+        } else if (in->width) {
+            uint64_t gpu = 0;
+            kr = fb->importUserSurface(gem, in->width, in->height, in->pixelFormat, &out.surfaceId, &gpu);
+            if (kr != kIOReturnSuccess)
+                out.rc = kr == kIOReturnBadArgument ? FXE_EINVAL : FXE_EINTERNAL;
+        }
+    }
+
+    if (kr == kIOReturnSuccess) {
+        IOLockLock(fUserptrLock);
+        for (slot = 0; slot < kMaxUserptrs && fUserptrs[slot].gem; ++slot) {}
+        if (slot < kMaxUserptrs) {
+            fUserptrs[slot].gem = gem;
+            fUserptrs[slot].surfaceId = out.surfaceId;
+            fUserptrs[slot].vmAddr = vmAddr;
+            fUserptrs[slot].salt = ++fUserptrSalt;
+            out.handle = FXE_SurfaceStore::makeHandle(slot + 1, fUserptrs[slot].salt);
+        }
+        IOLockUnlock(fUserptrLock);
+        if (slot == kMaxUserptrs) {
+            if (out.surfaceId) fb->destroySurface(out.surfaceId);
+            out.rc = FXE_EINTERNAL;
+            kr = kIOReturnNoResources;
+        }
+    }
+
+    if (kr != kIOReturnSuccess && gem) {
+        if (vmAddr)
+            vm->unmap(vmAddr);
+        gem->invalidate();
+        gem->unpin();
+        gem->release();
+        out.gpuAddr = 0;
+        out.surfaceId = 0;
+    }
+
+    bcopy(&out, args->structureOutput, sizeof(out));
+    args->structureOutputSize = sizeof(out);
+    FXE_LOG("[UC][UserptrCreate] va=0x%llX len=%llu %ux%u -> handle=0x%llX gpu=0x%llX surface=%llu rc=0x%X",
+            (unsigned long long)in->address,
+            (unsigned long long)in->length,
+            in->width,
+            in->height,
+            (unsigned long long)out.handle,
+            (unsigned long long)out.gpuAddr,
+            (unsigned long long)out.surfaceId,
+            out.rc);
+    return kr;
+}
+
+IOReturn FakeIrisXEAcceleratorUserClient::methodUserptrRelease(IOExternalMethodArguments* args) {
+    if (!args || !args->structureInput || !args->structureOutput ||
+        args->structureInputSize != sizeof(FXE_UserptrRelease_In) ||
+        args->structureOutputSize != sizeof(FXE_UserptrRelease_Out)) {
+        return kIOReturnBadArgument;
+    }
+
+    const FXE_UserptrRelease_In* in = (const FXE_UserptrRelease_In*)args->structureInput;
+    FXE_UserptrRelease_Out out = {};
+    const uint32_t slot = (uint32_t)(in->handle & 0xFFFFFFFFu) - 1;
+    const uint32_t salt = (uint32_t)(in->handle >> 32);
+
+    out.rc = FXE_ENOENT;
+    if (fUserptrLock) {
+        IOLockLock(fUserptrLock);
+        if (slot < kMaxUserptrs && fUserptrs[slot].gem && fUserptrs[slot].salt == salt) {
+            releaseUserptrLocked(fUserptrs[slot]);
+            out.rc = FXE_OK;
+        }
+        IOLockUnlock(fUserptrLock);
+    }
+
+    bcopy(&out, args->structureOutput, sizeof(out));
+    args->structureOutputSize = sizeof(out);
+    FXE_LOG("[UC][UserptrRelease] handle=0x%llX rc=0x%X", (unsigned long long)in->handle, out.rc);
+    return out.rc == FXE_OK ? kIOReturnSuccess : kIOReturnNotFound;
+}
+
+// Drop the surface (which waits for its last blit), then the mapping and
+// the wiring, before the client can reuse or unmap the range.
+void FakeIrisXEAcceleratorUserClient::releaseUserptrLocked(UserptrEntry& e) {
+    FakeIrisXEFramebuffer* fb = fOwner ? fOwner->getFramebufferOwner() : nullptr;
+    if (e.surfaceId && fb)
+        fb->destroySurface(e.surfaceId);
+    if (e.vmAddr && fVm)
+        fVm->unmap(e.vmAddr);
+    e.gem->invalidate();
+    e.gem->unpin();
+    e.gem->release();
+    bzero(&e, sizeof(e));
+}
+
+void FakeIrisXEAcceleratorUserClient::releaseAllUserptrs() {
+    if (!fUserptrLock) return;
+    IOLockLock(fUserptrLock);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < kMaxUserptrs; ++i) {
+        if (fUserptrs[i].gem) {
+            releaseUserptrLocked(fUserptrs[i]);
+            n++;
+        }
+    }
+    IOLockUnlock(fUserptrLock);
+    if (n) FXE_LOG("[UC] released %u userptr objects", n);
+}
+
+FakeIrisXEPpgtt* FakeIrisXEAcceleratorUserClient::addressSpace() {
+    FakeIrisXEFramebuffer* fb = fOwner ? fOwner->getFramebufferOwner() : nullptr;
+    if (!fb || !fUserptrLock) return nullptr;
+    IOLockLock(fUserptrLock);
+    if (!fVm) {
+        fVm = FakeIrisXEPpgtt::withOwner(fb);
+        if (fVm) FXE_LOG("[UC] address space root=0x%llX", (unsigned long long)fVm->rootAddress());
+    }
+    FakeIrisXEPpgtt* vm = fVm;
+    IOLockUnlock(fUserptrLock);
+    return vm;
+}
+
 IOReturn FakeIrisXEAcceleratorUserClient::methodFenceTest(IOExternalMethodArguments* args) {
     if (!args || !args->structureInput || !args->structureOutput ||
         args->structureInputSize != sizeof(FXE_FenceTest_In) ||
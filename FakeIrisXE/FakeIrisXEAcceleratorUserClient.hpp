@@ -7,6 +7,9 @@
 #include "FXE_SurfaceStore.hpp"
 
 class FakeIrisXEAccelerator;
+class FakeIrisXEGEM;
+class FakeIrisXEPpgtt;
+class FakeIrisXEClientAccount;
 
 class FakeIrisXEAcceleratorUserClient : public IOUserClient {
     OSDeclareDefaultStructors(FakeIrisXEAcceleratorUserClient);
@@ -29,6 +32,8 @@ public:
     static IOReturn sAttachShared(OSObject* target, void* ref, IOExternalMethodArguments* args);
     static IOReturn sBindSurface(OSObject* target, void* ref, IOExternalMethodArguments* args);
     static IOReturn sPresent(OSObject* target, void* ref, IOExternalMethodArguments* args);
+    static IOReturn sUserptrCreate(OSObject* target, void* ref, IOExternalMethodArguments* args);
+    static IOReturn sUserptrRelease(OSObject* target, void* ref, IOExternalMethodArguments* args);
     static IOReturn sFenceTest(OSObject* target, void* ref, IOExternalMethodArguments* args);
 
     
@@ -37,14 +42,40 @@ public:
 private:
     FakeIrisXEAccelerator* fOwner;
     task_t fTask;
+    uint32_t fPid = 0;
+    char fProcName[32] = {};
+    // Everything this connection creates is charged here
+    FakeIrisXEClientAccount* fAccount = nullptr;
 
     IOReturn methodGetCaps(IOExternalMethodArguments* args);
     IOReturn methodCreateContext(IOExternalMethodArguments* args);
     IOReturn methodAttachShared(IOExternalMethodArguments* args);
     IOReturn methodBindSurface(IOExternalMethodArguments* args);
     IOReturn methodPresent(IOExternalMethodArguments* args);
+    IOReturn methodUserptrCreate(IOExternalMethodArguments* args);
+    IOReturn methodUserptrRelease(IOExternalMethodArguments* args);
     IOReturn methodFenceTest(IOExternalMethodArguments* args);
 
+    // Userptr GEMs created by this client, each pinned (so wired and
+    // mapped) until released or the client goes away.
+    static const uint32_t kMaxUserptrs = 32;
+    struct UserptrEntry {
+        FakeIrisXEGEM* gem;
+        uint64_t surfaceId;
+        uint64_t vmAddr;        // mapped in fVm rather than the GGTT
+        uint32_t salt;
+    };
+    UserptrEntry fUserptrs[kMaxUserptrs];
+    uint32_t fUserptrSalt = 0;
+    IOLock* fUserptrLock = nullptr;
+    void releaseUserptrLocked(UserptrEntry& e);
+    void releaseAllUserptrs();
+
+    // The connection's GPU address space, created on first use (under
+    // fUserptrLock); every context it creates runs in it.
+    FakeIrisXEPpgtt* fVm = nullptr;
+    FakeIrisXEPpgtt* addressSpace();
+
     FXE_SurfaceStore fSurfaceStore;
     bool mIOSurfaceEnabled = false;
     uint64_t mCompletionCounter = 0;
@@ -0,0 +1,58 @@
+//
+//  FakeIrisXEClientAccount.cpp
+//  FakeIrisXEFramebuffer
+//
+
+#include "FakeIrisXEClientAccount.hpp"
+#include <libkern/c++/OSNumber.h>
+#include <libkern/c++/OSString.h>
+
+#define super OSObject
+OSDefineMetaClassAndStructors(FakeIrisXEClientAccount, OSObject);
+
+FakeIrisXEClientAccount* FakeIrisXEClientAccount::withClient(uint32_t pid, const char* name,
+                                                             uint64_t softQuota, uint64_t hardQuota)
+{
+    FakeIrisXEClientAccount* acct = OSTypeAlloc(FakeIrisXEClientAccount);
+    if (!acct)
+        return nullptr;
+    if (!acct->init()) {
+        acct->release();
+        return nullptr;
+    }
+    acct->fAccount.init(pid, name);
+    acct->fAccount.setQuota(softQuota, hardQuota);
+    return acct;
+}
+
+static void SetNumber(OSDictionary* d, const char* key, uint64_t value)
+{
+    OSNumber* n = OSNumber::withNumber(value, 64);
+    if (!n)
+        return;
+    d->setObject(key, n);
+    n->release();
+}
+
+OSDictionary* FakeIrisXEClientAccount::copyStats() const
+{
+    OSDictionary* d = OSDictionary::withCapacity(12);
+    if (!d)
+        return nullptr;
+    const FXE_AccountStats st = fAccount.stats();
+    SetNumber(d, "PID", fAccount.pid());
+    if (OSString* name = OSString::withCString(fAccount.name())) {
+        d->setObject("Name", name);
+        name->release();
+    }
+    SetNumber(d, "AllocatedKB", st.allocated >> 10);
+    SetNumber(d, "MappedKB", st.mapped >> 10);
+    SetNumber(d, "PeakAllocatedKB", st.peakAllocated >> 10);
+    SetNumber(d, "PeakMappedKB", st.peakMapped >> 10);
+    SetNumber(d, "Objects", st.objects);
+    SetNumber(d, "Contexts", st.contexts);
+    SetNumber(d, "Surfaces", st.surfaces);
+    SetNumber(d, "SoftQuotaHits", st.softHits);
+    SetNumber(d, "QuotaDenied", st.denied);
+    return d;
+}
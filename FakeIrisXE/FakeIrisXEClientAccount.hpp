@@ -0,0 +1,34 @@
+//
+//  FakeIrisXEClientAccount.hpp
+//  FakeIrisXEFramebuffer
+//
+//  GPU memory held by one user-client connection (FXE_ClientAccount).
+//  GEMs and accelerator contexts keep a reference, so the counters stay
+//  valid for objects that outlive the connection.
+//
+
+#ifndef FakeIrisXEClientAccount_hpp
+#define FakeIrisXEClientAccount_hpp
+
+#include <IOKit/IOLib.h>
+#include <libkern/c++/OSObject.h>
+#include <libkern/c++/OSDictionary.h>
+#include "FXE_ClientAccount.hpp"
+
+class FakeIrisXEClientAccount : public OSObject {
+    OSDeclareDefaultStructors(FakeIrisXEClientAccount)
+
+public:
+    // Quotas in bytes, 0 for none.
+    static FakeIrisXEClientAccount* withClient(uint32_t pid, const char* name,
+                                               uint64_t softQuota, uint64_t hardQuota);
+
+    FXE_ClientAccount& account() { return fAccount; }
+    // Counters as a registry dictionary (caller releases), null on failure.
+    OSDictionary* copyStats() const;
+
+private:
+    FXE_ClientAccount fAccount;
+};
+
+#endif /* FakeIrisXEClientAccount_hpp */
@@ -15,14 +15,16 @@
 #include "FakeIrisXEFramebuffer.hpp"
 #include "FakeIrisXEGEM.hpp"
 #include "FakeIrisXELRC.hpp"
+#include "FakeIrisXEPpgtt.hpp"
 #include "i915_reg.h"
 
+#include <kern/clock.h>
 
 
 OSDefineMetaClassAndStructors(FakeIrisXEExeclist, OSObject);
 
 // FACTORY
-FakeIrisXEExeclist* FakeIrisXEExeclist::withOwner(FakeIrisXEFramebuffer* owner)
+FakeIrisXEExeclist* FakeIrisXEExeclist::withOwner(FakeIrisXEFramebuffer* owner, uint32_t engineClass)
 {
     FakeIrisXEExeclist* obj = OSTypeAlloc(FakeIrisXEExeclist);
     if (!obj) return nullptr;
@@ -33,26 +35,48 @@ FakeIrisXEExeclist* FakeIrisXEExeclist::withOwner(FakeIrisXEFramebuffer* owner)
     }
 
     obj->fOwner = owner;
+    obj->fEngineClass = engineClass;
+    obj->fRegs = engineClass == ENGINE_CLASS_COPY ? FXE_EngineRegs::bcs0() : FXE_EngineRegs::rcs0();
 
     // init HW context table
     obj->fHwContextCount = 0;
     for (uint32_t i = 0; i < kMaxHwContexts; ++i) {
         bzero(&obj->fHwContexts[i], sizeof(XEHWContext));
     }
+    obj->fCtxPoolCount = 0;
+
+    // golden LRC image, copied into every new context
+    obj->fGoldenLrc = (uint8_t*)IOMalloc(kHwCtxLrcSize);
+    if (!obj->fGoldenLrc) {
+        obj->release();
+        return nullptr;
+    }
+    FakeIrisXELRC::buildGoldenImage(obj->fGoldenLrc, kHwCtxLrcSize, kHwCtxRingSize);
 
     // init SW execlist queue
-    obj->fQHead     = 0;
-    obj->fQTail     = 0;
-    obj->fNextSeqno = 1;
     for (uint32_t i = 0; i < kMaxExeclistQueue; ++i) {
         bzero(&obj->fQueue[i], sizeof(ExecQueueEntry));
     }
-
-    // inflight slots
-    obj->fInflight[0] = nullptr;
-    obj->fInflight[1] = nullptr;
-    obj->fInflightSeqno[0] = 0;
-    obj->fInflightSeqno[1] = 0;
+    obj->fPlatform.fExec = obj;
+    obj->fCore.init(&obj->fPlatform, obj->fRegs);
+    obj->fElspDescGem  = nullptr;
+    obj->fElspDescGGTT = 0;
+    obj->fTimelineGem  = nullptr;
+    obj->fTimelineGGTT = 0;
+    obj->fTimeline.init(nullptr, 0, 0);
+    obj->fBatchPoolPlatform.fExec = obj;
+    obj->fBatchPool.init(&obj->fBatchPoolPlatform, kBatchPoolChunkSize);
+    obj->fEngineIO     = nullptr;
+
+    // timeslicing is armed later by startScheduler() once a workloop exists
+    obj->fTimesliceTimer = nullptr;
+    obj->fSchedWorkLoop  = nullptr;
+    obj->fDepTimer       = nullptr;
+    obj->fSchedLock      = IOLockAlloc();
+    if (!obj->fSchedLock) {
+        obj->release();
+        return nullptr;
+    }
 
     // CSB ring defaults – you can update in createHwContext/setupExeclistPorts
     obj->fCsbGem         = nullptr;
@@ -70,7 +94,20 @@ FakeIrisXEExeclist* FakeIrisXEExeclist::withOwner(FakeIrisXEFramebuffer* owner)
 // FREE (destructor)
 void FakeIrisXEExeclist::free()
 {
+    stopScheduler();
+    for (uint32_t i = 0; i < kMaxHwContexts; ++i)
+        recycleHwContext(&fHwContexts[i]);
+    drainContextPool();
+    fBatchPool.drain();
+    if (fGoldenLrc) {
+        IOFree(fGoldenLrc, kHwCtxLrcSize);
+        fGoldenLrc = nullptr;
+    }
     freeHwContext();
+    if (fSchedLock) {
+        IOLockFree(fSchedLock);
+        fSchedLock = nullptr;
+    }
     OSObject::free();
 }
 
@@ -81,6 +118,8 @@ void FakeIrisXEExeclist::free()
 
 // V57: Enhanced MMIO with diagnostics
 uint32_t FakeIrisXEExeclist::mmioRead32(uint32_t off) {
+    if (fEngineIO)
+        return fEngineIO->read32(off);
     uint32_t val = *(volatile uint32_t*)((uint8_t*)fOwner->fBar0 + off);
     // V57: Optional verbose logging for critical registers
     #ifdef V57_VERBOSE_MMIO
@@ -93,6 +132,10 @@ uint32_t FakeIrisXEExeclist::mmioRead32(uint32_t off) {
 }
 
 void FakeIrisXEExeclist::mmioWrite32(uint32_t off, uint32_t val) {
+    if (fEngineIO) {
+        fEngineIO->write32(off, val);
+        return;
+    }
     volatile uint32_t* p = (volatile uint32_t*)((uint8_t*)fOwner->fBar0 + off);
     *p = val;
     (void)*p; // posted write ordering
@@ -105,6 +148,45 @@ void FakeIrisXEExeclist::mmioWrite32(uint32_t off, uint32_t val) {
     #endif
 }
 
+uint64_t FakeIrisXEExeclist::ggttMapGem(FakeIrisXEGEM* gem)
+{
+    if (!gem)
+        return 0;
+    if (fEngineIO) {
+        IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+        return md ? fEngineIO->ggttMap(md->getBytesNoCopy(), md->getLength()) : 0;
+    }
+    return fOwner->ggttMap(gem);
+}
+
+// Map `count` GEMs under a single GGTT flush. Returns false (with every
+// mapping made so far undone) if one of them fails.
+bool FakeIrisXEExeclist::ggttMapGems(FakeIrisXEGEM* const* gems, uint64_t* out, uint32_t count)
+{
+    if (fEngineIO) {
+        for (uint32_t i = 0; i < count; ++i)
+            if (!(out[i] = ggttMapGem(gems[i])))
+                return false;
+        return true;
+    }
+    if (!fOwner->ggttBegin())
+        return false;
+    bool ok = true;
+    for (uint32_t i = 0; i < count; ++i)
+        out[i] = ok ? fOwner->ggttMapDeferred(gems[i], 0, "ggttMapGems") : 0;
+    for (uint32_t i = 0; i < count; ++i)
+        ok = ok && out[i];
+    if (!ok) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (out[i])
+                fOwner->ggttUnmapDeferred(out[i]);
+            out[i] = 0;
+        }
+    }
+    fOwner->ggttCommit();
+    return ok;
+}
+
 // V57: Enhanced ring buffer diagnostics
 void FakeIrisXEExeclist::dumpRingBufferStatus(const char* label) {
     if (!fOwner) return;
@@ -272,14 +354,94 @@ void FakeIrisXEExeclist::handleCsbEntry(uint64_t entry, uint32_t ctx_id, uint32_
 
 bool FakeIrisXEExeclist::createHwContext()
 {
-    IOLog("(FakeIrisXE) [Exec] Alloc LRC\n");
+    IOLog("(FakeIrisXE) [Exec] %s: Alloc LRC\n", engineName());
 
     if (!fOwner) {
         IOLog("(FakeIrisXE) [Exec] createHwContext(): fOwner == NULL\n");
         return false;
     }
 
+
+    // The GT soft reset, RCS ring reset and forcewake belong to the render
+    // engine. The copy engine is brought up after it and only needs its own
+    // LRC, CSB and descriptor pages.
+    if (fEngineClass == ENGINE_CLASS_RENDER && !bringUpRenderEngine())
+        return false;
+
+    const size_t ctxSize = 4096;
+
+    // ---------------------------
+    // Allocate LRC GEM
+    // ---------------------------
+    fLrcGem = FakeIrisXEGEM::withSize(ctxSize, 0);
+    if (!fLrcGem) {
+        IOLog("(FakeIrisXE) [Exec] LRC alloc failed\n");
+        return false;
+    }
+
+    // Zero memory
+    IOBufferMemoryDescriptor* md = fLrcGem->memoryDescriptor();
+    if (md) {
+        bzero(md->getBytesNoCopy(), md->getLength());
+    }
+
+    // Your pin() returns void!
+    fLrcGem->pin();
+
+    // Map into GGTT
+    fLrcGGTT = ggttMapGem(fLrcGem);
+
+    if (fLrcGGTT == 0) {
+        IOLog("(FakeIrisXE) [Exec] ggttMap(LRC) failed\n");
+        return false;
+    }
+
+    // Align to 4K as required by LRC hardware
+    fLrcGGTT &= ~0xFFFULL;
+
+    IOLog("(FakeIrisXE) [Exec] LRC @ GGTT=0x%llx\n", fLrcGGTT);
+
+
     
+    // ---------------------------
+    // Allocate CSB GEM (GEN12 requires ~128B, we use 256B safe)
+    // ---------------------------
+    IOLog("(FakeIrisXE) [Exec] Alloc CSB\n");
+
+    constexpr size_t kCSBSize = 0x100; // 256 bytes
+    fCsbGem = FakeIrisXEGEM::withSize(kCSBSize, 0);
+    if (!fCsbGem) {
+        IOLog("(FakeIrisXE) [Exec] No CSB alloc\n");
+        fCsbGGTT = 0;
+    } else {
+        fCsbGem->pin();
+        fCsbGGTT = ggttMapGem(fCsbGem);
+        if (fCsbGGTT)
+            fCsbGGTT &= ~0xFFFULL;
+        fCore.setCsb((volatile uint64_t*)fCsbGem->memoryDescriptor()->getBytesNoCopy(),
+                     fCsbEntryCount);
+    }
+
+    if (!ensureElspDescriptorPage() || !ensureTimelinePage())
+        return false;
+
+    // Pre-mapped context backings so the first app contexts skip allocation
+    if (!prewarmContextPool(kHwCtxPoolPrewarm))
+        IOLog("(FakeIrisXE) [Exec] context pool prewarm incomplete (%u)\n", fCtxPoolCount);
+
+
+    return true;
+}
+
+
+
+
+
+
+// Render-engine bring-up ahead of the first LRC: soft GT reset, RCS ring
+// reset, forcewake, completion IRQ.
+bool FakeIrisXEExeclist::bringUpRenderEngine()
+{
     // --- robust preamble for createHwContext() ---
     IOLog("(FakeIrisXE) [Exec] Alloc LRC (enter pre-reset checks)\n");
 
@@ -359,73 +521,12 @@ bool FakeIrisXEExeclist::createHwContext()
         mmioWrite32(0x4400C, 0x1);  // RCS0_IER = enable complete IRQ
         (void)mmioRead32(0x4400C);  // Posted read
         IOSleep(5);
-    
-    
-    // continue with LRC allocation...
-
-    
-    
-    const size_t ctxSize = 4096;
-
-    // ---------------------------
-    // Allocate LRC GEM
-    // ---------------------------
-    fLrcGem = FakeIrisXEGEM::withSize(ctxSize, 0);
-    if (!fLrcGem) {
-        IOLog("(FakeIrisXE) [Exec] LRC alloc failed\n");
-        return false;
-    }
-
-    // Zero memory
-    IOBufferMemoryDescriptor* md = fLrcGem->memoryDescriptor();
-    if (md) {
-        bzero(md->getBytesNoCopy(), md->getLength());
-    }
-
-    // Your pin() returns void!
-    fLrcGem->pin();
-
-    // Map into GGTT
-    fLrcGGTT = fOwner->ggttMap(fLrcGem);   // 100% correct for your project
-
-    if (fLrcGGTT == 0) {
-        IOLog("(FakeIrisXE) [Exec] ggttMap(LRC) failed\n");
-        return false;
-    }
-
-    // Align to 4K as required by LRC hardware
-    fLrcGGTT &= ~0xFFFULL;
-
-    IOLog("(FakeIrisXE) [Exec] LRC @ GGTT=0x%llx\n", fLrcGGTT);
-
-
-    
-    // ---------------------------
-    // Allocate CSB GEM (GEN12 requires ~128B, we use 256B safe)
-    // ---------------------------
-    IOLog("(FakeIrisXE) [Exec] Alloc CSB\n");
-
-    constexpr size_t kCSBSize = 0x100; // 256 bytes
-    fCsbGem = FakeIrisXEGEM::withSize(kCSBSize, 0);
-    if (!fCsbGem) {
-        IOLog("(FakeIrisXE) [Exec] No CSB alloc\n");
-        fCsbGGTT = 0;
-    } else {
-        fCsbGem->pin();
-        fCsbGGTT = fOwner->ggttMap(fCsbGem);
-        if (fCsbGGTT)
-            fCsbGGTT &= ~0xFFFULL;
-    }
-
 
     return true;
 }
 
 
 
-
-
-
 // ------------------------------------------------------------
 // freeHwContext()
 // ------------------------------------------------------------
@@ -438,10 +539,25 @@ void FakeIrisXEExeclist::freeHwContext()
         fLrcGem = nullptr;
     }
     if (fCsbGem) {
+        fCore.setCsb(nullptr, 0);
         fCsbGem->unpin();
         fCsbGem->release();
         fCsbGem = nullptr;
     }
+    if (fElspDescGem) {
+        fCore.setDescriptorPage(nullptr, 0);
+        fElspDescGem->unpin();
+        fElspDescGem->release();
+        fElspDescGem = nullptr;
+        fElspDescGGTT = 0;
+    }
+    if (fTimelineGem) {
+        fTimeline.init(nullptr, 0, 0);
+        fTimelineGem->unpin();
+        fTimelineGem->release();
+        fTimelineGem = nullptr;
+        fTimelineGGTT = 0;
+    }
 }
 
 
@@ -495,8 +611,8 @@ bool FakeIrisXEExeclist::setupExeclistPorts()
     const uint64_t lrc = fLrcGGTT & ~0xFFFULL;
     uint32_t elsp_lo = (uint32_t)(lrc & 0xFFFFFFFFULL);
     uint32_t elsp_hi = (uint32_t)(lrc >> 32);
-    mmioWrite32(RCS0_EXECLIST_SUBMITPORT_LO, elsp_lo);
-    mmioWrite32(RCS0_EXECLIST_SUBMITPORT_HI, elsp_hi);
+    mmioWrite32(fRegs.submitLo, elsp_lo);
+    mmioWrite32(fRegs.submitHi, elsp_hi);
 
     
     
@@ -506,17 +622,17 @@ bool FakeIrisXEExeclist::setupExeclistPorts()
         uint32_t csb_lo = (uint32_t)(fCsbGGTT & 0xFFFFFFFFULL);
         uint32_t csb_hi = (uint32_t)(fCsbGGTT >> 32);
 
-        mmioWrite32(RCS0_CSB_ADDR_LO, csb_lo);
-        mmioWrite32(RCS0_CSB_ADDR_HI, csb_hi);
-        mmioWrite32(RCS0_CSB_CTRL, 0x1); // enable CSB tracking if needed
+        mmioWrite32(fRegs.csbAddrLo, csb_lo);
+        mmioWrite32(fRegs.csbAddrHi, csb_hi);
+        mmioWrite32(fEngineClass == ENGINE_CLASS_COPY ? BCS0_CSB_CTRL : RCS0_CSB_CTRL, 0x1); // enable CSB tracking if needed
     }
 
     
     
     
     // Readback checks (do not assume writes are posted)
-    uint32_t r_elsp_lo = mmioRead32(RCS0_EXECLIST_SUBMITPORT_LO);
-    uint32_t r_elsp_hi = mmioRead32(RCS0_EXECLIST_SUBMITPORT_HI);
+    uint32_t r_elsp_lo = mmioRead32(fRegs.submitLo);
+    uint32_t r_elsp_hi = mmioRead32(fRegs.submitHi);
     IOLog("(FakeIrisXE) [Exec] ELSP readback LO=0x%08x HI=0x%08x (expected LO=0x%08x HI=0x%08x)\n",
           r_elsp_lo, r_elsp_hi, elsp_lo, elsp_hi);
 
@@ -528,8 +644,8 @@ bool FakeIrisXEExeclist::setupExeclistPorts()
 
     
     if (fCsbGGTT) {
-        uint32_t r_csb_lo = mmioRead32(CSB_ADDR_LO);
-        uint32_t r_csb_hi = mmioRead32(CSB_ADDR_HI);
+        uint32_t r_csb_lo = mmioRead32(fRegs.csbAddrLo);
+        uint32_t r_csb_hi = mmioRead32(fRegs.csbAddrHi);
         IOLog("(FakeIrisXE) [Exec] CSB readback LO=0x%08x HI=0x%08x\n", r_csb_lo, r_csb_hi);
         // non-fatal; log only (CSB optional)
     }
@@ -542,17 +658,26 @@ bool FakeIrisXEExeclist::setupExeclistPorts()
         | (1 << 13)  // CONTEXT_SWITCH
         | (1 << 11); // PAGE_FAULT
 
-    mmioWrite32(RCS0_IMR, ~IRQS);
-    mmioWrite32(RCS0_IER, IRQS);
-    mmioWrite32(GEN11_GFX_MSTR_IRQ_MASK, 0x0);
-    mmioWrite32(GEN11_GFX_MSTR_IRQ, IRQS);
+    if (fEngineClass == ENGINE_CLASS_COPY) {
+        // BCS0 owns the low half of the shared render/copy enable and mask
+        const uint32_t bcsIrqs = GT_CONTEXT_SWITCH_INTERRUPT | GT_RENDER_USER_INTERRUPT;
+        mmioWrite32(GEN11_RENDER_COPY_INTR_ENABLE,
+                    (mmioRead32(GEN11_RENDER_COPY_INTR_ENABLE) & 0xFFFF0000u) | bcsIrqs);
+        mmioWrite32(GEN11_BCS_RSVD_INTR_MASK, ~bcsIrqs);
+    } else {
+        mmioWrite32(RCS0_IMR, ~IRQS);
+        mmioWrite32(RCS0_IER, IRQS);
+        mmioWrite32(GEN11_GFX_MSTR_IRQ_MASK, 0x0);
+        mmioWrite32(GEN11_GFX_MSTR_IRQ, IRQS);
+    }
 
     
     
     
     // ---------- 3) Keep the forcewake held. Do NOT kick here if you expect submit() later.
     // We return success while still holding the hold; submitBatch() MUST keep the hold across the ELSP kick.
-    IOLog("(FakeIrisXE) [Exec] setupExeclistPorts SUCCESS (no kick) - FUZZ: leaving forcewake held for submit path\n");
+    IOLog("(FakeIrisXE) [Exec] %s: setupExeclistPorts SUCCESS (no kick) - FUZZ: leaving forcewake held for submit path\n",
+          engineName());
     return true;
 }
 
@@ -1206,269 +1331,769 @@ void FakeIrisXEExeclist::engineIrq(uint32_t iir)
         return;
 
     // On any of those, read CSB entries.
+    IOLockLock(fSchedLock);
+    processCsbEntries();
+    IOLockUnlock(fSchedLock);
+}
+
+void FakeIrisXEExeclist::drainCsbFromIrq()
+{
+    IOLockLock(fSchedLock);
     processCsbEntries();
+    IOLockUnlock(fSchedLock);
 }
 
 
 void FakeIrisXEExeclist::processCsbEntries()
 {
-    if (!fCsbGem || fCsbEntryCount == 0)
-        return;
+    // Drains up to the engine's CSB write pointer (one MMIO read), publishes
+    // the read pointer once, retires/requeues, then refills the ports
+    fCore.processCsb();
+    fCsbReadIndex = fCore.csbReadPointer();
+}
 
-    IOBufferMemoryDescriptor* md = fCsbGem->memoryDescriptor();
-    if (!md) return;
 
-    volatile uint64_t* csbBase =
-        (volatile uint64_t*)md->getBytesNoCopy();
-    if (!csbBase) return;
+void FakeIrisXEExeclist::handleCsbEntry(uint64_t low, uint64_t high)
+{
+    fCore.handleCsbEntry(low, high);
+}
 
-    const uint32_t mask = fCsbEntryCount - 1; // assume power-of-two
 
-    for (;;) {
-        uint32_t idx = fCsbReadIndex & mask;
-        volatile uint64_t* entry = csbBase + idx * 2;
 
-        uint64_t low  = entry[0];
-        uint64_t high = entry[1];
+void FakeIrisXEExeclist::onContextComplete(uint32_t ctxId, uint32_t status)
+{
+    fCore.onComplete(ctxId, status);
+    maybeKickScheduler();
+}
+
+void FakeIrisXEExeclist::onContextPreempted(uint32_t ctxId, uint32_t status)
+{
+    // The engine saved RING_HEAD into the LRC when it switched out; the
+    // request resumes from there the next time it wins a port.
+    fCore.onPreempted(ctxId, status);
+    maybeKickScheduler();
+}
 
-        if (low == 0 && high == 0) {
-            // no more new CSB entries
-            break;
-        }
+void FakeIrisXEExeclist::onContextFault(uint32_t ctxId, uint32_t status)
+{
+    // Bans after kMaxBanScore faults and cancels the context's queued work
+    fCore.onFault(ctxId, status);
+    maybeKickScheduler();
+}
 
-        // Consume it
-        handleCsbEntry(low, high);
 
-        // Mark as consumed (zero it)
-        entry[0] = 0;
-        entry[1] = 0;
-        OSSynchronizeIO();
+bool FakeIrisXEExeclist::submitForContext(XEHWContext* hw, FakeIrisXEGEM* batchGem,
+                                          FXE_Fence* outFence,
+                                          const FXE_Fence* deps, uint32_t depCount)
+{
+    if (!hw || !batchGem || hw->banned || hw->destroyPending)
+        return false;
+
+    IOLockLock(fSchedLock);
 
-        fCsbReadIndex++;
+    if (hw->destroyPending || !ensureElspDescriptorPage() || !ensureTimelinePage()) {
+        IOLockUnlock(fSchedLock);
+        return false;
     }
 
-    // If engine idle and we have pending work, maybe kick
-    maybeKickScheduler();
+    batchGem->retain();
+    batchGem->pin();
+    uint64_t batchGGTT = ggttMapGem(batchGem);
+    if (batchGGTT == 0) {
+        IOLog("(FakeIrisXE) [Exec] %s submitForContext: ggttMap(batchGem)=0\n", engineName());
+        IOLockUnlock(fSchedLock);
+        batchGem->unpin();
+        batchGem->release();
+        return false;
+    }
+    batchGGTT &= ~0xFFFULL;
+
+    if (!queueBatchLocked(hw, batchGem, batchGGTT, outFence, deps, depCount)) {
+        IOLockUnlock(fSchedLock);
+        batchGem->unpin();
+        batchGem->release();
+        return false;
+    }
+
+    IOLockUnlock(fSchedLock);
+    return true;
 }
 
+bool FakeIrisXEExeclist::allocBatch(uint32_t bytes, FXE_BatchSlice* out)
+{
+    IOLockLock(fSchedLock);
+    bool ok = fBatchPool.alloc(bytes, out);
+    IOLockUnlock(fSchedLock);
+    return ok;
+}
 
-enum {
-    CSB_STATUS_COMPLETE = 1u << 0,
-    CSB_STATUS_PREEMPT  = 1u << 1,
-    CSB_STATUS_FAULT    = 1u << 2,
-};
+bool FakeIrisXEExeclist::submitBatchSlice(XEHWContext* hw, const FXE_BatchSlice& slice,
+                                          FXE_Fence* outFence,
+                                          const FXE_Fence* deps, uint32_t depCount)
+{
+    IOLockLock(fSchedLock);
+
+    // The queue holds no reference: the pool keeps the chunk until the fence is done
+    FXE_Fence fence = {};
+    bool ok = hw && !hw->banned && !hw->destroyPending &&
+              ensureElspDescriptorPage() && ensureTimelinePage() &&
+              queueBatchLocked(hw, nullptr, slice.gpu, &fence, deps, depCount);
+    if (ok)
+        fBatchPool.commit(slice, fence);
+    else
+        fBatchPool.abort(slice);
+
+    IOLockUnlock(fSchedLock);
+    if (ok && outFence)
+        *outFence = fence;
+    return ok;
+}
 
-void FakeIrisXEExeclist::handleCsbEntry(uint64_t low, uint64_t high)
+// Put a batch (GEM or pool slice, batchGem = nullptr) on the queue.
+// Called with fSchedLock held; takes over the caller's GEM reference
+// on success.
+bool FakeIrisXEExeclist::queueBatchLocked(XEHWContext* hw, FakeIrisXEGEM* batchGem, uint64_t batchGGTT,
+                                          FXE_Fence* outFence, const FXE_Fence* deps, uint32_t depCount)
 {
-    uint32_t ctxId  = (uint32_t)(low & 0xFFFFFFFFu);
-    uint32_t status = (uint32_t)(high & 0xFFFFFFFFu);
+    // Engine stores fenceSeqno into the context's timeline slot on completion
+    const uint32_t timeline = timelineFor(hw);
+    const uint64_t fenceSeqno = fTimeline.alloc(timeline);
+
+    uint32_t seqno = 0;
+    int32_t slot = fCore.enqueue(hw->ctxId, hw->priority, hw->lrcGGTT, batchGGTT, &seqno,
+                                 fTimeline.breadcrumbGGTT(timeline), fenceSeqno,
+                                 deps, depCount);
+    if (slot < 0) {
+        fTimeline.unalloc(timeline, fenceSeqno);
+        IOLog("(FakeIrisXE) [Exec] submit: queue full (or %u deps)\n", depCount);
+        return false;
+    }
 
-    IOLog("(FakeIrisXE) [Exec] CSB: ctx=%u status=0x%08x\n", ctxId, status);
+    ExecQueueEntry& e = fQueue[slot];
+    e.hwCtx    = hw;
+    e.batchGem = batchGem;
+    e.batchGGTT= batchGGTT;
+    e.seqno    = seqno;
+    e.timeline = timeline;
+    e.fenceSeqno = fenceSeqno;
+    e.inFlight = false;
+    e.completed= false;
+    e.faulted  = false;
 
-    if (status & CSB_STATUS_FAULT) {
-        onContextFault(ctxId, status);
-    } else if (status & CSB_STATUS_COMPLETE) {
-        onContextComplete(ctxId, status);
-    } else if (status & CSB_STATUS_PREEMPT) {
-        // preemption or switch – treat like partial completion
-        onContextComplete(ctxId, status);
-    } else {
-        // "switch only" or other
-        // You can log / ignore for now
+    if (outFence) {
+        outFence->timeline = timeline;
+        outFence->seqno    = fenceSeqno;
+        outFence->engine   = fEngineClass;
     }
+
+    // Try to kick immediately (may also preempt a lower band)
+    maybeKickScheduler();
+    return true;
 }
 
 
+int32_t FakeIrisXEExeclist::fenceState(const FXE_Fence& fence)
+{
+    if (fence.seqno && fence.engine != fEngineClass)
+        return FXE_FENCE_ERROR;
+    IOLockLock(fSchedLock);
+    int32_t st = fTimeline.state(fence);
+    IOLockUnlock(fSchedLock);
+    return st;
+}
 
-void FakeIrisXEExeclist::onContextComplete(uint32_t ctxId, uint32_t status)
+IOReturn FakeIrisXEExeclist::waitFence(const FXE_Fence& fence, uint32_t timeoutMs)
 {
-    // Mark inflight entry for ctxId as completed
-    for (int i = 0; i < 2; ++i) {
-        XEHWContext* hw = fInflight[i];
-        if (hw && hw->ctxId == ctxId) {
-            IOLog("(FakeIrisXE) [Exec] ctx %u complete on slot %d\n", ctxId, i);
-            fInflight[i] = nullptr;
-            fInflightSeqno[i] = 0;
+    return waitFences(&fence, 1, false, timeoutMs);
+}
+
+IOReturn FakeIrisXEExeclist::waitFences(const FXE_Fence* fences, uint32_t count, bool waitAny,
+                                        uint32_t timeoutMs, uint32_t* outIndex)
+{
+    if (count && !fences)
+        return kIOReturnBadArgument;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (fences[i].seqno && fences[i].engine != fEngineClass)
+            return kIOReturnBadArgument;
+    }
+
+    uint64_t deadline = 0;
+    if (timeoutMs)
+        clock_interval_to_deadline(timeoutMs, kMillisecondScale, &deadline);
+
+    IOLockLock(fSchedLock);
+    int32_t st;
+    for (;;) {
+        st = fTimeline.evaluate(fences, count, waitAny, outIndex);
+        if (st != FXE_FENCE_PENDING || !timeoutMs)
+            break;
+        // Woken by retire() for every finished request; re-check either way
+        if (IOLockSleepDeadline(fSchedLock, &fTimeline, deadline, THREAD_UNINT) == THREAD_TIMED_OUT) {
+            st = fTimeline.evaluate(fences, count, waitAny, outIndex);
             break;
         }
     }
+    IOLockUnlock(fSchedLock);
+
+    if (st == FXE_FENCE_PENDING)
+        return kIOReturnTimeout;
+    return st == FXE_FENCE_SIGNALED ? kIOReturnSuccess : kIOReturnIOError;
+}
 
-    // You could also wake any waiters, notify Accelerator, etc.
 
-    // Immediately schedule next context (if any)
-    maybeKickScheduler();
+// Input fences of queued requests, evaluated from fCore.kick() with
+// fSchedLock held. Another engine's fence needs that engine's lock, but it
+// may be kicking right now and asking about ours: only try the lock, and
+// if it is busy report PENDING and retry from fDepTimer.
+int32_t FakeIrisXEExeclist::depState(const FXE_Fence& fence)
+{
+    if (fence.engine == fEngineClass)
+        return fTimeline.state(fence);
+
+    FakeIrisXEExeclist* other = fOwner ? fOwner->execlistFor(fence.engine) : nullptr;
+    if (!other || other == this)
+        return FXE_FENCE_ERROR;
+    if (!IOLockTryLock(other->fSchedLock)) {
+        pokeDeps(kDepRetryUs);
+        return FXE_FENCE_PENDING;
+    }
+    int32_t st = other->fTimeline.state(fence);
+    IOLockUnlock(other->fSchedLock);
+    return st;
 }
 
-void FakeIrisXEExeclist::onContextFault(uint32_t ctxId, uint32_t status)
+// A fence whose request is already running on another engine can be
+// waited for by our engine (MI_SEMAPHORE_WAIT on its breadcrumb in the
+// request's ring commands) so the two overlap up to the last moment.
+// Same-engine fences are always held: the request they wait for is ahead
+// of them on this engine anyway.
+uint64_t FakeIrisXEExeclist::depSemaphore(const FXE_Fence& fence)
 {
-    XEHWContext* hw = lookupHwContext(ctxId);
-    if (!hw) return;
+    if (fence.engine == fEngineClass)
+        return 0;
+
+    FakeIrisXEExeclist* other = fOwner ? fOwner->execlistFor(fence.engine) : nullptr;
+    if (!other || other == this || !IOLockTryLock(other->fSchedLock))
+        return 0;
+    uint64_t addr = other->inFlightBreadcrumb(fence);
+    IOLockUnlock(other->fSchedLock);
+    return addr;
+}
+
+// Breadcrumb address of `fence` if its request sits on one of our ELSP
+// ports (fSchedLock held). The semaphore only sees the breadcrumb's low
+// dword, so not across a change of its high dword.
+uint64_t FakeIrisXEExeclist::inFlightBreadcrumb(const FXE_Fence& fence)
+{
+    if ((fTimeline.hwSeqno(fence.timeline) >> 32) != (fence.seqno >> 32))
+        return 0;
+    for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+        const int32_t slot = fCore.sched().port(p).req;
+        if (slot >= 0 && fQueue[slot].timeline == fence.timeline &&
+            fQueue[slot].fenceSeqno == fence.seqno)
+            return fTimeline.breadcrumbGGTT(fence.timeline);
+    }
+    return 0;
+}
+
+// Re-run kick() soon, e.g. another engine retired a request we may be
+// held on. Takes no lock, so any engine may call it.
+void FakeIrisXEExeclist::pokeDeps(uint32_t us)
+{
+    if (fDepTimer)
+        fDepTimer->setTimeoutUS(us);
+}
+
+
+FakeIrisXEExeclist::ExecQueueEntry* FakeIrisXEExeclist::pickNextReady()
+{
+    int32_t slot = fCore.sched().pickNext();
+    return slot >= 0 ? &fQueue[slot] : nullptr;
+}
 
-    hw->banScore++;
-    IOLog("(FakeIrisXE) [Exec] ctx %u fault (banScore=%u)\n",
-          ctxId, hw->banScore);
+void FakeIrisXEExeclist::maybeKickScheduler()
+{
+    // Fill free ELSP ports, issue preempt-to-idle, re-arm the timeslice
+    fCore.kick();
+}
 
-    if (hw->banScore >= kMaxBanScore) {
-        hw->banned = true;
-        IOLog("(FakeIrisXE) [Exec] ctx %u BANNED\n", ctxId);
+void FakeIrisXEExeclist::retireQueueEntry(int32_t slot)
+{
+    if (slot < 0 || (uint32_t)slot >= kMaxExeclistQueue)
+        return;
+
+    ExecQueueEntry& e = fQueue[slot];
+    if (e.batchGem && fOwner && !fEngineIO) {
+        fOwner->boRecycle(e.batchGem);      // parked if the queue held the last ref
+    } else if (e.batchGem) {
+        e.batchGem->unpin();
+        e.batchGem->release();
     }
+    bzero(&e, sizeof(ExecQueueEntry));
+}
 
-    // Drop inflight reference
-    for (int i = 0; i < 2; ++i) {
-        if (fInflight[i] && fInflight[i]->ctxId == ctxId) {
-            fInflight[i] = nullptr;
-            fInflightSeqno[i] = 0;
-        }
+bool FakeIrisXEExeclist::ensureElspDescriptorPage()
+{
+    if (fElspDescGem)
+        return true;
+
+    fElspDescGem = FakeIrisXEGEM::withSize(4096, 0);
+    if (!fElspDescGem) {
+        IOLog("(FakeIrisXE) [Exec] ELSP descriptor page alloc failed\n");
+        return false;
     }
+    fElspDescGem->pin();
+    void* cpu = fElspDescGem->memoryDescriptor()->getBytesNoCopy();
+    bzero(cpu, 4096);
 
-    // Do not reschedule banned contexts
-    maybeKickScheduler();
+    fElspDescGGTT = ggttMapGem(fElspDescGem) & ~0xFFFULL;
+    if (!fElspDescGGTT) {
+        IOLog("(FakeIrisXE) [Exec] ggttMap(ELSP desc) failed\n");
+        fElspDescGem->unpin();
+        fElspDescGem->release();
+        fElspDescGem = nullptr;
+        return false;
+    }
+    fCore.setDescriptorPage(cpu, fElspDescGGTT);
+    return true;
 }
 
-
-bool FakeIrisXEExeclist::submitForContext(XEHWContext* hw, FakeIrisXEGEM* batchGem)
+bool FakeIrisXEExeclist::ensureTimelinePage()
 {
-    if (!hw || !batchGem || hw->banned)
+    if (fTimelineGem)
+        return true;
+
+    fTimelineGem = FakeIrisXEGEM::withSize(4096, 0);
+    if (!fTimelineGem) {
+        IOLog("(FakeIrisXE) [Exec] fence timeline page alloc failed\n");
         return false;
+    }
+    fTimelineGem->pin();
+    void* cpu = fTimelineGem->memoryDescriptor()->getBytesNoCopy();
 
-    uint32_t nextTail = (fQTail + 1) % kMaxExeclistQueue;
-    if (nextTail == fQHead) {
-        IOLog("(FakeIrisXE) [Exec] submitForContext: queue full\n");
+    fTimelineGGTT = ggttMapGem(fTimelineGem) & ~0xFFFULL;
+    if (!fTimelineGGTT) {
+        IOLog("(FakeIrisXE) [Exec] ggttMap(fence timelines) failed\n");
+        fTimelineGem->unpin();
+        fTimelineGem->release();
+        fTimelineGem = nullptr;
         return false;
     }
+    fTimeline.init(cpu, fTimelineGGTT, 4096);
+    return true;
+}
 
-    batchGem->pin();
-    uint64_t batchGGTT = fOwner->ggttMap(batchGem) & ~0xFFFULL;
+void FakeIrisXEExeclist::armTimeslice(uint64_t deadlineNs)
+{
+    if (!fTimesliceTimer)
+        return;
 
-    ExecQueueEntry& e = fQueue[fQTail];
-    e.hwCtx    = hw;
-    e.batchGem = batchGem;
-    e.batchGGTT= batchGGTT;
-    e.seqno    = fNextSeqno++;
-    e.inFlight = false;
-    e.completed= false;
-    e.faulted  = false;
+    if (deadlineNs == UINT64_MAX) {
+        fTimesliceTimer->cancelTimeout();
+        return;
+    }
+
+    uint64_t now = schedNowNs();
+    uint64_t us = deadlineNs > now ? (deadlineNs - now) / 1000 : 0;
+    fTimesliceTimer->setTimeoutUS((UInt32)(us ? us : 1));
+}
+
+// Per-engine reset (called from the watchdog with fSchedLock held): ask the
+// engine to quiesce via RESET_CTL, pulse its GDRST domain bit, then restore
+// the CSB pointer the reset cleared. Other engines keep running.
+bool FakeIrisXEExeclist::resetEngine(const FXE_EngineRegs& regs)
+{
+    bool ok = true;
+
+    mmioWrite32(regs.resetCtl, (RESET_CTL_REQUEST_RESET << 16) | RESET_CTL_REQUEST_RESET);
+    uint32_t waitUs = 0;
+    while (!(mmioRead32(regs.resetCtl) & RESET_CTL_READY_TO_RESET) && waitUs < 700) {
+        IODelay(10);
+        waitUs += 10;
+    }
+    if (waitUs >= 700)
+        IOLog("(FakeIrisXE) [Exec] reset: engine not ready after 700us, forcing\n");
 
-    fQTail = nextTail;
+    mmioWrite32(GEN6_GDRST, regs.resetDomain);
+    waitUs = 0;
+    while ((mmioRead32(GEN6_GDRST) & regs.resetDomain) && waitUs < 10000) {
+        IODelay(10);
+        waitUs += 10;
+    }
+    if (waitUs >= 10000) {
+        IOLog("(FakeIrisXE) [Exec] reset: GDRST 0x%x did not clear\n", regs.resetDomain);
+        ok = false;
+    }
 
-    IOLog("(FakeIrisXE) [Exec] queued ctx=%u seq=%u\n", hw->ctxId, e.seqno);
+    mmioWrite32(regs.resetCtl, RESET_CTL_REQUEST_RESET << 16);
 
-    // Try to kick immediately
+    if (fCsbGGTT) {
+        mmioWrite32(regs.csbAddrLo, (uint32_t)(fCsbGGTT & 0xFFFFFFFFULL));
+        mmioWrite32(regs.csbAddrHi, (uint32_t)(fCsbGGTT >> 32));
+    }
+    fCsbReadIndex = fCsbEntryCount - 1;   // CSB pointers reset with the engine
+    return ok;
+}
+
+void FakeIrisXEExeclist::publishHangStats()
+{
+    if (!fOwner)
+        return;
+    const FXE_ExecStats& st = fCore.stats();
+    // Render keeps the original key names; other engines get a prefix
+    const char* pfx = fEngineClass == ENGINE_CLASS_COPY ? "Bcs" : "";
+    char key[64];
+    snprintf(key, sizeof(key), "%sExeclistHangs", pfx);
+    fOwner->setProperty(key, st.hangs, 64);
+    snprintf(key, sizeof(key), "%sExeclistEngineResets", pfx);
+    fOwner->setProperty(key, st.engineResets, 64);
+    snprintf(key, sizeof(key), "%sExeclistHangRecoveryLastUs", pfx);
+    fOwner->setProperty(key, st.lastRecoveryNs / 1000, 64);
+    snprintf(key, sizeof(key), "%sExeclistHangRecoveryMaxUs", pfx);
+    fOwner->setProperty(key, st.maxRecoveryNs / 1000, 64);
+}
+
+void FakeIrisXEExeclist::publishBatchPoolStats()
+{
+    if (!fOwner)
+        return;
+    IOLockLock(fSchedLock);
+    const FXE_BatchPoolStats st = fBatchPool.stats();
+    IOLockUnlock(fSchedLock);
+    const char* pfx = fEngineClass == ENGINE_CLASS_COPY ? "Bcs" : "Rcs";
+    char key[64];
+    snprintf(key, sizeof(key), "%sBatchPoolAllocs", pfx);
+    fOwner->setProperty(key, st.allocs, 64);
+    snprintf(key, sizeof(key), "%sBatchPoolRewinds", pfx);
+    fOwner->setProperty(key, st.rewinds, 64);
+    snprintf(key, sizeof(key), "%sBatchPoolChunks", pfx);
+    fOwner->setProperty(key, st.chunks, 32);
+    snprintf(key, sizeof(key), "%sBatchPoolExhausted", pfx);
+    fOwner->setProperty(key, st.exhausted, 64);
+}
+
+void FakeIrisXEExeclist::timesliceFired(IOTimerEventSource* sender)
+{
+    IOLockLock(fSchedLock);
     maybeKickScheduler();
+    IOLockUnlock(fSchedLock);
+}
 
-    return true;
+// LRC ring state block: HEAD at +0x00, TAIL at +0x04 (see createHwContextFor)
+static const uint32_t kLrcRingStateOffset = 0x100;
+
+uint32_t FakeIrisXEExeclist::readSavedRingHead(XEHWContext* hw)
+{
+    if (!hw || !hw->lrcGem || !hw->lrcGem->memoryDescriptor())
+        return 0;
+    uint8_t* cpu = (uint8_t*)hw->lrcGem->memoryDescriptor()->getBytesNoCopy();
+    if (!cpu)
+        return 0;
+    return *(volatile uint32_t*)(cpu + kLrcRingStateOffset);
+}
+
+void FakeIrisXEExeclist::restoreRingHead(XEHWContext* hw, uint32_t head)
+{
+    if (!hw || !hw->lrcGem || !hw->lrcGem->memoryDescriptor())
+        return;
+    uint8_t* cpu = (uint8_t*)hw->lrcGem->memoryDescriptor()->getBytesNoCopy();
+    if (!cpu)
+        return;
+    write_le32(cpu + kLrcRingStateOffset, head);
+    OSSynchronizeIO();
 }
 
+// Append a request's commands to the context's ring and publish them
+// through the LRC's RING_TAIL (fSchedLock held). At most kMaxExeclistQueue
+// requests are in the ring at once, a small fraction of its size, so what
+// lies ahead of the tail has always been executed. A request that would
+// run past the end starts over at 0, the rest filled with MI_NOOP.
+bool FakeIrisXEExeclist::emitRing(XEHWContext* hw, const uint32_t* cs, uint32_t dwords, uint32_t* outTail)
+{
+    if (!hw || !hw->ringGem || !hw->ringGem->memoryDescriptor() ||
+        !hw->lrcGem || !hw->lrcGem->memoryDescriptor())
+        return false;
+    uint32_t* ring = (uint32_t*)hw->ringGem->memoryDescriptor()->getBytesNoCopy();
+    uint8_t* lrc = (uint8_t*)hw->lrcGem->memoryDescriptor()->getBytesNoCopy();
+    const uint32_t bytes = dwords * sizeof(uint32_t);
+    if (!ring || !lrc || bytes > kHwCtxRingSize)
+        return false;
 
-FakeIrisXEExeclist::ExecQueueEntry* FakeIrisXEExeclist::pickNextReady()
+    uint32_t tail = hw->ringTail;
+    if (tail + bytes > kHwCtxRingSize) {
+        for (uint32_t i = tail / 4; i < kHwCtxRingSize / 4; ++i)
+            ring[i] = MI_NOOP;
+        tail = 0;
+    }
+    memcpy(ring + tail / 4, cs, bytes);
+    tail = (tail + bytes) & (kHwCtxRingSize - 1);
+    hw->ringTail = tail;
+
+    // Commands land before the tail that covers them
+    OSSynchronizeIO();
+    write_le32(lrc + kLrcRingStateOffset + 0x04, tail);
+    OSSynchronizeIO();
+    *outTail = tail;
+    return true;
+}
+
+bool FakeIrisXEExeclist::startScheduler(IOWorkLoop* wl)
 {
-    if (fQHead == fQTail)
-        return nullptr;
+    if (fTimesliceTimer)
+        return true;
+    if (!wl)
+        return false;
 
-    ExecQueueEntry* best = nullptr;
-    uint32_t bestPri = 0;
-    uint32_t idx = fQHead;
-
-    while (idx != fQTail) {
-        ExecQueueEntry& e = fQueue[idx];
-        XEHWContext* hw = e.hwCtx;
-        if (hw && !hw->banned && !e.inFlight) {
-            uint32_t pri = hw->priority;
-            if (!best || pri > bestPri) {
-                best    = &e;
-                bestPri = pri;
-            }
-        }
-        idx = (idx + 1) % kMaxExeclistQueue;
+    fTimesliceTimer = IOTimerEventSource::timerEventSource(
+        this,
+        OSMemberFunctionCast(IOTimerEventSource::Action, this,
+                             &FakeIrisXEExeclist::timesliceFired));
+    if (!fTimesliceTimer)
+        return false;
+
+    if (wl->addEventSource(fTimesliceTimer) != kIOReturnSuccess) {
+        fTimesliceTimer->release();
+        fTimesliceTimer = nullptr;
+        return false;
     }
-    return best;
+    wl->retain();
+    fSchedWorkLoop = wl;
+
+    // Same action: pokes just run the scheduler
+    fDepTimer = IOTimerEventSource::timerEventSource(
+        this,
+        OSMemberFunctionCast(IOTimerEventSource::Action, this,
+                             &FakeIrisXEExeclist::timesliceFired));
+    if (fDepTimer && wl->addEventSource(fDepTimer) != kIOReturnSuccess) {
+        fDepTimer->release();
+        fDepTimer = nullptr;
+    }
+    if (!fDepTimer)
+        IOLog("(FakeIrisXE) [Exec] %s: no dependency timer, held requests wait for local kicks\n",
+              engineName());
+
+    IOLog("(FakeIrisXE) [Exec] timeslicing on: quantum low=%lluus normal=%lluus high=%lluus rt=off\n",
+          fCore.sched().quantumNs(FXE_SCHED_PRIO_LOW) / 1000,
+          fCore.sched().quantumNs(FXE_SCHED_PRIO_NORMAL) / 1000,
+          fCore.sched().quantumNs(FXE_SCHED_PRIO_HIGH) / 1000);
+    return true;
 }
 
-void FakeIrisXEExeclist::maybeKickScheduler()
+void FakeIrisXEExeclist::stopScheduler()
 {
-    // See if any ELSP slot is free
-    int freeSlot = -1;
-    for (int i = 0; i < 2; ++i) {
-        if (!fInflight[i]) {
-            freeSlot = i;
-            break;
-        }
+    if (fDepTimer) {
+        fDepTimer->cancelTimeout();
+        if (fSchedWorkLoop)
+            fSchedWorkLoop->removeEventSource(fDepTimer);
+        fDepTimer->release();
+        fDepTimer = nullptr;
+    }
+    if (fTimesliceTimer) {
+        fTimesliceTimer->cancelTimeout();
+        if (fSchedWorkLoop)
+            fSchedWorkLoop->removeEventSource(fTimesliceTimer);
+        fTimesliceTimer->release();
+        fTimesliceTimer = nullptr;
+    }
+    if (fSchedWorkLoop) {
+        fSchedWorkLoop->release();
+        fSchedWorkLoop = nullptr;
     }
-    if (freeSlot < 0)
-        return; // both slots busy
+}
 
-    ExecQueueEntry* e = pickNextReady();
-    if (!e) return;
+uint64_t FakeIrisXEExeclist::schedNowNs()
+{
+    uint64_t ns = 0;
+    absolutetime_to_nanoseconds(mach_absolute_time(), &ns);
+    return ns;
+}
 
-    if (submitToELSPSlot(freeSlot, e)) {
-        e->inFlight = true;
-        fInflight[freeSlot] = e->hwCtx;
-        fInflightSeqno[freeSlot] = e->seqno;
-        IOLog("(FakeIrisXE) [Exec] ctx %u seq %u -> ELSP slot %d\n",
-              e->hwCtx->ctxId, e->seqno, freeSlot);
-    }
+
+// ------------------------------------------------------------
+// FXE_ExecCore platform hooks (called with fSchedLock held)
+// ------------------------------------------------------------
+
+uint32_t FakeIrisXEExecPlatform::read32(uint32_t off)
+{
+    return fExec->mmioRead32(off);
 }
 
-bool FakeIrisXEExeclist::submitToELSPSlot(int slot, ExecQueueEntry* e)
+void FakeIrisXEExecPlatform::write32(uint32_t off, uint32_t val)
 {
-    if (!e || !e->hwCtx)
+    fExec->mmioWrite32(off, val);
+}
+
+uint64_t FakeIrisXEExecPlatform::nowNs()
+{
+    return FakeIrisXEExeclist::schedNowNs();
+}
+
+uint32_t FakeIrisXEExecPlatform::savedRingHead(int32_t slot)
+{
+    return fExec->readSavedRingHead(fExec->fQueue[slot].hwCtx);
+}
+
+void FakeIrisXEExecPlatform::restoreRingHead(int32_t slot, uint32_t head)
+{
+    fExec->restoreRingHead(fExec->fQueue[slot].hwCtx, head);
+}
+
+bool FakeIrisXEExecPlatform::emitRequest(int32_t slot, const uint32_t* cs, uint32_t dwords,
+                                         uint32_t* outTail)
+{
+    if (!fExec->emitRing(fExec->fQueue[slot].hwCtx, cs, dwords, outTail))
         return false;
+    // The engine model keeps its progress in RING_HEAD, not a ring offset
+    if (fExec->fEngineIO)
+        *outTail = 0;
+    return true;
+}
 
-    XEHWContext* hw = e->hwCtx;
+void FakeIrisXEExecPlatform::retire(int32_t slot, uint32_t status)
+{
+    FakeIrisXEExeclist::ExecQueueEntry& e = fExec->fQueue[slot];
+    FakeIrisXEExeclist::XEHWContext* hw = e.hwCtx;
+
+    // Completion already landed in the timeline page via the post-sync;
+    // faulted/hung/cancelled requests never write it.
+    if (status & (FXE_CSB_FAULT | FXE_EXEC_HANG | FXE_EXEC_CANCELLED))
+        fExec->fTimeline.markError(e.timeline, e.fenceSeqno);
+    fExec->retireQueueEntry(slot);
+    IOLockWakeup(fExec->fSchedLock, &fExec->fTimeline, false);
+    if (fExec->fOwner)
+        fExec->fOwner->fenceRetired(fExec);
+
+    // Last request of a destroyed context has left the port
+    if (hw && hw->destroyPending && fExec->fCore.sched().portForCtx(hw->ctxId) < 0)
+        fExec->recycleHwContext(hw);
+}
 
-    // Build a small descriptor on the stack (you can still use a GEM if you want)
-    uint32_t desc[8] = {0};
+void FakeIrisXEExecPlatform::armTimer(uint64_t deadlineNs)
+{
+    fExec->armTimeslice(deadlineNs);
+}
 
-    desc[0] = (uint32_t)(hw->lrcGGTT & 0xFFFFFFFFu);
-    desc[1] = (uint32_t)(hw->lrcGGTT >> 32);
-    desc[2] = 0;
-    desc[3] = (1u << 0) | (1u << 1); // VALID|ACTIVE
-    desc[4] = (uint32_t)(e->batchGGTT & 0xFFFFFFFFu);
-    desc[5] = (uint32_t)(e->batchGGTT >> 32);
-    desc[6] = 0;
-    desc[7] = 0;
+bool FakeIrisXEExecPlatform::resetEngine(const FXE_EngineRegs& regs)
+{
+    return fExec->resetEngine(regs);
+}
 
-    // For now, write descriptor into a small GEM and ELSP points to it exactly
-    FakeIrisXEGEM* listGem = FakeIrisXEGEM::withSize(4096, 0);
-    if (!listGem) return false;
-    listGem->pin();
-    uint32_t* cpu = (uint32_t*)listGem->memoryDescriptor()->getBytesNoCopy();
-    bzero(cpu, 4096);
-    memcpy(cpu, desc, sizeof(desc));
+bool FakeIrisXEBatchPoolPlatform::allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu)
+{
+    FakeIrisXEGEM* gem = FakeIrisXEGEM::withSize(bytes, 0);
+    if (!gem)
+        return false;
+    gem->pin();
+    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+    uint64_t ggtt = md ? fExec->ggttMapGem(gem) & ~0xFFFULL : 0;
+    if (!ggtt) {
+        IOLog("(FakeIrisXE) [Exec] %s batch pool: chunk map failed\n", fExec->engineName());
+        gem->unpin();
+        gem->release();
+        return false;
+    }
+    *cookie = gem;
+    *cpu = md->getBytesNoCopy();
+    *gpu = ggtt;
+    return true;
+}
 
-    uint64_t listGGTT = fOwner->ggttMap(listGem) & ~0xFFFULL;
+void FakeIrisXEBatchPoolPlatform::releaseChunk(void* cookie)
+{
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)cookie;
+    gem->unpin();
+    gem->release();
+}
 
-    // For 2-port ELSP, port 0/1 share same SUBMITPORT regs on Gen12,
-    // hardware manages internal pending vs active.
-    // So we just write once per submit.
-    uint32_t lo = (uint32_t)(listGGTT & 0xFFFFFFFFu);
-    uint32_t hi = (uint32_t)(listGGTT >> 32);
+bool FakeIrisXEBatchPoolPlatform::fenceDone(const FXE_Fence& f)
+{
+    return fExec->fTimeline.state(f) != FXE_FENCE_PENDING;
+}
 
-    mmioWrite32(RCS0_EXECLIST_SUBMITPORT_LO, lo);
-    mmioWrite32(RCS0_EXECLIST_SUBMITPORT_HI, hi);
+int32_t FakeIrisXEExecPlatform::fenceState(const FXE_Fence& f)
+{
+    return fExec->depState(f);
+}
 
-    // Kick control register (lightweight)
-    mmioWrite32(RCS0_EXECLIST_SQ_CONTENTS, 0x1);
-    IOSleep(2);
-    uint32_t sq = mmioRead32(RCS0_EXECLIST_SQ_CONTENTS);
-    IOLog("SQ_CONTENTS after kick = 0x%08x\n", sq);
+uint64_t FakeIrisXEExecPlatform::semaphoreFor(const FXE_Fence& f)
+{
+    return fExec->depSemaphore(f);
+}
 
-    
-    IOLog("(FakeIrisXE) [Exec] submitToELSPSlot slot=%d ctx=%u listGGTT=0x%llx\n",
-          slot, hw->ctxId, listGGTT);
+void FakeIrisXEExecPlatform::event(uint32_t ev, uint32_t ctxId, uint32_t seqno, int32_t port)
+{
+    FakeIrisXEExeclist::XEHWContext* hw = fExec->lookupHwContext(ctxId);
 
-    // We keep listGem alive only for test; in real impl you'd reuse a pool.
-    listGem->release();
-    return true;
+    switch (ev) {
+        case FXE_EXEC_EV_QUEUED:
+            IOLog("(FakeIrisXE) [Exec] queued ctx=%u seq=%u\n", ctxId, seqno);
+            break;
+        case FXE_EXEC_EV_SUBMIT:
+        case FXE_EXEC_EV_RESUBMIT:
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u -> ELSP slot %d%s\n", ctxId, seqno, port,
+                  ev == FXE_EXEC_EV_RESUBMIT ? " (resubmit)" : "");
+            break;
+        case FXE_EXEC_EV_COMPLETE:
+            IOLog("(FakeIrisXE) [Exec] ctx %u complete on slot %d\n", ctxId, port);
+            break;
+        case FXE_EXEC_EV_PREEMPT_QUANTUM:
+        case FXE_EXEC_EV_PREEMPT_PRIORITY:
+            IOLog("(FakeIrisXE) [Exec] preempt-to-idle slot=%d ctx=%u reason=%s\n", port, ctxId,
+                  ev == FXE_EXEC_EV_PREEMPT_PRIORITY ? "priority" : "quantum");
+            break;
+        case FXE_EXEC_EV_PREEMPTED:
+            if (hw && hw->destroyPending) {
+                fExec->fCore.cancelContext(ctxId);   // destroyed while running
+                break;
+            }
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u preempted on slot %d, requeued\n", ctxId, seqno, port);
+            break;
+        case FXE_EXEC_EV_FAULT:
+            if (hw) hw->banScore = fExec->fCore.banScore(ctxId);
+            IOLog("(FakeIrisXE) [Exec] ctx %u fault (banScore=%u)\n", ctxId, fExec->fCore.banScore(ctxId));
+            break;
+        case FXE_EXEC_EV_BANNED:
+            if (hw) hw->banned = true;
+            IOLog("(FakeIrisXE) [Exec] ctx %u BANNED\n", ctxId);
+            break;
+        case FXE_EXEC_EV_STALE_CSB:
+            IOLog("(FakeIrisXE) [Exec] CSB for ctx %u with nothing on a port\n", ctxId);
+            break;
+        case FXE_EXEC_EV_HANG:
+            if (hw) hw->banScore = fExec->fCore.banScore(ctxId);
+            IOLog("(FakeIrisXE) [Exec] HANG ctx %u seq %u on slot %d (no progress for %llums, banScore=%u), resetting engine\n",
+                  ctxId, seqno, port, fExec->fCore.hangTimeoutNs() / 1000000ULL, fExec->fCore.banScore(ctxId));
+            break;
+        case FXE_EXEC_EV_REPLAYED:
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u replayed after engine reset\n", ctxId, seqno);
+            break;
+        case FXE_EXEC_EV_HELD:
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u held on input fences\n", ctxId, seqno);
+            break;
+        case FXE_EXEC_EV_READY:
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u inputs ready (semaphores=%llu)\n",
+                  ctxId, seqno, fExec->fCore.stats().depSemaphores);
+            break;
+        case FXE_EXEC_EV_DEP_FAILED:
+            IOLog("(FakeIrisXE) [Exec] ctx %u seq %u dropped: input fence failed\n", ctxId, seqno);
+            break;
+        case FXE_EXEC_EV_RECOVERED:
+            IOLog("(FakeIrisXE) [Exec] engine recovered in %lluus (hangs=%llu)\n",
+                  fExec->fCore.stats().lastRecoveryNs / 1000, fExec->fCore.stats().hangs);
+            fExec->publishHangStats();
+            break;
+        default:
+            break;
+    }
 }
 
 
 
 FakeIrisXEExeclist::XEHWContext* FakeIrisXEExeclist::lookupHwContext(uint32_t ctxId)
 {
-    for (uint32_t i = 0; i < fHwContextCount; ++i) {
+    for (uint32_t i = 0; i < kMaxHwContexts; ++i) {
         XEHWContext* hw = &fHwContexts[i];
-        if (hw->ctxId == ctxId) {
+        if (hw->used && hw->ctxId == ctxId) {
             return hw;
         }
     }
@@ -1476,144 +2101,231 @@ FakeIrisXEExeclist::XEHWContext* FakeIrisXEExeclist::lookupHwContext(uint32_t ct
 }
 
 
-FakeIrisXEExeclist::XEHWContext* FakeIrisXEExeclist::createHwContextFor(uint32_t ctxId, uint32_t priority)
+// Context creation is on the app-launch path: take a pre-mapped LRC/ring
+// backing from the pool (allocating only on a miss), copy the golden LRC
+// image over it and patch the per-context fields.
+FakeIrisXEExeclist::XEHWContext* FakeIrisXEExeclist::createHwContextFor(uint32_t ctxId, uint32_t priority,
+                                                                        FakeIrisXEPpgtt* vm)
 {
-    IOLog("[V61] createHwContextFor(ctxId=0x%X, priority=%u) - START\n", ctxId, priority);
-    
+    if (!fGoldenLrc)
+        return nullptr;
+
+    HwCtxBacking b;
+    bzero(&b, sizeof(b));
+
+    IOLockLock(fSchedLock);
     // If it already exists, just update priority and return
     XEHWContext* existing = lookupHwContext(ctxId);
     if (existing) {
         existing->priority = priority;
-        IOLog("[V61] createHwContextFor: REUSE ctx=%u pri=%u\n", ctxId, priority);
+        IOLockUnlock(fSchedLock);
         return existing;
     }
-    IOLog("[V61] createHwContextFor: Creating NEW context\n");
+    if (fCtxPoolCount)
+        b = fCtxPool[--fCtxPoolCount];
+    IOLockUnlock(fSchedLock);
 
-    if (fHwContextCount >= kMaxHwContexts) {
-        IOLog("[V61] ❌ createHwContextFor: no slots left (count=%u max=%u)\n", fHwContextCount, kMaxHwContexts);
+    if (!b.lrcGem && !allocCtxBacking(&b)) {
+        IOLog("(FakeIrisXE) [Exec] createHwContextFor: ctx=%u backing alloc FAILED\n", ctxId);
         return nullptr;
     }
 
-    XEHWContext* hw = &fHwContexts[fHwContextCount];
-    bzero(hw, sizeof(XEHWContext));
-
-    hw->ctxId    = ctxId;
-    hw->priority = priority;
-    hw->banScore = 0;
-    hw->banned   = false;
+    uint8_t* cpu = (uint8_t*)b.lrcGem->memoryDescriptor()->getBytesNoCopy();
+    memcpy(cpu, fGoldenLrc, kHwCtxLrcSize);
+    FakeIrisXELRC::patchContextImage(cpu, b.lrcGGTT, b.ringGGTT);
+    if (vm)
+        FakeIrisXELRC::setPageTableRoot(cpu, vm->rootAddress());
+    OSSynchronizeIO();
 
-    // --- 1) Allocate ring backing for this context ---
-    size_t ringSize = 0x4000; // 16KB
+    IOLockLock(fSchedLock);
+    XEHWContext* hw = lookupHwContext(ctxId);      // lost a race with another creator
+    if (hw) {
+        hw->priority = priority;
+    } else {
+        for (uint32_t i = 0; i < kMaxHwContexts && !hw; ++i) {
+            if (!fHwContexts[i].used)
+                hw = &fHwContexts[i];
+        }
+        if (hw) {
+            bzero(hw, sizeof(XEHWContext));
+            hw->used     = true;
+            hw->ctxId    = ctxId;
+            hw->priority = priority;
+            hw->lrcGem   = b.lrcGem;
+            hw->lrcGGTT  = b.lrcGGTT;
+            hw->ringGem  = b.ringGem;
+            hw->ringGGTT = b.ringGGTT;
+            hw->vm       = vm;
+            if (vm)
+                vm->retain();
+            fHwContextCount++;
+            bzero(&b, sizeof(b));
+        }
+    }
+    if (b.lrcGem && fCtxPoolCount < kMaxHwContexts) {
+        fCtxPool[fCtxPoolCount++] = b;
+        bzero(&b, sizeof(b));
+    }
+    IOLockUnlock(fSchedLock);
 
-    IOLog("[V61] createHwContextFor: Allocating ringGem (size=0x%zx)...\n", ringSize);
-    hw->ringGem = FakeIrisXEGEM::withSize(ringSize, 0);
-    if (!hw->ringGem) {
-        IOLog("[V61] ❌ createHwContextFor: ringGem alloc FAILED\n");
+    if (b.lrcGem)
+        freeCtxBacking(&b);
+    if (!hw) {
+        IOLog("(FakeIrisXE) [Exec] createHwContextFor: no slots left (max=%u)\n", kMaxHwContexts);
         return nullptr;
     }
-    IOLog("[V61] createHwContextFor: ringGem allocated=%p\n", hw->ringGem);
 
-    IOLog("[V61] createHwContextFor: Pinning ringGem...\n");
-    hw->ringGem->pin();
-    
-    IOLog("[V61] createHwContextFor: Mapping ringGem to GGTT...\n");
-    hw->ringGGTT = fOwner->ggttMap(hw->ringGem);
-    IOLog("[V61] createHwContextFor: ggttMap returned=0x%llX\n", hw->ringGGTT);
-    if (!hw->ringGGTT) {
-        IOLog("[V61] ❌ createHwContextFor: ggttMap(ring) FAILED\n");
-        hw->ringGem->unpin();
-        hw->ringGem->release();
-        hw->ringGem = nullptr;
-        return nullptr;
+    // Reset timestamp counter
+    fOwner->safeMMIOWrite(0x2580, 0);
+
+    IOLog("(FakeIrisXE) [Exec] ctx=%u pri=%u: LRC GGTT=0x%llx ring GGTT=0x%llx\n",
+          ctxId, priority, hw->lrcGGTT, hw->ringGGTT);
+    return hw;
+}
+
+
+bool FakeIrisXEExeclist::destroyHwContext(uint32_t ctxId)
+{
+    IOLockLock(fSchedLock);
+    XEHWContext* hw = lookupHwContext(ctxId);
+    if (!hw) {
+        IOLockUnlock(fSchedLock);
+        return false;
     }
-    hw->ringGGTT &= ~0xFFFULL;
-
-    IOLog("[V61] createHwContextFor: ringGGTT=0x%llX size=0x%zx\n", hw->ringGGTT, ringSize);
-
-    // --- 2) Build LRC image for this context using your helper ---
-    IOLog("[V61] createHwContextFor: Calling buildLRCContext...\n");
-    IOReturn ret = kIOReturnError;
-    hw->lrcGem = FakeIrisXELRC::buildLRCContext(
-                    fOwner,
-                    hw->ringGem,
-                    ringSize,
-                    hw->ringGGTT,
-                    ctxId,  // context ID
-                    0,      // pdps / vm pointer (0 for now)
-                    &ret);
-    IOLog("[V61] createHwContextFor: buildLRCContext returned lrcGem=%p ret=0x%x\n", hw->lrcGem, ret);
-
-    if (!hw->lrcGem || ret != kIOReturnSuccess) {
-        IOLog("[V61] ❌ createHwContextFor: buildLRCContext FAILED (lrcGem=%p ret=0x%x)\n", hw->lrcGem, ret);
-        if (hw->lrcGem) hw->lrcGem->release();
-        hw->lrcGem = nullptr;
-
-        hw->ringGem->unpin();
-        hw->ringGem->release();
-        hw->ringGem = nullptr;
-        return nullptr;
+
+    // Queued work is dropped now; a request still on a port keeps the LRC
+    // alive until it completes, faults or is preempted (see retire()).
+    hw->destroyPending = true;
+    fCore.cancelContext(ctxId);
+    if (fCore.sched().portForCtx(ctxId) < 0)
+        recycleHwContext(hw);
+
+    IOLockUnlock(fSchedLock);
+    return true;
+}
+
+
+// ------------------------------------------------------------
+// HW context backing pool
+// ------------------------------------------------------------
+
+bool FakeIrisXEExeclist::allocCtxBacking(HwCtxBacking* out)
+{
+    bzero(out, sizeof(*out));
+
+    out->ringGem = FakeIrisXEGEM::withSize(kHwCtxRingSize, 0);
+    if (!out->ringGem)
+        return false;
+    out->ringGem->pin();
+
+    out->lrcGem = FakeIrisXEGEM::withSize(kHwCtxLrcSize, 0);
+    if (!out->lrcGem) {
+        freeCtxBacking(out);
+        return false;
     }
-    IOLog("[V61] createHwContextFor: LRC context built successfully\n");
-
-    IOLog("[V61] createHwContextFor: Pinning LRC GEM...\n");
-    hw->lrcGem->pin();
-    IOLog("[V61] createHwContextFor: Mapping LRC to GGTT...\n");
-    hw->lrcGGTT = fOwner->ggttMap(hw->lrcGem);
-    IOLog("[V61] createHwContextFor: ggttMap(lrc) returned=0x%llX\n", hw->lrcGGTT);
-    if (!hw->lrcGGTT) {
-        IOLog("[V61] ❌ createHwContextFor: ggttMap(LRC) FAILED\n");
-        hw->lrcGem->unpin();
-        hw->lrcGem->release();  hw->lrcGem = nullptr;
-        hw->ringGem->unpin();
-        hw->ringGem->release(); hw->ringGem = nullptr;
-        return nullptr;
+    out->lrcGem->pin();
+
+    FakeIrisXEGEM* gems[2] = { out->ringGem, out->lrcGem };
+    uint64_t ggtt[2];
+    if (!ggttMapGems(gems, ggtt, 2)) {
+        freeCtxBacking(out);
+        return false;
     }
-    hw->lrcGGTT &= ~0xFFFULL;
+    out->ringGGTT = ggtt[0] & ~0xFFFULL;
+    out->lrcGGTT  = ggtt[1] & ~0xFFFULL;
+    return true;
+}
 
-    IOLog("(FakeIrisXE) [Exec] ctx=%u: LRC GGTT=0x%llx\n",
-          ctxId, hw->lrcGGTT);
+// Queue the ring and LRC unmaps on the open GGTT transaction.
+void FakeIrisXEExeclist::unmapCtxBacking(HwCtxBacking* b)
+{
+    if (b->ringGGTT)
+        fOwner->ggttUnmapDeferred(b->ringGGTT);
+    if (b->lrcGGTT)
+        fOwner->ggttUnmapDeferred(b->lrcGGTT);
+    b->ringGGTT = 0;
+    b->lrcGGTT  = 0;
+}
 
-    
-    
-    
-    
-    // --- 3) Patch minimal required fields inside LRC image ---
-    
-    {
-        IOBufferMemoryDescriptor* md = hw->lrcGem->memoryDescriptor();
-        if (md) {
-            uint8_t* cpu = (uint8_t*)md->getBytesNoCopy();
+void FakeIrisXEExeclist::freeCtxBacking(HwCtxBacking* b)
+{
+    // PTEs go (one flush for both) before the pages do
+    if ((b->ringGGTT || b->lrcGGTT) && !fEngineIO && fOwner->ggttBegin()) {
+        unmapCtxBacking(b);
+        fOwner->ggttCommit();
+    }
+    if (b->ringGem) {
+        b->ringGem->unpin();
+        b->ringGem->release();
+    }
+    if (b->lrcGem) {
+        b->lrcGem->unpin();
+        b->lrcGem->release();
+    }
+    bzero(b, sizeof(*b));
+}
+
+bool FakeIrisXEExeclist::prewarmContextPool(uint32_t count)
+{
+    for (;;) {
+        IOLockLock(fSchedLock);
+        bool full = fCtxPoolCount >= count || fCtxPoolCount >= kMaxHwContexts;
+        IOLockUnlock(fSchedLock);
+        if (full)
+            return true;
+
+        HwCtxBacking b;
+        if (!allocCtxBacking(&b))
+            return false;
 
-            //
-            // GEN12 REQUIRED LRC HEADER FIELDS
-            //
+        IOLockLock(fSchedLock);
+        bool stored = fCtxPoolCount < kMaxHwContexts;
+        if (stored)
+            fCtxPool[fCtxPoolCount++] = b;
+        IOLockUnlock(fSchedLock);
+        if (!stored) {
+            freeCtxBacking(&b);
+            return true;
+        }
+    }
+}
 
-            // PDP0 = Fake Page Directory Root — use LRC addr so GPU doesn't reject
-            write_le64(cpu + 0x00, hw->lrcGGTT & ~0xFFFULL);
+// Called with fSchedLock held; the context must be off the ELSP ports.
+void FakeIrisXEExeclist::recycleHwContext(XEHWContext* hw)
+{
+    if (!hw || !hw->used)
+        return;
 
-            // Enable timestamp for scheduler acceptance
-            write_le32(cpu + 0x30, 0x00010000);
+    fCore.resetContext(hw->ctxId);
 
-            // Context Control:
-            //  bit0 = Load
-            //  bit3 = Valid
-            //  bit8 = Header Size (1 = 64 bytes)
-            const uint32_t CTX_CTRL = (1 << 0) | (1 << 3) | (1 << 8);
-            write_le32(cpu + 0x2C, CTX_CTRL);
+    HwCtxBacking b;
+    b.lrcGem   = hw->lrcGem;
+    b.lrcGGTT  = hw->lrcGGTT;
+    b.ringGem  = hw->ringGem;
+    b.ringGGTT = hw->ringGGTT;
+    if (b.lrcGem) {
+        if (fCtxPoolCount < kMaxHwContexts)
+            fCtxPool[fCtxPoolCount++] = b;
+        else
+            freeCtxBacking(&b);
+    }
+    // the pool's next user patches PDP0 again
+    if (hw->vm)
+        hw->vm->release();
 
-            //
-            // RING STATE (GEN12 required offsets)
-            //
-            write_le32(cpu + 0x100 + 0x00, 0); // HEAD
-            write_le32(cpu + 0x100 + 0x04, 0); // TAIL
-            write_le32(cpu + 0x100 + 0x0C, (uint32_t)(hw->ringGGTT & 0xFFFFFFFF)); // RING_BASE
+    bzero(hw, sizeof(XEHWContext));
+    fHwContextCount--;
+}
 
-            // Optional: Reset timestamp counter
-            fOwner->safeMMIOWrite(0x2580, 0);
-        }
+void FakeIrisXEExeclist::drainContextPool()
+{
+    if (fCtxPoolCount && !fEngineIO && fOwner->ggttBegin()) {
+        for (uint32_t i = 0; i < fCtxPoolCount; ++i)
+            unmapCtxBacking(&fCtxPool[i]);
+        fOwner->ggttCommit();
     }
-    
-    return hw;
+    while (fCtxPoolCount)
+        freeCtxBacking(&fCtxPool[--fCtxPoolCount]);
 }
 
 
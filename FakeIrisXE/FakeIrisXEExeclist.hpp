@@ -16,16 +16,58 @@
 #define FakeIrisXEExeclist_hpp
 
 #include <IOKit/IOLib.h>
+#include <IOKit/IOLocks.h>
+#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/IOWorkLoop.h>
 #include "FakeIrisXEGEM.hpp"
 #include "FakeIrisXERing.h"
+#include "FakeIrisXEContext.hpp"
+#include "FXE_ExecCore.hpp"
+#include "FXE_Timeline.hpp"
+#include "FXE_BatchPool.hpp"
 
 // Forward declaration
 class FakeIrisXEFramebuffer;
+class FakeIrisXEExeclist;
+class FakeIrisXEPpgtt;
+
+// Routes FXE_ExecCore's platform hooks back into the execlist object.
+class FakeIrisXEExecPlatform : public FXE_ExecPlatform {
+public:
+    FakeIrisXEExeclist* fExec;
+
+    uint32_t read32(uint32_t off) override;
+    void     write32(uint32_t off, uint32_t val) override;
+    uint64_t nowNs() override;
+    uint32_t savedRingHead(int32_t slot) override;
+    void     restoreRingHead(int32_t slot, uint32_t head) override;
+    bool     emitRequest(int32_t slot, const uint32_t* cs, uint32_t dwords, uint32_t* outTail) override;
+    void     retire(int32_t slot, uint32_t status) override;
+    void     armTimer(uint64_t deadlineNs) override;
+    bool     resetEngine(const FXE_EngineRegs& regs) override;
+    int32_t  fenceState(const FXE_Fence& f) override;
+    uint64_t semaphoreFor(const FXE_Fence& f) override;
+    void     event(uint32_t ev, uint32_t ctxId, uint32_t seqno, int32_t port) override;
+};
+
+// Chunks and fence state for the engine's FXE_BatchPool (fSchedLock held).
+class FakeIrisXEBatchPoolPlatform : public FXE_BatchPoolPlatform {
+public:
+    FakeIrisXEExeclist* fExec;
+
+    bool allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu) override;
+    void releaseChunk(void* cookie) override;
+    bool fenceDone(const FXE_Fence& f) override;
+};
+
 class FakeIrisXEExeclist : public OSObject {
     OSDeclareDefaultStructors(FakeIrisXEExeclist)
 
 public:
-    static FakeIrisXEExeclist* withOwner(FakeIrisXEFramebuffer* owner);
+    // One instance per engine: render (RCS0) or copy (BCS0). Each has its
+    // own contexts, rings, CSB, ELSP descriptor page, scheduler and fences.
+    static FakeIrisXEExeclist* withOwner(FakeIrisXEFramebuffer* owner,
+                                         uint32_t engineClass = ENGINE_CLASS_RENDER);
     void free()override;
 
     bool createHwContext();
@@ -55,9 +97,23 @@ public:
 
         FakeIrisXEGEM*  ringGem;
         uint64_t        ringGGTT;
+        uint32_t        ringTail;       // bytes; where the next request's commands go
 
         FakeIrisXEGEM*  fenceGem;
         uint64_t        fenceGGTT;
+
+        FakeIrisXEPpgtt* vm;            // retained; null: runs in the GGTT
+
+        bool            used;           // slot holds a live context
+        bool            destroyPending; // recycle once its last request retires
+    };
+
+    // Pinned, GGTT-mapped LRC page + ring, recycled between contexts.
+    struct HwCtxBacking {
+        FakeIrisXEGEM*  lrcGem;
+        uint64_t        lrcGGTT;
+        FakeIrisXEGEM*  ringGem;
+        uint64_t        ringGGTT;
     };
 
         void handleCSB(); // called from interrupt
@@ -68,6 +124,8 @@ public:
         FakeIrisXEGEM*  batchGem;
         uint64_t        batchGGTT;
         uint32_t        seqno;          // submission sequence
+        uint32_t        timeline;       // fence timeline (= context slot)
+        uint64_t        fenceSeqno;     // value of the completion breadcrumb
 
         // software state flags:
         bool            inFlight;
@@ -78,49 +136,136 @@ public:
     static const uint32_t kMaxExeclistQueue  = 16;
     static const uint32_t kMaxHwContexts     = 16;
     static const uint32_t kMaxBanScore       = 3;
+    static const uint32_t kHwCtxRingSize     = 0x4000;   // 16KB per context
+    static const uint32_t kHwCtxLrcSize      = 4096;
+    static const uint32_t kHwCtxPoolPrewarm  = 2;
+    static const uint32_t kDepRetryUs        = 50;   // other engine's lock was busy
+    static const uint32_t kBatchPoolChunkSize = 64 * 1024;
 
     
     public:
         FakeIrisXEFramebuffer* fOwner;
 
-        // Global engine context list
+        // Engine this instance drives (ENGINE_CLASS_*) and its registers
+        uint32_t               fEngineClass;
+        FXE_EngineRegs         fRegs;
+
+        // Global engine context list (fHwContextCount = live entries)
         XEHWContext            fHwContexts[kMaxHwContexts];
         uint32_t               fHwContextCount;
 
-        // Software execlist queue
-        ExecQueueEntry         fQueue[kMaxExeclistQueue];
-        uint32_t               fQHead;
-        uint32_t               fQTail;
-        uint32_t               fNextSeqno;
+        // Free LRC/ring backings and the golden LRC image they are reset from
+        HwCtxBacking           fCtxPool[kMaxHwContexts];
+        uint32_t               fCtxPoolCount;
+        uint8_t*               fGoldenLrc;
 
-        // Currently running contexts (two ELSP slots)
-        XEHWContext*           fInflight[2];
-        uint32_t               fInflightSeqno[2];
+        // Software execlist queue. fQueue[i] carries the kext-side state of
+        // request slot i; ELSP/CSB/scheduling/ban logic lives in fCore.
+        ExecQueueEntry         fQueue[kMaxExeclistQueue];
+        FXE_ExecCore           fCore;
+        FakeIrisXEExecPlatform fPlatform;
+
+        // ELSP descriptor page (one 64-byte slot per port), reused per submit
+        FakeIrisXEGEM*         fElspDescGem;
+        uint64_t               fElspDescGGTT;
+
+        // Fence status page: one 64-bit seqno timeline per context slot,
+        // written by the engine on completion. Waiters sleep on fTimeline
+        // under fSchedLock.
+        FakeIrisXEGEM*         fTimelineGem;
+        uint64_t               fTimelineGGTT;
+        FXE_TimelinePage       fTimeline;
+
+        // Small kernel batches (blits, clip setup) are slices of a few
+        // pinned, mapped chunks; a chunk is reused once its last fence is done.
+        FXE_BatchPool               fBatchPool;
+        FakeIrisXEBatchPoolPlatform fBatchPoolPlatform;
+
+        // Optional MMIO/GGTT backend (engine model); nullptr = hardware
+        FXE_EngineIO*          fEngineIO;
+
+        // Timeslice / preemption / hang watchdog (one workloop timer, armed
+        // for whichever comes first; lock covers fCore+fQueue)
+        IOTimerEventSource*    fTimesliceTimer;
+        IOWorkLoop*            fSchedWorkLoop;
+        // Re-kick for requests held on input fences (pokeDeps); separate so
+        // armTimeslice() does not overwrite it
+        IOTimerEventSource*    fDepTimer;
+        IOLock*                fSchedLock;
 
         // CSB state
         FakeIrisXEGEM*         fCsbGem;
         uint64_t               fCsbGGTT;
         uint32_t               fCsbSizeBytes;
         uint32_t               fCsbEntryCount;
-        uint32_t               fCsbReadIndex;   // software head
+        uint32_t               fCsbReadIndex;   // CSB read pointer (last entry consumed)
 
         // Single global LRC context from earlier can remain for simple paths,
         // but for multi-context execlists we mostly use XEHWContext entries.
 
         // ---- API ----
 
-        // New: register HW context per ctxId (from Accelerator)
-        XEHWContext* createHwContextFor(uint32_t ctxId, uint32_t priority);
+        // New: register HW context per ctxId (from Accelerator). With vm
+        // the context's LRC points at that address space's page tables.
+        XEHWContext* createHwContextFor(uint32_t ctxId, uint32_t priority,
+                                        FakeIrisXEPpgtt* vm = nullptr);
         XEHWContext* lookupHwContext(uint32_t ctxId);
-
-        // New: main submit entry point
-        bool submitForContext(XEHWContext* hw, FakeIrisXEGEM* batchGem);
-
-        // Low-level ELSP writer (single slot)
-        bool submitToELSPSlot(int slot, ExecQueueEntry* e);
+        bool destroyHwContext(uint32_t ctxId);
+
+        // Context backing pool
+        bool prewarmContextPool(uint32_t count);
+        bool allocCtxBacking(HwCtxBacking* out);
+        void freeCtxBacking(HwCtxBacking* b);
+        void unmapCtxBacking(HwCtxBacking* b);
+        void recycleHwContext(XEHWContext* hw);
+        void drainContextPool();
+
+        const char* engineName() const { return fEngineClass == ENGINE_CLASS_COPY ? "bcs0" : "rcs0"; }
+
+        // New: main submit entry point. deps: up to FXE_ExecCore::kMaxDeps
+        // input fences from any engine; the request is held until they
+        // signal and fails (fence error) if one of them fails.
+        bool submitForContext(XEHWContext* hw, FakeIrisXEGEM* batchGem,
+                              FXE_Fence* outFence = nullptr,
+                              const FXE_Fence* deps = nullptr, uint32_t depCount = 0);
+
+        // Same for a slice of the engine's batch pool. allocBatch() fails
+        // when every chunk is busy (fall back to a GEM); submitBatchSlice()
+        // commits the slice to the request's fence, or gives it back if
+        // the submit fails.
+        bool allocBatch(uint32_t bytes, FXE_BatchSlice* out);
+        bool submitBatchSlice(XEHWContext* hw, const FXE_BatchSlice& slice,
+                              FXE_Fence* outFence = nullptr,
+                              const FXE_Fence* deps = nullptr, uint32_t depCount = 0);
+        void publishBatchPoolStats();
+
+        // Fences: block until all (or, with waitAny, one) of `count` fences
+        // signal. kIOReturnTimeout after timeoutMs (0 = just poll),
+        // kIOReturnIOError if a fence that ended the wait failed (fault,
+        // ban, context destroyed); *outIndex names that fence. All fences
+        // must come from this engine (kIOReturnBadArgument otherwise).
+        IOReturn waitFences(const FXE_Fence* fences, uint32_t count, bool waitAny,
+                            uint32_t timeoutMs, uint32_t* outIndex = nullptr);
+        IOReturn waitFence(const FXE_Fence& fence, uint32_t timeoutMs);
+        int32_t  fenceState(const FXE_Fence& fence);
+
+        // Input fences (called with fSchedLock held, see the platform hooks)
+        int32_t  depState(const FXE_Fence& fence);
+        uint64_t depSemaphore(const FXE_Fence& fence);
+        uint64_t inFlightBreadcrumb(const FXE_Fence& fence);
+        void     pokeDeps(uint32_t us = 1);
+
+        // Route MMIO and GGTT mapping through a model instead of hardware.
+        // Set before createHwContext(); the caller keeps io alive.
+        void setEngineIO(FXE_EngineIO* io) { fEngineIO = io; }
+        uint64_t ggttMapGem(FakeIrisXEGEM* gem);
+        bool ggttMapGems(FakeIrisXEGEM* const* gems, uint64_t* out, uint32_t count);
 
         // Called from framebuffer IRQ
         void engineIrq(uint32_t iir);
+        // Same, for an engine without its own IIR on the shared line (BCS0):
+        // costs one CSB pointer read when nothing new has landed.
+        void drainCsbFromIrq();
 
         // CSB handling
         void processCsbEntries();
@@ -130,9 +275,30 @@ public:
         void onContextComplete(uint32_t ctxId, uint32_t status);
         void onContextFault(uint32_t ctxId, uint32_t status);
 
-        // Scheduling helpers
+        void onContextPreempted(uint32_t ctxId, uint32_t status);
+
+        // Scheduling helpers (called with fSchedLock held)
         ExecQueueEntry* pickNextReady();
         void maybeKickScheduler();
+        void retireQueueEntry(int32_t slot);
+        bool queueBatchLocked(XEHWContext* hw, FakeIrisXEGEM* batchGem, uint64_t batchGGTT,
+                              FXE_Fence* outFence, const FXE_Fence* deps, uint32_t depCount);
+        void armTimeslice(uint64_t deadlineNs);
+        bool resetEngine(const FXE_EngineRegs& regs);
+        void publishHangStats();
+        bool bringUpRenderEngine();
+        bool ensureElspDescriptorPage();
+        bool ensureTimelinePage();
+        uint32_t timelineFor(XEHWContext* hw) const { return (uint32_t)(hw - fHwContexts); }
+        uint32_t readSavedRingHead(XEHWContext* hw);
+        void restoreRingHead(XEHWContext* hw, uint32_t head);
+        bool emitRing(XEHWContext* hw, const uint32_t* cs, uint32_t dwords, uint32_t* outTail);
+
+        // Timeslicing lifecycle
+        bool startScheduler(IOWorkLoop* wl);
+        void stopScheduler();
+        void timesliceFired(IOTimerEventSource* sender);
+        static uint64_t schedNowNs();
 
         // Existing helpers
         uint32_t mmioRead32(uint32_t off);
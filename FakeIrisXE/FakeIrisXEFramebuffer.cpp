@@ -1611,7 +1611,22 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
     fGGTT = (volatile uint32_t*)map->getVirtualAddress();
     fGGTTSize = gttSize2;
     fGGTTBaseGPU = 0x00000000;
-    fNextGGTTOffset = 0x00100000;   // leave hardware reserved region
+    // one 8-byte PTE per 4 KB page; leave the hardware reserved first 1 MB
+    fGgttSpace.init(0x00100000, (fGGTTSize / 8) << 12);
+    if (!fGgttLock)
+        fGgttLock = IOLockAlloc();
+    fGgttIO.fFb = this;
+    // Gen12 GGTT entries map 4 KB each; a table with 64 KB / 2 MB entries
+    // sets them here and ggttMap starts using them for aligned runs.
+    fGgttIO.fPageSizes = FXE_PAGE_4K;
+    fPteBatch.init(&fGgttIO);
+    fGgttEvictPlatform.fFb = this;
+    fGgttEvict.init(&fGgttSpace, &fGgttEvictPlatform);
+    if (!fPtPoolLock) {
+        fPtPoolLock = IOLockAlloc();
+        fPtPages.fFb = this;
+        fPtPool.init(&fPtBacking);
+    }
 
     IOLog("FakeIrisXEFramebuffer: GGTT mapped at %p\n", fGGTT);
 
@@ -1655,8 +1670,7 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
 
     
     // map BAR0 into fBar0 — you already have this
-    // map GGTT into fGGTT — you already have this
-    fNextGGTTOffset = 0x00100000; // choose appropriate base
+    // map GGTT into fGGTT — you already have this (fGgttSpace set up there)
 
     // Create ring
     if (!createRcsRing(256 * 1024)) {
@@ -1669,11 +1683,8 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
     }
 
     // optional: create & map fence early (so submitBatch doesn't do it)
-    fFenceGEM = FakeIrisXEGEM::withSize(4096, 0);
-    if (fFenceGEM) {
-        fFenceGEM->pin();
-    } else {
-        IOLog("(FakeIrisXE) [V154] Fence GEM allocation failed (continuing without early fence)\n");
+    if (!ensureFencePage()) {
+        IOLog("(FakeIrisXE) [V154] Fence page setup failed (continuing without early fence)\n");
     }
 
     // ================================================
@@ -1747,12 +1758,12 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
     
     
     // Create lock for pending submissions
-    if (!fPendingLock)
+    if (!fPendingLock) {
         fPendingLock = IOLockAlloc();
-
-    // Pending submission array
-    if (!fPendingSubmissions)
-        fPendingSubmissions = OSArray::withCapacity(16);
+        fPending.init();
+        fChainPoolPlatform.fFb = this;
+        fChainPool.init(&fChainPoolPlatform, kChainPoolChunkSize);
+    }
 
     // Create IOCommandGate
     if (fWorkLoop && !fCmdGate) {
@@ -1763,6 +1774,49 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
         }
     }
 
+    // Client accounts and their optional quotas
+    if (!fAccountLock) {
+        fAccountLock = IOLockAlloc();
+        fClientAccounts = OSArray::withCapacity(4);
+        uint32_t mb = 0;
+        if (PE_parse_boot_argn("fakeirisxe-quota-soft", &mb, sizeof(mb)))
+            fClientQuotaSoft = (uint64_t)mb << 20;
+        mb = 0;
+        if (PE_parse_boot_argn("fakeirisxe-quota-hard", &mb, sizeof(mb)))
+            fClientQuotaHard = (uint64_t)mb << 20;
+        if (fClientQuotaSoft || fClientQuotaHard)
+            IOLog("FakeIrisXEFramebuffer: client GGTT quota soft=%lluMB hard=%lluMB\n",
+                  fClientQuotaSoft >> 20, fClientQuotaHard >> 20);
+    }
+
+    // BO cache for the chain/blit batches; works without the reap timer
+    if (!fBoCacheLock) {
+        fBoCacheLock = IOLockAlloc();
+        fBoCache.init(&fBoCachePlatform, kBoCacheBudget, (uint64_t)kBoCacheMaxAgeMs * 1000000ULL);
+    }
+    if (fWorkLoop && !fRingFlushTimer) {
+        fRingFlushTimer = IOTimerEventSource::timerEventSource(this,
+            OSMemberFunctionCast(IOTimerEventSource::Action, this,
+                                 &FakeIrisXEFramebuffer::ringFlushTimerFired));
+        if (fRingFlushTimer && fWorkLoop->addEventSource(fRingFlushTimer) != kIOReturnSuccess) {
+            fRingFlushTimer->release();
+            fRingFlushTimer = nullptr;
+        }
+        if (fRingRCS)
+            fRingRCS->setFlushTimer(fRingFlushTimer);
+    }
+    if (fWorkLoop && fBoCacheLock && !fBoCacheTimer) {
+        fBoCacheTimer = IOTimerEventSource::timerEventSource(this,
+            OSMemberFunctionCast(IOTimerEventSource::Action, this,
+                                 &FakeIrisXEFramebuffer::boCacheTimerFired));
+        if (fBoCacheTimer && fWorkLoop->addEventSource(fBoCacheTimer) == kIOReturnSuccess) {
+            fBoCacheTimer->setTimeoutMS(kBoCacheReapMs);
+        } else if (fBoCacheTimer) {
+            fBoCacheTimer->release();
+            fBoCacheTimer = nullptr;
+        }
+    }
+
     
 
     enableRcsInterruptsSafely();
@@ -1781,9 +1835,10 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
     if (!fExeclist) {
         IOLog("FakeIrisXEFramebuffer: EXECLIST allocation FAILED\n");
     } else {
-        
-        
-        
+        if (!fExeclist->startScheduler(fWorkLoop)) {
+            IOLog("FakeIrisXEFramebuffer: EXECLIST timeslicing unavailable (no workloop timer)\n");
+        }
+
         if (!fExeclist->createHwContext()) {
             IOLog("FakeIrisXEFramebuffer: EXECLIST HW context FAILED\n");
         } else {
@@ -1816,6 +1871,9 @@ bool FakeIrisXEFramebuffer::start(IOService* provider) {
                 } else {
                     IOLog("FakeIrisXEFramebuffer: [V151] Skipping diagnostics (add '-fakeirisxe-diag' to boot-args to enable)\n");
                 }
+
+                if (!initBlitEngine())
+                    IOLog("FakeIrisXEFramebuffer: BCS0 unavailable, blits stay on the RCS ring\n");
             }
         
             // Create / init RCS ring (existing helper returns bool)
@@ -2225,9 +2283,32 @@ void FakeIrisXEFramebuffer::stop(IOService* provider)
         fInterruptSource->release();
         fInterruptSource = nullptr;
     }
-    if (fPendingSubmissions) {
-        fPendingSubmissions->release();
-        fPendingSubmissions = nullptr;
+    if (fExeclist) {
+        fExeclist->stopScheduler();
+    }
+    if (fBlitExeclist) {
+        fBlitExeclist->stopScheduler();
+    }
+    if (fRingFlushTimer) {
+        if (fRingRCS)
+            fRingRCS->setFlushTimer(nullptr);
+        fRingFlushTimer->cancelTimeout();
+        if (fWorkLoop)
+            fWorkLoop->removeEventSource(fRingFlushTimer);
+        fRingFlushTimer->release();
+        fRingFlushTimer = nullptr;
+    }
+    if (fBoCacheTimer) {
+        fBoCacheTimer->cancelTimeout();
+        if (fWorkLoop)
+            fWorkLoop->removeEventSource(fBoCacheTimer);
+        fBoCacheTimer->release();
+        fBoCacheTimer = nullptr;
+    }
+    if (fBoCacheLock) {
+        IOLockLock(fBoCacheLock);
+        fBoCache.trim(0);
+        IOLockUnlock(fBoCacheLock);
     }
     if (fWorkLoop) {
         fWorkLoop->release();
@@ -2241,13 +2322,9 @@ void FakeIrisXEFramebuffer::stop(IOService* provider)
         fCmdGate = nullptr;
     }
 
-    if (fPendingSubmissions) {
-        cleanupAllPendingSubmissions();
-        fPendingSubmissions->release();
-        fPendingSubmissions = nullptr;
-    }
-
     if (fPendingLock) {
+        cleanupAllPendingSubmissions();
+        fChainPool.drain();
         IOLockFree(fPendingLock);
         fPendingLock = nullptr;
     }
@@ -2425,6 +2502,36 @@ void FakeIrisXEFramebuffer::free() {
         IOLockFree(timerLock);
         timerLock = nullptr;
     }
+
+    if (fBoCacheLock) {
+        IOLockLock(fBoCacheLock);
+        fBoCache.trim(0);
+        IOLockUnlock(fBoCacheLock);
+        IOLockFree(fBoCacheLock);
+        fBoCacheLock = nullptr;
+    }
+
+    if (fAccountLock) {
+        IOLockLock(fAccountLock);
+        OSSafeReleaseNULL(fClientAccounts);
+        IOLockUnlock(fAccountLock);
+        IOLockFree(fAccountLock);
+        fAccountLock = nullptr;
+    }
+
+    // every client (and its page tables) is gone by now
+    if (fPtPoolLock) {
+        IOLockLock(fPtPoolLock);
+        fPtPool.drain();
+        IOLockUnlock(fPtPoolLock);
+        IOLockFree(fPtPoolLock);
+        fPtPoolLock = nullptr;
+    }
+
+    if (fGgttLock) {
+        IOLockFree(fGgttLock);
+        fGgttLock = nullptr;
+    }
     
     driverActive = false;
     
@@ -4363,152 +4470,288 @@ static inline uint32_t make_ggtt_pte32_hi(uint64_t phys) {
     return (uint32_t)((phys >> 44) & 0xFF); // platform dependent; keep simple
 }
 
-// Map a GEM into GGTT and return GPU VA (aligned to page). Thread-safe enough for bring up.
-uint64_t FakeIrisXEFramebuffer::ggttMap(FakeIrisXEGEM* gem) {
-    if (!gem || !fGGTT) return 0;
-
-    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
-    if (!md) {
-        IOLog("(FakeIrisXE) ggttMap: gem->memoryDescriptor() is NULL (gem=%p)\n", gem);
-        return 0;
-    }
+// TGL 64-bit GGTT PTE for one 4 KB page of system memory
+static inline uint64_t make_ggtt_pte64(uint64_t phys) {
+    uint64_t pte_val = (phys >> 12) & 0x0000FFFFFFFFF000ULL;  // Phys page in bits 56:12
 
-    // FIXED: Ensure GGTT is 64-bit array (TGL PTEs)
-    if (!fGGTT) {
-        IOLog("(FakeIrisXE) ggttMap: BAR1/GGTT not mapped yet (fBar1=%p)\n", fGGTT);
-        return 0;
-    }
+    pte_val |= (1ULL << 57);   // Valid bit (bit 57 = 1)
+    pte_val |= (0ULL << 59);   // 4KB page (exponent = 0)
+    pte_val |= (0ULL << 58);   // System memory (bit 58 = 0)
+    pte_val |= (0ULL << 2);    // PAT index 0 (WB cache)
+    return pte_val;
+}
 
-    uint32_t pages = gem->pageCount();
-    uint64_t gpuAddr = fNextGGTTOffset;  // in bytes
-    uint64_t offGPU = gpuAddr;
+volatile uint64_t* FakeIrisXEGgttIO::ptes()
+{
+    return (volatile uint64_t*)fFb->fGGTT;
+}
 
-    uint64_t offset = 0;
-    for (uint32_t i = 0; i < pages; ++i) {
-        uint64_t segSz = 0;
-        mach_vm_address_t phys = gem->getPhysicalSegment(offset, &segSz);
-        if (!phys) {
-            IOLog("FakeIrisXEFramebuffer: ggttMap - null phys seg at page %u\n", i);
-            return 0;
-        }
+uint64_t FakeIrisXEGgttIO::entries()
+{
+    return fFb->fGGTTSize / 8;
+}
 
-        // FIXED: Index in pages (>>12)
-        uint64_t gtt_index = (offGPU >> 12);
-        if ((gtt_index + 1) * 8 > fGGTTSize) {  // FIXED: 8 bytes per 64-bit PTE
-            IOLog("FakeIrisXEFramebuffer: ggttMap - out of GGTT space\n");
-            return 0;
-        }
+void FakeIrisXEGgttIO::flush()
+{
+    fFb->safeMMIOWrite(GTT_FLUSH_REG, 1);  // GTT_WRITE_FLUSH (TGL required)
+}
 
-        // FIXED: TGL 64-bit PTE (bits 63:0)
-        uint64_t pte_val = ((uint64_t)phys >> 12) & 0x0000FFFFFFFFF000ULL;  // Phys page in bits 56:12
+uint64_t FakeIrisXEGgttIO::encode(uint64_t phys, uint32_t size)
+{
+    (void)size;     // only FXE_PAGE_4K is advertised
+    return make_ggtt_pte64(phys);
+}
 
-        pte_val |= (1ULL << 57);   // Valid bit (bit 57 = 1)
-        pte_val |= (0ULL << 59);   // 4KB page (exponent = 0)
-        pte_val |= (0ULL << 58);   // System memory (bit 58 = 0)
-        pte_val |= (0ULL << 2);    // PAT index 0 (WB cache)
+bool FakeIrisXEFramebuffer::ggttBegin()
+{
+    if (!fGGTT || !fGgttLock) return false;
+    IOLockLock(fGgttLock);
+    return true;
+}
 
-        // FIXED: Write full 64-bit PTE (no low/high split)
-        volatile uint64_t* pte_ptr = (volatile uint64_t*)fGGTT + gtt_index;
-        *pte_ptr = pte_val;
+// Store every PTE queued since ggttBegin(), flush once, unwire what was
+// unbound and drop the lock.
+uint32_t FakeIrisXEFramebuffer::ggttCommit()
+{
+    uint32_t written = fPteBatch.commit();
+    ggttRunUnwires();
+    IOLockUnlock(fGgttLock);
+    return written;
+}
 
-        offGPU += 4096;
-        offset += segSz ? segSz : 4096;
+// The GGTT may point at a userptr's pages until the clears are flushed,
+// so its wiring goes at the commit. A full list commits early.
+void FakeIrisXEFramebuffer::ggttDeferUnwire(FakeIrisXEGEM* gem)
+{
+    if (!gem->isUserptr())
+        return;
+    if (fGgttUnwireCount == kGgttUnwireBatch) {
+        fPteBatch.commit();
+        ggttRunUnwires();
     }
-
-    // FIXED: Full flush (CPU + GPU cache)
-    __sync_synchronize();
-    safeMMIOWrite(0x1082C0, 1);  // GTT_WRITE_FLUSH (TGL required)
-
-    uint64_t ret = gpuAddr;
-    fNextGGTTOffset += ((uint64_t)pages << 12);
-    IOLog("FakeIrisXEFramebuffer: ggttMap -> GPU VA 0x%llx pages=%u (TGL PTEs)\n", (unsigned long long)ret, pages);
-    return ret;
+    fGgttUnwire[fGgttUnwireCount++] = gem;
 }
 
-// V140: Map a GEM into GGTT at or above a minimum offset (for GuC firmware placement)
-// This ensures firmware is mapped above WOPCM size to avoid GGTT pin bias issues
-uint64_t FakeIrisXEFramebuffer::ggttMapAtOrAbove(FakeIrisXEGEM* gem, uint64_t minOffset) {
-    if (!gem || !fGGTT) return 0;
-
-    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+void FakeIrisXEFramebuffer::ggttRunUnwires()
+{
+    for (uint32_t i = 0; i < fGgttUnwireCount; ++i)
+        fGgttUnwire[i]->unwire();
+    fGgttUnwireCount = 0;
+}
+
+// Map a GEM into a free GGTT range at or above minOffset and return its GPU
+// VA (0 on failure). The range comes from fGgttSpace. The GEM's last
+// unpin leaves the mapping on the idle list (ggttIdle); the range goes
+// back, PTEs cleared, when the evictor picks it, on ggttUnmap() or when
+// the GEM is freed. A GEM that is already bound gets its current range
+// back. Called between ggttBegin()/ggttCommit().
+// The object is walked one physically contiguous segment at a time;
+// aligned stretches get large entries where the table has them.
+// Userptr objects are wired here and unwired at the commit that stores
+// the clears of their range.
+uint64_t FakeIrisXEFramebuffer::ggttMapDeferred(FakeIrisXEGEM* gem, uint64_t minOffset, const char* who,
+                                                FXE_PteMapInfo* info) {
+    if (!gem) return 0;
+
+    IOMemoryDescriptor* md = gem->backing();
     if (!md) {
-        IOLog("(FakeIrisXE) ggttMapAtOrAbove: gem->memoryDescriptor() is NULL (gem=%p)\n", gem);
+        IOLog("(FakeIrisXE) %s: gem->backing() is NULL (gem=%p)\n", who, gem);
         return 0;
     }
 
-    if (!fGGTT) {
-        IOLog("(FakeIrisXE) ggttMapAtOrAbove: BAR1/GGTT not mapped yet (fGGTT=%p)\n", fGGTT);
-        return 0;
+    uint32_t pages = gem->pageCount();
+    if (!pages) return 0;
+
+    const FakeIrisXEVma& vma = gem->vma();
+    if (vma.owner == this) {
+        if (vma.gpuAddr >= minOffset) {
+            fGgttEvict.remove(gem->lruNode());     // in use again
+            return vma.gpuAddr;
+        }
+        // bound too low for this caller (GuC above WOPCM): move it
+        ggttUnmapDeferred(vma.gpuAddr);
     }
 
-    uint32_t pages = gem->pageCount();
-    
-    // V140: Align minOffset to page boundary and ensure fNextGGTTOffset is at least minOffset
-    minOffset = (minOffset + 4095) & ~4095ULL;
-    if (fNextGGTTOffset < minOffset) {
-        fNextGGTTOffset = minOffset;
+    if (!gem->wire()) {
+        IOLog("FakeIrisXEFramebuffer: %s - cannot wire client pages (gem=%p%s)\n",
+              who, gem, gem->isInvalidated() ? ", invalidated" : "");
+        return 0;
     }
-    
-    uint64_t gpuAddr = fNextGGTTOffset;
-    uint64_t offGPU = gpuAddr;
 
-    IOLog("(FakeIrisXE) ggttMapAtOrAbove: minOffset=0x%llx starting at GPU VA 0x%llx\n", 
-          (unsigned long long)minOffset, (unsigned long long)gpuAddr);
+    const uint64_t bytes = (uint64_t)pages << 12;
+    // A client's objects count against its quota: over the hard limit the
+    // map fails, over the soft one its own idle mappings make room first.
+    FakeIrisXEClientAccount* acct = gem->account();
+    if (acct) {
+        const FXE_Charge charge = acct->account().chargeMap(bytes);
+        if (charge == FXE_CHARGE_DENIED) {
+            IOLog("FakeIrisXEFramebuffer: %s - pid %u over its GGTT quota (%llu KB mapped)\n",
+                  who, acct->account().pid(), acct->account().stats().mapped >> 10);
+            gem->unwire();
+            return 0;
+        }
+        if (charge == FXE_CHARGE_SOFT)
+            fGgttEvict.evictOwned(acct, acct->account().mappedOverSoft());
+    }
+
+    const uint64_t align = FXE_PteBatch::alignFor(fGgttIO.pageSizes(), bytes);
+    uint64_t gpuAddr = 0;
+    if (!fGgttEvict.alloc(bytes, align, minOffset, UINT64_MAX, &gpuAddr)) {
+        IOLog("FakeIrisXEFramebuffer: %s - out of GGTT space (pages=%u free=%lluKB largest=%lluKB idle=%u)\n",
+              who, pages, fGgttSpace.freeBytes() >> 10, fGgttSpace.largestHole() >> 10,
+              fGgttEvict.stats().idle);
+        if (acct)
+            acct->account().unchargeMap(bytes);
+        gem->unwire();
+        return 0;
+    }
 
+    const uint64_t index = gpuAddr >> 12;
+    FXE_PteMapInfo local = {};
+    if (!info) info = &local;
     uint64_t offset = 0;
-    for (uint32_t i = 0; i < pages; ++i) {
+    while (offset < bytes) {
         uint64_t segSz = 0;
         mach_vm_address_t phys = gem->getPhysicalSegment(offset, &segSz);
         if (!phys) {
-            IOLog("FakeIrisXEFramebuffer: ggttMapAtOrAbove - null phys seg at page %u\n", i);
+            IOLog("FakeIrisXEFramebuffer: %s - null phys seg at page %llu\n", who, offset >> 12);
+            // the batch may already have stored part of the mapping
+            fPteBatch.clear(index, offset >> 12);
+            fGgttSpace.free(gpuAddr);
+            if (acct)
+                acct->account().unchargeMap(bytes);
+            ggttDeferUnwire(gem);
             return 0;
         }
+        // whole pages from here to the end of the segment (the last one of
+        // the object may be partial)
+        uint64_t segPages = (((phys & 0xFFFULL) + segSz + 4095) >> 12);
+        if (!segPages) segPages = 1;
+        if (segPages > ((bytes - offset) >> 12)) segPages = (bytes - offset) >> 12;
+        fPteBatch.addRun(index + (offset >> 12), phys & ~0xFFFULL, segPages, info);
+        offset += segPages << 12;
+    }
+    fGgttSpace.setTag(gpuAddr, (uint64_t)(uintptr_t)gem);
+    gem->setGpuAddress(this, gpuAddr, bytes, info->pageSize);
+    return gpuAddr;
+}
 
-        uint64_t gtt_index = (offGPU >> 12);
-        if ((gtt_index + 1) * 8 > fGGTTSize) {
-            IOLog("FakeIrisXEFramebuffer: ggttMapAtOrAbove - out of GGTT space\n");
-            return 0;
-        }
+// Queue the PTE clears of the mapping at gpuAddr and return its range to
+// the allocator. Returns the mapping's size, 0 if nothing was mapped there.
+uint64_t FakeIrisXEFramebuffer::ggttUnmapDeferred(uint64_t gpuAddr)
+{
+    const uint64_t bytes = fGgttSpace.sizeOf(gpuAddr);
+    if (!bytes) return 0;
+    // a GEM freed while bound unbinds first, so the tag is never stale
+    if (FakeIrisXEGEM* gem = (FakeIrisXEGEM*)(uintptr_t)fGgttSpace.tagOf(gpuAddr)) {
+        fGgttEvict.remove(gem->lruNode());
+        if (FakeIrisXEClientAccount* acct = gem->account())
+            acct->account().unchargeMap(gem->vma().size);
+        gem->clearGpuAddress();
+        // the clears are only queued: the pages stay wired until the
+        // commit has stored and flushed them
+        ggttDeferUnwire(gem);
+    }
+    fPteBatch.clear(gpuAddr >> 12, bytes >> 12);
+    fGgttSpace.free(gpuAddr);
+    return bytes;
+}
+
+void FakeIrisXEFramebuffer::ggttUnbind(FakeIrisXEGEM* gem, bool force)
+{
+    if (!gem || !ggttBegin()) return;
+    const FakeIrisXEVma& vma = gem->vma();
+    if (vma.owner == this && (force || !gem->pinCount()))
+        ggttUnmapDeferred(vma.gpuAddr);
+    ggttCommit();
+}
 
-        uint64_t pte_val = ((uint64_t)phys >> 12) & 0x0000FFFFFFFFF000ULL;
-        pte_val |= (1ULL << 57);
-        pte_val |= (0ULL << 59);
-        pte_val |= (0ULL << 58);
-        pte_val |= (0ULL << 2);
+void FakeIrisXEFramebuffer::ggttIdle(FakeIrisXEGEM* gem)
+{
+    if (!gem || !fGgttLock) return;
+    IOLockLock(fGgttLock);
+    const FakeIrisXEVma& vma = gem->vma();
+    if (vma.owner == this && !gem->pinCount())
+        fGgttEvict.touch(gem->lruNode(), gem, vma.gpuAddr);
+    IOLockUnlock(fGgttLock);
+}
 
-        volatile uint64_t* pte_ptr = (volatile uint64_t*)fGGTT + gtt_index;
-        *pte_ptr = pte_val;
+// Picked by fGgttEvict when a mapping does not fit. A pin taken since
+// the GEM went idle (pin() leaves the node listed) keeps it bound.
+uint64_t FakeIrisXEGgttEvict::evict(void* obj)
+{
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)obj;
+    if (gem->pinCount() || gem->vma().owner != fFb)
+        return 0;
+    return fFb->ggttUnmapDeferred(gem->vma().gpuAddr);
+}
 
-        offGPU += 4096;
-        offset += segSz ? segSz : 4096;
+const void* FakeIrisXEGgttEvict::ownerOf(void* obj)
+{
+    return ((FakeIrisXEGEM*)obj)->account();
+}
+
+uint64_t FakeIrisXEFramebuffer::ggttMapRange(FakeIrisXEGEM* gem, uint64_t minOffset, const char* who,
+                                             FXE_PteMapInfo* info) {
+    if (!gem || !ggttBegin()) return 0;
+    const uint64_t failures = fGgttEvict.stats().failures;
+    uint64_t gpuAddr = ggttMapDeferred(gem, minOffset, who, info);
+    const bool noSpace = fGgttEvict.stats().failures != failures;
+    ggttCommit();
+
+    // Objects parked in the BO cache stay pinned, out of the evictor's
+    // reach: drop them and try once more.
+    if (!gpuAddr && noSpace && fBoCacheLock) {
+        IOLockLock(fBoCacheLock);
+        const uint32_t dropped = fBoCache.trim(0);
+        IOLockUnlock(fBoCacheLock);
+        if (dropped && ggttBegin()) {
+            gpuAddr = ggttMapDeferred(gem, minOffset, who, info);
+            ggttCommit();
+        }
     }
+    return gpuAddr;
+}
 
-    __sync_synchronize();
-    safeMMIOWrite(0x1082C0, 1);
-
-    uint64_t ret = gpuAddr;
-    fNextGGTTOffset += ((uint64_t)pages << 12);
-    IOLog("FakeIrisXEFramebuffer: ggttMapAtOrAbove -> GPU VA 0x%llx pages=%u\n", (unsigned long long)ret, pages);
+// Map a GEM into GGTT and return GPU VA (aligned to page).
+uint64_t FakeIrisXEFramebuffer::ggttMap(FakeIrisXEGEM* gem) {
+    FXE_PteMapInfo info = {};
+    uint64_t ret = ggttMapRange(gem, 0, "ggttMap", &info);
+    if (ret && info.segments)
+        IOLog("FakeIrisXEFramebuffer: ggttMap -> GPU VA 0x%llx pages=%u segs=%u ptes=%u saved=%u page=%uK\n",
+              (unsigned long long)ret, gem->pageCount(), info.segments, info.ptes,
+              info.ptesSaved, info.pageSize >> 10);
     return ret;
 }
 
+// V140: Map a GEM into GGTT at or above a minimum offset (for GuC firmware placement)
+// This ensures firmware is mapped above WOPCM size to avoid GGTT pin bias issues
+uint64_t FakeIrisXEFramebuffer::ggttMapAtOrAbove(FakeIrisXEGEM* gem, uint64_t minOffset) {
+    minOffset = (minOffset + 4095) & ~4095ULL;
+    uint64_t ret = ggttMapRange(gem, minOffset, "ggttMapAtOrAbove");
+    if (ret)
+        IOLog("FakeIrisXEFramebuffer: ggttMapAtOrAbove(min=0x%llx) -> GPU VA 0x%llx pages=%u\n",
+              (unsigned long long)minOffset, (unsigned long long)ret, gem->pageCount());
+    return ret;
+}
 
-
-
-
+// Clear the PTEs of the mapping that starts at gpuAddr and return its range.
+// `pages` is informational; the allocator knows the real size.
 void FakeIrisXEFramebuffer::ggttUnmap(uint64_t gpuAddr, uint32_t pages) {
-    if (!fGGTT) return;
-    uint64_t off = gpuAddr;
-    for (uint32_t i = 0; i < pages; ++i) {
-        uint64_t idx = (off >> 12);
-        if ((idx * 4 + 4) <= fGGTTSize) {
-            fGGTT[idx] = 0;
-            // if 64-bit PTE used, also clear next dword
-        }
-        off += 4096;
+    if (!gpuAddr || !ggttBegin()) return;
+
+    const uint64_t bytes = ggttUnmapDeferred(gpuAddr);
+    ggttCommit();
+    if (!bytes) {
+        IOLog("FakeIrisXEFramebuffer: ggttUnmap GPU VA 0x%llx not mapped\n", (unsigned long long)gpuAddr);
+        return;
     }
-    __sync_synchronize();
-    IOLog("FakeIrisXEFramebuffer: ggttUnmap GPU VA 0x%llx pages=%u\n", (unsigned long long)gpuAddr, pages);
+    if (pages && ((uint64_t)pages << 12) != bytes)
+        IOLog("FakeIrisXEFramebuffer: ggttUnmap GPU VA 0x%llx pages=%u, mapped %llu\n",
+              (unsigned long long)gpuAddr, pages, bytes >> 12);
+
+    IOLog("FakeIrisXEFramebuffer: ggttUnmap GPU VA 0x%llx pages=%llu\n",
+          (unsigned long long)gpuAddr, bytes >> 12);
 }
 
 
@@ -4552,6 +4795,7 @@ FakeIrisXERing* FakeIrisXEFramebuffer::createRcsRing(size_t ringBytes)
 
     // Save metadata into ring object
     fRingRCS->attachRingGPUAddress(ringGpuVA);
+    fRingRCS->setFlushTimer(fRingFlushTimer);
     fRingSize = ringBytes;
     fRingGpuVA = ringGpuVA;
     fRingGem = ringGem;      // store GEM (so it doesn’t get freed)
@@ -4568,90 +4812,116 @@ FakeIrisXERing* FakeIrisXEFramebuffer::createRcsRing(size_t ringBytes)
 
 
 
-// Submit a batch GEM (already filled by caller) to RCS
+// Submit a batch GEM (already filled by caller) to RCS and wait for it
 // - batchGem: GEM that contains the batch commands.
 // - batchOffsetBytes: offset into GEM where batch starts
 // - batchSizeBytes: length of the batch
-// Return: sequence number or 0 on failure
-uint32_t FakeIrisXEFramebuffer::submitBatch(FakeIrisXEGEM* batchGem, size_t batchOffsetBytes, size_t batchSizeBytes) {
+// - latencyNs: optional, submit-to-completion time
+// Return: 1 once the batch completed, 0 on failure or timeout
+uint32_t FakeIrisXEFramebuffer::submitBatch(FakeIrisXEGEM* batchGem, size_t batchOffsetBytes, size_t batchSizeBytes,
+                                            uint64_t* latencyNs) {
     if (!fRingRCS || !batchGem) {
         IOLog("FakeIrisXEFramebuffer: submitBatch - bad args\n");
         return 0;
     }
 
-    // Ensure batch GEM is pinned and mapped into GGTT (if not, pin+map)
-    batchGem->pin();
-    uint64_t batchGpu = batchGem->gpuAddress(); // if your GEM stores GPU VA after ggttMap; else call ggttMap(batchGem)
-    if (batchGpu == 0) {
-        // If gpuAddress() not set, do a ggttMap here
-        batchGpu = ggttMap(batchGem);
-        if (batchGpu == 0) {
-            IOLog("FakeIrisXEFramebuffer: submitBatch - cannot get batch GPU VA\n");
-            batchGem->unpin();
-            return 0;
-        }
+    // Chain the batch with a tail that stores its seqno into the fence
+    // page; we wait for it right after, so no tail-write coalescing.
+    const uint64_t submitNs = FakeIrisXEExeclist::schedNowNs();
+    const uint64_t seq = appendFenceAndSubmit(batchGem, batchOffsetBytes, batchSizeBytes, true);
+    if (!seq) {
+        IOLog("FakeIrisXEFramebuffer: submitBatch - ring submit failed\n");
+        return 0;
     }
 
-    // Prepare fence: allocate if missing
-    if (!fFenceGEM) {
-        fFenceGEM = FakeIrisXEGEM::withSize(4096, 0);
-        if (!fFenceGEM) {
-            IOLog("FakeIrisXEFramebuffer: submitBatch - fence GEM alloc fail\n");
-            return 0;
-        }
-        fFenceGEM->pin();
-        uint64_t fenceGpu = ggttMap(fFenceGEM);
-        IOLog("FakeIrisXEFramebuffer: Fence GEM mapped at 0x%llx\n", (unsigned long long)fenceGpu);
-    }
-    uint64_t fenceGpuAddr = fFenceGEM->gpuAddress();
-    IOBufferMemoryDescriptor* fenceDesc = fFenceGEM->memoryDescriptor();
-    volatile uint32_t* fenceCpu = (volatile uint32_t*)fenceDesc->getBytesNoCopy();
-    // ensure fence is zero
-    fenceCpu[0] = 0;
-    __sync_synchronize();
-
-    // We need to ensure the batch ends with a MI_FLUSH_DW (POSTSYNC) writing a known value
-    // For a real driver we inject a MI_FLUSH_DW/POST_SYNC to fence address BEFORE MI_BATCH_BUFFER_END.
-    // Caller can include it; if not present we append an inline post-sync packet here.
-    // For safety we will not modify caller batch; instead the driver should require caller to
-    // include MI_FLUSH_DW or we can create a small chaining batch. Here we assume caller's batch
-    // already contains post-sync fence. If not, we can implement chain: create small tail-batch.
-    //
-    // For now: submit batchGpu directly.
-
-    // Push batch address into ring: use submitBatch64 (the ring helper we implemented)
-    bool ok = fRingRCS->submitBatch64(batchGpu);
-    if (!ok) {
-        IOLog("FakeIrisXEFramebuffer: submitBatch - ring submit failed\n");
-        batchGem->unpin();
+    uint64_t latency = 0;
+    if (waitForRcsSeqno(seq, submitNs, 2000, &latency) != kIOReturnSuccess) {
+        IOLog("FakeIrisXEFramebuffer: Batch fence TIMEOUT seq=%llu completed=%llu\n",
+              (unsigned long long)seq, (unsigned long long)fenceCompleted(FXE_FencePage::kRcs));
         return 0;
     }
 
-    // LOG the submission
-    IOLog("FakeIrisXEFramebuffer: Batch submitted GPU 0x%llx size=%zu\n",
-          (unsigned long long)batchGpu, batchSizeBytes);
+    IOLog("FakeIrisXEFramebuffer: Batch fence completed seq=%llu in %llu us\n",
+          (unsigned long long)seq, (unsigned long long)(latency / 1000));
+    // the chain's pin on the batch goes with its pending entry
+    retirePendingSubmissions(fenceCompleted(FXE_FencePage::kRcs));
+    if (latencyNs)
+        *latencyNs = latency;
+    return 1;
+}
 
-    // Wait for fence to be written — *do not busy-loop in production*, here we poll with timeout,
-    // but the real production path should use interrupts and proper synchronization.
-    const int timeoutMs = 2000;
-    int waited = 0;
-    bool completed = false;
-    while (waited < timeoutMs) {
-        __sync_synchronize();
-        if (fenceCpu[0] != 0) { completed = true; break; }
-        IOSleep(1);
-        waited++;
+static IOReturn rcsSeqnoSleepAction(OSObject* owner, void* arg0, void* arg1,
+                                    void* /*arg2*/, void* /*arg3*/)
+{
+    FakeIrisXEFramebuffer* self = OSDynamicCast(FakeIrisXEFramebuffer, owner);
+    if (!self) return kIOReturnBadArgument;
+    return self->sleepForRcsSeqno(*(const uint64_t*)arg0, *(const uint64_t*)arg1);
+}
+
+IOReturn FakeIrisXEFramebuffer::waitForRcsSeqno(uint64_t seq, uint64_t submitNs, uint32_t timeoutMs,
+                                                uint64_t* latencyNs)
+{
+    // Most small batches finish well inside a scheduler tick: spin first
+    const uint64_t spinEnd = FakeIrisXEExeclist::schedNowNs() + kRcsWaitSpinUs * 1000ULL;
+    bool done = FXE_FencePage::passed(fenceCompleted(FXE_FencePage::kRcs), seq);
+    while (!done && FakeIrisXEExeclist::schedNowNs() < spinEnd) {
+        IODelay(1);
+        done = FXE_FencePage::passed(fenceCompleted(FXE_FencePage::kRcs), seq);
     }
 
-    if (completed) {
-        IOLog("FakeIrisXEFramebuffer: Batch fence completed value=0x%08x\n", fenceCpu[0]);
+    IOReturn ret = kIOReturnSuccess;
+    if (done) {
+        __atomic_fetch_add(&fRcsWaitSpun, 1, __ATOMIC_RELAXED);
     } else {
-        IOLog("FakeIrisXEFramebuffer: Batch fence TIMEOUT fence=0x%08x\n", fenceCpu[0]);
+        __atomic_fetch_add(&fRcsWaitSlept, 1, __ATOMIC_RELAXED);
+        uint64_t deadline = 0;
+        clock_interval_to_deadline(timeoutMs, kMillisecondScale, &deadline);
+        if (fCmdGate && fWorkLoop && !fWorkLoop->onThread()) {
+            ret = fCmdGate->runAction(rcsSeqnoSleepAction, &seq, &deadline);
+        } else {
+            // On the workloop thread the interrupt cannot run: poll
+            ret = kIOReturnTimeout;
+            for (uint32_t waited = 0; waited < timeoutMs; ++waited) {
+                IOSleep(1);
+                if (FXE_FencePage::passed(fenceCompleted(FXE_FencePage::kRcs), seq)) {
+                    ret = kIOReturnSuccess;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (ret != kIOReturnSuccess) {
+        __atomic_fetch_add(&fRcsWaitTimeouts, 1, __ATOMIC_RELAXED);
+        return ret;
+    }
+    const uint64_t now = FakeIrisXEExeclist::schedNowNs();
+    const uint64_t latency = now > submitNs ? now - submitNs : 0;
+    __atomic_store_n(&fRcsWaitLastNs, latency, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&fRcsWaitMaxNs, __ATOMIC_RELAXED);
+    while (latency > max &&
+           !__atomic_compare_exchange_n(&fRcsWaitMaxNs, &max, latency, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
     }
+    if (latencyNs)
+        *latencyNs = latency;
+    return kIOReturnSuccess;
+}
 
-    // cleanup: don't unpin fence (we keep it), unpin batch if temporary
-    batchGem->unpin();
-    return completed ? 1 : 0;
+// In the gate: sleep until handleInterrupt's commandWakeup shows the slot
+// past `seq`, or the absolute `deadline`. Wakes every kRcsWaitSliceMs to
+// re-check in case the interrupt never comes.
+IOReturn FakeIrisXEFramebuffer::sleepForRcsSeqno(uint64_t seq, uint64_t deadline)
+{
+    for (;;) {
+        if (FXE_FencePage::passed(fenceCompleted(FXE_FencePage::kRcs), seq))
+            return kIOReturnSuccess;
+        if (mach_absolute_time() >= deadline)
+            return kIOReturnTimeout;
+        uint64_t slice = 0;
+        clock_interval_to_deadline(kRcsWaitSliceMs, kMillisecondScale, &slice);
+        fCmdGate->commandSleep(fSleepToken, slice < deadline ? slice : deadline, THREAD_UNINT);
+    }
 }
 
 // CORRECTED MI packet definitions
@@ -4691,13 +4961,47 @@ static inline void write_u32_to_gem(IOBufferMemoryDescriptor* desc, size_t dword
     __sync_synchronize();
 }
 
-// create a tiny tail batch that writes `seq` into fenceGpuAddr and ends
-// returns a pinned+GGTT-mapped tailGem (retained) and its GPU address in tailGpuOut
-static FakeIrisXEGEM* createTailBatchAndMap(FakeIrisXEFramebuffer* fb, uint64_t fenceGpuAddr, uint32_t seq, uint64_t* tailGpuOut) {
+// Tail batch: store `seqno` into the fence slot, end.
+//   [0..4] = MI_STORE_DATA_IMM qword (FXE_FencePage::emitStore)
+//   [5]    = MI_BATCH_BUFFER_END
+static uint32_t emitTailBatch(uint32_t* p, uint64_t slotGpu, uint64_t seqno) {
+    const uint32_t n = FXE_FencePage::emitStore(p, slotGpu, seqno);
+    p[n] = MI_BATCH_BUFFER_END;
+    return n + 1;
+}
+
+// Master batch that does:
+//
+//   MI_BATCH_BUFFER_START (64-bit) -> userBatchGpu
+//   MI_BATCH_BUFFER_START (64-bit) -> tailGpu
+//   MI_BATCH_BUFFER_END
+static uint32_t emitMasterChain(uint32_t* p, uint64_t userBatchGpu, uint64_t tailGpu) {
+    uint32_t idx = 0;
+
+    // MI_BATCH_BUFFER_START with 64-bit pointer: implementation dependent.
+    // We'll set the generic pattern: opcode + 64-bit address (low, high)
+    // If your platform requires a flag to indicate 64-bit, adjust below.
+    const uint32_t MBS_64 = MI_BATCH_BUFFER_START | (1u << 8); // (1<<8) used earlier as 64-bit flag (common)
+    p[idx++] = MBS_64;
+    p[idx++] = (uint32_t)(userBatchGpu & 0xFFFFFFFFULL);
+    p[idx++] = (uint32_t)(userBatchGpu >> 32);
+
+    p[idx++] = MBS_64;
+    p[idx++] = (uint32_t)(tailGpu & 0xFFFFFFFFULL);
+    p[idx++] = (uint32_t)(tailGpu >> 32);
+
+    p[idx++] = MI_BATCH_BUFFER_END;
+    return idx;
+}
+
+// Standalone tail batch, for when the chain pool is exhausted.
+// Returns a pinned+GGTT-mapped tailGem (retained) and its GPU address in tailGpuOut.
+static FakeIrisXEGEM* createTailBatchAndMap(FakeIrisXEFramebuffer* fb, uint64_t slotGpu, uint64_t seqno,
+                                            uint64_t* tailGpuOut) {
     if (!fb || !tailGpuOut) return nullptr;
 
-    // allocate 4KB GEM for tail
-    FakeIrisXEGEM* tailGem = FakeIrisXEGEM::withSize(4096, 0);
+    // 4KB GEM for tail, pinned, usually from the BO cache
+    FakeIrisXEGEM* tailGem = fb->boAlloc(4096, false);
     if (!tailGem) {
         IOLog("FakeIrisXEFramebuffer: createTailBatchAndMap - tail GEM alloc failed\n");
         return nullptr;
@@ -4706,55 +5010,32 @@ static FakeIrisXEGEM* createTailBatchAndMap(FakeIrisXEFramebuffer* fb, uint64_t
     IOBufferMemoryDescriptor* tailDesc = tailGem->memoryDescriptor();
     if (!tailDesc) {
         IOLog("FakeIrisXEFramebuffer: createTailBatchAndMap - no memoryDescriptor\n");
-        tailGem->release();
+        fb->boRecycle(tailGem);
         return nullptr;
     }
     bzero(tailDesc->getBytesNoCopy(), 4096);
-
-    // Build tail batch:
-    // [0] = MI_STORE_DWORD_IMM | MI_USE_GGTT
-    // [1] = seq (immediate)
-    // [2] = low32(fenceGpuAddr)
-    // [3] = high32(fenceGpuAddr)
-    // [4] = MI_BATCH_BUFFER_END
-
-    uint32_t* p = (uint32_t*)tailDesc->getBytesNoCopy();
-    p[0] = MI_STORE_DWORD_IMM | MI_USE_GGTT;
-    p[1] = seq;
-    p[2] = (uint32_t)(fenceGpuAddr & 0xFFFFFFFFULL);
-    p[3] = (uint32_t)(fenceGpuAddr >> 32);
-    p[4] = MI_BATCH_BUFFER_END;
+    emitTailBatch((uint32_t*)tailDesc->getBytesNoCopy(), slotGpu, seqno);
     // flush CPU writes
     __sync_synchronize();
 
-    // pin and map into GGTT
-    tailGem->pin(); // void pin() per your GEM API
+    // map into GGTT (a recycled GEM keeps its range)
     uint64_t tailGpu = fb->ggttMap(tailGem);
     if (!tailGpu) {
         IOLog("FakeIrisXEFramebuffer: createTailBatchAndMap - ggttMap(tail) failed\n");
-        tailGem->unpin();
-        tailDesc->release();
-        tailGem->release();
+        fb->boRecycle(tailGem);
         return nullptr;
     }
 
-    IOLog("FakeIrisXEFramebuffer: tail batch created at GPU 0x%llx seq=%u\n", (unsigned long long)tailGpu, seq);
     *tailGpuOut = tailGpu;
-    // keep tailDesc alive via tailGem (we will release tailDesc not here)
     return tailGem;
 }
 
-// Create a master batch that does:
-//
-//   MI_BATCH_BUFFER_START (64-bit) -> userBatchGpu
-//   MI_BATCH_BUFFER_START (64-bit) -> tailGpu
-//   MI_BATCH_BUFFER_END
-//
-// This master batch is returned pinned+mapped as masterGem and its GPU address in masterGpuOut.
+// Standalone master batch (emitMasterChain), for when the chain pool is
+// exhausted. Returned pinned+mapped, its GPU address in masterGpuOut.
 static FakeIrisXEGEM* createMasterBatchChain(FakeIrisXEFramebuffer* fb, uint64_t userBatchGpu, uint64_t tailGpu, uint64_t* masterGpuOut) {
     if (!fb || !masterGpuOut) return nullptr;
 
-    FakeIrisXEGEM* masterGem = FakeIrisXEGEM::withSize(4096, 0);
+    FakeIrisXEGEM* masterGem = fb->boAlloc(4096, false);
     if (!masterGem) {
         IOLog("FakeIrisXEFramebuffer: createMasterBatchChain - master GEM alloc failed\n");
         return nullptr;
@@ -4763,43 +5044,20 @@ static FakeIrisXEGEM* createMasterBatchChain(FakeIrisXEFramebuffer* fb, uint64_t
     IOBufferMemoryDescriptor* masterDesc = masterGem->memoryDescriptor();
     if (!masterDesc) {
         IOLog("FakeIrisXEFramebuffer: createMasterBatchChain - no memoryDescriptor\n");
-        masterGem->release();
+        fb->boRecycle(masterGem);
         return nullptr;
     }
     bzero(masterDesc->getBytesNoCopy(), 4096);
-
-    uint32_t* p = (uint32_t*)masterDesc->getBytesNoCopy();
-    size_t idx = 0;
-
-    // MI_BATCH_BUFFER_START with 64-bit pointer: implementation dependent.
-    // We'll set the generic pattern: opcode + 64-bit address (low, high)
-    // If your platform requires a flag to indicate 64-bit, adjust below.
-    const uint32_t MBS_64 = MI_BATCH_BUFFER_START | (1u << 8); // (1<<8) used earlier as 64-bit flag (common)
-    p[idx++] = MBS_64;
-    p[idx++] = (uint32_t)(userBatchGpu & 0xFFFFFFFFULL);
-    p[idx++] = (uint32_t)(userBatchGpu >> 32);
-
-    p[idx++] = MBS_64;
-    p[idx++] = (uint32_t)(tailGpu & 0xFFFFFFFFULL);
-    p[idx++] = (uint32_t)(tailGpu >> 32);
-
-    p[idx++] = MI_BATCH_BUFFER_END;
-
+    emitMasterChain((uint32_t*)masterDesc->getBytesNoCopy(), userBatchGpu, tailGpu);
     __sync_synchronize();
 
-    masterGem->pin();
     uint64_t masterGpu = fb->ggttMap(masterGem);
     if (!masterGpu) {
         IOLog("FakeIrisXEFramebuffer: createMasterBatchChain - ggttMap(master) failed\n");
-        masterGem->unpin();
-        masterDesc->release();
-        masterGem->release();
+        fb->boRecycle(masterGem);
         return nullptr;
     }
 
-    IOLog("FakeIrisXEFramebuffer: master batch created at GPU 0x%llx (user=0x%llx tail=0x%llx)\n",
-          (unsigned long long)masterGpu, (unsigned long long)userBatchGpu, (unsigned long long)tailGpu);
-
     *masterGpuOut = masterGpu;
     return masterGem;
 }
@@ -4808,98 +5066,120 @@ static FakeIrisXEGEM* createMasterBatchChain(FakeIrisXEFramebuffer* fb, uint64_t
 // - userBatchGem: caller's batch GEM (already contains GPU commands and ends with MI_BATCH_BUFFER_END)
 // - userBatchOffsetBytes: offset into GEM (usually 0)
 // - userBatchSizeBytes: size of user batch region (for logging only)
-// Returns sequence number (non-zero) on success, 0 on failure.
-uint32_t FakeIrisXEFramebuffer::appendFenceAndSubmit(FakeIrisXEGEM* userBatchGem, size_t userBatchOffsetBytes, size_t userBatchSizeBytes) {
+// - flushNow: publish the ring tail at once (the caller waits for the seqno)
+// Returns the RCS fence seqno (non-zero) on success, 0 on failure.
+uint64_t FakeIrisXEFramebuffer::appendFenceAndSubmit(FakeIrisXEGEM* userBatchGem, size_t userBatchOffsetBytes,
+                                                     size_t userBatchSizeBytes, bool flushNow) {
     if (!userBatchGem || !fRingRCS) {
         IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - invalid args\n");
         return 0;
     }
 
-    // 1) Ensure a fence object exists (one persistent fence GEM kept on the FB)
-    if (!fFenceGEM) {
-        fFenceGEM = FakeIrisXEGEM::withSize(4096, 0);
-        if (!fFenceGEM) {
-            IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - fence GEM alloc failed\n");
-            return 0;
-        }
-        fFenceGEM->pin();
-        uint64_t fenceGpu = ggttMap(fFenceGEM);
-        if (!fenceGpu) {
-            IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - fence ggttMap failed\n");
-            fFenceGEM->unpin();
-            fFenceGEM->release();
-            fFenceGEM = nullptr;
-            return 0;
-        }
-        // ensure initial fence value = 0
-        IOBufferMemoryDescriptor* fd = fFenceGEM->memoryDescriptor();
-        if (fd) {
-            volatile uint32_t* fenceCpu = (volatile uint32_t*)fd->getBytesNoCopy();
-            fenceCpu[0] = 0;
-            __sync_synchronize();
-        }
-        IOLog("FakeIrisXEFramebuffer: fence precreated at GPU 0x%llx\n", (unsigned long long)fenceGpu);
-    }
-
-    // 2) Build a tail batch that writes a unique seq into fence
-    static atomic_uint_fast32_t global_seq = 1;
-    uint32_t seq = (uint32_t)atomic_fetch_add(&global_seq, 1);
-    IOBufferMemoryDescriptor* fenceDesc = fFenceGEM->memoryDescriptor();
-    uint64_t fenceGpu = fFenceGEM->physicalAddress(); // prefer gpuAddress if you set it; use physicalAddress if placeholder
-    // If you have proper fFenceGEM->gpuAddress(), prefer that:
-    if (fFenceGEM->gpuAddress()) fenceGpu = fFenceGEM->gpuAddress();
-
-    uint64_t tailGpuAddr = 0;
-    FakeIrisXEGEM* tailGem = createTailBatchAndMap(this, fenceGpu, seq, &tailGpuAddr);
-    if (!tailGem) {
-        IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - createTailBatch failed\n");
+    // 1) The fence page (one persistent GEM kept on the FB)
+    if (!ensureFencePage()) {
+        IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - no fence page\n");
         return 0;
     }
+    const uint64_t slotGpu = fFenceGEM->gpuAddress() + FXE_FencePage::offset(FXE_FencePage::kRcs);
 
-    // 3) Ensure user batch is pinned and mapped (pin if needed). We will map to GPU VA if not present.
+    // 2) Ensure user batch is pinned and mapped. The pending entry keeps
+    //    this reference and pin until the seqno retires.
+    userBatchGem->retain();
     userBatchGem->pin();
     uint64_t userGpu = userBatchGem->gpuAddress();
     if (!userGpu) {
         userGpu = ggttMap(userBatchGem);
         if (!userGpu) {
             IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - ggttMap(user) failed\n");
-            tailGem->unpin();
-            tailGem->release();
             userBatchGem->unpin();
+            userBatchGem->release();
             return 0;
         }
     }
 
-    // 4) Build master chain batch that jumps into user batch then tail
-    uint64_t masterGpuAddr = 0;
-    FakeIrisXEGEM* masterGem = createMasterBatchChain(this, userGpu + userBatchOffsetBytes, tailGpuAddr, &masterGpuAddr);
-    if (!masterGem) {
-        IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - master chain creation failed\n");
-        tailGem->unpin();
-        tailGem->release();
+    // 3) Master chain (user batch, then tail) and tail (seqno store),
+    //    carved from the chain pool; standalone GEMs if it is exhausted.
+    //    Seqnos are taken under the ring lock so they reach the ring, and
+    //    the fence slot, in increasing order.
+    fRingRCS->lock();
+    const uint64_t seq = fRcsSeqno + 1;
+    FXE_BatchSlice slice;
+    FakeIrisXEGEM* masterGem = nullptr;
+    FakeIrisXEGEM* tailGem = nullptr;
+    uint64_t masterGpuAddr = 0, tailGpuAddr = 0;
+    const bool pooled = fChainPool.alloc(kChainBytes, &slice);
+    if (pooled) {
+        uint32_t* p = (uint32_t*)slice.cpu;
+        masterGpuAddr = slice.gpu;
+        tailGpuAddr = slice.gpu + kChainTailOffset;
+        emitTailBatch(p + kChainTailOffset / 4, slotGpu, seq);
+        emitMasterChain(p, userGpu + userBatchOffsetBytes, tailGpuAddr);
+        __sync_synchronize();
+    } else {
+        tailGem = createTailBatchAndMap(this, slotGpu, seq, &tailGpuAddr);
+        if (tailGem)
+            masterGem = createMasterBatchChain(this, userGpu + userBatchOffsetBytes, tailGpuAddr, &masterGpuAddr);
+        if (!masterGem) {
+            fRingRCS->unlock();
+            IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - chain batch creation failed\n");
+            if (tailGem)
+                boRecycle(tailGem);
+            userBatchGem->unpin();
+            userBatchGem->release();
+            return 0;
+        }
+    }
+
+    // 4) Track it, then submit master batch (this will execute user batch
+    //    then tail in order). The pending entry goes in first so a retire
+    //    pass cannot miss it. With the pending ring full, retire what the
+    //    engine has finished first and fail the submission if that frees
+    //    nothing.
+    bool tracked = addPendingSubmission(seq, userBatchGem, masterGem, tailGem);
+    if (!tracked && retirePendingSubmissions(fenceCompleted(FXE_FencePage::kRcs)))
+        tracked = addPendingSubmission(seq, userBatchGem, masterGem, tailGem);
+    if (!tracked) {
+        if (pooled)
+            fChainPool.abort(slice);
+        fRingRCS->unlock();
+        IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - too many submissions in flight\n");
+        if (!pooled) {
+            boRecycle(masterGem);
+            boRecycle(tailGem);
+        }
         userBatchGem->unpin();
+        userBatchGem->release();
         return 0;
     }
-
-    // 5) Submit master batch (this will execute user batch then tail in order)
-    bool ok = fRingRCS->submitBatch64(masterGpuAddr);
+    bool ok = fRingRCS->emitBatchStart(masterGpuAddr, flushNow);
+    if (ok) {
+        if (pooled) {
+            FXE_Fence fence = {};
+            fence.seqno = seq;
+            fChainPool.commit(slice, fence);
+        }
+        fRcsSeqno = seq;
+    } else {
+        // nothing reached the ring: take everything back, the seqno is reused
+        popPendingSubmission();
+        if (pooled)
+            fChainPool.abort(slice);
+    }
+    fRingRCS->unlock();
     if (!ok) {
         IOLog("FakeIrisXEFramebuffer: appendFenceAndSubmit - ring submit failed\n");
-        masterGem->unpin(); masterGem->release();
-        tailGem->unpin(); tailGem->release();
+        if (!pooled) {
+            boRecycle(masterGem);
+            boRecycle(tailGem);
+        }
         userBatchGem->unpin();
+        userBatchGem->release();
         return 0;
     }
 
-    IOLog("FakeIrisXEFramebuffer: Batch submitted (master=0x%llx user=0x%llx tail=0x%llx) seq=%u\n",
-          (unsigned long long)masterGpuAddr, (unsigned long long)userGpu, (unsigned long long)tailGpuAddr, seq);
-
-    // Do not release master/tail immediately — keep them alive until fence observed to avoid reuse.
-    // We can store them in a small list or release after fence observed in IRQ handler.
-    // For simplicity keep refs in a tiny list (you should implement proper cleanup).
-    // For now: keep masterGem and tailGem retained and rely on periodic cleanup / reboot (for bring-up).
-    // (Production: add list<active_submission> and cleanup when fence observed.)
-
+    IOLog("FakeIrisXEFramebuffer: Batch submitted (master=0x%llx user=0x%llx tail=0x%llx) seq=%llu%s\n",
+          (unsigned long long)masterGpuAddr, (unsigned long long)userGpu, (unsigned long long)tailGpuAddr,
+          (unsigned long long)seq, pooled ? "" : " (standalone chain)");
     return seq;
 }
 
@@ -4918,9 +5198,10 @@ static IOReturn deferredCleanupAction(OSObject* owner,
     FakeIrisXEFramebuffer* self = OSDynamicCast(FakeIrisXEFramebuffer, owner);
     if (!self) return kIOReturnBadArgument;
 
-    uint32_t seq = (uint32_t)(uintptr_t)arg0;
-    bool ok = self->completePendingSubmission(seq);
-    IOLog("FakeIrisXEFramebuffer: deferredCleanup seq=%u ok=%d\n", seq, (int)ok);
+    const uint64_t done = self->fenceCompleted(FXE_FencePage::kRcs);
+    const uint32_t retired = self->retirePendingSubmissions(done);
+    IOLog("FakeIrisXEFramebuffer: deferredCleanup completed=%llu retired=%u\n",
+          (unsigned long long)done, retired);
     return kIOReturnSuccess;
 }
 
@@ -4949,6 +5230,11 @@ void FakeIrisXEFramebuffer::handleInterrupt(IOInterruptEventSource* /*src*/, int
     if (!fBar0)
         return;
 
+    // BCS0 shares the GT line and has no IIR here; its CSB drain is a
+    // single pointer read when nothing new has landed.
+    if (fBlitExeclist)
+        fBlitExeclist->drainCsbFromIrq();
+
     // Read engine-specific interrupt identity (RCS engine)
     uint32_t iir = mmio_read32(fBar0, RCS0_IIR);
     if (iir == 0) {
@@ -4978,34 +5264,23 @@ void FakeIrisXEFramebuffer::handleInterrupt(IOInterruptEventSource* /*src*/, int
 
 
 
-    // Handle completion bit only (conservative)
+    // Handle completion bit only (conservative). The slot holds the last
+    // completed seqno; one interrupt may cover several submissions.
     if (iir & RCS_INTR_COMPLETE) {
         if (fFenceGEM) {
-            IOBufferMemoryDescriptor* desc = fFenceGEM->memoryDescriptor();
-            if (desc) {
-                volatile uint32_t* fenceCpu =
-                    (volatile uint32_t*)desc->getBytesNoCopy();
-                uint32_t val = fenceCpu[0];
-
-                IOLog("FakeIrisXEFramebuffer: IRQ - fenceCpu[0]=0x%08x\n", val);
-
-                if (val != 0) {
-                    // reset fence immediately (optional)
-                    fenceCpu[0] = 0;
-                    __sync_synchronize();
-
-                    if (fCmdGate) {
-                        // Defer cleanup to gate
-                        fCmdGate->runAction(
-                            deferredCleanupAction,
-                            (void*)(uintptr_t)val,  // arg0: seq
-                            nullptr, nullptr, nullptr);
-                    } else {
-                        // Fallback: direct cleanup (less ideal but safe-ish)
-                        bool cleaned = completePendingSubmission(val);
-                        IOLog("FakeIrisXE: direct cleanup seq=%u result=%d\n",
-                              val, (int)cleaned);
-                    }
+            const uint64_t done = fenceCompleted(FXE_FencePage::kRcs);
+
+            IOLog("FakeIrisXEFramebuffer: IRQ - RCS completed seqno=%llu\n", (unsigned long long)done);
+
+            if (done > fRcsRetired) {
+                if (fCmdGate) {
+                    // Defer cleanup to gate
+                    fCmdGate->runAction(deferredCleanupAction, nullptr, nullptr, nullptr, nullptr);
+                } else {
+                    // Fallback: direct cleanup (less ideal but safe-ish)
+                    uint32_t cleaned = retirePendingSubmissions(done);
+                    IOLog("FakeIrisXE: direct cleanup completed=%llu retired=%u\n",
+                          (unsigned long long)done, cleaned);
                 }
             }
         } else {
@@ -5033,156 +5308,122 @@ void FakeIrisXEFramebuffer::handleInterrupt(IOInterruptEventSource* /*src*/, int
 
 
 
-// Create an OSDictionary entry for a submission
-
-
-// Create an OSDictionary entry for a submission
-static OSDictionary* createSubmissionEntry(uint32_t seq,
-                                           FakeIrisXEGEM* master,
-                                           FakeIrisXEGEM* tail)
-{
-    OSDictionary* dict = OSDictionary::withCapacity(4);
-    if (!dict) return nullptr;
-
-    // seq
-    OSNumber* nseq = OSNumber::withNumber(seq, 32);
-    dict->setObject("seq", nseq);
-    nseq->release();
-
-    // master GEM pointer
-    if (master) {
-        master->retain();
-        FakeIrisXEGEM* tmp = master;
-        OSData* md = OSData::withBytes(&tmp, sizeof(tmp));
-        dict->setObject("master", md);
-        md->release();
-    }
-
-    // tail GEM pointer
-    if (tail) {
-        tail->retain();
-        FakeIrisXEGEM* tmp = tail;
-        OSData* td = OSData::withBytes(&tmp, sizeof(tmp));
-        dict->setObject("tail", td);
-        td->release();
-    }
-
-    return dict;
-}
-
-// Add pending submission (thread-safe)
-bool FakeIrisXEFramebuffer::addPendingSubmission(uint32_t seq,
+// Add pending submission (thread-safe). Called under the RCS ring lock,
+// so entries arrive in seqno order. False when the pending ring is full.
+bool FakeIrisXEFramebuffer::addPendingSubmission(uint64_t seq,
+                                                 FakeIrisXEGEM* batch,
                                                  FakeIrisXEGEM* master,
                                                  FakeIrisXEGEM* tail)
 {
-    if (!fPendingSubmissions || !fPendingLock)
+    if (!fPendingLock)
         return false;
 
     IOLockLock(fPendingLock);
-    OSDictionary* e = createSubmissionEntry(seq, master, tail);
-    if (e) {
-        fPendingSubmissions->setObject(e);
-        e->release(); // OSArray retained it
+    const bool ok = fPending.push(seq, batch, master, tail);
     IOLockUnlock(fPendingLock);
-        IOLog("FakeIrisXEFramebuffer: addPendingSubmission seq=%u\n", seq);
-        return true;
-    }
-IOLockUnlock(fPendingLock);
-    return false;
+    return ok;
 }
 
-// Find and remove submission by seq. Returns true if found and cleaned up.
-bool FakeIrisXEFramebuffer::completePendingSubmission(uint32_t seq)
+// Undo the addPendingSubmission() just made under the same RCS ring
+// lock hold; the caller still owns what it passed in.
+void FakeIrisXEFramebuffer::popPendingSubmission()
 {
-    if (!fPendingSubmissions || !fPendingLock)
-        return false;
-
-    bool found = false;
+    if (!fPendingLock)
+        return;
     IOLockLock(fPendingLock);
+    fPending.popBack(nullptr);
+    IOLockUnlock(fPendingLock);
+}
 
-    for (unsigned i = 0; i < fPendingSubmissions->getCount(); ++i) {
-        OSDictionary* dict =
-            OSDynamicCast(OSDictionary, fPendingSubmissions->getObject(i));
-        if (!dict) continue;
-
-        OSNumber* nseq =
-            OSDynamicCast(OSNumber, dict->getObject("seq"));
-        if (!nseq) continue;
-
-        if (nseq->unsigned32BitValue() == seq) {
-            // master
-            OSData* md = OSDynamicCast(OSData, dict->getObject("master"));
-            if (md && md->getLength() == sizeof(FakeIrisXEGEM*)) {
-                FakeIrisXEGEM* master = nullptr;
-                memcpy(&master, md->getBytesNoCopy(), sizeof(master));
-                if (master) {
-                    master->unpin();
-                    master->release();
-                }
-            }
-
-            // tail
-            OSData* td = OSDynamicCast(OSData, dict->getObject("tail"));
-            if (td && td->getLength() == sizeof(FakeIrisXEGEM*)) {
-                FakeIrisXEGEM* tail = nullptr;
-                memcpy(&tail, td->getBytesNoCopy(), sizeof(tail));
-                if (tail) {
-                    tail->unpin();
-                    tail->release();
-                }
-            }
-
-            fPendingSubmissions->removeObject(i);
-            found = true;
-            IOLog("FakeIrisXEFramebuffer: completePendingSubmission seq=%u cleaned\n", seq);
-            break;
+// The engine is done with a submission: drop the chain's reference and
+// pin on the caller's batch and recycle standalone master/tail GEMs
+// (pooled ones went back with the chain pool's fence). A batch nobody
+// else holds (the RCS blit fallback's boAlloc) goes back to the BO cache.
+void FakeIrisXEFramebuffer::releaseSubmission(const FXE_Submission& s)
+{
+    if (FakeIrisXEGEM* batch = (FakeIrisXEGEM*)s.batch) {
+        if (batch->getRetainCount() == 1 && !batch->account()) {
+            boRecycle(batch);
+        } else {
+            batch->unpin();
+            batch->release();
         }
     }
-
-IOLockUnlock(fPendingLock);
-    return found;
+    if (s.master)
+        boRecycle((FakeIrisXEGEM*)s.master);
+    if (s.tail)
+        boRecycle((FakeIrisXEGEM*)s.tail);
 }
 
-// Optional: cleanup all pending submissions (called at stop())
-void FakeIrisXEFramebuffer::cleanupAllPendingSubmissions()
+// Pop every submission with seq <= completed and release it, a batch at
+// a time, outside fPendingLock. Returns how many were retired.
+uint32_t FakeIrisXEFramebuffer::retirePendingSubmissions(uint64_t completed)
 {
-    if (!fPendingSubmissions || !fPendingLock)
-        return;
-
-    IOLockLock(fPendingLock);
+    if (!fPendingLock)
+        return 0;
 
-    while (fPendingSubmissions->getCount() > 0) {
-        OSDictionary* dict =
-            OSDynamicCast(OSDictionary, fPendingSubmissions->getObject(0));
-        if (!dict) {
-            fPendingSubmissions->removeObject(0);
-            continue;
+    FXE_Submission done[16];
+    uint32_t retired = 0;
+    uint32_t n;
+    do {
+        IOLockLock(fPendingLock);
+        n = fPending.retire(completed, done, 16);
+        if (completed > fRcsRetired)
+            fRcsRetired = completed;
+        IOLockUnlock(fPendingLock);
+
+        for (uint32_t i = 0; i < n; ++i)
+            releaseSubmission(done[i]);
+        retired += n;
+    } while (n == 16);
+    return retired;
+}
+
+// The seqno fence page (FXE_FencePage): created zeroed, pinned and
+// GGTT-mapped once; the CPU never writes it again.
+bool FakeIrisXEFramebuffer::ensureFencePage()
+{
+    if (!fFenceGEM) {
+        FakeIrisXEGEM* gem = FakeIrisXEGEM::withSize(4096, 0);
+        if (!gem || !gem->memoryDescriptor()) {
+            OSSafeReleaseNULL(gem);
+            return false;
         }
+        bzero(gem->memoryDescriptor()->getBytesNoCopy(), 4096);
+        __sync_synchronize();
+        gem->pin();
+        fFenceGEM = gem;
+    }
+    if (!fFenceGEM->gpuAddress() && !ggttMap(fFenceGEM)) {
+        IOLog("FakeIrisXEFramebuffer: fence page ggttMap failed\n");
+        return false;
+    }
+    return true;
+}
 
-        OSData* md = OSDynamicCast(OSData, dict->getObject("master"));
-        if (md && md->getLength() == sizeof(FakeIrisXEGEM*)) {
-            FakeIrisXEGEM* master = nullptr;
-            memcpy(&master, md->getBytesNoCopy(), sizeof(master));
-            if (master) {
-                master->unpin();
-                master->release();
-            }
-        }
+uint64_t FakeIrisXEFramebuffer::fenceCompleted(uint32_t slot)
+{
+    IOBufferMemoryDescriptor* desc = fFenceGEM ? fFenceGEM->memoryDescriptor() : nullptr;
+    return desc ? FXE_FencePage::completed(desc->getBytesNoCopy(), slot) : 0;
+}
 
-        OSData* td = OSDynamicCast(OSData, dict->getObject("tail"));
-        if (td && td->getLength() == sizeof(FakeIrisXEGEM*)) {
-            FakeIrisXEGEM* tail = nullptr;
-            memcpy(&tail, td->getBytesNoCopy(), sizeof(tail));
-            if (tail) {
-                tail->unpin();
-                tail->release();
-            }
-        }
+// Recycle every pending submission whatever its seqno (called at stop(),
+// with the engines stopped)
+void FakeIrisXEFramebuffer::cleanupAllPendingSubmissions()
+{
+    if (!fPendingLock)
+        return;
 
-        fPendingSubmissions->removeObject(0);
-    }
+    FXE_Submission done[16];
+    uint32_t n;
+    do {
+        IOLockLock(fPendingLock);
+        n = fPending.drain(done, 16);
+        IOLockUnlock(fPendingLock);
 
-IOLockUnlock(fPendingLock);
+        for (uint32_t i = 0; i < n; ++i)
+            releaseSubmission(done[i]);
+    } while (n == 16);
 }
 
 
@@ -5323,13 +5564,8 @@ void FakeIrisXEFramebuffer::enableRcsInterruptsSafely() {
     fInterruptSource->disable(); // ensure disabled while we finish setup (safe no-op if already disabled)
     // safe to call enable() later after masks/unmasks done.
 
-    // 5) Prepare the ring/fence state required by handler: ensure fence is zeroed and in memory
-    IOBufferMemoryDescriptor* fenceDesc = fFenceGEM->memoryDescriptor();
-    if (fenceDesc) {
-        volatile uint32_t* fenceCpu = (volatile uint32_t*)fenceDesc->getBytesNoCopy();
-        fenceCpu[0] = 0;
-        __sync_synchronize();
-    }
+    // 5) The fence page was zeroed when it was created; seqnos only grow
+    //    from there and the handler never clears it.
 
     // 6) Now set the engine IER via read/modify/write (so we don't accidentally clear bits)
     uint32_t cur_ier = safeMMIORead(RCS0_IER);
@@ -5627,12 +5863,10 @@ void FakeIrisXEFramebuffer::unmapGEMFromGGTT(uint64_t gpuAddr) {
         return;
     }
     
-    // For now, just log the unmap request
-    // In a full implementation, we'd walk the GGTT and invalidate entries
     IOLog("[V90] unmapGEMFromGGTT: Unmapping GPU addr 0x%llx\n", (unsigned long long)gpuAddr);
     
-    // TODO: Implement proper GGTT entry invalidation
-    // This would involve finding the PTE and clearing the valid bit
+    // Clears the PTEs and hands the range back for reuse
+    ggttUnmap(gpuAddr, 0);
 }
 
 // ============================================================
@@ -5647,6 +5881,56 @@ IOReturn FakeIrisXEFramebuffer::createSurface(uint32_t width, uint32_t height,
 {
     IOLog("[V90] createSurface(%u x %u, format=%u)\n", width, height, format);
     
+    // Calculate size (assume 4 bytes per pixel for now)
+    size_t surfaceSize = width * height * 4;
+    surfaceSize = (surfaceSize + 4095) & ~4095; // Page align
+    
+    // Create GEM object for surface
+    FakeIrisXEGEM* gem = createGEMObject(surfaceSize);
+    if (!gem) {
+        IOLog("[V90] ❌ Failed to create GEM object for surface\n");
+        return kIOReturnNoMemory;
+    }
+    
+    IOReturn ret = addSurface(gem, width, height, format, surfaceIdOut, gpuAddrOut);
+    if (ret != kIOReturnSuccess) {
+        gem->unpin();
+        gem->release();
+    }
+    return ret;
+}
+
+// A client's pixels, wrapped by FakeIrisXEGEM::withUserRange, as a blit
+// surface: the copy engine reads and writes them in place. The surface
+// takes its own reference and pin; the rows must be packed (the blitter
+// pitch is width * 4).
+IOReturn FakeIrisXEFramebuffer::importUserSurface(FakeIrisXEGEM* gem, uint32_t width, uint32_t height,
+                                                  uint32_t format, uint64_t* surfaceIdOut,
+                                                  uint64_t* gpuAddrOut)
+{
+    if (!gem || !gem->isUserptr() || !width || !height)
+        return kIOReturnBadArgument;
+    if ((uint64_t)width * height * 4 > (uint64_t)gem->pageCount() << 12) {
+        IOLog("[V90] importUserSurface: %ux%u does not fit %u pages\n", width, height, gem->pageCount());
+        return kIOReturnBadArgument;
+    }
+
+    gem->retain();
+    gem->pin();
+    IOReturn ret = addSurface(gem, width, height, format, surfaceIdOut, gpuAddrOut);
+    if (ret != kIOReturnSuccess) {
+        gem->unpin();
+        gem->release();
+    }
+    return ret;
+}
+
+// Map a pinned GEM and enter it in a free surface slot, which takes over
+// the caller's reference and pin (dropped by destroySurface).
+IOReturn FakeIrisXEFramebuffer::addSurface(FakeIrisXEGEM* gem, uint32_t width, uint32_t height,
+                                           uint32_t format, uint64_t* surfaceIdOut,
+                                           uint64_t* gpuAddrOut)
+{
     // Find free surface slot
     int slot = -1;
     for (uint32_t i = 0; i < kMaxSurfaces; i++) {
@@ -5661,22 +5945,10 @@ IOReturn FakeIrisXEFramebuffer::createSurface(uint32_t width, uint32_t height,
         return kIOReturnNoResources;
     }
     
-    // Calculate size (assume 4 bytes per pixel for now)
-    size_t surfaceSize = width * height * 4;
-    surfaceSize = (surfaceSize + 4095) & ~4095; // Page align
-    
-    // Create GEM object for surface
-    FakeIrisXEGEM* gem = createGEMObject(surfaceSize);
-    if (!gem) {
-        IOLog("[V90] ❌ Failed to create GEM object for surface\n");
-        return kIOReturnNoMemory;
-    }
-    
     // Map to GGTT
     uint64_t gpuAddr = mapGEMToGGTT(gem);
     if (gpuAddr == 0) {
         IOLog("[V90] ❌ Failed to map surface to GGTT\n");
-        gem->release();
         return kIOReturnError;
     }
     
@@ -5687,15 +5959,18 @@ IOReturn FakeIrisXEFramebuffer::createSurface(uint32_t width, uint32_t height,
     fSurfaces[slot].format = format;
     fSurfaces[slot].gpuAddress = gpuAddr;
     fSurfaces[slot].gemObj = gem;
+    fSurfaces[slot].fence = FXE_Fence();
     fSurfaces[slot].inUse = true;
+    if (FakeIrisXEClientAccount* acct = gem->account())
+        acct->account().addSurface();
     
     *surfaceIdOut = fSurfaces[slot].id;
     *gpuAddrOut = gpuAddr;
     
     fV90SurfaceCount++;
     
-    IOLog("[V90] ✅ Surface created: ID=%llu, GPU=0x%llx, slot=%d\n", 
-          fSurfaces[slot].id, gpuAddr, slot);
+    IOLog("[V90] ✅ Surface created: ID=%llu, GPU=0x%llx, slot=%d%s\n", 
+          fSurfaces[slot].id, gpuAddr, slot, gem->isUserptr() ? " (userptr)" : "");
     IOLog("[V90]    Total surfaces: %u\n", fV90SurfaceCount);
     
     return kIOReturnSuccess;
@@ -5708,11 +5983,21 @@ IOReturn FakeIrisXEFramebuffer::destroySurface(uint64_t surfaceId)
     // Find surface
     for (uint32_t i = 0; i < kMaxSurfaces; i++) {
         if (fSurfaces[i].inUse && fSurfaces[i].id == surfaceId) {
+            // The range is reused once unmapped: let the last GPU write land
+            const FXE_Fence& fence = fSurfaces[i].fence;
+            if (FakeIrisXEExeclist* exec = fence.seqno ? execlistFor(fence.engine) : nullptr) {
+                if (exec->waitFence(fence, 100) == kIOReturnTimeout)
+                    IOLog("[V90] destroySurface: fence still pending, unmapping anyway\n");
+            }
+
             // Unmap from GGTT
             unmapGEMFromGGTT(fSurfaces[i].gpuAddress);
             
             // Release GEM object
             if (fSurfaces[i].gemObj) {
+                if (FakeIrisXEClientAccount* acct = fSurfaces[i].gemObj->account())
+                    acct->account().removeSurface();
+                fSurfaces[i].gemObj->unpin();
                 fSurfaces[i].gemObj->release();
             }
             
@@ -5935,42 +6220,23 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_SRC_COPY(
         return kIOReturnBadArgument;
     }
     
-    if (!fExeclist || !fRcsRing) {
+    if (!fBlitCtx && (!fExeclist || !fRcsRing)) {
         IOLog("[V91] ❌ Execlist/Ring not initialized\n");
         return kIOReturnNotReady;
     }
     
-    // Create batch buffer for blit command
+    // Batch space for blit command
     const size_t batchSize = 256;  // Enough for blit + fence + batch end
-    FakeIrisXEGEM* batchGem = createGEMObject(batchSize);
-    if (!batchGem) {
-        IOLog("[V91] ❌ Failed to create batch GEM\n");
+    BlitBatch batch;
+    if (!blitBatchBegin(batchSize, &batch)) {
+        IOLog("[V91] ❌ Failed to get batch buffer\n");
         return kIOReturnNoMemory;
     }
+    uint32_t* cmd = batch.cmd;
     
-    // Map to GGTT
-    uint64_t batchGpuAddr = mapGEMToGGTT(batchGem);
-    if (batchGpuAddr == 0) {
-        IOLog("[V91] ❌ Failed to map batch GEM\n");
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    // Get CPU pointer to write commands
-    IOBufferMemoryDescriptor* desc = batchGem->memoryDescriptor();
-    if (!desc) {
-        IOLog("[V91] ❌ Failed to get memory descriptor\n");
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    uint32_t* cmd = (uint32_t*)desc->getBytesNoCopy();
-    if (!cmd) {
-        IOLog("[V91] ❌ Failed to get command buffer pointer\n");
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
+    FXE_Fence deps[FXE_ExecCore::kMaxDeps];
+    uint32_t depCount = addBlitDep(deps, 0, srcSurf);
+    depCount = addBlitDep(deps, depCount, dstSurf);
     uint32_t idx = 0;
     
     // DW0: Command header
@@ -6043,8 +6309,8 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_SRC_COPY(
     // For now, log that we would submit
     IOLog("[V91] Submitting to GPU via execlist...\n");
     
-    // Use appendFenceAndSubmit for proper fence tracking
-    uint32_t seqNum = appendFenceAndSubmit(batchGem, 0, idx * 4);
+    // BCS0 when available, else appendFenceAndSubmit on the RCS ring
+    uint32_t seqNum = submitBlitBatch(&batch, idx * 4, deps, depCount, &dstSurf->fence);
     
     if (seqNum == 0) {
         IOLog("[V91] ❌ Failed to submit blit command\n");
@@ -6052,14 +6318,11 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_SRC_COPY(
         fGpuSubmissionQuarantined = true;
         setProperty("V153GpuSubmissionQuarantined", kOSBooleanTrue);
         setProperty("V153GpuSubmissionFailureCount", fGpuSubmissionFailureCount, 32);
-        setProperty("V153LastSubmissionFailure", "appendFenceAndSubmit failed");
-        batchGem->release();
+        setProperty("V153LastSubmissionFailure", "blit submit failed");
         return kIOReturnTimeout;
     }
     
     IOLog("[V91] ✅ Blit submitted with sequence %u\n", seqNum);
-    
-    // Note: batchGem is retained by submission, will be released on completion
     return kIOReturnSuccess;
 }
 
@@ -6308,38 +6571,22 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_COLOR_BLT_Full(
         return kIOReturnBadArgument;
     }
     
-    if (!fExeclist || !fRcsRing) {
+    if (!fBlitCtx && (!fExeclist || !fRcsRing)) {
         IOLog("[V92] ❌ GPU not ready\n");
         return kIOReturnNotReady;
     }
     
-    // Create batch buffer
+    // Batch space for fill + fence + batch end
     const size_t batchSize = 128;
-    FakeIrisXEGEM* batchGem = createGEMObject(batchSize);
-    if (!batchGem) {
-        IOLog("[V92] ❌ Failed to create batch GEM\n");
+    BlitBatch batch;
+    if (!blitBatchBegin(batchSize, &batch)) {
+        IOLog("[V92] ❌ Failed to get batch buffer\n");
         return kIOReturnNoMemory;
     }
+    uint32_t* cmd = batch.cmd;
     
-    uint64_t batchGpuAddr = mapGEMToGGTT(batchGem);
-    if (batchGpuAddr == 0) {
-        IOLog("[V92] ❌ Failed to map batch GEM\n");
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    IOBufferMemoryDescriptor* desc = batchGem->memoryDescriptor();
-    if (!desc) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    uint32_t* cmd = (uint32_t*)desc->getBytesNoCopy();
-    if (!cmd) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
+    FXE_Fence deps[FXE_ExecCore::kMaxDeps];
+    const uint32_t depCount = addBlitDep(deps, 0, dstSurf);
     uint32_t idx = 0;
     
     // XY_COLOR_BLT command
@@ -6382,10 +6629,9 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_COLOR_BLT_Full(
     
     IOLog("[V92]   Fill 0x%08x at (%u,%u) size %ux%u\n", color, x, y, width, height);
     
-    uint32_t seqNum = appendFenceAndSubmit(batchGem, 0, idx * 4);
+    uint32_t seqNum = submitBlitBatch(&batch, idx * 4, deps, depCount, &dstSurf->fence);
     if (seqNum == 0) {
         IOLog("[V92] ❌ Failed to submit fill command\n");
-        batchGem->release();
         return kIOReturnError;
     }
     
@@ -6425,28 +6671,11 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_SETUP_CLIP(
     
     // Create clip setup command
     const size_t batchSize = 64;
-    FakeIrisXEGEM* batchGem = createGEMObject(batchSize);
-    if (!batchGem) {
+    BlitBatch batch;
+    if (!blitBatchBegin(batchSize, &batch)) {
         return kIOReturnNoMemory;
     }
-    
-    uint64_t batchGpuAddr = mapGEMToGGTT(batchGem);
-    if (batchGpuAddr == 0) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    IOBufferMemoryDescriptor* desc = batchGem->memoryDescriptor();
-    if (!desc) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    uint32_t* cmd = (uint32_t*)desc->getBytesNoCopy();
-    if (!cmd) {
-        batchGem->release();
-        return kIOReturnError;
-    }
+    uint32_t* cmd = batch.cmd;
     
     uint32_t idx = 0;
     
@@ -6463,9 +6692,9 @@ IOReturn FakeIrisXEFramebuffer::submitBlitXY_SETUP_CLIP(
     // MI_BATCH_BUFFER_END
     cmd[idx++] = 0x0A << 23;
     
-    uint32_t seqNum = appendFenceAndSubmit(batchGem, 0, idx * 4);
+    // Clip rectangle is blitter state: same engine (and context) as the blits
+    uint32_t seqNum = submitBlitBatch(&batch, idx * 4, nullptr, 0, nullptr);
     if (seqNum == 0) {
-        batchGem->release();
         return kIOReturnError;
     }
     
@@ -6487,10 +6716,9 @@ IOReturn FakeIrisXEFramebuffer::submitBatchBlits(BatchBlitEntry* entries, uint32
     
     IOLog("[V92] Submitting batch of %u blits...\n", count);
     
-    FakeIrisXEGEM* batchGem = nullptr;
     uint32_t seqNum = 0;
     
-    IOReturn result = buildBatchCommandBuffer(entries, count, &batchGem, &seqNum);
+    IOReturn result = buildBatchCommandBuffer(entries, count, &seqNum);
     if (result != kIOReturnSuccess) {
         IOLog("[V92] ❌ Failed to build batch command buffer\n");
         return result;
@@ -6503,36 +6731,21 @@ IOReturn FakeIrisXEFramebuffer::submitBatchBlits(BatchBlitEntry* entries, uint32
 }
 
 IOReturn FakeIrisXEFramebuffer::buildBatchCommandBuffer(
-    BatchBlitEntry* entries, uint32_t count,
-    FakeIrisXEGEM** batchGemOut, uint32_t* seqNumOut)
+    BatchBlitEntry* entries, uint32_t count, uint32_t* seqNumOut)
 {
-    // Calculate required size: each blit ~20 dwords + fence + end
+    // Calculate required size: each blit ~20 dwords, up to two render
+    // waits (4 dwords each) + fence + end
     const size_t batchSize = count * 80 + 64;
     
-    FakeIrisXEGEM* batchGem = createGEMObject(batchSize);
-    if (!batchGem) {
+    BlitBatch batch;
+    if (!blitBatchBegin(batchSize, &batch)) {
         return kIOReturnNoMemory;
     }
-    
-    uint64_t batchGpuAddr = mapGEMToGGTT(batchGem);
-    if (batchGpuAddr == 0) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    IOBufferMemoryDescriptor* desc = batchGem->memoryDescriptor();
-    if (!desc) {
-        batchGem->release();
-        return kIOReturnError;
-    }
-    
-    uint32_t* cmd = (uint32_t*)desc->getBytesNoCopy();
-    if (!cmd) {
-        batchGem->release();
-        return kIOReturnError;
-    }
+    uint32_t* cmd = batch.cmd;
     
     uint32_t idx = 0;
+    FXE_Fence deps[FXE_ExecCore::kMaxDeps];
+    uint32_t depCount = 0;
     
     // Process each blit in the batch
     for (uint32_t i = 0; i < count; i++) {
@@ -6553,6 +6766,10 @@ IOReturn FakeIrisXEFramebuffer::buildBatchCommandBuffer(
             IOLog("[V92]   Skipping blit %u - surface not found\n", i);
             continue;
         }
+
+        if (!entry->isFill)
+            depCount = addBlitDep(deps, depCount, srcSurf);
+        depCount = addBlitDep(deps, depCount, dstSurf);
         
         if (entry->isFill) {
             // XY_COLOR_BLT
@@ -6600,18 +6817,484 @@ IOReturn FakeIrisXEFramebuffer::buildBatchCommandBuffer(
     
     IOLog("[V92]   Batch buffer: %u dwords for %u blits\n", idx, count);
     
-    uint32_t seqNum = appendFenceAndSubmit(batchGem, 0, idx * 4);
+    FXE_Fence fence = {};
+    uint32_t seqNum = submitBlitBatch(&batch, idx * 4, deps, depCount, &fence);
     if (seqNum == 0) {
-        batchGem->release();
         return kIOReturnError;
     }
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t s = 0; s < kMaxSurfaces; s++) {
+            if (fSurfaces[s].inUse && fSurfaces[s].id == entries[i].dstSurfaceId)
+                fSurfaces[s].fence = fence;
+        }
+    }
     
-    *batchGemOut = batchGem;
     *seqNumOut = seqNum;
     
     return kIOReturnSuccess;
 }
 
+// ============================================================
+// Copy engine (BCS0)
+// ============================================================
+
+// Second execlist instance on the blitter, with one kernel context for all
+// compositing blits. Runs after the render engine is up (forcewake held).
+bool FakeIrisXEFramebuffer::initBlitEngine()
+{
+    fBlitExeclist = FakeIrisXEExeclist::withOwner(this, ENGINE_CLASS_COPY);
+    if (!fBlitExeclist)
+        return false;
+
+    if (!fBlitExeclist->startScheduler(fWorkLoop))
+        IOLog("FakeIrisXEFramebuffer: BCS0 timeslicing unavailable (no workloop timer)\n");
+
+    if (fBlitExeclist->createHwContext() && fBlitExeclist->setupExeclistPorts())
+        fBlitCtx = fBlitExeclist->createHwContextFor(kBlitCtxId, FXE_SCHED_PRIO_HIGH);
+
+    if (!fBlitCtx) {
+        IOLog("FakeIrisXEFramebuffer: BCS0 execlist setup FAILED\n");
+        fBlitExeclist->release();
+        fBlitExeclist = nullptr;
+        return false;
+    }
+
+    IOLog("FakeIrisXEFramebuffer: BCS0 execlist READY (blit ctx %u)\n", kBlitCtxId);
+    setProperty("BlitEngine", "bcs0");
+    return true;
+}
+
+// Render fences of the surfaces a blit reads or writes become input
+// fences of its BCS0 request (FXE_ExecCore::enqueue): the copy engine
+// waits for exactly those render requests, not the whole RCS queue, and
+// other blits go ahead meanwhile. One entry per render timeline (its
+// newest seqno covers the older ones). Finished fences and BCS0's own
+// (ordered by the blit context) add nothing; a failed render fence is not
+// carried over, the surface just holds whatever the engine left. Past
+// kMaxDeps timelines, the extra ones are waited for on the CPU.
+uint32_t FakeIrisXEFramebuffer::addBlitDep(FXE_Fence* deps, uint32_t count, const SurfaceInfo* surf)
+{
+    if (!fBlitCtx || !surf || !surf->fence.seqno || surf->fence.engine == ENGINE_CLASS_COPY)
+        return count;
+
+    const FXE_Fence& f = surf->fence;
+    FakeIrisXEExeclist* exec = execlistFor(f.engine);
+    if (!exec || exec->fenceState(f) != FXE_FENCE_PENDING)
+        return count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (deps[i].engine == f.engine && deps[i].timeline == f.timeline) {
+            if (f.seqno > deps[i].seqno)
+                deps[i].seqno = f.seqno;
+            return count;
+        }
+    }
+    if (count < FXE_ExecCore::kMaxDeps) {
+        deps[count] = f;
+        return count + 1;
+    }
+    if (exec->waitFence(f, 100) != kIOReturnSuccess)
+        IOLog("FakeIrisXEFramebuffer: blit dependency tl=%u seq=%llu not signaled\n",
+              f.timeline, f.seqno);
+    return count;
+}
+
+// Command space for a blit: a BCS0 pool slice first, else a BO-cache GEM for the RCS ring.
+bool FakeIrisXEFramebuffer::blitBatchBegin(size_t bytes, BlitBatch* batch)
+{
+    bzero(batch, sizeof(*batch));
+    if (fBlitCtx && fBlitExeclist->allocBatch((uint32_t)bytes, &batch->slice)) {
+        batch->cmd = (uint32_t*)batch->slice.cpu;
+        return true;
+    }
+
+    batch->gem = boAlloc(bytes);
+    if (!batch->gem)
+        return false;
+    IOBufferMemoryDescriptor* desc = batch->gem->memoryDescriptor();
+    if (!desc || !mapGEMToGGTT(batch->gem)) {
+        boRecycle(batch->gem);
+        batch->gem = nullptr;
+        return false;
+    }
+    batch->cmd = (uint32_t*)desc->getBytesNoCopy();
+    return true;
+}
+
+// Callers only need a non-zero sequence; the 64-bit seqno stays internal
+// and a multiple of 2^32 must not read as a failure.
+static inline uint32_t blitSeq(uint64_t seqno)
+{
+    return !seqno ? 0 : (uint32_t)seqno ? (uint32_t)seqno : 1;
+}
+
+// Submit a finished blit batch after its input fences (addBlitDep).
+// Returns a non-zero sequence on success and the request's fence in
+// *outFence (no fence on the RCS fallback, which tracks completion through
+// fFenceGEM instead and is ordered behind all render work anyway).
+uint32_t FakeIrisXEFramebuffer::submitBlitBatch(BlitBatch* batch, uint32_t bytes,
+                                                const FXE_Fence* deps, uint32_t depCount,
+                                                FXE_Fence* outFence)
+{
+    FakeIrisXEGEM* batchGem = batch->gem;
+    batch->gem = nullptr;
+    batch->cmd = nullptr;
+
+    FXE_Fence fence = {};
+    uint32_t seq = 0;
+    if (!batchGem) {
+        // pool slice: committed to the fence, or given back on failure
+        if (fBlitExeclist->submitBatchSlice(fBlitCtx, batch->slice, &fence, deps, depCount))
+            seq = blitSeq(fence.seqno);
+    } else if (!fBlitCtx) {
+        seq = blitSeq(appendFenceAndSubmit(batchGem, 0, bytes));
+    } else if (fBlitExeclist->submitForContext(fBlitCtx, batchGem, &fence, deps, depCount)) {
+        seq = blitSeq(fence.seqno);
+    }
+
+    if (!seq) {
+        IOLog("FakeIrisXEFramebuffer: blit submit failed (%u bytes)\n", bytes);
+        if (batchGem)
+            boRecycle(batchGem);
+        return 0;
+    }
+    if (outFence)
+        *outFence = fence;
+
+    // BCS0's queue and the RCS pending entry hold their own pin and
+    // reference until the batch retires.
+    if (batchGem) {
+        batchGem->unpin();
+        batchGem->release();
+    }
+    return seq;
+}
+
+bool FakeIrisXEChainPoolPlatform::allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu)
+{
+    FakeIrisXEGEM* gem = FakeIrisXEGEM::withSize(bytes, 0);
+    if (!gem)
+        return false;
+    gem->pin();
+    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+    uint64_t ggtt = md ? fFb->ggttMap(gem) : 0;
+    if (!ggtt) {
+        IOLog("FakeIrisXEFramebuffer: RCS chain pool: chunk map failed\n");
+        gem->unpin();
+        gem->release();
+        return false;
+    }
+    *cookie = gem;
+    *cpu = md->getBytesNoCopy();
+    *gpu = ggtt;
+    return true;
+}
+
+void FakeIrisXEChainPoolPlatform::releaseChunk(void* cookie)
+{
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)cookie;
+    gem->unpin();
+    gem->release();
+}
+
+bool FakeIrisXEChainPoolPlatform::fenceDone(const FXE_Fence& f)
+{
+    return FXE_FencePage::passed(fFb->fenceCompleted(FXE_FencePage::kRcs), f.seqno);
+}
+
+void FakeIrisXEBoCachePlatform::release(void* obj)
+{
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)obj;
+    gem->unpin();
+    gem->release();
+}
+
+FakeIrisXEGEM* FakeIrisXEFramebuffer::boAlloc(size_t size, bool zero)
+{
+    const uint64_t bytes = FXE_BoCache::roundUp(size);
+    FakeIrisXEGEM* gem = nullptr;
+    if (fBoCacheLock) {
+        IOLockLock(fBoCacheLock);
+        gem = (FakeIrisXEGEM*)fBoCache.get(bytes);
+        IOLockUnlock(fBoCacheLock);
+    }
+    if (!gem) {
+        gem = FakeIrisXEGEM::withSize(bytes, 0);
+        if (!gem && fBoCacheLock) {
+            // the only memory-pressure signal a kext gets: give the cache back
+            IOLockLock(fBoCacheLock);
+            uint32_t dropped = fBoCache.trim(0);
+            IOLockUnlock(fBoCacheLock);
+            if (dropped)
+                gem = FakeIrisXEGEM::withSize(bytes, 0);
+        }
+        if (!gem)
+            return nullptr;
+        gem->pin();
+    }
+    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+    if (zero && md)
+        bzero(md->getBytesNoCopy(), md->getLength());
+    return gem;
+}
+
+void FakeIrisXEFramebuffer::boRecycle(FakeIrisXEGEM* gem)
+{
+    if (!gem)
+        return;
+    IOBufferMemoryDescriptor* md = gem->memoryDescriptor();
+    bool parked = false;
+    if (fBoCacheLock && md && gem->getRetainCount() == 1 && gem->pinCount() == 1) {
+        if (!fBoCacheKeepMapped)
+            ggttUnbind(gem, true);
+        IOLockLock(fBoCacheLock);
+        parked = fBoCache.put(gem, md->getLength(), FakeIrisXEExeclist::schedNowNs());
+        IOLockUnlock(fBoCacheLock);
+    }
+    if (!parked) {
+        gem->unpin();
+        gem->release();
+    }
+}
+
+void FakeIrisXEFramebuffer::boCacheTimerFired(IOTimerEventSource* sender)
+{
+    if (!fBoCacheLock)
+        return;
+    IOLockLock(fBoCacheLock);
+    fBoCache.reap(FakeIrisXEExeclist::schedNowNs());
+    IOLockUnlock(fBoCacheLock);
+    // catches completions whose interrupt was missed or coalesced away
+    if (fFenceGEM)
+        retirePendingSubmissions(fenceCompleted(FXE_FencePage::kRcs));
+    publishBoCacheStats();
+    publishClientStats();
+    if (fBlitExeclist)
+        fBlitExeclist->publishBatchPoolStats();
+    publishGgttStats();
+    publishRingStats();
+    if (sender)
+        sender->setTimeoutMS(kBoCacheReapMs);
+}
+
+// Deferred RCS tail write is due (see FakeIrisXERing::commitDeferred).
+void FakeIrisXEFramebuffer::ringFlushTimerFired(IOTimerEventSource* sender)
+{
+    if (fRingRCS)
+        fRingRCS->flushDeferred();
+}
+
+// Legacy RCS ring space: head reads and waits show the CPU outrunning
+// the engine.
+void FakeIrisXEFramebuffer::publishRingStats()
+{
+    if (!fRingRCS)
+        return;
+    const FXE_RingStats st = fRingRCS->stats();
+    setProperty("RingReserves", st.reserves, 64);
+    setProperty("RingTailWrites", st.commits, 64);
+    setProperty("RingTailWritesCoalesced", st.coalesced, 64);
+    setProperty("RingHeadReads", st.headReads, 64);
+    setProperty("RingWaits", st.waits, 64);
+    setProperty("RingWraps", st.wraps, 64);
+    setProperty("RingTimeouts", st.timeouts, 64);
+    setProperty("RingPeakUsedBytes", st.peakUsed, 32);
+
+    if (!fPendingLock)
+        return;
+    IOLockLock(fPendingLock);
+    const uint32_t inFlight = fPending.count();
+    const FXE_SubmitRingStats ps = fPending.stats();
+    IOLockUnlock(fPendingLock);
+    setProperty("RcsInFlight", inFlight, 32);
+    setProperty("RcsInFlightPeak", ps.peak, 32);
+    setProperty("RcsRetired", ps.retired, 64);
+    setProperty("RcsPendingFull", ps.full, 64);
+
+    fRingRCS->lock();
+    const FXE_BatchPoolStats cs = fChainPool.stats();
+    fRingRCS->unlock();
+    setProperty("RcsChainPoolChunks", cs.chunks, 32);
+    setProperty("RcsChainPoolRewinds", cs.rewinds, 64);
+    setProperty("RcsChainPoolExhausted", cs.exhausted, 64);
+
+    setProperty("RcsWaitSpun", __atomic_load_n(&fRcsWaitSpun, __ATOMIC_RELAXED), 64);
+    setProperty("RcsWaitSlept", __atomic_load_n(&fRcsWaitSlept, __ATOMIC_RELAXED), 64);
+    setProperty("RcsWaitTimeouts", __atomic_load_n(&fRcsWaitTimeouts, __ATOMIC_RELAXED), 64);
+    setProperty("RcsWaitLastLatencyUs", __atomic_load_n(&fRcsWaitLastNs, __ATOMIC_RELAXED) / 1000, 64);
+    setProperty("RcsWaitMaxLatencyUs", __atomic_load_n(&fRcsWaitMaxNs, __ATOMIC_RELAXED) / 1000, 64);
+}
+
+// Eviction counters; the rate is per reap-timer period.
+void FakeIrisXEFramebuffer::publishGgttStats()
+{
+    if (!fGgttLock)
+        return;
+    IOLockLock(fGgttLock);
+    const FXE_GgttEvictStats st = fGgttEvict.stats();
+    const uint64_t freeBytes = fGgttSpace.freeBytes();
+    IOLockUnlock(fGgttLock);
+    const uint64_t perSec = (st.evictions - fGgttEvictionsPublished) * 1000 / kBoCacheReapMs;
+    fGgttEvictionsPublished = st.evictions;
+    setProperty("GgttEvictions", st.evictions, 64);
+    setProperty("GgttEvictionsPerSec", perSec, 64);
+    setProperty("GgttEvictedKB", st.evictedBytes >> 10, 64);
+    setProperty("GgttEvictFailures", st.failures, 64);
+    setProperty("GgttIdleMappings", st.idle, 32);
+    setProperty("GgttFreeKB", freeBytes >> 10, 64);
+
+    if (!fPtPoolLock)
+        return;
+    IOLockLock(fPtPoolLock);
+    const FXE_PtPoolStats pt = fPtPool.stats();
+    IOLockUnlock(fPtPoolLock);
+    setProperty("PpgttTablePages", pt.outstanding, 32);
+    setProperty("PpgttTablePagesCached", pt.cached, 32);
+    setProperty("PpgttTablePoolHits", pt.hits, 64);
+    setProperty("PpgttTableAllocFailures", pt.failures, 64);
+}
+
+// ------------------------------------------------------------
+// Per-client accounting
+// ------------------------------------------------------------
+
+FakeIrisXEClientAccount* FakeIrisXEFramebuffer::openClientAccount(uint32_t pid, const char* name)
+{
+    if (!fAccountLock)
+        return nullptr;
+    FakeIrisXEClientAccount* acct = FakeIrisXEClientAccount::withClient(pid, name, fClientQuotaSoft,
+                                                                        fClientQuotaHard);
+    if (!acct)
+        return nullptr;
+    IOLockLock(fAccountLock);
+    if (fClientAccounts)
+        fClientAccounts->setObject(acct);
+    IOLockUnlock(fAccountLock);
+    return acct;
+}
+
+// The connection closed: off the published list. Objects it left behind
+// keep the account (and their charges) until they go.
+void FakeIrisXEFramebuffer::closeClientAccount(FakeIrisXEClientAccount* acct)
+{
+    if (!acct || !fAccountLock)
+        return;
+    IOLockLock(fAccountLock);
+    if (fClientAccounts) {
+        for (unsigned i = 0; i < fClientAccounts->getCount(); ++i) {
+            if (fClientAccounts->getObject(i) == acct) {
+                fClientAccounts->removeObject(i);
+                break;
+            }
+        }
+    }
+    IOLockUnlock(fAccountLock);
+}
+
+void FakeIrisXEFramebuffer::publishClientStats()
+{
+    if (!fAccountLock)
+        return;
+    IOLockLock(fAccountLock);
+    const unsigned count = fClientAccounts ? fClientAccounts->getCount() : 0;
+    OSArray* out = OSArray::withCapacity(count ? count : 1);
+    for (unsigned i = 0; out && i < count; ++i) {
+        FakeIrisXEClientAccount* acct = (FakeIrisXEClientAccount*)fClientAccounts->getObject(i);
+        if (OSDictionary* d = acct->copyStats()) {
+            out->setObject(d);
+            d->release();
+        }
+    }
+    IOLockUnlock(fAccountLock);
+    if (out) {
+        setProperty("ClientMemory", out);
+        out->release();
+    }
+}
+
+// ------------------------------------------------------------
+// PPGTT page-table pages and TLB invalidation
+// ------------------------------------------------------------
+
+bool FakeIrisXEPtBacking::allocPage(FXE_PtPage* out)
+{
+    FakeIrisXEGEM* gem = FakeIrisXEGEM::withSize(4096, 0);
+    if (!gem)
+        return false;
+    gem->pin();
+    out->cookie = gem;
+    out->cpu    = (uint64_t*)gem->memoryDescriptor()->getBytesNoCopy();
+    out->phys   = gem->physicalAddress();
+    bzero(out->cpu, 4096);
+    return true;
+}
+
+void FakeIrisXEPtBacking::freePage(const FXE_PtPage& page)
+{
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)page.cookie;
+    gem->unpin();
+    gem->release();
+}
+
+bool FakeIrisXEPtPages::allocPage(FXE_PtPage* out)
+{
+    IOLockLock(fFb->fPtPoolLock);
+    const bool ok = fFb->fPtPool.allocPage(out);
+    IOLockUnlock(fFb->fPtPoolLock);
+    return ok;
+}
+
+void FakeIrisXEPtPages::freePage(const FXE_PtPage& page)
+{
+    IOLockLock(fFb->fPtPoolLock);
+    fFb->fPtPool.freePage(page);
+    IOLockUnlock(fFb->fPtPoolLock);
+}
+
+void FakeIrisXEFramebuffer::invalidateGpuTlbs()
+{
+    safeMMIOWrite(GEN12_GFX_TLB_INV_CR, GEN12_TLB_INV_REQUEST);
+    safeMMIOWrite(GEN12_BLT_TLB_INV_CR, GEN12_TLB_INV_REQUEST);
+    if (!waitForMMIO(GEN12_GFX_TLB_INV_CR, GEN12_TLB_INV_REQUEST, 0, kTlbInvTimeoutUs) ||
+        !waitForMMIO(GEN12_BLT_TLB_INV_CR, GEN12_TLB_INV_REQUEST, 0, kTlbInvTimeoutUs))
+        IOLog("(FakeIrisXEFramebuffer) TLB invalidation did not complete\n");
+}
+
+void FakeIrisXEFramebuffer::publishBoCacheStats()
+{
+    IOLockLock(fBoCacheLock);
+    const FXE_BoCacheStats st = fBoCache.stats();
+    const uint32_t hitRate = fBoCache.hitRatePermille();
+    const uint32_t objects = fBoCache.count();
+    IOLockUnlock(fBoCacheLock);
+    setProperty("BoCacheHitRatePermille", hitRate, 32);
+    setProperty("BoCacheLookups", st.lookups, 64);
+    setProperty("BoCacheBytes", st.bytesCached, 64);
+    setProperty("BoCachePeakBytes", st.peakBytesCached, 64);
+    setProperty("BoCacheObjects", objects, 32);
+    setProperty("BoCacheEvictions", st.evictedAge + st.evictedBudget + st.evictedTrim, 64);
+}
+
+void FakeIrisXEFramebuffer::fenceRetired(FakeIrisXEExeclist* from)
+{
+    FakeIrisXEExeclist* engines[2] = { fExeclist, fBlitExeclist };
+    for (uint32_t i = 0; i < 2; i++) {
+        if (engines[i] && engines[i] != from)
+            engines[i]->pokeDeps();
+    }
+}
+
+bool FakeIrisXEFramebuffer::setSurfaceFence(uint64_t surfaceId, const FXE_Fence& fence)
+{
+    for (uint32_t s = 0; s < kMaxSurfaces; s++) {
+        if (fSurfaces[s].inUse && fSurfaces[s].id == surfaceId) {
+            fSurfaces[s].fence = fence;
+            return true;
+        }
+    }
+    return false;
+}
+
 // ============================================================
 // V93: Display Verification & Integration Testing
 // Based on Intel PRM Volume 12: Display Engine
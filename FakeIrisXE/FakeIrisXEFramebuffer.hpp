@@ -20,6 +20,13 @@
 
 #include "FakeIrisXEGEM.hpp"
 #include "FakeIrisXEExeclist.hpp"
+#include "FXE_Ggtt.hpp"
+#include "FXE_BoCache.hpp"
+#include "FXE_Ppgtt.hpp"
+#include "FXE_FencePage.hpp"
+#include "FXE_SubmitRing.hpp"
+#include "FXE_BatchPool.hpp"
+#include "FakeIrisXEClientAccount.hpp"
 
 #include "FakeIrisXERing.h"
 
@@ -36,6 +43,65 @@
 
 
 
+class FakeIrisXEFramebuffer;
+
+// Points FXE_PteBatch at the mapped GGTT and its GTT_WRITE_FLUSH register.
+class FakeIrisXEGgttIO : public FXE_GgttIO {
+public:
+    FakeIrisXEFramebuffer* fFb;
+    uint32_t fPageSizes;    // FXE_PAGE_* entries the table takes
+
+    volatile uint64_t* ptes() override;
+    uint64_t entries() override;
+    void flush() override;
+    uint32_t pageSizes() override { return fPageSizes; }
+    uint64_t encode(uint64_t phys, uint32_t size) override;
+};
+
+// Unbinds an idle GEM picked by the GGTT evictor (fGgttLock held).
+class FakeIrisXEGgttEvict : public FXE_GgttEvictPlatform {
+public:
+    FakeIrisXEFramebuffer* fFb;
+
+    uint64_t evict(void* obj) override;
+    const void* ownerOf(void* obj) override;
+};
+
+// Chunks for the RCS chain pool; its fences are RCS fence-page seqnos
+// (ring lock held).
+class FakeIrisXEChainPoolPlatform : public FXE_BatchPoolPlatform {
+public:
+    FakeIrisXEFramebuffer* fFb;
+
+    bool allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu) override;
+    void releaseChunk(void* cookie) override;
+    bool fenceDone(const FXE_Fence& f) override;
+};
+
+// What the BO cache drops loses its pin (and with it the GGTT range) and
+// its reference.
+class FakeIrisXEBoCachePlatform : public FXE_BoCachePlatform {
+public:
+    void release(void* obj) override;
+};
+
+// Page-table pages for every PPGTT: 4K pinned GEMs (cookie = the GEM).
+class FakeIrisXEPtBacking : public FXE_PtPagePlatform {
+public:
+    bool allocPage(FXE_PtPage* out) override;
+    void freePage(const FXE_PtPage& page) override;
+};
+
+// What each FakeIrisXEPpgtt allocates from: the shared pool under
+// fPtPoolLock.
+class FakeIrisXEPtPages : public FXE_PtPagePlatform {
+public:
+    FakeIrisXEFramebuffer* fFb;
+
+    bool allocPage(FXE_PtPage* out) override;
+    void freePage(const FXE_PtPage& page) override;
+};
+
 class FakeIrisXEFramebuffer : public IOFramebuffer
 
 {
@@ -162,6 +228,17 @@ protected:
                   #endif
 
        }
+
+       // Poll until (reg & mask) == value, for at most timeoutUs.
+       bool waitForMMIO(uint32_t offset, uint32_t mask, uint32_t value, uint32_t timeoutUs) {
+           for (uint32_t us = 0; ; ++us) {
+               if ((safeMMIORead(offset) & mask) == value)
+                   return true;
+               if (us >= timeoutUs)
+                   return false;
+               IODelay(1);
+           }
+       }
     
     
     
@@ -370,6 +447,26 @@ protected:
 
 
     FakeIrisXEExeclist* getExeclist() const { return fExeclist; }
+    FakeIrisXEExeclist* getBlitExeclist() const { return fBlitExeclist; }
+    FakeIrisXEExeclist* execlistFor(uint32_t engineClass) const {
+        return engineClass == ENGINE_CLASS_COPY ? fBlitExeclist : fExeclist;
+    }
+    // A request on `from` retired: let the other engines re-check requests
+    // held on its fences. Called with from's fSchedLock held; takes no
+    // other engine's lock.
+    void fenceRetired(FakeIrisXEExeclist* from);
+
+    // Short-lived batch GEMs. boAlloc returns an object of at least `size`
+    // bytes with one reference and one pin, possibly recycled and still
+    // GGTT-mapped (ggttMap returns that range). boRecycle takes one
+    // reference and one pin back and parks the object if nobody else
+    // holds it; only call it once the GPU is done with the contents.
+    FakeIrisXEGEM* boAlloc(size_t size, bool zero = true);
+    void boRecycle(FakeIrisXEGEM* gem);
+    void boCacheTimerFired(IOTimerEventSource* sender);
+    void publishBoCacheStats();
+    void publishRingStats();
+    void ringFlushTimerFired(IOTimerEventSource* sender);
     FakeIrisXERing* getRcsRing() const { return fRcsRing; }
     
     
@@ -439,8 +536,23 @@ protected:
     uint64_t fGGTTSize = 0;       // bytes
     uint64_t fGGTTBaseGPU = 0;    // start VA
 
-    // Simple bump allocator state
-    uint64_t fNextGGTTOffset = 0;
+    // GGTT address space: ranges handed out by ggttMap*, returned by
+    // ggttUnmap (lock covers fGgttSpace, the PTE batch and the PTEs)
+    FXE_GgttSpace fGgttSpace;
+    IOLock* fGgttLock = nullptr;
+    FakeIrisXEGgttIO fGgttIO;
+    FXE_PteBatch fPteBatch;
+    // Userptr objects unbound in this transaction: unwired only once their
+    // PTE clears are stored and flushed
+    static const uint32_t kGgttUnwireBatch = 32;
+    FakeIrisXEGEM* fGgttUnwire[kGgttUnwireBatch];
+    uint32_t fGgttUnwireCount = 0;
+    void ggttDeferUnwire(FakeIrisXEGEM* gem);
+    void ggttRunUnwires();
+    // Unpinned objects keep their range until space runs out
+    FXE_GgttEvictor fGgttEvict;
+    FakeIrisXEGgttEvict fGgttEvictPlatform;
+    uint64_t fGgttEvictionsPublished = 0;
     
     // V90: Helper functions for GEM/GGTT management
     FakeIrisXEGEM* createGEMObject(size_t size);
@@ -454,6 +566,8 @@ protected:
     // Surface management for IOSurface integration
     IOReturn createSurface(uint32_t width, uint32_t height, uint32_t format, 
                            uint64_t* surfaceIdOut, uint64_t* gpuAddrOut);
+    IOReturn importUserSurface(FakeIrisXEGEM* gem, uint32_t width, uint32_t height, uint32_t format,
+                               uint64_t* surfaceIdOut, uint64_t* gpuAddrOut);
     IOReturn destroySurface(uint64_t surfaceId);
     IOReturn getSurfaceInfo(uint64_t surfaceId, uint32_t* width, uint32_t* height, 
                            uint32_t* format, uint64_t* gpuAddr);
@@ -479,8 +593,11 @@ protected:
         uint64_t gpuAddress = 0;
         FakeIrisXEGEM* gemObj = nullptr;
         bool inUse = false;
+        FXE_Fence fence = {};       // last GPU write (render or copy engine)
     };
     SurfaceInfo fSurfaces[kMaxSurfaces];
+    IOReturn addSurface(FakeIrisXEGEM* gem, uint32_t width, uint32_t height, uint32_t format,
+                        uint64_t* surfaceIdOut, uint64_t* gpuAddrOut);
     uint64_t fNextSurfaceId = 1;
     
     // V90 diagnostic counters
@@ -554,8 +671,31 @@ protected:
     };
     
     IOReturn submitBatchBlits(BatchBlitEntry* entries, uint32_t count);
-    IOReturn buildBatchCommandBuffer(BatchBlitEntry* entries, uint32_t count,
-                                     FakeIrisXEGEM** batchGemOut, uint32_t* seqNumOut);
+    IOReturn buildBatchCommandBuffer(BatchBlitEntry* entries, uint32_t count, uint32_t* seqNumOut);
+
+    // Copy engine (BCS0): XY_* blits run on their own execlist so they
+    // overlap with render work instead of queueing behind it on the RCS
+    // ring. Without BCS0 they fall back to appendFenceAndSubmit.
+    FakeIrisXEExeclist* fBlitExeclist = nullptr;
+    FakeIrisXEExeclist::XEHWContext* fBlitCtx = nullptr;
+    static constexpr uint32_t kBlitCtxId = 1;
+
+    bool initBlitEngine();
+    uint32_t addBlitDep(FXE_Fence* deps, uint32_t count, const SurfaceInfo* surf);
+    // Command space for one blit batch: a slice of BCS0's batch pool, or
+    // a BO-cache GEM without BCS0 (or when every pool chunk is busy).
+    // submitBlitBatch() consumes it whether or not the submit succeeds.
+    struct BlitBatch {
+        uint32_t*      cmd;
+        FakeIrisXEGEM* gem;
+        FXE_BatchSlice slice;
+    };
+    bool blitBatchBegin(size_t bytes, BlitBatch* batch);
+    uint32_t submitBlitBatch(BlitBatch* batch, uint32_t bytes,
+                             const FXE_Fence* deps, uint32_t depCount, FXE_Fence* outFence);
+    // Render work that writes a surface records its fence here so blits
+    // touching the surface wait for it.
+    bool setSurfaceFence(uint64_t surfaceId, const FXE_Fence& fence);
     
     // V92 counters
     uint32_t fV92ClipCount = 0;
@@ -614,6 +754,47 @@ protected:
     uint64_t ggttMap(FakeIrisXEGEM* gem);
     uint64_t ggttMapAtOrAbove(FakeIrisXEGEM* gem, uint64_t minOffset);  // V140: Map at or above minimum offset
     void ggttUnmap(uint64_t gpuAddr, uint32_t pages);
+    uint64_t ggttMapRange(FakeIrisXEGEM* gem, uint64_t minOffset, const char* who,
+                          FXE_PteMapInfo* info = nullptr);
+
+    // GGTT transactions: map/unmap several objects between ggttBegin() and
+    // ggttCommit() and pay for one GTT_WRITE_FLUSH. The lock is held
+    // throughout; addresses returned by ggttMapDeferred() must not reach
+    // the GPU before the commit.
+    bool ggttBegin();
+    uint64_t ggttMapDeferred(FakeIrisXEGEM* gem, uint64_t minOffset, const char* who,
+                             FXE_PteMapInfo* info = nullptr);
+    uint64_t ggttUnmapDeferred(uint64_t gpuAddr);
+    uint32_t ggttCommit();
+    // Drop gem's binding: only if it is unpinned or, with force, because
+    // it is being freed.
+    void ggttUnbind(FakeIrisXEGEM* gem, bool force);
+    // Last unpin of a bound GEM: to the young end of the eviction list.
+    // Pinning again does not take it off; the evictor skips pinned GEMs.
+    void ggttIdle(FakeIrisXEGEM* gem);
+    void publishGgttStats();
+
+    // Per-process page tables (FakeIrisXEPpgtt) draw their table pages
+    // from one pool and flush the GPU TLBs through here.
+    FXE_PtPagePlatform* ptPages() { return &fPtPages; }
+    void invalidateGpuTlbs();
+    static const uint32_t kTlbInvTimeoutUs = 100;
+    FXE_PtPool fPtPool;
+    FakeIrisXEPtBacking fPtBacking;
+    FakeIrisXEPtPages fPtPages;
+    IOLock* fPtPoolLock = nullptr;
+
+    // Per-client accounting: one account per user-client connection,
+    // listed here (under fAccountLock) while the connection is open and
+    // published as "ClientMemory". Quotas come from the
+    // fakeirisxe-quota-soft / fakeirisxe-quota-hard boot-args (MB).
+    FakeIrisXEClientAccount* openClientAccount(uint32_t pid, const char* name);
+    void closeClientAccount(FakeIrisXEClientAccount* acct);
+    void publishClientStats();
+    OSArray* fClientAccounts = nullptr;
+    IOLock* fAccountLock = nullptr;
+    uint64_t fClientQuotaSoft = 0;
+    uint64_t fClientQuotaHard = 0;
 
     // ===========================
     // RCS Ring + GGTT + BAR0
@@ -627,7 +808,9 @@ protected:
     // Temporary batch GEM for testing
     FakeIrisXEGEM* batchGem = nullptr;
 
-    FakeIrisXEGEM*    fFenceGEM = nullptr;
+    FakeIrisXEGEM*    fFenceGEM = nullptr;       // FXE_FencePage: last completed seqno per engine
+    uint64_t          fRcsSeqno = 0;             // last issued on the RCS ring (under its lock)
+    uint64_t          fRcsRetired = 0;           // pending submissions retired up to here
     uint64_t          fRingGpuVA = 0;             // GPU VA of ring buffer (GGTT)
     size_t            fRingSize = 0;              // bytes
     uint32_t fFenceSeq;
@@ -639,16 +822,32 @@ protected:
     
     FakeIrisXERing* createRcsRing(size_t bytes);
 
-    uint32_t submitBatch(FakeIrisXEGEM* batchGem, size_t batchOffsetBytes, size_t batchSizeBytes);
+    uint32_t submitBatch(FakeIrisXEGEM* batchGem, size_t batchOffsetBytes, size_t batchSizeBytes,
+                         uint64_t* latencyNs = nullptr);
+    // Wait for the RCS fence slot to pass `seq`: a short spin, then sleep
+    // on the completion wakeup from handleInterrupt. On success *latencyNs
+    // is the time from `submitNs` (schedNowNs) to the observed completion.
+    IOReturn waitForRcsSeqno(uint64_t seq, uint64_t submitNs, uint32_t timeoutMs,
+                             uint64_t* latencyNs = nullptr);
+    IOReturn sleepForRcsSeqno(uint64_t seq, uint64_t deadline);   // in the gate
     
     
     
     
-    uint32_t appendFenceAndSubmit(FakeIrisXEGEM* userBatchGem, size_t userBatchOffsetBytes, size_t userBatchSizeBytes);
+    // Returns the RCS fence seqno of the submission, 0 on failure.
+    uint64_t appendFenceAndSubmit(FakeIrisXEGEM* userBatchGem, size_t userBatchOffsetBytes,
+                                  size_t userBatchSizeBytes, bool flushNow = false);
+    bool ensureFencePage();
+    uint64_t fenceCompleted(uint32_t slot);
    
     void handleInterrupt(IOInterruptEventSource* src, int count);
-    bool addPendingSubmission(uint32_t seq, FakeIrisXEGEM* master, FakeIrisXEGEM* tail);
-    bool completePendingSubmission(uint32_t seq);
+    // The entry takes over the caller's references (and pins) on batch and
+    // on standalone master and tail (null when carved from fChainPool).
+    bool addPendingSubmission(uint64_t seq, FakeIrisXEGEM* batch,
+                              FakeIrisXEGEM* master, FakeIrisXEGEM* tail);
+    void popPendingSubmission();
+    void releaseSubmission(const FXE_Submission& s);
+    uint32_t retirePendingSubmissions(uint64_t completed);
     void cleanupAllPendingSubmissions();
 
     bool setBacklightPercent(uint32_t percent);
@@ -700,17 +899,41 @@ protected:
 private:
     IOInterruptEventSource* fInterruptSource = nullptr;
 
-    // simple struct to keep pending submissions if you want cleanup:
-    struct Submission {
-        uint32_t seq;
-        FakeIrisXEGEM* masterGem;
-        FakeIrisXEGEM* tailGem;
-        // add timestamp, owner, etc.
-    };
-    OSArray* fPendingSubmissions = nullptr; // array of Submission objects or custom wrapper
+    // RCS submissions in flight, in seqno order; master/tail GEMs as void*
+    FXE_SubmitRing fPending;                // under fPendingLock
     IOLock* fPendingLock = nullptr;
 
+    // Master chain + tail of every RCS submission, one slice each, reused
+    // once the fence page passes the seqno (under the RCS ring lock)
+    static const uint32_t kChainBytes        = 128;
+    static const uint32_t kChainTailOffset   = 64;
+    static const uint32_t kChainPoolChunkSize = 64 * 1024;
+    FXE_BatchPool               fChainPool;
+    FakeIrisXEChainPoolPlatform fChainPoolPlatform;
+
+    // waitForRcsSeqno: spin this long before sleeping; re-check the fence
+    // page at least this often while asleep, in case the interrupt is lost
+    static const uint32_t kRcsWaitSpinUs  = 20;
+    static const uint32_t kRcsWaitSliceMs = 10;
+    uint64_t fRcsWaitSpun = 0;              // completed while spinning
+    uint64_t fRcsWaitSlept = 0;
+    uint64_t fRcsWaitTimeouts = 0;
+    uint64_t fRcsWaitLastNs = 0;
+    uint64_t fRcsWaitMaxNs = 0;
+
     IOCommandGate*  fCmdGate          = nullptr;
+
+    // Buffer-object cache (lock covers fBoCache). Entries are reaped after
+    // kBoCacheMaxAgeMs by fBoCacheTimer and trimmed when an allocation fails.
+    static const uint64_t kBoCacheBudget   = 8ULL << 20;
+    static const uint32_t kBoCacheMaxAgeMs = 2000;
+    static const uint32_t kBoCacheReapMs   = 1000;
+    FXE_BoCache fBoCache;
+    FakeIrisXEBoCachePlatform fBoCachePlatform;
+    IOLock* fBoCacheLock = nullptr;
+    IOTimerEventSource* fBoCacheTimer = nullptr;
+    IOTimerEventSource* fRingFlushTimer = nullptr;   // deferred RCS tail writes
+    bool fBoCacheKeepMapped = true;     // park objects with their GGTT range
    
     FakeIrisXEBacklight* fBacklight = nullptr;
     
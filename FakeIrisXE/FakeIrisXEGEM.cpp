@@ -1,4 +1,6 @@
 #include "FakeIrisXEGEM.hpp"
+#include "FakeIrisXEFramebuffer.hpp"
+#include "FakeIrisXEClientAccount.hpp"
 
 #define super OSObject
 OSDefineMetaClassAndStructors(FakeIrisXEGEM, OSObject)
@@ -6,15 +8,37 @@ OSDefineMetaClassAndStructors(FakeIrisXEGEM, OSObject)
 bool FakeIrisXEGEM::init() {
     if (!super::init()) return false;
     fBuffer = nullptr;
+    fUserMem = nullptr;
+    fUserMap = nullptr;
+    fWireCount = 0;
+    fInvalid = false;
     fSize = 0;
     fPhysAddr = 0;
-    fPinCount = 0;
+    bzero(&fVma, sizeof(fVma));
+    fGgttHome = nullptr;
     fFlags = 0;
-    fLock = IOLockAlloc();
+    fLock = nullptr;
+    fAccount = nullptr;
     return true;
 }
 
 void FakeIrisXEGEM::free() {
+    // the PTEs must not outlive the pages, and a userptr unbound by
+    // another thread is unwired at that thread's ggttCommit: wait for it
+    if (FakeIrisXEFramebuffer* ggtt = fVma.owner ? fVma.owner : (fUserMem ? fGgttHome : nullptr))
+        ggtt->ggttUnbind(this, true);
+    if (fUserMem && fWireCount) {
+        fUserMem->complete(kIODirectionOutIn);
+        fWireCount = 0;
+    }
+    if (fUserMap) {
+        fUserMap->release();
+        fUserMap = nullptr;
+    }
+    if (fUserMem) {
+        fUserMem->release();
+        fUserMem = nullptr;
+    }
     if (fBuffer) {
         fBuffer->release();
         fBuffer = nullptr;
@@ -23,6 +47,11 @@ void FakeIrisXEGEM::free() {
         IOLockFree(fLock);
         fLock = nullptr;
     }
+    if (fAccount) {
+        fAccount->account().unchargeAlloc((uint64_t)pageCount() << 12);
+        fAccount->release();
+        fAccount = nullptr;
+    }
     super::free();
 }
 
@@ -42,6 +71,26 @@ FakeIrisXEGEM* FakeIrisXEGEM::withSize(size_t size, uint32_t flags) {
     return obj;
 }
 
+FakeIrisXEGEM* FakeIrisXEGEM::withUserRange(task_t task, mach_vm_address_t address, size_t size,
+                                            uint32_t flags) {
+    if (!task || !address || !size || (address & 0xFFF) || (size & 0xFFF))
+        return nullptr;
+
+    FakeIrisXEGEM* obj = OSTypeAlloc(FakeIrisXEGEM);
+    if (!obj) return nullptr;
+    if (!obj->init()) { obj->release(); return nullptr; }
+
+    obj->fSize = size;
+    obj->fFlags = flags;
+    obj->fLock = IOLockAlloc();
+    obj->fUserMem = IOMemoryDescriptor::withAddressRange(address, size, kIODirectionOutIn, task);
+    if (!obj->fLock || !obj->fUserMem) {
+        obj->release();
+        return nullptr;
+    }
+    return obj;
+}
+
 bool FakeIrisXEGEM::allocate() {
     fBuffer = IOBufferMemoryDescriptor::inTaskWithPhysicalMask(
         kernel_task,
@@ -56,19 +105,108 @@ bool FakeIrisXEGEM::allocate() {
     return (fPhysAddr != 0);
 }
 
+// A mapping that is still on the idle list stays there: the evictor sees
+// the pin and skips it, and ggttMap* after the pin rebinds it if eviction
+// won the race.
 void FakeIrisXEGEM::pin() {
+    __atomic_fetch_add(&fVma.pinCount, 1, __ATOMIC_ACQUIRE);
+}
+
+void FakeIrisXEGEM::unpin() {
+    uint32_t n = __atomic_load_n(&fVma.pinCount, __ATOMIC_RELAXED);
+    do {
+        if (!n) return;
+    } while (!__atomic_compare_exchange_n(&fVma.pinCount, &n, n - 1, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    // Rechecked under the GGTT lock: a pin() in between keeps it off the list
+    FakeIrisXEFramebuffer* owner = __atomic_load_n(&fVma.owner, __ATOMIC_ACQUIRE);
+    if (n == 1 && owner)
+        owner->ggttIdle(this);
+}
+
+uint32_t FakeIrisXEGEM::pinCount() const {
+    return __atomic_load_n(&fVma.pinCount, __ATOMIC_ACQUIRE);
+}
+
+void FakeIrisXEGEM::setGpuAddress(FakeIrisXEFramebuffer* owner, uint64_t a, uint64_t size, uint32_t pageSize) {
+    fVma.gpuAddr = a;
+    fVma.size = size;
+    fVma.pageSize = pageSize;
+    fGgttHome = owner;
+    __atomic_store_n(&fVma.owner, owner, __ATOMIC_RELEASE);
+}
+
+void FakeIrisXEGEM::clearGpuAddress() {
+    __atomic_store_n(&fVma.owner, (FakeIrisXEFramebuffer*)nullptr, __ATOMIC_RELEASE);
+    fVma.gpuAddr = 0;
+    fVma.size = 0;
+    fVma.pageSize = 0;
+}
+
+bool FakeIrisXEGEM::setAccount(FakeIrisXEClientAccount* account) {
+    if (!account || fAccount) return false;
+    if (account->account().chargeAlloc((uint64_t)pageCount() << 12) == FXE_CHARGE_DENIED)
+        return false;
+    account->retain();
+    fAccount = account;
+    return true;
+}
+
+IOMemoryDescriptor* FakeIrisXEGEM::backing() const {
+    if (fUserMem) return fUserMem;
+    return fBuffer;
+}
+
+bool FakeIrisXEGEM::wire() {
+    if (!fUserMem) return true;
     IOLockLock(fLock);
-    fPinCount++;
+    bool ok = !fInvalid;
+    if (ok && !fWireCount)
+        ok = fUserMem->prepare(kIODirectionOutIn) == kIOReturnSuccess;
+    if (ok)
+        fWireCount++;
     IOLockUnlock(fLock);
+    return ok;
 }
 
-void FakeIrisXEGEM::unpin() {
+void FakeIrisXEGEM::unwire() {
+    if (!fUserMem) return;
+    IOLockLock(fLock);
+    if (fWireCount && --fWireCount == 0)
+        fUserMem->complete(kIODirectionOutIn);
+    IOLockUnlock(fLock);
+}
+
+void* FakeIrisXEGEM::cpuAddress() {
+    if (fBuffer) return fBuffer->getBytesNoCopy();
+    if (!fUserMem) return nullptr;
+    IOLockLock(fLock);
+    if (!fUserMap && !fInvalid)
+        fUserMap = fUserMem->createMappingInTask(kernel_task, 0, kIOMapAnywhere);
+    void* p = fUserMap ? (void*)fUserMap->getVirtualAddress() : nullptr;
+    IOLockUnlock(fLock);
+    return p;
+}
+
+void FakeIrisXEGEM::invalidate() {
+    if (!fUserMem) return;
     IOLockLock(fLock);
-    if (fPinCount > 0) fPinCount--;
+    fInvalid = true;
+    IOMemoryMap* map = fUserMap;
+    fUserMap = nullptr;
     IOLockUnlock(fLock);
+    FakeIrisXEFramebuffer* owner = __atomic_load_n(&fVma.owner, __ATOMIC_ACQUIRE);
+    // PTEs first, then the pages may go. PPGTT mappings are their
+    // owner's to remove before this.
+    if (owner)
+        owner->ggttUnbind(this, true);
+    if (map) map->release();
 }
 
 mach_vm_address_t FakeIrisXEGEM::getPhysicalSegment(uint64_t offset, uint64_t* lengthOut) {
-    if (!fBuffer) return 0;
-    return fBuffer->getPhysicalSegment(offset, lengthOut);
+    IOMemoryDescriptor* md = backing();
+    if (!md) return 0;
+    // a client range only has stable pages while wired
+    if (fUserMem && !fWireCount) return 0;
+    return md->getPhysicalSegment(offset, lengthOut);
 }
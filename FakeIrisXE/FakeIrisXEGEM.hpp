@@ -4,47 +4,111 @@
 #include <IOKit/IOBufferMemoryDescriptor.h>
 #include <IOKit/IOLib.h>
 #include <libkern/c++/OSObject.h>
+#include "FXE_Ggtt.hpp"
 
 
 extern "C" void OSMemoryBarrier(void);
 #define OSMemoryBarrier() __asm__ volatile("" ::: "memory")
 
+class FakeIrisXEFramebuffer;
+class FakeIrisXEClientAccount;
+
+// A GEM's GGTT binding. Bound by FakeIrisXEFramebuffer::ggttMap* (which
+// returns the same range while it is bound) and unbound by ggttUnmap, by
+// GGTT eviction once the last unpin() left it idle, or when the object is
+// freed.
+//
+// The binding fields and the LRU node belong to the framebuffer's GGTT
+// lock. pinCount is atomic and taken without it: pin() is one increment,
+// and only the unpin() that reaches zero takes the GGTT lock, to put the
+// mapping at the young end of the idle list. A node stays listed while
+// pinned again; the evictor rechecks the count and skips it.
+struct FakeIrisXEVma {
+    FakeIrisXEFramebuffer* owner;   // null: not bound
+    uint64_t gpuAddr;
+    uint64_t size;
+    uint32_t pageSize;              // largest GGTT entry used (FXE_PAGE_*)
+    uint32_t pinCount;              // pins keep the binding alive
+    FXE_LruNode lru;                // on the GGTT idle list once unpinned
+};
+
 
 class FakeIrisXEGEM : public OSObject {
     OSDeclareDefaultStructors(FakeIrisXEGEM);
 
 public:
     static FakeIrisXEGEM* withSize(size_t size, uint32_t flags = 0);
+    // Zero-copy wrapper around a page-aligned range of a client task. The
+    // pages are wired only while the object is bound into the GGTT.
+    static FakeIrisXEGEM* withUserRange(task_t task, mach_vm_address_t address, size_t size,
+                                        uint32_t flags = 0);
 
     bool init() override;
     void free() override;
 
     bool allocate();
-    void pin();
-    void unpin();
+    void pin();         // acquire: lock-free
+    void unpin();       // release; the last one leaves the mapping idle (evictable)
+    uint32_t pinCount() const;
 
     uint64_t physicalAddress() const { return fPhysAddr; }
-    IOBufferMemoryDescriptor* memoryDescriptor() const { return fBuffer; }
+    IOBufferMemoryDescriptor* memoryDescriptor() const { return fBuffer; }   // null for userptr
+    IOMemoryDescriptor* backing() const;    // kernel buffer or client range
+
+    // Userptr objects: wire() makes the pages resident and their physical
+    // segments valid; every GGTT or PPGTT binding holds one wiring,
+    // dropped with unwire() on unbind. No-ops for kernel buffers.
+    bool isUserptr() const { return fUserMem != nullptr; }
+    bool wire();
+    void unwire();
+    // Kernel view of the pages (mapped on first use for userptr), null
+    // once invalidated.
+    void* cpuAddress();
+    // The client range is going away (release, unmap or exit): drop the
+    // GGTT binding and refuse any further mapping. PPGTT mappings must be
+    // removed by their address space first.
+    void invalidate();
+    bool isInvalidated() const { return fInvalid; }
 
     uint32_t pageCount() const { return (uint32_t)((fSize + 4095) / 4096); }
 
+    // Owning client: charges the object's pages to it until freed (and
+    // its GGTT range while bound). Set once, right after creation; false
+    // if the client's hard quota refuses the pages.
+    bool setAccount(FakeIrisXEClientAccount* account);
+    FakeIrisXEClientAccount* account() const { return fAccount; }
+
     mach_vm_address_t getPhysicalSegment(uint64_t offset, uint64_t* lengthOut);
 
 private:
     IOBufferMemoryDescriptor* fBuffer;
+    IOMemoryDescriptor* fUserMem;
+    IOMemoryMap* fUserMap;
+    uint32_t fWireCount;
+    bool fInvalid;
     size_t fSize;
     mach_vm_address_t fPhysAddr;
 
-    IOLock* fLock;
-    uint32_t fPinCount;
+    IOLock* fLock;      // userptr only: wiring, kernel map, invalidation
     uint32_t fFlags;
+    FakeIrisXEClientAccount* fAccount;
     
 private:
-    uint64_t fGpuAddress = 0;
+    FakeIrisXEVma fVma;
+    // Last framebuffer that bound us: free() syncs with its GGTT lock so
+    // an unbind's deferred unwire (at ggttCommit) never outlives us
+    FakeIrisXEFramebuffer* fGgttHome;
 
 public:
-    void setGpuAddress(uint64_t a) { fGpuAddress = a; }
-    uint64_t gpuAddress() const { return fGpuAddress; }
+    // Set and cleared by the framebuffer under its GGTT lock; vma() and
+    // gpuAddress() are only stable under it too.
+    void setGpuAddress(FakeIrisXEFramebuffer* owner, uint64_t a, uint64_t size, uint32_t pageSize);
+    void clearGpuAddress();
+
+    const FakeIrisXEVma& vma() const { return fVma; }
+    FXE_LruNode* lruNode() { return &fVma.lru; }   // framebuffer's, under its GGTT lock
+    uint64_t gpuAddress() const { return fVma.gpuAddr; }
+    uint32_t ggttPageSize() const { return fVma.pageSize; }
 
     
     
@@ -43,19 +43,44 @@ FakeIrisXEGEM* FakeIrisXELRC::buildLRCContext(
         ctxGem->release();
         return nullptr;
     }
-    bzero(p, ctxSize);
 
     uint64_t ctxGpu = fb->ggttMap(ctxGem) & ~0xFFFULL;
 
+    buildGoldenImage(p, ctxSize, ringSize);
+    patchContextImage(p, ctxGpu, ringGpuAddr);
+
+    // HEAD / TAIL are byte offsets from RING_BASE, masked by (ringSize - 1).
+    uint32_t headBytes = ringHead & (uint32_t)(ringSize - 1);
+    uint32_t tailBytes = ringTail & (uint32_t)(ringSize - 1);
+
+    write_le32(p + kRingStateOffset + 0x00, headBytes);  // RING_HEAD
+    write_le32(p + kRingStateOffset + 0x04, tailBytes);  // RING_TAIL
+
+    uint32_t pages = (uint32_t)(ringSize / 4096);
+    if (!pages) pages = 1;
+    uint32_t ringCtl = ((pages - 1) << 12) | 1u;
+
+    __sync_synchronize();
+    OSSynchronizeIO();
+
+    IOLog("GEN12 LRC built: ctxGpu=0x%llx ringGpu=0x%llx head=%u tail=%u pages=%u ctl=0x%08x\n",
+          (unsigned long long)ctxGpu,
+          (unsigned long long)ringGpuAddr,
+          headBytes, tailBytes, pages, ringCtl);
+
+    if (outErr) *outErr = kIOReturnSuccess;
+    return ctxGem;
+}
+
+
+void FakeIrisXELRC::buildGoldenImage(uint8_t* p, size_t ctxSize, size_t ringSize)
+{
+    bzero(p, ctxSize);
+
     //
     // ===== GEN12 LRC HEADER =====
     //
-
-    // Fake PDP0 = context page, so HW sees a non-zero root and doesn't reject.
-    write_le64(p + 0x00, ctxGpu & ~0xFFFULL);  // PDP0
-    write_le64(p + 0x08, 0);                   // PDP1
-    write_le64(p + 0x10, 0);                   // PDP2
-    write_le64(p + 0x18, 0);                   // PDP3
+    // PDP0..3 are per-context (patchContextImage); left zero here.
 
     // Timestamp enable
     write_le32(p + 0x30, 0x00010000);
@@ -70,35 +95,28 @@ FakeIrisXEGEM* FakeIrisXELRC::buildLRCContext(
     //
     // ===== GEN12 RING STATE BLOCK =====
     //
-    const uint32_t ringStateOff = 0x100;
-
-    // HEAD / TAIL are byte offsets from RING_BASE, masked by (ringSize - 1).
-    uint32_t headBytes = ringHead & (uint32_t)(ringSize - 1);
-    uint32_t tailBytes = ringTail & (uint32_t)(ringSize - 1);
-
-    write_le32(p + ringStateOff + 0x00, headBytes);  // RING_HEAD
-    write_le32(p + ringStateOff + 0x04, tailBytes);  // RING_TAIL
-
-    // RING_BASE (GGTT VA of ring buffer)
-    write_le32(p + ringStateOff + 0x08, (uint32_t)(ringGpuAddr & 0xFFFFFFFFu));      // LO
-    write_le32(p + ringStateOff + 0x0C, (uint32_t)(ringGpuAddr >> 32));             // HI
+    write_le32(p + kRingStateOffset + 0x00, 0);  // RING_HEAD
+    write_le32(p + kRingStateOffset + 0x04, 0);  // RING_TAIL
 
     // RING_CTL:
     //   bits [20:12] = (num_pages - 1)
     //   bit 0        = Ring Enable
     uint32_t pages = (uint32_t)(ringSize / 4096);
     if (!pages) pages = 1;
-    uint32_t ringCtl = ((pages - 1) << 12) | 1u;
-    write_le32(p + ringStateOff + 0x10, ringCtl);
+    write_le32(p + kRingStateOffset + 0x10, ((pages - 1) << 12) | 1u);
+}
 
-    __sync_synchronize();
-    OSSynchronizeIO();
+void FakeIrisXELRC::patchContextImage(uint8_t* p, uint64_t ctxGpu, uint64_t ringGpuAddr)
+{
+    // Fake PDP0 = context page, so HW sees a non-zero root and doesn't reject.
+    write_le64(p + 0x00, ctxGpu & ~0xFFFULL);  // PDP0
 
-    IOLog("GEN12 LRC built: ctxGpu=0x%llx ringGpu=0x%llx head=%u tail=%u pages=%u ctl=0x%08x\n",
-          (unsigned long long)ctxGpu,
-          (unsigned long long)ringGpuAddr,
-          headBytes, tailBytes, pages, ringCtl);
+    // RING_BASE (GGTT VA of ring buffer)
+    write_le32(p + kRingStateOffset + 0x08, (uint32_t)(ringGpuAddr & 0xFFFFFFFFu));  // LO
+    write_le32(p + kRingStateOffset + 0x0C, (uint32_t)(ringGpuAddr >> 32));         // HI
+}
 
-    if (outErr) *outErr = kIOReturnSuccess;
-    return ctxGem;
+void FakeIrisXELRC::setPageTableRoot(uint8_t* p, uint64_t pml4)
+{
+    write_le64(p + 0x00, pml4 & ~0xFFFULL);  // PDP0 = PML4 in 4-level mode
 }
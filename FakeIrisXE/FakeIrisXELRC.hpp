@@ -24,6 +24,19 @@ public:
            uint32_t               ringHead,
            uint32_t               ringTail,
            IOReturn*              outErr);
+
+    // Context-independent part of the image (header, RING_CTL for a
+    // ringSize ring, HEAD = TAIL = 0). Built once, memcpy'd per context.
+    static void buildGoldenImage(uint8_t* p, size_t ctxSize, size_t ringSize);
+
+    // Per-context fields on top of a golden copy.
+    static void patchContextImage(uint8_t* p, uint64_t ctxGpu, uint64_t ringGpuAddr);
+
+    // Run the context in a 4-level PPGTT: PDP0 holds the PML4 address
+    // instead of the placeholder patchContextImage writes.
+    static void setPageTableRoot(uint8_t* p, uint64_t pml4);
+
+    static const uint32_t kRingStateOffset = 0x100;
    
     
     static void write_le32(uint8_t* p, uint32_t v) { *(uint32_t*)p = v; }
@@ -0,0 +1,125 @@
+//
+//  FakeIrisXEPpgtt.cpp
+//  FakeIrisXEFramebuffer
+//
+
+#include "FakeIrisXEPpgtt.hpp"
+#include "FakeIrisXEFramebuffer.hpp"
+#include "FakeIrisXEGEM.hpp"
+
+#define super OSObject
+OSDefineMetaClassAndStructors(FakeIrisXEPpgtt, OSObject);
+
+void* FakeIrisXEPpgttPlatform::allocMeta(size_t bytes)
+{
+    return IOMallocZero(bytes);
+}
+
+void FakeIrisXEPpgttPlatform::freeMeta(void* p, size_t bytes)
+{
+    IOFree(p, bytes);
+}
+
+void FakeIrisXEPpgttPlatform::invalidateTlb()
+{
+    fVm->owner()->invalidateGpuTlbs();
+}
+
+FakeIrisXEPpgtt* FakeIrisXEPpgtt::withOwner(FakeIrisXEFramebuffer* owner)
+{
+    if (!owner || !owner->fPtPoolLock)
+        return nullptr;
+    FakeIrisXEPpgtt* vm = new FakeIrisXEPpgtt;
+    if (!vm)
+        return nullptr;
+    if (!vm->init()) {
+        vm->release();
+        return nullptr;
+    }
+    vm->fOwner = owner;
+    vm->fPlatform.fVm = vm;
+    vm->fLock = IOLockAlloc();
+    if (!vm->fLock || !vm->fPt.init(owner->ptPages(), &vm->fPlatform)) {
+        IOLog("(FakeIrisXE) [PPGTT] no memory for a new address space\n");
+        vm->release();
+        return nullptr;
+    }
+    return vm;
+}
+
+void FakeIrisXEPpgtt::free()
+{
+    // Owners unmap their objects first (the user client does on close);
+    // only the tables are left to go.
+    if (fLock) {
+        IOLockLock(fLock);
+        fPt.destroy();
+        IOLockUnlock(fLock);
+        IOLockFree(fLock);
+        fLock = nullptr;
+    }
+    super::free();
+}
+
+uint64_t FakeIrisXEPpgtt::map(FakeIrisXEGEM* gem)
+{
+    if (!gem || gem->isInvalidated() || !gem->wire())
+        return 0;
+    const uint64_t bytes = (uint64_t)gem->pageCount() << 12;
+
+    IOLockLock(fLock);
+    uint64_t va = 0;
+    bool ok = fPt.bind(bytes, 0, &va);
+    // one run of entries per physically contiguous segment
+    for (uint64_t off = 0; ok && off < bytes; ) {
+        uint64_t len = 0;
+        const uint64_t phys = gem->getPhysicalSegment(off, &len);
+        if (!phys || !len) {
+            ok = false;
+            break;
+        }
+        if (len > bytes - off)
+            len = bytes - off;
+        const uint64_t pages = (len + 4095) >> 12;
+        ok = fPt.map(va + off, phys & ~0xFFFULL, pages);
+        off += pages << 12;
+    }
+    if (ok) {
+        fPt.setTag(va, (uint64_t)(uintptr_t)gem);
+    } else if (va) {
+        fPt.unbind(va);
+    }
+    fPt.commit();
+    IOLockUnlock(fLock);
+
+    if (!ok) {
+        gem->unwire();
+        IOLog("(FakeIrisXE) [PPGTT] map of %llu KB failed\n", bytes >> 10);
+        return 0;
+    }
+    gem->retain();
+    return va;
+}
+
+bool FakeIrisXEPpgtt::unmap(uint64_t va)
+{
+    IOLockLock(fLock);
+    FakeIrisXEGEM* gem = (FakeIrisXEGEM*)(uintptr_t)fPt.tagOf(va);
+    const bool found = gem && fPt.unbind(va);
+    fPt.commit();
+    IOLockUnlock(fLock);
+
+    if (!found)
+        return false;
+    gem->unwire();
+    gem->release();
+    return true;
+}
+
+FXE_PpgttStats FakeIrisXEPpgtt::stats()
+{
+    IOLockLock(fLock);
+    const FXE_PpgttStats st = fPt.stats();
+    IOLockUnlock(fLock);
+    return st;
+}
@@ -0,0 +1,58 @@
+//
+//  FakeIrisXEPpgtt.hpp
+//  FakeIrisXEFramebuffer
+//
+//  Per-client GPU address space: an FXE_Ppgtt whose table pages come from
+//  the framebuffer's shared pool. Contexts created with it carry its PML4
+//  in their LRC (FakeIrisXELRC::setPageTableRoot).
+//
+
+#ifndef FakeIrisXEPpgtt_hpp
+#define FakeIrisXEPpgtt_hpp
+
+#include <IOKit/IOLib.h>
+#include <IOKit/IOLocks.h>
+#include <libkern/c++/OSObject.h>
+#include "FXE_Ppgtt.hpp"
+
+class FakeIrisXEFramebuffer;
+class FakeIrisXEGEM;
+class FakeIrisXEPpgtt;
+
+// Table bookkeeping from the kernel heap, TLB flushes through the
+// framebuffer.
+class FakeIrisXEPpgttPlatform : public FXE_PpgttPlatform {
+public:
+    FakeIrisXEPpgtt* fVm;
+
+    void* allocMeta(size_t bytes) override;
+    void freeMeta(void* p, size_t bytes) override;
+    void invalidateTlb() override;
+};
+
+class FakeIrisXEPpgtt : public OSObject {
+    OSDeclareDefaultStructors(FakeIrisXEPpgtt)
+
+public:
+    static FakeIrisXEPpgtt* withOwner(FakeIrisXEFramebuffer* owner);
+    void free() override;
+
+    // Map the whole GEM (retained and wired until unmap). Returns its
+    // address in this space, 0 on failure.
+    uint64_t map(FakeIrisXEGEM* gem);
+    // Remove the mapping at va; one TLB flush, then the GEM is let go.
+    bool unmap(uint64_t va);
+
+    // PML4 for the context image
+    uint64_t rootAddress() const { return fPt.root(); }
+    FXE_PpgttStats stats();
+    FakeIrisXEFramebuffer* owner() const { return fOwner; }
+
+private:
+    FakeIrisXEFramebuffer* fOwner;
+    IOLock* fLock;                  // covers fPt
+    FXE_Ppgtt fPt;
+    FakeIrisXEPpgttPlatform fPlatform;
+};
+
+#endif /* FakeIrisXEPpgtt_hpp */
@@ -1,6 +1,7 @@
 #include "FakeIrisXERing.h"
 #include "i915_reg.h"
 #include <IOKit/IOLib.h>
+#include <IOKit/IOTimerEventSource.h>
 #include <libkern/OSAtomic.h>
 #include <stdatomic.h>
 #include "FakeIrisXEExeclist.hpp"
@@ -25,6 +26,17 @@
 #define RENDER_RING_BASE_HI (RENDER_RING_BASE + 0x04)
 #endif
 
+#define RING_HEAD_ADDR_MASK 0x001FFFFCu
+
+// How long a reservation waits for the engine to make room: 20 ms.
+static const uint32_t kRingWaitUs = 10;
+static const uint32_t kRingWaitAttempts = 2000;
+
+// Tail writes are an MMIO write and a posting read under forcewake; a
+// submission this close behind the last one waits for the next.
+static const uint32_t kRingCoalesceUs = 50;
+static const uint32_t kRingMaxDeferred = 16;
+
 static inline void mmio_write32(volatile uint32_t* mmio, uint32_t off, uint32_t val)
 {
     volatile uint32_t* addr = (volatile uint32_t*)((uintptr_t)mmio + off);
@@ -42,15 +54,21 @@ FakeIrisXERing::FakeIrisXERing(volatile uint32_t* mmioBase)
 : mMMIO(mmioBase),
   mRingCPU(nullptr),
   mRingSize(0),
-  mRingWriteOffset(0),
-  mRingGPUAddr(0)
+  mRingGPUAddr(0),
+  mFlushTimer(nullptr)
 {
+    mHw.fRing = this;
+    mSpace.init(&mHw, nullptr, 0);
+    mSpace.setCoalesce((uint64_t)kRingCoalesceUs * 1000, kRingMaxDeferred);
+    mLock = IOLockAlloc();
 }
 
 FakeIrisXERing::~FakeIrisXERing()
 {
     if (mRingCPU)
         IOFreeAligned(mRingCPU, mRingSize);
+    if (mLock)
+        IOLockFree(mLock);
 }
 
 
@@ -65,7 +83,7 @@ bool FakeIrisXERing::allocateRing(size_t bytes)
 
     mRingCPU = (uint32_t*)buf;
     mRingSize = size;
-    mRingWriteOffset = 0;
+    mSpace.init(&mHw, mRingCPU, (uint32_t)size);
     return true;
 }
 
@@ -97,16 +115,62 @@ void FakeIrisXERing::enableRing()
 
 
 
-void FakeIrisXERing::pushDword(uint32_t d)
+uint32_t* FakeIrisXERing::reserve(uint32_t dwords)
+{
+    uint32_t* p = mSpace.reserve(dwords);
+    if (!p && mRingCPU)
+        IOLog("(FakeIrisXE) ring: no room for %u dwords (head=0x%x tail=0x%x)\n",
+              dwords, mSpace.cachedHead(), mSpace.tail());
+    return p;
+}
+
+bool FakeIrisXERing::commit()
+{
+    return mSpace.commit(FakeIrisXEExeclist::schedNowNs());
+}
+
+FXE_RingCommit FakeIrisXERing::commitDeferred()
+{
+    const uint64_t now = FakeIrisXEExeclist::schedNowNs();
+    const FXE_RingCommit r = mSpace.commitDeferred(now);
+    // the first deferral since the last tail write arms the timer
+    if (r == FXE_RING_DEFERRED && mSpace.deferred() == 1 && mFlushTimer) {
+        const uint64_t due = mSpace.deadline();
+        mFlushTimer->setTimeoutUS(due > now ? (uint32_t)((due - now + 999) / 1000) : 1);
+    }
+    return r;
+}
+
+void FakeIrisXERing::beginBatch()
 {
-    if (!mRingCPU) return;
+    lock();
+    mSpace.plug();
+    unlock();
+}
 
-    size_t idx = (mRingWriteOffset >> 2) % (mRingSize >> 2);
-    mRingCPU[idx] = d;
+void FakeIrisXERing::endBatch()
+{
+    lock();
+    mSpace.unplug(FakeIrisXEExeclist::schedNowNs());
+    unlock();
+}
 
-    mRingWriteOffset += 4;
-    if (mRingWriteOffset >= mRingSize)
-        mRingWriteOffset = 0;
+void FakeIrisXERing::setFlushTimer(IOTimerEventSource* timer)
+{
+    lock();
+    mFlushTimer = timer;
+    unlock();
+    // nothing may be left waiting on a timer that is going away
+    if (!timer)
+        flushDeferred();
+}
+
+// Flush timer: publish whatever is still deferred.
+void FakeIrisXERing::flushDeferred()
+{
+    lock();
+    commit();
+    unlock();
 }
 
 void FakeIrisXERing::flushRingCpuCache()
@@ -114,34 +178,66 @@ void FakeIrisXERing::flushRingCpuCache()
     atomic_thread_fence(memory_order_seq_cst);
 }
 
-void FakeIrisXERing::updateHWTail()
+void FakeIrisXERing::updateHWTail(uint32_t tail)
 {
     if (!mMMIO) return;
 
-    uint32_t tail = (uint32_t)mRingWriteOffset;
     mmio_write32(mMMIO, RENDER_RING_TAIL, tail);
     (void)mmio_read32(mMMIO, RENDER_RING_TAIL);
 }
 
 uint32_t FakeIrisXERing::readHWHead()
 {
-    return mmio_read32(mMMIO, RENDER_RING_HEAD);
+    if (!mMMIO) return 0;
+    return mmio_read32(mMMIO, RENDER_RING_HEAD) & RING_HEAD_ADDR_MASK;
 }
 
-bool FakeIrisXERing::submitBatch64(uint64_t gpu)
+bool FakeIrisXERing::submitBatch64(uint64_t gpu, bool flushNow)
 {
     if (!mRingCPU) return false;
 
+    lock();
+    const bool ok = emitBatchStart(gpu, flushNow);
+    unlock();
+    return ok;
+}
+
+bool FakeIrisXERing::emitBatchStart(uint64_t gpu, bool flushNow)
+{
     const uint32_t MI_BATCH_START_64 = (0x31u << 23) | (1 << 8);
     const uint32_t MI_BATCH_END      = (0x0Au << 23);
 
-    pushDword(MI_BATCH_START_64);
-    pushDword((uint32_t)gpu);
-    pushDword((uint32_t)(gpu >> 32));
-    pushDword(MI_BATCH_END);
+    uint32_t* cs = reserve(4);
+    if (!cs)
+        return false;
+    cs[0] = MI_BATCH_START_64;
+    cs[1] = (uint32_t)gpu;
+    cs[2] = (uint32_t)(gpu >> 32);
+    cs[3] = MI_BATCH_END;
+
+    if (flushNow)
+        commit();
+    else
+        commitDeferred();
+    return true;
+}
 
-    flushRingCpuCache();
-    updateHWTail();
 
+uint32_t FakeIrisXERingHw::readHead()
+{
+    return fRing->readHWHead();
+}
+
+void FakeIrisXERingHw::writeTail(uint32_t tail)
+{
+    fRing->flushRingCpuCache();
+    fRing->updateHWTail(tail);
+}
+
+bool FakeIrisXERingHw::waitForSpace(uint32_t attempt)
+{
+    if (attempt >= kRingWaitAttempts)
+        return false;
+    IODelay(kRingWaitUs);
     return true;
 }
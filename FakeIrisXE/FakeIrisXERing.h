@@ -2,10 +2,25 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <IOKit/IOLocks.h>
 
+#include "FXE_RingSpace.hpp"
 
+
+class IOTimerEventSource;
 class FakeIrisXEGEM;
 class FakeIrisXEFramebuffer;
+class FakeIrisXERing;
+
+// Head/tail MMIO for FXE_RingSpace; waits spin on IODelay.
+class FakeIrisXERingHw : public FXE_RingPlatform {
+public:
+    FakeIrisXERing* fRing;
+
+    uint32_t readHead() override;
+    void writeTail(uint32_t tail) override;
+    bool waitForSpace(uint32_t attempt) override;
+};
 
 class FakeIrisXERing {
 public:
@@ -22,27 +37,52 @@ public:
     void programRingBaseToHW();
     void enableRing();
 
-    // Software ring operations
-    void pushDword(uint32_t dword);
+    // Software ring operations: reserve() a whole packet, fill it, then
+    // commit() publishes the tail once for everything reserved since, or
+    // commitDeferred() leaves it to the coalescing window. Emitters hold
+    // lock() from reserve() to the commit.
+    uint32_t* reserve(uint32_t dwords);
+    bool commit();
+    FXE_RingCommit commitDeferred();
+    void lock() { if (mLock) IOLockLock(mLock); }
+    void unlock() { if (mLock) IOLockUnlock(mLock); }
+
+    // Tail-write coalescing. Submissions between beginBatch() and
+    // endBatch() share one tail write; outside, a submission close behind
+    // the last tail write is published by the flush timer (or the next
+    // flush-now submission) at most kRingCoalesceUs later.
+    void beginBatch();
+    void endBatch();
+    void setFlushTimer(IOTimerEventSource* timer);
+    void flushDeferred();
+
     void flushRingCpuCache();
-    void updateHWTail();
+    void updateHWTail(uint32_t tail);
     uint32_t readHWHead();
 
     FakeIrisXEFramebuffer* fOwner;
 
     
     
-    // Submit a batch buffer GPU address using MI_BATCH_BUFFER_START
-    bool submitBatch64(uint64_t batchGpuAddr);
+    // Submit a batch buffer GPU address using MI_BATCH_BUFFER_START.
+    // flushNow publishes the tail at once, for work someone waits on.
+    bool submitBatch64(uint64_t batchGpuAddr, bool flushNow = false);
+    // The same with lock() held, for callers that number submissions in
+    // ring order.
+    bool emitBatchStart(uint64_t batchGpuAddr, bool flushNow);
 
     // Getter
     size_t size() const { return mRingSize; }
     uint64_t gpuAddr() const { return mRingGPUAddr; }
+    const FXE_RingStats& stats() const { return mSpace.stats(); }
 
 private:
     volatile uint32_t* mMMIO;   // BAR0 base
     uint32_t*          mRingCPU;
     size_t             mRingSize;
-    uint64_t           mRingWriteOffset;
     uint64_t           mRingGPUAddr;
+    FXE_RingSpace      mSpace;
+    FakeIrisXERingHw   mHw;
+    IOLock*            mLock;
+    IOTimerEventSource* mFlushTimer;
 };
@@ -1092,7 +1092,6 @@
 // Tiger Lake Gen12 RCS base = 0x2C000
 #define RCS_BASE = 0x2C000;
 #define RCS0_MODE = RCS_BASE + 0xD8;
-#define RCS0_RESET_CTRL = RCS_BASE + 0x8;
 
 
 // Workaround registers for Gen12
@@ -1153,6 +1152,28 @@
 #define MI_NOOP               (0 << 23)
 #endif
 
+// Poll a dword in GGTT until it is >= the inline value (gen12: 4 dwords).
+#ifndef MI_SEMAPHORE_WAIT
+#define MI_SEMAPHORE_WAIT     MI_INSTR(0x1C, 2)
+#define MI_SEMAPHORE_GLOBAL_GTT (1u << 22)
+#define MI_SEMAPHORE_POLL     (1u << 15)
+#define MI_SEMAPHORE_SAD_GTE_SDD (0u << 12)
+#endif
+
+// Post-sync qword writes to a GGTT address: PIPE_CONTROL (render), with
+// the CS stall and post-sync write bits below, and MI_FLUSH_DW (copy).
+#ifndef GFX_OP_PIPE_CONTROL
+#define GFX_OP_PIPE_CONTROL(len) ((0x3u << 29) | (0x3u << 27) | (0x2u << 24) | ((len) - 2))
+#define PIPE_CONTROL_GLOBAL_GTT_IVB  (1u << 24)
+#define PIPE_CONTROL_RENDER_TARGET_CACHE_FLUSH (1u << 12)
+#define PIPE_CONTROL_DC_FLUSH_ENABLE (1u << 5)
+#define PIPE_CONTROL_DEPTH_CACHE_FLUSH (1u << 0)
+#endif
+#ifndef MI_FLUSH_DW_OP_STOREDW
+#define MI_FLUSH_DW_OP_STOREDW (1u << 14)
+#define MI_FLUSH_DW_USE_GTT    (1u << 2)
+#endif
+
 
 
 
@@ -1174,7 +1195,6 @@ static constexpr uint32_t RING_CTL     = 0x2020;
 #define RCS0_RING_START              (TGL_RCS0_BASE + 0x38)   // start/base
 #define RCS0_RING_CTL                (TGL_RCS0_BASE + 0x3C)   // ctl
 #define RCS0_RING_MODE               (TGL_RCS0_BASE + 0xD8)   // ring mode
-#define RCS0_RESET_CTRL              (TGL_RCS0_BASE + 0x1C0)  // reset/control
 
 #define RCS0_GFX_MODE     (0x2C000 + 0xD0)
 #define RCS0_GFX_MODE2    (0x2C000 + 0xD4)
@@ -1239,6 +1259,16 @@ static constexpr uint32_t RING_CTL     = 0x2020;
 #define RCS0_CSB_ADDR_HI      0x22A4
 #define RCS0_CSB_CTRL         0x22A8
 
+// CSB pointers (masked register): write pointer in 3:0 is owned by the
+// engine and names the last entry written; the driver publishes its read
+// pointer in 11:8. Both reset to entries - 1. The engine mirrors the write
+// pointer into its status page at dword HWS_CSB_WRITE_INDEX.
+#define RCS0_CSB_PTR          0x23A0
+#define CSB_PTR_WRITE_MASK    0xFu
+#define CSB_PTR_READ_SHIFT    8
+#define RCS0_HWS_PGA          0x2080
+#define HWS_CSB_WRITE_INDEX   0x2F
+
 
 
 
@@ -1272,6 +1302,41 @@ static constexpr uint32_t RING_CTL     = 0x2020;
 
 
 #define RCS0_EXECLIST_PREEMPT        0x2510
+#define EXECLIST_PREEMPT_TO_IDLE     (1u << 0)   // save current ctx, go idle, CSB PREEMPTED
+
+// Per-engine reset: RESET_CTL handshake (masked register), then the
+// engine's domain bit in GDRST, which self-clears when the reset is done.
+#define GEN6_GDRST                   0x941C
+#define GEN11_GRDOM_RENDER           (1u << 1)
+#define GEN11_GRDOM_BLT              (1u << 2)
+#define RING_RESET_CTL(base)         ((base) + 0xD0)
+#define RESET_CTL_REQUEST_RESET      (1u << 0)
+#define RESET_CTL_READY_TO_RESET     (1u << 1)
+
+// Gen12 per-engine TLB invalidation: write 1, hardware clears it when done.
+#define GEN12_GFX_TLB_INV_CR         0xCED8
+#define GEN12_BLT_TLB_INV_CR         0xCEE4
+#define GEN12_TLB_INV_REQUEST        (1u << 0)
+
+// =============== GEN12 Tiger Lake BCS0 (copy engine) ===============
+// Same per-engine layout as the other rings, relative to the blitter base.
+// Its context-switch / user interrupts sit in the low half of the shared
+// render/copy GT interrupt enable and mask registers.
+#define TGL_BCS0_BASE                0x22000
+#define BCS0_RING_TAIL               (TGL_BCS0_BASE + 0x30)
+#define BCS0_RING_HEAD               (TGL_BCS0_BASE + 0x34)
+#define BCS0_HWS_PGA                 (TGL_BCS0_BASE + 0x80)
+#define BCS0_EXECLIST_SUBMITPORT_LO  (TGL_BCS0_BASE + 0x230)
+#define BCS0_EXECLIST_SUBMITPORT_HI  (TGL_BCS0_BASE + 0x234)
+#define BCS0_CSB_ADDR_LO             (TGL_BCS0_BASE + 0x2A0)
+#define BCS0_CSB_ADDR_HI             (TGL_BCS0_BASE + 0x2A4)
+#define BCS0_CSB_CTRL                (TGL_BCS0_BASE + 0x2A8)
+#define BCS0_CSB_PTR                 (TGL_BCS0_BASE + 0x3A0)
+#define BCS0_EXECLIST_SQ_CONTENTS    (TGL_BCS0_BASE + 0x510)
+#define BCS0_EXECLIST_PREEMPT        (TGL_BCS0_BASE + 0x550)
+
+#define GEN11_RENDER_COPY_INTR_ENABLE 0x190030
+#define GEN11_BCS_RSVD_INTR_MASK     0x1900A8
 #define RCS0_EXECLIST_CONTEXT_CONTROL 0x244C
 
 #define GEN6_RC_CONTROL              0xA090    // RC6 control
@@ -4,6 +4,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "fakeirisxe_user_shared.h"
 
@@ -144,6 +145,51 @@ int main() {
            presentOut.rc,
            (unsigned long long)presentOut.completionValue);
 
+    // 256x256 BGRA in our own pages, wrapped with no copy
+    const size_t upBytes = 256 * 256 * 4;
+    void* upMem = mmap(nullptr, upBytes, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (upMem != MAP_FAILED) {
+        memset(upMem, 0x80, upBytes);
+        FXE_UserptrCreate_In upIn = {};
+        upIn.address = (uint64_t)(uintptr_t)upMem;
+        upIn.length = upBytes;
+        upIn.width = 256;
+        upIn.height = 256;
+        FXE_UserptrCreate_Out upOut = {};
+        size_t outSz5 = sizeof(upOut);
+        kr = CallStruct(conn, FXE_SEL_USERPTR_CREATE, &upIn, sizeof(upIn), &upOut, &outSz5);
+        printf("{\"step\":\"UserptrCreate\",\"kr\":%d,\"rc\":%u,\"handle\":\"0x%llX\",\"gpu\":\"0x%llX\",\"surfaceId\":%llu}\n",
+               kr,
+               upOut.rc,
+               (unsigned long long)upOut.handle,
+               (unsigned long long)upOut.gpuAddr,
+               (unsigned long long)upOut.surfaceId);
+
+        FXE_UserptrRelease_In relIn = {upOut.handle};
+        FXE_UserptrRelease_Out relOut = {};
+        size_t outSz6 = sizeof(relOut);
+        kr = CallStruct(conn, FXE_SEL_USERPTR_RELEASE, &relIn, sizeof(relIn), &relOut, &outSz6);
+        printf("{\"step\":\"UserptrRelease\",\"kr\":%d,\"rc\":%u}\n", kr, relOut.rc);
+
+        // same pages, this time in the connection's own address space
+        upIn.width = 0;
+        upIn.height = 0;
+        upIn.flags = FXE_USERPTR_FLAG_PPGTT;
+        upOut = {};
+        outSz5 = sizeof(upOut);
+        kr = CallStruct(conn, FXE_SEL_USERPTR_CREATE, &upIn, sizeof(upIn), &upOut, &outSz5);
+        printf("{\"step\":\"UserptrCreatePpgtt\",\"kr\":%d,\"rc\":%u,\"handle\":\"0x%llX\",\"gpu\":\"0x%llX\"}\n",
+               kr,
+               upOut.rc,
+               (unsigned long long)upOut.handle,
+               (unsigned long long)upOut.gpuAddr);
+        relIn.handle = upOut.handle;
+        outSz6 = sizeof(relOut);
+        kr = CallStruct(conn, FXE_SEL_USERPTR_RELEASE, &relIn, sizeof(relIn), &relOut, &outSz6);
+        printf("{\"step\":\"UserptrReleasePpgtt\",\"kr\":%d,\"rc\":%u}\n", kr, relOut.rc);
+        munmap(upMem, upBytes);
+    }
+
     FXE_FenceTest_In fenceIn = {0, 2000};
     FXE_FenceTest_Out fenceOut = {};
     size_t outSz7 = sizeof(fenceOut);
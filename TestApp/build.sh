@@ -19,10 +19,73 @@ clang++ -std=c++17 -framework IOKit -framework IOSurface -framework CoreFoundati
     -o build/FakeIrisXETest \
     FakeIrisXETest.cpp
 
+# Host-only scheduler test (no IOKit, runs anywhere)
+clang++ -std=c++17 -I../FakeIrisXE \
+    -o build/fxe_sched_host_test \
+    fxe_sched_host_test.cpp
+
+# Host-only execlist core vs. software engine model (fuzz + benchmark)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_engine_model_test \
+    fxe_engine_model_test.cpp
+
+# Host-only GGTT address-space allocator (fragmentation + throughput)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_ggtt_host_test \
+    fxe_ggtt_host_test.cpp
+
+# Host-only buffer-object cache (buckets, eviction, hit rate)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_bocache_host_test \
+    fxe_bocache_host_test.cpp
+
+# Host-only batch-buffer sub-allocator (bump, fence retirement, fallback)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_batchpool_host_test \
+    fxe_batchpool_host_test.cpp
+
+# Host-only per-process page tables (lazy tables, batched flush, table pool)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_ppgtt_host_test \
+    fxe_ppgtt_host_test.cpp
+
+# Host-only per-client accounting (counters, quotas, owner-scoped eviction)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_account_host_test \
+    fxe_account_host_test.cpp
+
+# Host-only ring space accounting (reserve/commit, wrap padding, stalls, tail coalescing)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_ring_host_test \
+    fxe_ring_host_test.cpp
+
+# Host-only in-flight submission tracking (seqno order, coalesced retirement, full ring, chain pool reuse)
+clang++ -std=c++17 -O2 -I../FakeIrisXE \
+    -o build/fxe_submit_host_test \
+    fxe_submit_host_test.cpp
+
 echo "✅ Build complete:"
 echo "  - build/FakeIrisXETest"
 echo "  - build/fxe_compliance_test"
+echo "  - build/fxe_sched_host_test"
+echo "  - build/fxe_engine_model_test"
+echo "  - build/fxe_ggtt_host_test"
+echo "  - build/fxe_bocache_host_test"
+echo "  - build/fxe_batchpool_host_test"
+echo "  - build/fxe_ppgtt_host_test"
+echo "  - build/fxe_account_host_test"
+echo "  - build/fxe_ring_host_test"
+echo "  - build/fxe_submit_host_test"
 echo ""
 echo "Usage:"
 echo "  sudo ./build/FakeIrisXETest"
 echo "  sudo ./build/fxe_compliance_test"
+echo "  ./build/fxe_sched_host_test"
+echo "  ./build/fxe_engine_model_test [benchmark-requests]"
+echo "  ./build/fxe_ggtt_host_test [trace-ops] [pte-rounds] [session-uses]"
+echo "  ./build/fxe_bocache_host_test"
+echo "  ./build/fxe_batchpool_host_test"
+echo "  ./build/fxe_ppgtt_host_test"
+echo "  ./build/fxe_account_host_test"
+echo "  ./build/fxe_ring_host_test"
+echo "  ./build/fxe_submit_host_test [throughput-ops]"
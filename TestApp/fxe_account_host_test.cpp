@@ -0,0 +1,191 @@
+// Host-side test for per-client GPU memory accounting (FXE_ClientAccount.hpp)
+// and owner-scoped GGTT eviction (FXE_GgttEvictor::evictOwned).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_account_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FXE_ClientAccount.hpp"
+#include "FXE_Ggtt.hpp"
+
+static int gFailures = 0;
+static const uint64_t kKB = 1024;
+static const uint64_t kMB = 1024 * 1024;
+
+static void Report(const char* step, bool ok, const FXE_ClientAccount& a) {
+    const FXE_AccountStats st = a.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"allocatedKB\":%llu,\"mappedKB\":%llu,\"peakMappedKB\":%llu,"
+           "\"objects\":%u,\"softHits\":%llu,\"denied\":%llu}\n",
+           step, ok ? "true" : "false", (unsigned long long)(st.allocated / kKB),
+           (unsigned long long)(st.mapped / kKB), (unsigned long long)(st.peakMapped / kKB),
+           st.objects, (unsigned long long)st.softHits, (unsigned long long)st.denied);
+    if (!ok) gFailures++;
+}
+
+// Counters follow charges, peaks stay, no quota means never refused.
+static void TestCounters() {
+    static FXE_ClientAccount a;
+    a.init(42, "WindowServer-with-a-much-longer-name-than-fits");
+    bool ok = a.pid() == 42 && strlen(a.name()) == 31;
+    for (int i = 0; i < 8; ++i)
+        ok = ok && a.chargeAlloc(64 * kKB) == FXE_CHARGE_OK && a.chargeMap(64 * kKB) == FXE_CHARGE_OK;
+    for (int i = 0; i < 6; ++i) {
+        a.unchargeMap(64 * kKB);
+        a.unchargeAlloc(64 * kKB);
+    }
+    a.addContext();
+    a.addSurface();
+    a.addSurface();
+    a.removeSurface();
+    const FXE_AccountStats st = a.stats();
+    ok = ok && st.allocated == 128 * kKB && st.mapped == 128 * kKB && st.objects == 2;
+    ok = ok && st.peakAllocated == 512 * kKB && st.peakMapped == 512 * kKB;
+    ok = ok && st.contexts == 1 && st.surfaces == 1 && st.softHits == 0 && st.denied == 0;
+    Report("Counters", ok, a);
+}
+
+// Over soft: charged and flagged. Over hard: refused, nothing charged.
+static void TestQuotas() {
+    static FXE_ClientAccount a;
+    a.init(7, "quota");
+    a.setQuota(1 * kMB, 2 * kMB);
+    bool ok = a.chargeMap(768 * kKB) == FXE_CHARGE_OK && a.mappedOverSoft() == 0;
+    ok = ok && a.chargeMap(512 * kKB) == FXE_CHARGE_SOFT && a.mappedOverSoft() == 256 * kKB;
+    ok = ok && a.chargeMap(1 * kMB) == FXE_CHARGE_DENIED && a.stats().mapped == 1280 * kKB;
+    ok = ok && a.chargeMap(768 * kKB) == FXE_CHARGE_SOFT && a.stats().mapped == 2 * kMB;   // exactly at hard
+    ok = ok && a.chargeAlloc(4 * kMB) == FXE_CHARGE_DENIED && a.stats().objects == 0;
+    a.unchargeMap(2 * kMB);
+    ok = ok && a.mappedOverSoft() == 0 && a.chargeMap(4096) == FXE_CHARGE_OK;
+
+    a.setQuota(2 * kMB, 1 * kMB);               // soft above hard: hard only
+    ok = ok && a.chargeMap(512 * kKB) == FXE_CHARGE_OK;
+    ok = ok && a.stats().softHits == 2 && a.stats().denied == 2;
+    Report("Quotas", ok, a);
+}
+
+// Idle mappings tagged with their client; evictOwned only takes the
+// named client's, oldest first.
+struct Obj {
+    FXE_LruNode node;
+    uint64_t addr;
+    uint64_t size;
+    const void* owner;
+    bool pinned;
+};
+
+class SimEvict : public FXE_GgttEvictPlatform {
+public:
+    FXE_GgttSpace* space = nullptr;
+    uint64_t evict(void* p) override {
+        Obj* o = (Obj*)p;
+        if (o->pinned || !o->addr) return 0;
+        const uint64_t bytes = space->free(o->addr);
+        o->addr = 0;
+        return bytes;
+    }
+    const void* ownerOf(void* p) override { return ((Obj*)p)->owner; }
+};
+
+static void TestEvictOwned() {
+    static FXE_GgttSpace s;
+    static FXE_GgttEvictor ev;
+    SimEvict plat;
+    plat.space = &s;
+    s.init(0x100000, 0x100000 + 64 * 4096);
+    ev.init(&s, &plat);
+    int clientA = 0, clientB = 0;
+
+    static Obj o[12];
+    memset(o, 0, sizeof(o));
+    bool ok = true;
+    for (int i = 0; i < 12; ++i) {
+        o[i].size = 4096;
+        o[i].owner = (i % 3) ? (const void*)&clientA : (const void*)&clientB;
+        ok = ok && s.alloc(o[i].size, &o[i].addr);
+        ev.touch(&o[i].node, &o[i], o[i].addr);
+    }
+    o[1].pinned = true;                         // pinned again since it went idle
+    const uint64_t freed = ev.evictOwned(&clientA, 3 * 4096);
+    // A owns 1,2,4,5,7,8,10,11: 1 is busy, 2, 4 and 5 go
+    ok = ok && freed == 3 * 4096 && o[1].addr && !o[2].addr && !o[4].addr && !o[5].addr && o[7].addr;
+    ok = ok && o[0].addr && o[3].addr && ev.stats().busy == 1 && ev.stats().evictions == 3;
+    ok = ok && ev.evictOwned(&clientB, ~0ULL) == 4 * 4096 && ev.evictOwned(&clientB, 1) == 0;
+    printf("{\"step\":\"EvictOwned\",\"ok\":%s,\"evictions\":%llu,\"busy\":%llu,\"idle\":%u}\n",
+           ok ? "true" : "false", (unsigned long long)ev.stats().evictions,
+           (unsigned long long)ev.stats().busy, ev.stats().idle);
+    if (!ok) gFailures++;
+}
+
+// One client leaks mapped surfaces in a shared GGTT while another maps a
+// steady working set. Without a quota the leak takes the aperture and the
+// well-behaved client starts failing; with a hard quota the leaker is
+// refused at its limit and the other client never fails.
+static void TestLeakingClient(bool quota) {
+    const uint64_t aperture = 256 * kMB;
+    static FXE_GgttSpace s;
+    static FXE_GgttEvictor ev;
+    SimEvict plat;
+    plat.space = &s;
+    s.init(0, aperture);
+    ev.init(&s, &plat);
+
+    static FXE_ClientAccount leaker, good;
+    leaker.init(100, "leaker");
+    good.init(200, "good");
+    if (quota) {
+        leaker.setQuota(64 * kMB, 96 * kMB);
+        good.setQuota(64 * kMB, 96 * kMB);
+    }
+
+    uint64_t leakerDenied = 0, goodFailures = 0;
+    static Obj work[16];
+    memset(work, 0, sizeof(work));
+    for (uint32_t frame = 0; frame < 400; ++frame) {
+        // leaker: 1 MB a frame, never released
+        uint64_t a = 0;
+        if (leaker.chargeMap(kMB) == FXE_CHARGE_DENIED) leakerDenied++;
+        else if (!s.alloc(kMB, &a)) leaker.unchargeMap(kMB);
+
+        // good client: 16 x 2 MB surfaces remapped every frame
+        for (uint32_t i = 0; i < 16; ++i) {
+            Obj& w = work[i];
+            if (w.addr) continue;
+            w.size = 2 * kMB;
+            w.owner = &good;
+            if (good.chargeMap(w.size) == FXE_CHARGE_DENIED) {
+                goodFailures++;
+            } else if (!ev.alloc(w.size, 4096, 0, aperture, &w.addr)) {
+                good.unchargeMap(w.size);
+                goodFailures++;
+                w.addr = 0;
+            }
+        }
+        if (frame % 50 == 49) {                  // the good client frees its set now and then
+            for (uint32_t i = 0; i < 16; ++i) {
+                if (!work[i].addr) continue;
+                s.free(work[i].addr);
+                good.unchargeMap(work[i].size);
+                work[i].addr = 0;
+            }
+        }
+    }
+    const bool ok = quota ? goodFailures == 0 && leakerDenied > 0 && leaker.stats().mapped <= 96 * kMB
+                          : goodFailures > 0 && leakerDenied == 0;
+    printf("{\"step\":\"LeakingClient_%s\",\"ok\":%s,\"leakerMappedMB\":%llu,\"leakerDenied\":%llu,"
+           "\"goodFailures\":%llu,\"goodPeakMB\":%llu}\n",
+           quota ? "Quota" : "NoQuota", ok ? "true" : "false",
+           (unsigned long long)(leaker.stats().mapped / kMB), (unsigned long long)leakerDenied,
+           (unsigned long long)goodFailures, (unsigned long long)(good.stats().peakMapped / kMB));
+    if (!ok) gFailures++;
+}
+
+int main() {
+    TestCounters();
+    TestQuotas();
+    TestEvictOwned();
+    TestLeakingClient(false);
+    TestLeakingClient(true);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
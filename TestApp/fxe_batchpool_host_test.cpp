@@ -0,0 +1,180 @@
+// Host-side test for the batch-buffer sub-allocator (FXE_BatchPool.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_batchpool_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FXE_BatchPool.hpp"
+
+static int gFailures = 0;
+
+// Chunks are heap blocks at fake GGTT addresses; one timeline whose
+// completed seqno the test moves by hand.
+class HostPlatform : public FXE_BatchPoolPlatform {
+public:
+    uint64_t completed = 0;
+    uint32_t allocated = 0;
+    uint32_t released = 0;
+    uint32_t failAllocs = 0;    // refuse the next n chunk allocations
+
+    bool allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu) override {
+        if (failAllocs) {
+            failAllocs--;
+            return false;
+        }
+        void* p = malloc(bytes);
+        if (!p) return false;
+        *cookie = p;
+        *cpu = p;
+        *gpu = 0x100000ULL * (++allocated);
+        return true;
+    }
+    void releaseChunk(void* cookie) override {
+        released++;
+        free(cookie);
+    }
+    bool fenceDone(const FXE_Fence& f) override { return f.seqno <= completed; }
+};
+
+static FXE_Fence Fence(uint64_t seqno) {
+    FXE_Fence f = {};
+    f.seqno = seqno;
+    return f;
+}
+
+static void Report(const char* step, bool ok, const FXE_BatchPool& p) {
+    const FXE_BatchPoolStats& st = p.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"allocs\":%llu,\"chunks\":%u,\"chunkAllocs\":%llu,"
+           "\"rewinds\":%llu,\"exhausted\":%llu,\"aborts\":%llu}\n",
+           step, ok ? "true" : "false", (unsigned long long)st.allocs, st.chunks,
+           (unsigned long long)st.chunkAllocs, (unsigned long long)st.rewinds,
+           (unsigned long long)st.exhausted, (unsigned long long)st.aborts);
+    if (!ok) gFailures++;
+}
+
+// Slices are aligned, contiguous and share one chunk until it fills.
+static void TestBump() {
+    HostPlatform h;
+    static FXE_BatchPool p;
+    p.init(&h, 4096);
+    FXE_BatchSlice a, b, c;
+    bool ok = p.alloc(88, &a) && p.alloc(256, &b) && p.alloc(1, &c);
+    ok = ok && a.offset == 0 && a.bytes == 128 && b.offset == 128 && c.offset == 384;
+    ok = ok && b.gpu == a.gpu + 128 && (uint8_t*)c.cpu == (uint8_t*)a.cpu + 384;
+    ok = ok && a.gpu % FXE_BatchPool::kAlign == 0 && h.allocated == 1;
+    p.commit(a, Fence(1));
+    p.commit(b, Fence(2));
+    p.commit(c, Fence(3));
+
+    FXE_BatchSlice big;
+    ok = ok && !p.alloc(8192, &big) && p.stats().tooLarge == 1;
+    ok = ok && p.alloc(4096 - 448, &big) && big.chunk == 0;       // exactly fills it
+    p.commit(big, Fence(4));
+    p.drain();
+    ok = ok && h.released == 1 && p.chunkCount() == 0;
+    Report("Bump", ok, p);
+}
+
+// A full chunk is only rewound once its last fence is done and nothing
+// taken from it is still uncommitted; until then the pool grows.
+static void TestRetire() {
+    HostPlatform h;
+    static FXE_BatchPool p;
+    p.init(&h, 1024);
+    FXE_BatchSlice s[16];
+    uint64_t seq = 0;
+    bool ok = true;
+    for (int i = 0; i < 16; ++i) {                      // 4 chunks of 4 slices
+        ok = ok && p.alloc(256, &s[i]);
+        p.commit(s[i], Fence(++seq));
+    }
+    ok = ok && h.allocated == 4 && s[4].chunk == 1 && s[15].chunk == 3;
+
+    FXE_BatchSlice x;
+    ok = ok && !p.alloc(64, &x) && p.stats().exhausted == 1;      // all busy, at kMaxChunks
+    h.completed = 3;                                               // chunk 0 not done (seq 4)
+    ok = ok && !p.alloc(64, &x);
+    h.completed = 4;
+    ok = ok && p.alloc(64, &x) && x.chunk == 0 && x.offset == 0 && p.stats().rewinds == 1;
+
+    // chunk 0 now has an open slice: even with everything done it is skipped
+    h.completed = seq;
+    FXE_BatchSlice y[16];
+    int n = 0;
+    while (n < 16 && p.alloc(1024, &y[n])) {
+        p.commit(y[n], Fence(++seq));
+        n++;
+    }
+    ok = ok && n == 3 && y[0].chunk == 1 && y[2].chunk == 3;
+    p.commit(x, Fence(++seq));
+    h.completed = seq;
+    ok = ok && p.alloc(1024, &x) && x.chunk == 0;
+    p.commit(x, Fence(++seq));
+    p.drain();
+    ok = ok && h.released == h.allocated;
+    Report("Retire", ok, p);
+}
+
+// A failed submit gives its slice back when it was the latest; chunk
+// allocation failure is reported, not fatal.
+static void TestAbort() {
+    HostPlatform h;
+    static FXE_BatchPool p;
+    p.init(&h, 1024);
+    FXE_BatchSlice a, b, c;
+    bool ok = p.alloc(64, &a) && p.alloc(64, &b);
+    p.abort(b);
+    ok = ok && p.alloc(64, &c) && c.offset == b.offset;          // reused
+    p.abort(a);                                                    // not the latest: a hole
+    p.commit(c, Fence(1));
+    ok = ok && p.alloc(64, &b) && b.offset == 128 && p.stats().aborts == 2;
+    p.commit(b, Fence(2));
+
+    h.failAllocs = 1;
+    FXE_BatchSlice full;
+    ok = ok && !p.alloc(1024, &full) && p.stats().exhausted == 1;  // chunk 0 busy, grow failed
+    ok = ok && p.alloc(1024, &full) && full.chunk == 1;
+    p.commit(full, Fence(3));
+    p.drain();
+    ok = ok && h.released == h.allocated;
+    Report("Abort", ok, p);
+}
+
+// Compositing-style traffic: one small blit batch per submission with
+// `inFlight` requests outstanding. Without the pool every one of them is
+// a GEM allocation, pin and GGTT map.
+static void TestBlitTraffic(uint32_t submissions) {
+    HostPlatform h;
+    static FXE_BatchPool p;
+    p.init(&h, 64 * 1024);
+    const uint32_t inFlight = 64;
+    static const uint32_t sizes[] = { 256, 128, 64, 8 * 80 + 64 };
+    uint64_t seq = 0, fallbacks = 0;
+    for (uint32_t i = 0; i < submissions; ++i) {
+        FXE_BatchSlice s;
+        if (!p.alloc(sizes[i % 4], &s)) {
+            fallbacks++;
+        } else {
+            memset(s.cpu, 0, 8);
+            p.commit(s, Fence(++seq));
+        }
+        if (seq > inFlight) h.completed = seq - inFlight;
+    }
+    p.drain();
+    const bool ok = fallbacks == 0 && h.allocated <= 2 && h.released == h.allocated;
+    printf("{\"step\":\"BlitTraffic\",\"ok\":%s,\"submissions\":%u,\"chunkAllocs\":%u,"
+           "\"withoutPool\":%u,\"rewinds\":%llu,\"fallbacks\":%llu}\n",
+           ok ? "true" : "false", submissions, h.allocated, submissions,
+           (unsigned long long)p.stats().rewinds, (unsigned long long)fallbacks);
+    if (!ok) gFailures++;
+}
+
+int main() {
+    TestBump();
+    TestRetire();
+    TestAbort();
+    TestBlitTraffic(100000);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
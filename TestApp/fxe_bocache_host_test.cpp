@@ -0,0 +1,136 @@
+// Host-side test for the buffer-object cache (FXE_BoCache.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_bocache_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FXE_BoCache.hpp"
+
+static int gFailures = 0;
+
+// Objects are heap blocks tagged with their size; release() frees them.
+class HostPlatform : public FXE_BoCachePlatform {
+public:
+    uint64_t released = 0;
+    uint64_t allocated = 0;
+
+    void* alloc(uint64_t bytes) {
+        uint64_t* o = (uint64_t*)malloc(sizeof(uint64_t));
+        *o = bytes;
+        allocated++;
+        return o;
+    }
+    void release(void* obj) override {
+        released++;
+        free(obj);
+    }
+};
+
+static void Report(const char* step, bool ok, const FXE_BoCache& c) {
+    const FXE_BoCacheStats& st = c.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"lookups\":%llu,\"hits\":%llu,\"hitRatePermille\":%u,"
+           "\"bytesCached\":%llu,\"evictedAge\":%llu,\"evictedBudget\":%llu,\"evictedTrim\":%llu}\n",
+           step, ok ? "true" : "false", (unsigned long long)st.lookups, (unsigned long long)st.hits,
+           c.hitRatePermille(), (unsigned long long)st.bytesCached,
+           (unsigned long long)st.evictedAge, (unsigned long long)st.evictedBudget,
+           (unsigned long long)st.evictedTrim);
+    if (!ok) gFailures++;
+}
+
+// Buckets, LIFO reuse, rejects.
+static void TestBuckets() {
+    HostPlatform p;
+    static FXE_BoCache c;
+    c.init(&p, 1 << 20, 1000);
+    bool ok = FXE_BoCache::bucketFor(64) == 0 && FXE_BoCache::bucketFor(4096) == 0;
+    ok = ok && FXE_BoCache::bucketFor(4097) == 1 && FXE_BoCache::bucketFor(1 << 20) == 8;
+    ok = ok && FXE_BoCache::bucketFor((1 << 20) + 1) == -1;
+    ok = ok && FXE_BoCache::roundUp(256) == 4096 && FXE_BoCache::roundUp(3 << 20) == (3u << 20);
+
+    void* a = p.alloc(4096);
+    void* b = p.alloc(4096);
+    void* big = p.alloc(8192);
+    ok = ok && c.get(64) == nullptr;                            // miss
+    ok = ok && c.put(a, 4096, 1) && c.put(b, 4096, 2) && c.put(big, 8192, 3);
+    ok = ok && c.stats().bytesCached == 16384 && c.count() == 3;
+    ok = ok && c.get(100) == b && c.get(4096) == a && c.get(4096) == nullptr;   // newest first
+    ok = ok && c.get(5000) == big;
+
+    void* odd = p.alloc(6000);
+    ok = ok && !c.put(odd, 6000, 4) && c.stats().rejects == 1; // not a bucket size
+    p.release(odd);
+    p.release(a);
+    p.release(b);
+    p.release(big);
+    ok = ok && c.stats().bytesCached == 0 && c.hitRatePermille() == 600;   // 3 of 5
+    Report("Buckets", ok, c);
+}
+
+// Age, budget and trim all drop oldest first and hand objects to release().
+static void TestEviction() {
+    HostPlatform p;
+    static FXE_BoCache c;
+    c.init(&p, 4 * 4096, 100);
+    for (uint64_t t = 0; t < 4; ++t)
+        c.put(p.alloc(4096), 4096, t * 10);                    // parked at 0, 10, 20, 30
+    bool ok = c.count() == 4 && c.reap(105) == 1 && p.released == 1;   // the one from t=0
+    ok = ok && c.reap(125) == 2 && c.count() == 1;
+
+    c.put(p.alloc(8192), 8192, 200);
+    c.put(p.alloc(8192), 8192, 210);                            // 4K + 16K > budget: the 4K one goes
+    ok = ok && c.stats().evictedBudget == 1 && c.stats().bytesCached == 16384;
+    ok = ok && c.get(4096) == nullptr && c.count() == 2;
+
+    for (uint32_t i = 0; i < FXE_BoCache::kPerBucket + 2; ++i)  // bucket full: oldest of it goes
+        c.put(p.alloc(4096), 4096, 300 + i);
+    ok = ok && c.stats().bytesCached <= 4 * 4096;
+
+    ok = ok && c.trim(4096) > 0 && c.stats().bytesCached <= 4096;
+    ok = ok && c.trim(0) == 1 && c.count() == 0;
+    ok = ok && p.released == p.allocated;
+    Report("Eviction", ok, c);
+}
+
+// Chain submissions: a tail and a master batch each, released `lag`
+// submissions later, with a reap every `reapEvery`. Without the cache each
+// would be an allocate + pin + map.
+static void TestChainTraffic(uint32_t submissions) {
+    HostPlatform p;
+    static FXE_BoCache c;
+    const uint64_t msPerSubmit = 2;                             // ~500 submits/s
+    c.init(&p, 8 << 20, 2000ULL * 1000000);
+    const uint32_t lag = 8, reapEvery = 500;
+    void* inflight[lag][2] = {};
+    for (uint32_t i = 0; i < submissions; ++i) {
+        const uint64_t now = (uint64_t)i * msPerSubmit * 1000000;
+        if (i % reapEvery == 0) c.reap(now);
+        void*(&slot)[2] = inflight[i % lag];
+        for (void*& o : slot) {
+            if (o && !c.put(o, 4096, now)) p.release(o);
+            o = c.get(4096);
+            if (!o) o = p.alloc(4096);
+        }
+        if (i == submissions / 2) {                             // a 10 s idle gap
+            c.reap(now + 10000ULL * 1000000);
+        }
+    }
+    for (auto& slot : inflight)
+        for (void* o : slot)
+            if (o) p.release(o);
+    c.trim(0);
+    const bool ok = c.hitRatePermille() > 990 && p.allocated <= 4 * lag && p.released == p.allocated;
+    printf("{\"step\":\"ChainTraffic\",\"ok\":%s,\"submissions\":%u,\"allocations\":%llu,"
+           "\"withoutCache\":%u,\"hitRatePermille\":%u,\"peakBytesCached\":%llu}\n",
+           ok ? "true" : "false", submissions, (unsigned long long)p.allocated, submissions * 2,
+           c.hitRatePermille(), (unsigned long long)c.stats().peakBytesCached);
+    if (!ok) gFailures++;
+}
+
+int main() {
+    TestBuckets();
+    TestEviction();
+    TestChainTraffic(100000);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
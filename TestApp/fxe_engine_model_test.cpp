@@ -0,0 +1,784 @@
+// Host-side test and benchmark for the execlist core (FXE_ExecCore.hpp)
+// running against the software engine model (FXE_EngineModel.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_engine_model_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "FXE_ExecCore.hpp"
+#include "FXE_EngineModel.hpp"
+#include "FXE_Timeline.hpp"
+
+static const uint32_t kContexts  = 8;
+static const uint32_t kMaxSeqno  = 1u << 20;
+
+// Per-request work is keyed by seqno so a resubmitted request keeps its size.
+struct Model : FXE_EngineModel {
+    uint64_t* work = nullptr;
+    uint64_t execNs(uint32_t ctxId, uint32_t seqno) override {
+        if (work && seqno < kMaxSeqno && work[seqno]) return work[seqno];
+        return FXE_EngineModel::execNs(ctxId, seqno);
+    }
+};
+
+// Decodes FXE_RequestCmds output: an optional semaphore wait (returned in
+// *semAddr/*semValue, 0 if none), the batch start, then the engine's
+// post-sync qword write of the breadcrumb (if addr), MI_NOOP padding.
+static uint64_t Qword(const uint32_t* cs) { return ((uint64_t)cs[1] << 32) | cs[0]; }
+
+static bool CheckCmds(const uint32_t* cs, uint32_t n, bool pipeControl, uint64_t batch,
+                      uint64_t addr, uint64_t value, uint64_t* semAddr, uint32_t* semValue) {
+    *semAddr = 0;
+    *semValue = 0;
+    if ((n & 1) || n > FXE_RequestCmds::kMaxDwords) return false;
+    uint32_t i = 0;
+    if (cs[i] == (MI_SEMAPHORE_WAIT | MI_SEMAPHORE_GLOBAL_GTT | MI_SEMAPHORE_POLL | MI_SEMAPHORE_SAD_GTE_SDD)) {
+        *semValue = cs[i + 1];
+        *semAddr = Qword(cs + i + 2);
+        if (!*semAddr) return false;
+        i += 4;
+    }
+    if (cs[i] != MI_BATCH_BUFFER_START || Qword(cs + i + 1) != batch) return false;
+    i += 3;
+    if (addr && pipeControl) {
+        const uint32_t need = PIPE_CONTROL_CS_STALL | PIPE_CONTROL_POST_SYNC_WRITE | PIPE_CONTROL_GLOBAL_GTT_IVB;
+        if (cs[i] != GFX_OP_PIPE_CONTROL(6) || (cs[i + 1] & need) != need) return false;
+        if (Qword(cs + i + 2) != addr || Qword(cs + i + 4) != value) return false;
+        i += 6;
+    } else if (addr) {
+        if (cs[i] != (MI_FLUSH_DW | MI_FLUSH_DW_OP_STOREDW | 3) || !(cs[i + 1] & MI_FLUSH_DW_USE_GTT)) return false;
+        if ((Qword(cs + i + 1) & ~7ULL) != addr || Qword(cs + i + 3) != value) return false;
+        i += 5;
+    }
+    while (i < n)
+        if (cs[i++] != MI_NOOP) return false;
+    return true;
+}
+
+// Plays FakeIrisXEExeclist's role: owns the buffers and the per-slot state.
+struct Host : FXE_ExecPlatform {
+    Model         model;
+    FXE_ExecCore  core;
+    FXE_EngineRegs regs;
+    uint32_t      engine = 0;           // engine class stamped on fences
+    Host*         peer = nullptr;       // other engine, for cross-engine fences
+
+    uint8_t*  desc = nullptr;
+    uint64_t* csb = nullptr;
+    uint8_t*  hwsp = nullptr;
+    uint8_t*  lrc[kContexts + 1];
+    uint64_t  lrcGGTT[kContexts + 1];
+    uint8_t*  batch = nullptr;
+    uint64_t  batchGGTT = 0;
+    uint8_t*  status = nullptr;         // fence timeline page, timeline = ctxId
+    FXE_TimelinePage timeline;
+
+    struct Slot { uint32_t ctxId; uint32_t seqno; FXE_Fence fence; bool used; };
+    Slot      slot[FXE_Scheduler::kCapacity];
+
+    uint64_t  timerAt = UINT64_MAX;
+    uint64_t  mmioReads = 0, mmioWrites = 0;
+    uint8_t*  retired = nullptr;        // per seqno: times retired
+    uint8_t*  emits = nullptr;          // per seqno: times its ring commands were emitted
+    uint64_t* retiredAt = nullptr;
+    uint32_t* retireStatus = nullptr;
+    uint32_t  lastRetired[kContexts + 1];
+    bool      bannedSeen[kContexts + 1];
+    uint64_t  submitted = 0, completed = 0, faulted = 0, cancelled = 0, hung = 0, emitted = 0;
+    uint64_t  semAddr = 0, semEmitted = 0;  // last semaphoreFor() answer, waits put in the ring
+    uint32_t  semValue = 0;
+    bool      orderViolation = false, doubleRetire = false, bannedSubmit = false;
+    bool      slotMismatch = false, fenceMismatch = false, cmdMismatch = false;
+
+    static void* alloc(size_t n) {
+        void* p = nullptr;
+        if (posix_memalign(&p, 4096, n) != 0) return nullptr;
+        memset(p, 0, n);
+        return p;
+    }
+
+    // useHwsp: drain from the status-page write pointer instead of the
+    // CSB pointer register (the kext reads the register).
+    void init(bool useHwsp = false, const FXE_EngineRegs& r = FXE_EngineRegs::rcs0(),
+              uint64_t ggttBase = FXE_EngineModel::kGgttBase) {
+        regs = r;
+        model.init(regs, ggttBase);
+        core.init(this, regs);
+
+        desc = (uint8_t*)alloc(4096);
+        csb = (uint64_t*)alloc(256);
+        hwsp = (uint8_t*)alloc(4096);
+        batch = (uint8_t*)alloc(4096);
+        status = (uint8_t*)alloc(4096);
+        for (uint32_t c = 1; c <= kContexts; ++c) {
+            lrc[c] = (uint8_t*)alloc(4096);
+            lrcGGTT[c] = model.ggttMap(lrc[c], 4096);
+        }
+        batchGGTT = model.ggttMap(batch, 4096);
+        timeline.init(status, model.ggttMap(status, 4096), 4096);
+
+        // Same programming order as createHwContext/setupExeclistPorts
+        const uint64_t csbGGTT = model.ggttMap(csb, 256);
+        write32(regs.csbAddrLo, (uint32_t)csbGGTT);
+        write32(regs.csbAddrHi, (uint32_t)(csbGGTT >> 32));
+        model.setCsbEntries(16);
+        if (useHwsp) {
+            write32(regs.hwsPga, (uint32_t)model.ggttMap(hwsp, 4096));
+            core.setCsb(csb, 16, (const volatile uint32_t*)(hwsp + HWS_CSB_WRITE_INDEX * 4));
+        } else {
+            core.setCsb(csb, 16);
+        }
+        core.setDescriptorPage(desc, model.ggttMap(desc, 4096));
+
+        memset(slot, 0, sizeof(slot));
+        memset(lastRetired, 0, sizeof(lastRetired));
+        memset(bannedSeen, 0, sizeof(bannedSeen));
+        retired = (uint8_t*)calloc(kMaxSeqno, 1);
+        emits = (uint8_t*)calloc(kMaxSeqno, 1);
+        retireStatus = (uint32_t*)calloc(kMaxSeqno, sizeof(uint32_t));
+        retiredAt = (uint64_t*)calloc(kMaxSeqno, sizeof(uint64_t));
+        model.work = (uint64_t*)calloc(kMaxSeqno, sizeof(uint64_t));
+    }
+
+    void destroy() {
+        free(desc); free(csb); free(hwsp); free(batch); free(status);
+        for (uint32_t c = 1; c <= kContexts; ++c) free(lrc[c]);
+        free(retired); free(emits); free(retireStatus); free(retiredAt); free(model.work);
+    }
+
+    // ---- FXE_ExecPlatform ----
+    uint32_t read32(uint32_t off) override { mmioReads++; return model.read32(off); }
+    void write32(uint32_t off, uint32_t val) override { mmioWrites++; model.write32(off, val); }
+    uint64_t nowNs() override { return model.now(); }
+
+    uint32_t savedRingHead(int32_t s) override {
+        return *(uint32_t*)(lrc[slot[s].ctxId] + FXE_EngineModel::kLrcRingHeadOffset);
+    }
+    void restoreRingHead(int32_t s, uint32_t head) override {
+        *(uint32_t*)(lrc[slot[s].ctxId] + FXE_EngineModel::kLrcRingHeadOffset) = head;
+    }
+
+    // Checked, not written: the model runs the descriptor and keeps its
+    // progress in the LRC head, so there is no ring offset to hand back.
+    bool emitRequest(int32_t s, const uint32_t* cs, uint32_t n, uint32_t* outTail) override {
+        const Slot& sl = slot[s];
+        if (emits[sl.seqno]++) cmdMismatch = true;
+        const uint64_t post = sl.fence.seqno ? timeline.breadcrumbGGTT(sl.fence.timeline) : 0;
+        uint64_t wAddr;
+        uint32_t wValue;
+        if (!CheckCmds(cs, n, regs.pipeControl, batchGGTT, post, sl.fence.seqno, &wAddr, &wValue))
+            cmdMismatch = true;
+        if (wAddr) {
+            if (wAddr != semAddr || wValue != semValue) cmdMismatch = true;
+            semEmitted++;
+        }
+        emitted++;
+        *outTail = 0;
+        return true;
+    }
+
+    void retire(int32_t s, uint32_t status) override {
+        Slot& sl = slot[s];
+        if (!sl.used || core.sched().request(s).seqno != sl.seqno) slotMismatch = true;
+        // Only work that reached a port was put in the ring
+        if (emits[sl.seqno] != ((status & FXE_EXEC_CANCELLED) ? 0 : 1)) cmdMismatch = true;
+        if (retired[sl.seqno]++) doubleRetire = true;
+        retireStatus[sl.seqno] = status;
+        retiredAt[sl.seqno] = model.now();
+        if (sl.seqno <= lastRetired[sl.ctxId]) orderViolation = true;
+        lastRetired[sl.ctxId] = sl.seqno;
+        if (status & FXE_EXEC_CANCELLED) cancelled++;
+        else if (status & FXE_EXEC_HANG) hung++;
+        else if (status & FXE_CSB_FAULT) faulted++;
+        else completed++;
+
+        // Same bookkeeping as FakeIrisXEExecPlatform::retire(): the breadcrumb
+        // is already in the page for completions, errors are CPU-recorded.
+        if (status & (FXE_CSB_FAULT | FXE_EXEC_HANG | FXE_EXEC_CANCELLED)) {
+            if (timeline.state(sl.fence) != FXE_FENCE_PENDING) fenceMismatch = true;
+            timeline.markError(sl.fence.timeline, sl.fence.seqno);
+            if (timeline.state(sl.fence) != FXE_FENCE_ERROR) fenceMismatch = true;
+        } else if (timeline.state(sl.fence) != FXE_FENCE_SIGNALED) {
+            fenceMismatch = true;
+        }
+        sl.used = false;
+        // FakeIrisXEFramebuffer::fenceRetired(): poke the other engine
+        if (peer && peer->core.held() && peer->timerAt > peer->model.now())
+            peer->timerAt = peer->model.now();
+    }
+
+    void armTimer(uint64_t deadlineNs) override { timerAt = deadlineNs; }
+
+    // Same register sequence as FakeIrisXEExeclist::resetEngine()
+    bool resetEngine(const FXE_EngineRegs& r) override {
+        write32(r.resetCtl, (RESET_CTL_REQUEST_RESET << 16) | RESET_CTL_REQUEST_RESET);
+        if (!(read32(r.resetCtl) & RESET_CTL_READY_TO_RESET)) return false;
+        write32(GEN6_GDRST, r.resetDomain);
+        const bool ok = !(read32(GEN6_GDRST) & r.resetDomain);
+        write32(r.resetCtl, RESET_CTL_REQUEST_RESET << 16);
+        return ok;
+    }
+
+    const FXE_TimelinePage* timelineFor(uint32_t eng) const {
+        if (eng == engine) return &timeline;
+        return peer && peer->engine == eng ? &peer->timeline : nullptr;
+    }
+
+    int32_t fenceState(const FXE_Fence& f) override {
+        const FXE_TimelinePage* tl = timelineFor(f.engine);
+        return tl ? tl->state(f) : FXE_FENCE_ERROR;
+    }
+
+    // Same rule as FakeIrisXEExeclist::depSemaphore(): only for a request
+    // already on one of the other engine's ports, within the breadcrumb's
+    // current high dword.
+    uint64_t semaphoreFor(const FXE_Fence& f) override {
+        if (!peer || f.engine != peer->engine) return 0;
+        if ((peer->timeline.hwSeqno(f.timeline) >> 32) != (f.seqno >> 32)) return 0;
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            const int32_t s = peer->core.sched().port(p).req;
+            if (s >= 0 && peer->slot[s].fence.timeline == f.timeline && peer->slot[s].fence.seqno == f.seqno) {
+                semAddr = peer->timeline.breadcrumbGGTT(f.timeline);
+                semValue = (uint32_t)f.seqno;
+                return semAddr;
+            }
+        }
+        return 0;
+    }
+
+    void event(uint32_t ev, uint32_t ctxId, uint32_t, int32_t) override {
+        if (ev == FXE_EXEC_EV_BANNED) bannedSeen[ctxId] = true;
+        if ((ev == FXE_EXEC_EV_SUBMIT || ev == FXE_EXEC_EV_RESUBMIT) && bannedSeen[ctxId])
+            bannedSubmit = true;
+    }
+
+    // ---- driver ----
+    int32_t submit(uint32_t ctxId, uint32_t prio, uint64_t workNs, FXE_Fence* outFence = nullptr,
+                   const FXE_Fence* deps = nullptr, uint32_t depCount = 0) {
+        uint32_t seqno = 0;
+        const uint64_t fenceSeqno = timeline.alloc(ctxId);
+        int32_t s = core.enqueue(ctxId, prio, lrcGGTT[ctxId], batchGGTT, &seqno,
+                                 timeline.breadcrumbGGTT(ctxId), fenceSeqno, deps, depCount);
+        if (s < 0) {
+            timeline.unalloc(ctxId, fenceSeqno);
+            return -1;
+        }
+        slot[s].ctxId = ctxId;
+        slot[s].seqno = seqno;
+        slot[s].fence.timeline = ctxId;
+        slot[s].fence.seqno = fenceSeqno;
+        slot[s].fence.engine = engine;
+        slot[s].used = true;
+        if (outFence) *outFence = slot[s].fence;
+        model.work[seqno] = workNs;
+        submitted++;
+        core.kick();
+        return s;
+    }
+
+    uint64_t nextNs() const {
+        const uint64_t t = model.nextEventNs();
+        return timerAt < t ? timerAt : t;
+    }
+
+    // Move to the next engine event or timer (bounded by `limit`), then run
+    // the IRQ / timer paths like engineIrq() and timesliceFired() do.
+    void advance(uint64_t limit) {
+        uint64_t t = model.nextEventNs();
+        if (timerAt < t) t = timerAt;
+        if (limit < t) t = limit;
+        if (t < model.now()) t = model.now();
+        model.advanceTo(t);
+        deliver();
+    }
+
+    void deliver() {
+        if (model.takeIrq() & (RCS_INTR_COMPLETE | RCS_INTR_CTX_SWITCH | RCS_INTR_FAULT))
+            core.processCsb();
+        if (timerAt <= model.now()) {
+            timerAt = UINT64_MAX;
+            core.kick();
+        }
+    }
+
+    bool idle() const { return core.sched().idle() && model.idle(); }
+
+    bool drain(uint64_t budgetNs) {
+        const uint64_t until = model.now() + budgetNs;
+        while (!idle() && model.now() < until) advance(until);
+        return idle();
+    }
+
+    bool invariantsOk() const {
+        const FXE_EngineModelStats& ms = model.stats();
+        return !orderViolation && !doubleRetire && !bannedSubmit && !slotMismatch &&
+               !fenceMismatch && !cmdMismatch && ms.badPostSync == 0 && ms.badSemaphore == 0 &&
+               ms.csbOverflow == 0 && ms.elspOverflow == 0 && ms.badDescriptor == 0 &&
+               core.stats().staleCsb == 0;
+    }
+};
+
+static uint64_t gRng = 0x9E3779B97F4A7C15ULL;
+static uint64_t Rand() {
+    gRng ^= gRng << 13;
+    gRng ^= gRng >> 7;
+    gRng ^= gRng << 17;
+    return gRng;
+}
+static uint64_t RandRange(uint64_t lo, uint64_t hi) { return lo + Rand() % (hi - lo + 1); }
+
+static int gFailures = 0;
+
+static void Report(const char* step, bool ok, const Host& h) {
+    const FXE_EngineModelStats& ms = h.model.stats();
+    const FXE_SchedStats& ss = h.core.sched().stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"submitted\":%llu,\"completed\":%llu,\"faulted\":%llu,"
+           "\"hung\":%llu,\"cancelled\":%llu,\"preempted\":%llu,\"resubmitted\":%llu,\"elsp\":%llu,"
+           "\"simTimeNs\":%llu}\n",
+           step, ok ? "true" : "false",
+           (unsigned long long)h.submitted, (unsigned long long)h.completed,
+           (unsigned long long)h.faulted, (unsigned long long)h.hung, (unsigned long long)h.cancelled,
+           (unsigned long long)ms.preempted, (unsigned long long)ss.resubmitted,
+           (unsigned long long)ms.elspSubmits, (unsigned long long)h.model.now());
+    if (!ok) gFailures++;
+}
+
+// One request: ELSP write -> COMPLETE CSB after switch + exec time.
+static void TestBasic() {
+    Host h;
+    h.init();
+    h.model.setSwitchNs(2000);
+    int32_t s = h.submit(1, FXE_SCHED_PRIO_NORMAL, 100000);
+    bool ok = s >= 0 && h.model.inflight() == 1;
+    ok = ok && h.drain(10000000) && h.completed == 1;
+    ok = ok && h.model.now() == 102000 && h.core.csbReadIndex() == 1 && h.emitted == 1;
+    ok = ok && h.invariantsOk();
+    Report("Basic", ok, h);
+    h.destroy();
+}
+
+// Render and copy engines are separate execlists (registers, CSB, ports,
+// scheduler). Stepped on one clock, a stream of short blits on BCS0
+// finishes while a long render request is still running on RCS0.
+static void TestCopyEngine() {
+    const FXE_EngineRegs r = FXE_EngineRegs::rcs0();
+    const FXE_EngineRegs b = FXE_EngineRegs::bcs0();
+    const uint32_t* rr = &r.submitLo;
+    const uint32_t* br = &b.submitLo;
+    const uint32_t nregs = (uint32_t)(offsetof(FXE_EngineRegs, resetDomain) / sizeof(uint32_t));
+    bool ok = b.resetDomain != r.resetDomain;
+    for (uint32_t i = 0; i < nregs; ++i)
+        for (uint32_t j = 0; j < nregs; ++j)
+            if (br[i] == rr[j]) ok = false;
+
+    Host rcs, bcs;
+    rcs.init();
+    bcs.init(false, b);
+    const uint32_t kBlits = 8;
+    ok = ok && rcs.submit(1, FXE_SCHED_PRIO_NORMAL, 2000000) >= 0;
+    for (uint32_t i = 0; i < kBlits; ++i)
+        ok = ok && bcs.submit(1, FXE_SCHED_PRIO_HIGH, 50000) >= 0;
+
+    uint64_t blitsDoneNs = 0;
+    for (uint32_t steps = 0; ok && !(rcs.idle() && bcs.idle()) && steps < 10000; ++steps) {
+        const uint64_t a = rcs.nextNs(), c = bcs.nextNs();
+        const uint64_t t = a < c ? a : c;
+        rcs.advance(t);
+        bcs.advance(t);
+        if (!blitsDoneNs && bcs.completed == kBlits) blitsDoneNs = bcs.model.now();
+    }
+    const uint64_t renderDoneNs = rcs.model.now();
+    ok = ok && rcs.idle() && bcs.idle() && rcs.completed == 1 && bcs.completed == kBlits;
+    ok = ok && rcs.emitted == 1 && bcs.emitted == kBlits;
+    ok = ok && blitsDoneNs && blitsDoneNs < renderDoneNs;
+    ok = ok && rcs.invariantsOk() && bcs.invariantsOk();
+    printf("{\"step\":\"CopyEngine\",\"ok\":%s,\"blits\":%u,\"blitsDoneNs\":%llu,\"renderDoneNs\":%llu}\n",
+           ok ? "true" : "false", kBlits, (unsigned long long)blitsDoneNs,
+           (unsigned long long)renderDoneNs);
+    if (!ok) gFailures++;
+    rcs.destroy();
+    bcs.destroy();
+}
+
+// Lets rcs and bcs see each other's fences: each status page is mapped
+// into the other model at its own GGTT address, as the kext's shared GGTT
+// does.
+static void Link(Host& rcs, Host& bcs) {
+    bcs.engine = 1;
+    rcs.peer = &bcs;
+    bcs.peer = &rcs;
+    rcs.model.ggttMapAt(bcs.status, 4096, bcs.timeline.breadcrumbGGTT(0));
+    bcs.model.ggttMapAt(rcs.status, 4096, rcs.timeline.breadcrumbGGTT(0));
+}
+
+static void Lockstep(Host& a, Host& b, bool* ok) {
+    for (uint32_t steps = 0; !(a.idle() && b.idle()) && steps < 1000000; ++steps) {
+        const uint64_t x = a.nextNs(), y = b.nextNs();
+        const uint64_t t = x < y ? x : y;
+        if (t == UINT64_MAX) break;
+        a.advance(t);
+        b.advance(t);
+    }
+    *ok = *ok && a.idle() && b.idle();
+}
+
+// Input fences. Same engine: a held request lets an independent context
+// run ahead of it while its own context's later work waits behind it; a
+// failed input fails the request. Across engines: a fence already running
+// on RCS becomes a semaphore in the BCS descriptor, one still queued
+// holds the blit until RCS retires it.
+static void TestDependencies() {
+    bool ok = true;
+    {
+        Host h;
+        h.init();
+        FXE_Fence a, b, c, d;
+        h.submit(1, FXE_SCHED_PRIO_NORMAL, 500000, &a);
+        const uint32_t bs = h.slot[h.submit(2, FXE_SCHED_PRIO_NORMAL, 100000, &b, &a, 1)].seqno;
+        const uint32_t cs = h.slot[h.submit(2, FXE_SCHED_PRIO_HIGH, 100000, &c)].seqno;
+        const uint32_t ds = h.slot[h.submit(3, FXE_SCHED_PRIO_NORMAL, 100000, &d)].seqno;
+        ok = ok && h.core.held() == 1 && h.core.stats().depHeld == 1;
+        ok = ok && h.drain(100000000) && h.completed == 4 && h.core.held() == 0;
+        ok = ok && h.retiredAt[ds] < h.retiredAt[bs] && h.retiredAt[bs] < h.retiredAt[cs];
+        ok = ok && h.retiredAt[bs] > h.retiredAt[1];
+
+        h.model.injectFault(4, 1);
+        FXE_Fence bad, dep;
+        h.submit(4, FXE_SCHED_PRIO_NORMAL, 100000, &bad);
+        const uint32_t es = h.slot[h.submit(5, FXE_SCHED_PRIO_NORMAL, 100000, &dep, &bad, 1)].seqno;
+        ok = ok && h.drain(100000000) && h.faulted == 1 && h.cancelled == 1;
+        ok = ok && h.retireStatus[es] == (FXE_EXEC_CANCELLED | FXE_EXEC_DEP_ERROR);
+        ok = ok && h.timeline.state(dep) == FXE_FENCE_ERROR && h.core.stats().depFailed == 1;
+        ok = ok && h.invariantsOk();
+        Report("DependenciesLocal", ok, h);
+        h.destroy();
+    }
+
+    Host rcs, bcs;
+    rcs.init();
+    bcs.init(false, FXE_EngineRegs::bcs0(), 0x10000000);
+    Link(rcs, bcs);
+
+    // Render running -> semaphore; the blit is on the BCS ports early but
+    // starts only after the breadcrumb lands.
+    FXE_Fence r1, b1;
+    rcs.submit(1, FXE_SCHED_PRIO_NORMAL, 400000, &r1);
+    const uint32_t b1s = bcs.slot[bcs.submit(1, FXE_SCHED_PRIO_HIGH, 50000, &b1, &r1, 1)].seqno;
+    ok = ok && bcs.core.held() == 0 && bcs.core.stats().depSemaphores == 1 && bcs.model.inflight() == 1;
+    ok = ok && bcs.semEmitted == 1 && !bcs.cmdMismatch;
+    Lockstep(rcs, bcs, &ok);
+    ok = ok && bcs.model.stats().semaphoreWaits == 1;
+    ok = ok && bcs.retiredAt[b1s] >= rcs.retiredAt[1] + 50000;
+
+    // Render only queued (behind two render hogs) -> held until it reaches
+// an RCS port or retires.
+    FXE_Fence hog, r2, b2;
+    rcs.submit(2, FXE_SCHED_PRIO_HIGH, 300000, &hog);
+    rcs.submit(3, FXE_SCHED_PRIO_HIGH, 300000);
+    const uint32_t r2s = rcs.slot[rcs.submit(4, FXE_SCHED_PRIO_LOW, 100000, &r2)].seqno;
+    const uint32_t b2s = bcs.slot[bcs.submit(1, FXE_SCHED_PRIO_HIGH, 50000, &b2, &r2, 1)].seqno;
+    ok = ok && bcs.core.held() == 1 && bcs.model.inflight() == 0;
+    Lockstep(rcs, bcs, &ok);
+    ok = ok && bcs.retiredAt[b2s] > rcs.retiredAt[r2s];
+    ok = ok && rcs.completed == 4 && bcs.completed == 2;
+    ok = ok && rcs.invariantsOk() && bcs.invariantsOk();
+    printf("{\"step\":\"DependenciesCross\",\"ok\":%s,\"semaphores\":%llu,\"held\":%llu,"
+           "\"renderDoneNs\":%llu,\"blitDoneNs\":%llu}\n",
+           ok ? "true" : "false", (unsigned long long)bcs.core.stats().depSemaphores,
+           (unsigned long long)bcs.core.stats().depHeld, (unsigned long long)rcs.retiredAt[r2s],
+           (unsigned long long)bcs.retiredAt[b2s]);
+    if (!ok) gFailures++;
+    rcs.destroy();
+    bcs.destroy();
+}
+
+// Low-priority hogs on both ports; a high-priority request preempts them,
+// and they resume from the saved LRC head without redoing or losing work.
+static void TestPreemptResume() {
+    Host h;
+    h.init();
+    h.submit(1, FXE_SCHED_PRIO_LOW, 5000000);
+    h.submit(2, FXE_SCHED_PRIO_LOW, 5000000);
+    while (h.model.now() < 1000000) h.advance(1000000);
+    int32_t hi = h.submit(3, FXE_SCHED_PRIO_HIGH, 100000);
+    const uint32_t hiSeq = h.slot[hi].seqno;
+    uint64_t hiDoneAt = 0;
+    while (!h.idle() && h.model.now() < 100000000) {
+        h.advance(100000000);
+        if (!hiDoneAt && h.retired[hiSeq]) hiDoneAt = h.model.now();
+    }
+    bool ok = h.idle() && h.completed == 3 && hiDoneAt && hiDoneAt < 1300000;
+    ok = ok && h.model.stats().preempted >= 1 && h.core.sched().stats().preemptPriority >= 1;
+    ok = ok && h.emitted == 3;      // resubmits resume the ring, nothing re-emitted
+    // µs-granular saved head: each preemption may redo < 1 µs of work.
+    const uint64_t work = 5000000 + 5000000 + 100000;
+    const uint64_t busy = h.model.stats().busyNs;
+    ok = ok && busy >= work && busy <= work + h.model.stats().preempted * 1000 + 64 * 2000;
+    ok = ok && h.invariantsOk();
+    Report("PreemptResume", ok, h);
+    h.destroy();
+}
+
+// kMaxBanScore faults ban the context: its queued work is cancelled in
+// seqno order and later submissions are rejected.
+static void TestFaultBan() {
+    Host h;
+    h.init();
+    h.model.injectFault(5, FXE_ExecCore::kMaxBanScore);
+    for (int i = 0; i < 6; ++i) h.submit(5, FXE_SCHED_PRIO_NORMAL, 200000);
+    h.submit(6, FXE_SCHED_PRIO_NORMAL, 200000);
+    bool ok = h.drain(100000000);
+    ok = ok && h.faulted == FXE_ExecCore::kMaxBanScore && h.cancelled == 3 && h.completed == 1;
+    ok = ok && h.core.isBanned(5) && !h.core.isBanned(6);
+    ok = ok && h.submit(5, FXE_SCHED_PRIO_HIGH, 1000) < 0;
+    ok = ok && h.invariantsOk();
+    Report("FaultBan", ok, h);
+    h.destroy();
+}
+
+// Per-context timelines: the engine's post-sync signals each fence before
+// its CSB; wait-any finishes on the first request, wait-all on the last,
+// and a faulted request's fence reports an error.
+static void TestFences() {
+    Host h;
+    h.init();
+    h.model.injectFault(3, 1);
+    FXE_Fence f[4];
+    h.submit(1, FXE_SCHED_PRIO_NORMAL, 100000, &f[0]);
+    h.submit(2, FXE_SCHED_PRIO_NORMAL, 800000, &f[1]);
+    h.submit(1, FXE_SCHED_PRIO_NORMAL, 100000, &f[2]);
+    h.submit(3, FXE_SCHED_PRIO_NORMAL, 100000, &f[3]);
+
+    bool ok = f[0].seqno == 1 && f[2].seqno == 2 && f[1].seqno == 1;
+    uint32_t index = 99;
+    ok = ok && h.timeline.evaluate(f, 3, true, &index) == FXE_FENCE_PENDING;
+    while (!h.idle() && h.timeline.evaluate(f, 3, true, &index) == FXE_FENCE_PENDING)
+        h.advance(100000000);
+    ok = ok && index == 0 && h.timeline.state(f[1]) == FXE_FENCE_PENDING;
+    ok = ok && h.timeline.evaluate(f, 3, false, nullptr) == FXE_FENCE_PENDING;
+
+    ok = ok && h.drain(100000000);
+    ok = ok && h.timeline.evaluate(f, 3, false, nullptr) == FXE_FENCE_SIGNALED;
+    ok = ok && h.timeline.hwSeqno(1) == 2 && h.model.stats().postSyncs == 3;
+    index = 99;
+    ok = ok && h.timeline.evaluate(f, 4, false, &index) == FXE_FENCE_ERROR && index == 3;
+
+    // Next request on the timeline completes; older fences stay signaled.
+    FXE_Fence g;
+    h.submit(3, FXE_SCHED_PRIO_NORMAL, 1000, &g);
+    ok = ok && h.drain(100000000) && g.seqno == 2;
+    ok = ok && h.timeline.state(g) == FXE_FENCE_SIGNALED && h.timeline.state(f[3]) == FXE_FENCE_ERROR;
+    ok = ok && h.invariantsOk();
+    Report("Fences", ok, h);
+    h.destroy();
+}
+
+// A context wedges the engine: the watchdog resets it after the timeout,
+// retires only the hung request, replays the innocent one that was on the
+// other port plus the queue, and bans the context on its third hang.
+static void TestHang() {
+    Host h;
+    h.init();
+    h.core.setHangTimeoutNs(2000000);
+    h.model.injectHang(1, FXE_ExecCore::kMaxBanScore);
+    FXE_Fence f[4];
+    h.submit(1, FXE_SCHED_PRIO_NORMAL, 300000, &f[0]);
+    h.submit(2, FXE_SCHED_PRIO_NORMAL, 300000, &f[1]);
+    h.submit(3, FXE_SCHED_PRIO_NORMAL, 300000, &f[2]);
+    h.submit(1, FXE_SCHED_PRIO_NORMAL, 300000, &f[3]);
+
+    bool ok = h.drain(100000000);
+    const FXE_ExecStats& st = h.core.stats();
+    ok = ok && h.hung == 2 && h.completed == 2 && h.model.stats().resets == 2;
+    ok = ok && st.hangs == 2 && st.replayed >= 1 && st.resetFailures == 0;
+    ok = ok && h.timeline.state(f[0]) == FXE_FENCE_ERROR && h.timeline.state(f[3]) == FXE_FENCE_ERROR;
+    ok = ok && h.timeline.state(f[1]) == FXE_FENCE_SIGNALED && h.timeline.state(f[2]) == FXE_FENCE_SIGNALED;
+    // detection waits out the timeout; reset itself is instant in the model
+    ok = ok && st.lastRecoveryNs >= 2000000 && st.maxRecoveryNs < 2000000 + 200000;
+
+    h.submit(1, FXE_SCHED_PRIO_NORMAL, 300000);
+    ok = ok && h.drain(100000000) && h.hung == 3 && h.core.isBanned(1);
+    ok = ok && h.submit(1, FXE_SCHED_PRIO_NORMAL, 1000) < 0;
+    ok = ok && h.invariantsOk();
+    Report("Hang", ok, h);
+    printf("{\"step\":\"HangRecovery\",\"ok\":%s,\"hangs\":%llu,\"lastRecoveryUs\":%llu,"
+           "\"maxRecoveryUs\":%llu,\"replayed\":%llu}\n",
+           ok ? "true" : "false", (unsigned long long)st.hangs,
+           (unsigned long long)(st.lastRecoveryNs / 1000), (unsigned long long)(st.maxRecoveryNs / 1000),
+           (unsigned long long)st.replayed);
+    h.destroy();
+}
+
+// Random submits, priorities, work sizes, faults and external preempts.
+static void TestFuzz(uint64_t seed, uint32_t ops) {
+    gRng = seed;
+    Host h;
+    h.init();
+    h.model.setSwitchNs(RandRange(500, 5000));
+    h.model.setPreemptLatencyNs(RandRange(5000, 50000));
+    h.core.setHangTimeoutNs(2000000);
+
+    uint64_t rejectedBanned = 0;
+    for (uint32_t op = 0; op < ops; ++op) {
+        const uint64_t r = Rand() % 100;
+        if (r < 45) {
+            const uint32_t ctx = (uint32_t)RandRange(1, kContexts);
+            if (Rand() % 400 == 0) h.model.injectFault(ctx, 1);
+            if (Rand() % 2000 == 0) h.model.injectHang(ctx, 1);
+            const bool banned = h.core.isBanned(ctx);
+            int32_t s = h.submit(ctx, (uint32_t)RandRange(0, FXE_SCHED_PRIO_COUNT - 1),
+                                 RandRange(1000, 400000));
+            if (banned && s >= 0) h.bannedSubmit = true;
+            if (banned) rejectedBanned++;
+        } else if (r < 48) {
+            h.model.injectPreemptAt(h.model.now() + RandRange(0, 200000));
+        } else {
+            h.advance(h.model.now() + RandRange(1000, 500000));
+        }
+    }
+
+    bool ok = h.drain(10000000000ULL);
+    ok = ok && h.submitted == h.completed + h.faulted + h.cancelled + h.hung;
+    ok = ok && h.hung == h.core.stats().hangs && h.core.stats().resetFailures == 0;
+    ok = ok && h.core.sched().used() == 0;
+    for (uint32_t c = 1; c <= kContexts; ++c) {
+        const FXE_Fence last = { c, h.timeline.lastAllocated(c), 0 };
+        ok = ok && h.timeline.state(last) != FXE_FENCE_PENDING;
+    }
+    for (uint32_t c = 1; c <= kContexts; ++c) ok = ok && (h.core.isBanned(c) == h.bannedSeen[c]);
+    ok = ok && h.invariantsOk();
+
+    char name[64];
+    snprintf(name, sizeof(name), "Fuzz_%llx", (unsigned long long)seed);
+    Report(name, ok, h);
+    h.destroy();
+}
+
+// Host cost of the core's submit/CSB/kick path per request at steady state:
+// every iteration submits one request, runs the model to its next event and
+// delivers the IRQ. Model time is excluded from coreNsPerSubmit.
+static void Benchmark(uint32_t requests) {
+    gRng = 12345;
+    Host h;
+    h.init();
+    h.model.setSwitchNs(0);
+
+    using clk = std::chrono::steady_clock;
+    uint64_t coreNs = 0;
+    uint32_t done = 0;
+    const auto t0 = clk::now();
+    for (uint32_t i = 0; i < requests && i + 2 < kMaxSeqno; ++i) {
+        const uint32_t ctx = (uint32_t)RandRange(1, kContexts);
+        const uint32_t prio = (uint32_t)RandRange(0, FXE_SCHED_PRIO_COUNT - 1);
+
+        const auto a = clk::now();
+        uint32_t seqno = 0;
+        const uint64_t fenceSeqno = h.timeline.alloc(ctx);
+        int32_t s = h.core.enqueue(ctx, prio, h.lrcGGTT[ctx], h.batchGGTT, &seqno,
+                                   h.timeline.breadcrumbGGTT(ctx), fenceSeqno);
+        if (s >= 0) {
+            h.slot[s].ctxId = ctx;
+            h.slot[s].seqno = seqno;
+            h.slot[s].fence.timeline = ctx;
+            h.slot[s].fence.seqno = fenceSeqno;
+            h.slot[s].used = true;
+            h.submitted++;
+            h.core.kick();
+            done++;
+        }
+        const auto b = clk::now();
+        const uint64_t next = h.model.nextEventNs();
+        h.model.advanceTo(next == UINT64_MAX ? h.model.now() : next);
+        const auto c = clk::now();
+        h.deliver();
+        const auto d = clk::now();
+        coreNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>((b - a) + (d - c)).count();
+    }
+    h.drain(100000000000ULL);
+    const uint64_t totalNs =
+        (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - t0).count();
+
+    const bool ok = h.idle() && h.completed == h.submitted && h.invariantsOk();
+    printf("{\"step\":\"Benchmark\",\"ok\":%s,\"requests\":%u,\"coreNsPerSubmit\":%.1f,"
+           "\"totalNsPerSubmit\":%.1f,\"elspPerSubmit\":%.2f,\"preempted\":%llu}\n",
+           ok ? "true" : "false", done,
+           done ? (double)coreNs / done : 0.0, done ? (double)totalNs / done : 0.0,
+           done ? (double)h.model.stats().elspSubmits / done : 0.0,
+           (unsigned long long)h.model.stats().preempted);
+    if (!ok) gFailures++;
+    h.destroy();
+}
+
+// Host cost of one interrupt on the CSB path: both ports complete between
+// interrupts, then the IRQ drains the entries (drainNsPerIrq) and refills
+// the ports (nsPerIrq covers both). MMIO counts are per interrupt and
+// include the ELSP refill.
+static void BenchmarkCsb(uint32_t irqs, bool useHwsp) {
+    Host h;
+    h.init(useHwsp);
+    h.model.setSwitchNs(0);
+    h.model.setDefaultExecNs(2000);
+
+    using clk = std::chrono::steady_clock;
+    uint64_t irqNs = 0, drainNs = 0, irqCount = 0, entries = 0, reads = 0, writes = 0;
+    uint32_t ctx = 1;
+    for (uint32_t i = 0; i < irqs && h.submitted + 16 < kMaxSeqno; ++i) {
+        while (h.core.sched().queued() < 8) {
+            uint32_t seqno = 0;
+            int32_t s = h.core.enqueue(ctx, FXE_SCHED_PRIO_NORMAL, h.lrcGGTT[ctx], h.batchGGTT, &seqno);
+            if (s < 0) break;
+            h.slot[s].ctxId = ctx;
+            h.slot[s].seqno = seqno;
+            h.slot[s].used = true;
+            h.submitted++;
+            ctx = ctx % kContexts + 1;
+        }
+        h.core.kick();
+        h.model.advanceTo(h.model.now() + 10000);
+        if (!h.model.takeIrq()) continue;
+
+        const uint64_t csb0 = h.core.stats().csbEntries;
+        const uint64_t r0 = h.mmioReads, w0 = h.mmioWrites;
+        const auto a = clk::now();
+        h.core.drainCsb();
+        const auto b = clk::now();
+        h.core.kick();
+        const auto c = clk::now();
+        drainNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+        irqNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(c - a).count();
+        irqCount++;
+        entries += h.core.stats().csbEntries - csb0;
+        reads += h.mmioReads - r0;
+        writes += h.mmioWrites - w0;
+    }
+    h.drain(100000000000ULL);
+
+    const bool ok = h.idle() && h.completed == h.submitted && h.invariantsOk();
+    printf("{\"step\":\"BenchmarkCsb%s\",\"ok\":%s,\"irqs\":%llu,\"entriesPerIrq\":%.2f,"
+           "\"drainNsPerIrq\":%.1f,\"nsPerIrq\":%.1f,\"mmioReadsPerIrq\":%.2f,\"mmioWritesPerIrq\":%.2f}\n",
+           useHwsp ? "Hwsp" : "Reg", ok ? "true" : "false", (unsigned long long)irqCount,
+           irqCount ? (double)entries / irqCount : 0.0, irqCount ? (double)drainNs / irqCount : 0.0,
+           irqCount ? (double)irqNs / irqCount : 0.0,
+           irqCount ? (double)reads / irqCount : 0.0, irqCount ? (double)writes / irqCount : 0.0);
+    if (!ok) gFailures++;
+    h.destroy();
+}
+
+int main(int argc, char** argv) {
+    TestBasic();
+    TestPreemptResume();
+    TestFaultBan();
+    TestFences();
+    TestHang();
+    TestCopyEngine();
+    TestDependencies();
+    const uint64_t seeds[] = { 1, 2, 3, 0xC0FFEE, 0xFA17, 0x5EED5EED };
+    for (uint64_t seed : seeds) TestFuzz(seed, 20000);
+    Benchmark(argc > 1 ? (uint32_t)atoi(argv[1]) : 200000);
+    BenchmarkCsb(argc > 1 ? (uint32_t)atoi(argv[1]) : 200000, false);
+    BenchmarkCsb(argc > 1 ? (uint32_t)atoi(argv[1]) : 200000, true);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,717 @@
+// Host-side test and benchmark for the GGTT address-space allocator and the
+// batched PTE writer (FXE_Ggtt.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_ggtt_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "FXE_Ggtt.hpp"
+
+static const uint64_t kMB = 1024 * 1024;
+static const uint64_t kSpaceBase = 1 * kMB;     // below: hardware reserved, as in the kext
+
+static int gFailures = 0;
+
+static void Report(const char* step, bool ok, const FXE_GgttSpace& s) {
+    const FXE_GgttSpaceStats& st = s.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"allocs\":%llu,\"frees\":%llu,\"failures\":%llu,"
+           "\"holes\":%u,\"freeBytes\":%llu,\"largestHole\":%llu}\n",
+           step, ok ? "true" : "false",
+           (unsigned long long)st.allocs, (unsigned long long)st.frees,
+           (unsigned long long)st.failures, s.holes(),
+           (unsigned long long)s.freeBytes(), (unsigned long long)s.largestHole());
+    if (!ok) gFailures++;
+}
+
+static uint64_t gRng = 0x9E3779B97F4A7C15ULL;
+static uint64_t Rand() {
+    gRng ^= gRng << 13;
+    gRng ^= gRng >> 7;
+    gRng ^= gRng << 17;
+    return gRng;
+}
+static uint64_t RandRange(uint64_t lo, uint64_t hi) { return lo + Rand() % (hi - lo + 1); }
+
+// Freed neighbours merge back into one hole; freed space is reused.
+static void TestCoalesce() {
+    static FXE_GgttSpace s;
+    s.init(kSpaceBase, kSpaceBase + 64 * kMB);
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    bool ok = s.alloc(3 * 4096, &a) && s.alloc(5000, &b) && s.alloc(4096, &c);
+    ok = ok && a == kSpaceBase && b == a + 3 * 4096 && c == b + 2 * 4096;
+    ok = ok && s.sizeOf(b) == 2 * 4096 && s.holes() == 1;
+
+    ok = ok && s.free(b) == 2 * 4096 && s.holes() == 2;
+    ok = ok && s.alloc(8192, &d) && d == b;                 // exact fit reused
+    ok = ok && s.free(d) && s.free(a) && s.holes() == 2;    // a+b merged
+    ok = ok && s.free(c) && s.holes() == 1;                 // and with the tail
+    ok = ok && s.freeBytes() == 64 * kMB && s.largestHole() == 64 * kMB;
+    ok = ok && s.free(c) == 0 && s.stats().badFrees == 1;
+    ok = ok && s.fragmentationPermille() == 0;
+    Report("Coalesce", ok, s);
+}
+
+// Alignment, the at-or-above bias, windows and exact placement.
+static void TestPlacement() {
+    static FXE_GgttSpace s;
+    s.init(kSpaceBase, kSpaceBase + 64 * kMB);
+    uint64_t a = 0, b = 0, g = 0, w = 0;
+    bool ok = s.alloc(4096, &a) && a == kSpaceBase;
+    ok = ok && s.alloc(64 * 1024, 2 * kMB, 0, UINT64_MAX, &b) && b == 2 * kMB;
+    ok = ok && s.allocAtOrAbove(256 * 1024, 16 * kMB + 4096, &g) && g == 16 * kMB + 4096;
+    ok = ok && s.allocAt(32 * kMB, 8192) && s.sizeOf(32 * kMB) == 8192;
+    ok = ok && !s.allocAt(32 * kMB + 4096, 4096);           // overlaps
+    ok = ok && !s.allocAt(g - 4096, 8192);                  // straddles g
+    ok = ok && s.alloc(4096, 4096, 8 * kMB, 8 * kMB + 4096, &w) && w == 8 * kMB;
+    ok = ok && !s.alloc(4096, 4096, 8 * kMB, 8 * kMB + 4096, &w);   // window full
+    ok = ok && !s.alloc(128 * kMB, &w);                              // too big
+    ok = ok && !s.alloc(4096, 3 * 4096, 0, UINT64_MAX, &w);          // not a power of two
+    // A 4 KB request lands in the first (4 KB) gap, not the big tail
+    uint64_t x = 0, y = 0, z = 0;
+    ok = ok && s.alloc(4096, &x) && s.alloc(4096, &y) && s.alloc(4096, &z);
+    ok = ok && s.free(y) == 4096 && s.alloc(4096, &w) && w == y;
+    Report("Placement", ok, s);
+}
+
+// Random alloc/free with every constraint, checked page by page against a
+// bitmap; everything freed at the end must collapse into one hole.
+static void TestFuzz(uint64_t seed, FXE_GgttSpace::Policy policy, const char* name) {
+    static FXE_GgttSpace s;
+    const uint64_t pages = 8192;                     // 32 MB
+    s.init(kSpaceBase, kSpaceBase + pages * 4096, policy);
+    static uint8_t owner[8192];
+    struct Live { uint64_t addr; uint64_t size; };
+    static Live live[4096];
+    uint32_t liveCount = 0;
+    memset(owner, 0, sizeof(owner));
+    gRng = seed;
+
+    bool ok = true;
+    for (uint32_t op = 0; op < 200000 && ok; ++op) {
+        const uint64_t r = Rand() % 100;
+        if (liveCount && (r < 45 || liveCount == 4096)) {
+            const uint32_t i = (uint32_t)(Rand() % liveCount);
+            ok = s.free(live[i].addr) == live[i].size;
+            for (uint64_t p = 0; p < live[i].size / 4096; ++p)
+                owner[(live[i].addr - kSpaceBase) / 4096 + p] = 0;
+            live[i] = live[--liveCount];
+            continue;
+        }
+        const uint64_t size = RandRange(1, r < 90 ? 16 : 512) * 4096 - RandRange(0, 4095);
+        const uint64_t align = 4096ULL << RandRange(0, r < 95 ? 0 : 6);
+        uint64_t lo = 0, hi = UINT64_MAX, addr = 0;
+        bool got;
+        if (r < 60) {
+            got = s.alloc(size, align, 0, UINT64_MAX, &addr);
+        } else if (r < 75) {
+            lo = kSpaceBase + RandRange(0, pages - 1) * 4096;
+            got = s.allocAtOrAbove(size, lo, &addr);
+        } else if (r < 90) {
+            lo = kSpaceBase + RandRange(0, pages / 2) * 4096;
+            hi = lo + RandRange(1, pages / 2) * 4096;
+            got = s.alloc(size, align, lo, hi, &addr);
+        } else {
+            addr = kSpaceBase + RandRange(0, pages - 1) * 4096;
+            got = s.allocAt(addr, size);
+        }
+        const uint64_t rounded = (size + 4095) & ~4095ULL;
+        // Reference: was there room?
+        bool fits = false;
+        if (r >= 90) {
+            fits = addr + rounded <= kSpaceBase + pages * 4096;
+            for (uint64_t p = 0; fits && p < rounded / 4096; ++p)
+                fits = !owner[(addr - kSpaceBase) / 4096 + p];
+            if (fits != got) ok = false;
+        }
+        if (!got) continue;
+        if (addr < kSpaceBase || addr + rounded > kSpaceBase + pages * 4096) ok = false;
+        if ((r < 60 || (r >= 75 && r < 90)) && (addr & (align - 1))) ok = false;
+        if (addr < lo || addr + rounded > hi) ok = false;
+        for (uint64_t p = 0; ok && p < rounded / 4096; ++p) {
+            uint8_t& o = owner[(addr - kSpaceBase) / 4096 + p];
+            if (o) ok = false;
+            o = 1;
+        }
+        live[liveCount++] = Live{ addr, rounded };
+    }
+    uint64_t used = 0;
+    for (uint32_t i = 0; i < liveCount; ++i) used += live[i].size;
+    ok = ok && s.stats().bytesUsed == used && s.allocations() == liveCount;
+    while (liveCount && ok) {
+        ok = s.free(live[liveCount - 1].addr) == live[liveCount - 1].size;
+        liveCount--;
+    }
+    ok = ok && s.holes() == 1 && s.freeBytes() == pages * 4096 && s.stats().badFrees == 0;
+    char step[48];
+    snprintf(step, sizeof(step), "Fuzz_%s_%llx", name, (unsigned long long)seed);
+    Report(step, ok, s);
+}
+
+// ---- trace replay benchmark ----
+//
+// Driver-shaped traffic: batch buffers (4-64 KB, retired within a few
+// submissions), one-page descriptors/fences, contexts (16 KB ring + 4 KB
+// LRC, long-lived), window surfaces (16 KB - 8 MB, medium-lived, the big
+// ones 64 KB aligned) and a GuC image placed above WOPCM once. Replayed
+// against the old bump allocator (never reuses) and both policies.
+
+struct TraceOp {
+    uint64_t size;
+    uint64_t align;
+    uint64_t minAddr;
+    uint32_t lifetime;      // in ops; UINT32_MAX = never freed
+};
+
+static uint32_t BuildTrace(TraceOp* ops, uint32_t count, uint64_t seed) {
+    static const uint64_t kSurfaces[] = {
+        64 * 64 * 4, 256 * 256 * 4, 512 * 512 * 4, 800 * 600 * 4,
+        1280 * 800 * 4, 1920 * 1080 * 4,
+    };
+    gRng = seed;
+    uint32_t n = 0;
+    ops[n++] = TraceOp{ 256 * 1024, 4096, 16 * kMB, UINT32_MAX };        // GuC above WOPCM
+    while (n < count) {
+        const uint64_t r = Rand() % 100;
+        TraceOp op = { 4096, 4096, 0, 0 };
+        if (r < 70) {
+            op.size = 4096ULL << RandRange(0, 4);
+            op.lifetime = (uint32_t)RandRange(1, 32);
+        } else if (r < 90) {
+            op.lifetime = (uint32_t)RandRange(1, 8);
+        } else if (r < 95 && n + 1 < count) {
+            const uint32_t life = (uint32_t)RandRange(200, 2000);
+            ops[n++] = TraceOp{ 16 * 1024, 4096, 0, life };
+            op.lifetime = life;
+        } else {
+            op.size = kSurfaces[Rand() % (sizeof(kSurfaces) / sizeof(kSurfaces[0]))];
+            op.align = op.size >= kMB ? 64 * 1024 : 4096;
+            op.lifetime = (uint32_t)RandRange(50, 1000);
+        }
+        ops[n++] = op;
+    }
+    return n;
+}
+
+struct ReplayResult {
+    uint32_t opsDone;       // before the first failure
+    uint32_t failures;
+    uint32_t maxHoles;
+    uint32_t fragPermille;  // at the end
+    uint64_t peakUsed;
+    uint64_t highWater;     // highest address handed out
+    double   nsPerOp;
+};
+
+static ReplayResult ReplayBump(const TraceOp* ops, uint32_t count, uint64_t spaceBytes) {
+    ReplayResult res = {};
+    uint64_t next = kSpaceBase;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (next < ops[i].minAddr) next = ops[i].minAddr;
+        const uint64_t a = (next + ops[i].align - 1) & ~(ops[i].align - 1);
+        const uint64_t size = (ops[i].size + 4095) & ~4095ULL;
+        if (a + size > kSpaceBase + spaceBytes) {
+            res.failures++;
+            continue;
+        }
+        next = a + size;
+        if (!res.failures) res.opsDone = i + 1;
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    res.highWater = next;
+    res.nsPerOp = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / count;
+    return res;
+}
+
+// Frees are due `lifetime` ops later: a timing wheel of singly linked
+// lists keeps the replay loop O(1) per op so the time is the allocator's.
+static ReplayResult ReplaySpace(const TraceOp* ops, uint32_t count, uint64_t spaceBytes,
+                                FXE_GgttSpace::Policy policy) {
+    static FXE_GgttSpace s;
+    static const uint32_t kWheel = 4096, kNodes = 1 << 16;     // wheel > longest lifetime
+    struct Node { uint64_t addr; int32_t next; };
+    static Node node[kNodes];
+    static int32_t wheel[kWheel];
+    int32_t freeNode = 0;
+    for (uint32_t i = 0; i < kNodes; ++i) node[i].next = i + 1 < kNodes ? (int32_t)i + 1 : -1;
+    for (uint32_t i = 0; i < kWheel; ++i) wheel[i] = -1;
+    ReplayResult res = {};
+    s.init(kSpaceBase, kSpaceBase + spaceBytes, policy);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; ++i) {
+        for (int32_t n = wheel[i % kWheel]; n >= 0;) {
+            const int32_t next = node[n].next;
+            s.free(node[n].addr);
+            node[n].next = freeNode;
+            freeNode = n;
+            n = next;
+        }
+        wheel[i % kWheel] = -1;
+        uint64_t addr = 0;
+        if (!s.alloc(ops[i].size, ops[i].align, ops[i].minAddr, UINT64_MAX, &addr)) {
+            res.failures++;
+            continue;
+        }
+        if (!res.failures) res.opsDone = i + 1;
+        const uint64_t end = addr + ((ops[i].size + 4095) & ~4095ULL);
+        if (end > res.highWater) res.highWater = end;
+        if (s.holes() > res.maxHoles) res.maxHoles = s.holes();
+        if (ops[i].lifetime != UINT32_MAX && freeNode >= 0) {
+            const int32_t n = freeNode;
+            const uint32_t due = (i + ops[i].lifetime) % kWheel;
+            freeNode = node[n].next;
+            node[n].addr = addr;
+            node[n].next = wheel[due];
+            wheel[due] = n;
+        }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    res.fragPermille = s.fragmentationPermille();
+    res.peakUsed = s.stats().peakBytesUsed;
+    res.nsPerOp = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / count;
+    return res;
+}
+
+static void PrintReplay(const char* name, uint32_t count, const ReplayResult& r, bool ok) {
+    printf("{\"step\":\"Trace_%s\",\"ok\":%s,\"ops\":%u,\"opsBeforeFailure\":%u,\"failures\":%u,"
+           "\"maxHoles\":%u,\"fragPermille\":%u,\"peakUsedMB\":%.1f,\"highWaterMB\":%.1f,"
+           "\"nsPerOp\":%.1f,\"opsPerSec\":%.0f}\n",
+           name, ok ? "true" : "false", count, r.opsDone, r.failures, r.maxHoles, r.fragPermille,
+           (double)r.peakUsed / kMB, (double)r.highWater / kMB, r.nsPerOp,
+           r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0.0);
+    if (!ok) gFailures++;
+}
+
+static void BenchmarkTraces(uint32_t count) {
+    const uint64_t space = 256 * kMB;
+    TraceOp* ops = (TraceOp*)calloc(count, sizeof(TraceOp));
+    count = BuildTrace(ops, count, 0x6A77);
+
+    const ReplayResult bump = ReplayBump(ops, count, space);
+    const ReplayResult first = ReplaySpace(ops, count, space, FXE_GgttSpace::kFirstFit);
+    const ReplayResult best = ReplaySpace(ops, count, space, FXE_GgttSpace::kBestFit);
+    // The bump allocator runs out long before the trace ends; the range
+    // allocator keeps going with a working set far below the space.
+    PrintReplay("Bump", count, bump, bump.failures > 0);
+    PrintReplay("FirstFit", count, first, first.failures == 0);
+    PrintReplay("BestFit", count, best, best.failures == 0);
+    free(ops);
+}
+
+// Tags follow their allocation while the tables shift around it.
+static void TestTags() {
+    static FXE_GgttSpace s;
+    s.init(kSpaceBase, kSpaceBase + 64 * kMB);
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    bool ok = s.alloc(4096, &a) && s.alloc(8192, &b) && s.alloc(4096, &c);
+    ok = ok && s.setTag(b, 0xB) && s.setTag(c, 0xC) && !s.setTag(b + 4096, 1);
+    ok = ok && s.tagOf(a) == 0 && s.tagOf(b) == 0xB;
+    ok = ok && s.free(a) && s.alloc(4096, &d) && d == a;    // insert in front of b and c
+    ok = ok && s.tagOf(d) == 0 && s.tagOf(b) == 0xB && s.tagOf(c) == 0xC;
+    ok = ok && s.free(b) && s.tagOf(b) == 0;
+    ok = ok && s.alloc(8192, &b) && s.tagOf(b) == 0;        // reused range starts untagged
+    Report("Tags", ok, s);
+}
+
+// Objects for the evictor: a mapping (addr, 0 = unmapped), a pin flag and
+// the intrusive LRU node the kext keeps in the GEM's VMA.
+struct SimObj {
+    FXE_LruNode node;
+    uint64_t    addr;
+    uint64_t    size;
+    bool        pinned;
+    bool        alive;
+};
+
+class SimEvict : public FXE_GgttEvictPlatform {
+public:
+    FXE_GgttSpace* space = nullptr;
+    uint64_t evict(void* o) override {
+        SimObj* obj = (SimObj*)o;
+        if (obj->pinned || !obj->addr) return 0;
+        const uint64_t bytes = space->free(obj->addr);
+        obj->addr = 0;
+        return bytes;
+    }
+};
+
+// Idle mappings go oldest first and only as many as the request needs;
+// a re-pinned object reached on the way stays mapped, and mappings outside
+// the requested window are left alone.
+static void TestEviction() {
+    static FXE_GgttSpace s;
+    static FXE_GgttEvictor ev;
+    SimEvict plat;
+    plat.space = &s;
+    s.init(kSpaceBase, kSpaceBase + 16 * 4096);
+    ev.init(&s, &plat);
+    SimObj o[16] = {};
+    bool ok = true;
+    for (int i = 0; i < 16; ++i)
+        ok = ok && s.alloc(4096, &o[i].addr);
+    uint64_t x = 0;
+    ok = ok && !ev.alloc(4096, 4096, 0, UINT64_MAX, &x) && ev.stats().failures == 1;   // nothing idle
+
+    const int order[] = { 3, 1, 5, 8, 9, 7 };
+    for (int i : order) ev.touch(&o[i].node, &o[i], o[i].addr);
+    ok = ok && ev.stats().idle == 6 && ev.oldest() == &o[3];
+
+    const uint64_t a3 = o[3].addr;
+    ok = ok && ev.alloc(4096, 4096, 0, UINT64_MAX, &x) && x == a3 && o[3].addr == 0;
+    ok = ok && ev.stats().evictions == 1 && ev.stats().idle == 5;
+
+    o[1].pinned = true;                                     // pinned since it went idle
+    const uint64_t a5 = o[5].addr;
+    ok = ok && ev.alloc(4096, 4096, 0, UINT64_MAX, &x) && x == a5;
+    ok = ok && o[1].addr && ev.stats().busy == 1 && ev.stats().evictions == 2;
+
+    // 8 and 9 are neighbours: evicting 8 alone does not make 8 KB
+    const uint64_t a8 = o[8].addr;
+    ok = ok && ev.alloc(8192, 4096, 0, UINT64_MAX, &x) && x == a8;
+    ok = ok && o[8].addr == 0 && o[9].addr == 0 && ev.stats().evictions == 4;
+
+    // Only 7 is idle and it sits below the window
+    const uint64_t a7 = kSpaceBase + 7 * 4096;
+    ok = ok && !ev.alloc(4096, 4096, a7 + 4096, UINT64_MAX, &x);
+    ok = ok && o[7].addr == a7 && ev.stats().idle == 1 && ev.stats().failures == 2;
+    ev.remove(&o[7].node);
+    ev.remove(&o[7].node);                                  // twice is harmless
+    ok = ok && ev.oldest() == nullptr && ev.stats().idle == 0;
+    Report("Eviction", ok, s);
+}
+
+// A long session: surfaces of 16 KB .. 2 MB are created, used (pinned
+// and mapped), unpinned and now and then destroyed, with a hot fifth of
+// them getting most of the use; together they need several times the
+// space. Policies:
+//   UnmapOnUnpin  unmap at the last unpin (the old behaviour)
+//   KeepMapped    keep idle mappings, never evict
+//   KeepLru       keep idle mappings, evict LRU when space runs out
+struct SessionResult {
+    uint64_t uses;
+    uint64_t maps;          // uses that had to write PTEs
+    uint64_t failures;
+    uint64_t evictions;
+};
+
+static SessionResult ReplaySession(uint32_t uses, int policy) {
+    static FXE_GgttSpace s;
+    static FXE_GgttEvictor ev;
+    SimEvict plat;
+    plat.space = &s;
+    s.init(kSpaceBase, kSpaceBase + 64 * kMB);
+    ev.init(&s, &plat);
+    static const uint32_t kObjs = 512;
+    static SimObj o[kObjs];
+    memset(o, 0, sizeof(o));
+    gRng = 0x5E55;
+    SessionResult r = {};
+    for (uint32_t u = 0; u < uses; ++u) {
+        const uint32_t i = Rand() % 5 ? (uint32_t)(Rand() % (kObjs / 5)) : (uint32_t)(Rand() % kObjs);
+        SimObj& obj = o[i];
+        if (!obj.alive) {
+            obj.alive = true;
+            obj.size = 16384ULL << RandRange(0, 7);
+        }
+        r.uses++;
+        if (obj.addr) {
+            ev.remove(&obj.node);                           // pinned again
+        } else {
+            r.maps++;
+            const bool fit = policy == 2 ? ev.alloc(obj.size, 4096, 0, UINT64_MAX, &obj.addr)
+                                         : s.alloc(obj.size, &obj.addr);
+            if (!fit) {
+                r.failures++;
+                obj.addr = 0;
+                continue;
+            }
+        }
+        // done with it: the last unpin
+        if (policy == 0) {
+            s.free(obj.addr);
+            obj.addr = 0;
+        } else if (policy == 2) {
+            ev.touch(&obj.node, &obj, obj.addr);
+        }
+        if (Rand() % 64 == 0) {                             // destroyed
+            ev.remove(&obj.node);
+            if (obj.addr) s.free(obj.addr);
+            obj.addr = 0;
+            obj.alive = false;
+        }
+    }
+    r.evictions = ev.stats().evictions;
+    return r;
+}
+
+static void BenchmarkSession(uint32_t uses) {
+    const char* names[] = { "UnmapOnUnpin", "KeepMapped", "KeepLru" };
+    SessionResult res[3];
+    for (int p = 0; p < 3; ++p) res[p] = ReplaySession(uses, p);
+    for (int p = 0; p < 3; ++p) {
+        // Keeping mappings without eviction runs out of space; with LRU
+        // eviction it never fails and rewrites far fewer PTE ranges.
+        bool ok = p == 1 ? res[p].failures > 0 : res[p].failures == 0;
+        if (p == 2) ok = ok && res[2].maps * 2 < res[0].maps;
+        printf("{\"step\":\"Session_%s\",\"ok\":%s,\"uses\":%llu,\"maps\":%llu,\"failures\":%llu,"
+               "\"evictions\":%llu}\n",
+               names[p], ok ? "true" : "false", (unsigned long long)res[p].uses,
+               (unsigned long long)res[p].maps, (unsigned long long)res[p].failures,
+               (unsigned long long)res[p].evictions);
+        if (!ok) gFailures++;
+    }
+}
+
+// A GGTT in host memory. flush() stands in for the GTT_WRITE_FLUSH MMIO
+// write plus the GPU-side TLB invalidate it triggers: a store to a
+// "register" and a spin of flushNs.
+class SimGgtt : public FXE_GgttIO {
+public:
+    uint64_t* table = nullptr;
+    uint64_t  count = 0;
+    uint64_t  flushes = 0;
+    uint64_t  flushNs = 0;
+    uint32_t  sizes = FXE_PAGE_4K;
+    volatile uint32_t flushReg = 0;
+
+    explicit SimGgtt(uint64_t entries) : count(entries) { table = (uint64_t*)calloc(entries, 8); }
+    ~SimGgtt() { free(table); }
+
+    volatile uint64_t* ptes() override { return table; }
+    uint64_t entries() override { return count; }
+    uint32_t pageSizes() override { return sizes; }
+    // page number | size exponent << 52 | valid
+    uint64_t encode(uint64_t phys, uint32_t size) override {
+        return (phys & ~0xFFFULL) | ((uint64_t)__builtin_ctz(size) << 52) | 1;
+    }
+    void flush() override {
+        flushReg = 1;
+        flushes++;
+        if (!flushNs) return;
+        const auto t0 = std::chrono::steady_clock::now();
+        while ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - t0).count() < flushNs) {}
+    }
+};
+
+// Runs land in order, one flush per commit, a full batch commits itself.
+static void TestPteBatch() {
+    SimGgtt g(4096);
+    static FXE_PteBatch b;
+    b.init(&g);
+    bool ok = b.commit() == 0 && g.flushes == 0;            // empty: no flush
+
+    for (uint64_t i = 0; i < 8; ++i) b.add(100 + i, 0x1000 + i);
+    for (uint64_t i = 0; i < 4; ++i) b.add(10 + i, 0x2000 + i);
+    ok = ok && b.pending() == 12 && g.table[100] == 0;      // nothing stored yet
+    ok = ok && b.commit() == 12 && g.flushes == 1 && b.stats().runs == 2;
+    ok = ok && g.table[107] == 0x1007 && g.table[13] == 0x2003 && g.table[108] == 0;
+
+    b.clear(100, 8);                                        // unmap, then remap part
+    for (uint64_t i = 0; i < 4; ++i) b.add(102 + i, 0x3000 + i);
+    ok = ok && b.commit() == 12 && g.flushes == 2;
+    ok = ok && g.table[101] == 0 && g.table[102] == 0x3000 && g.table[106] == 0;
+
+    for (uint64_t i = 0; i < FXE_PteBatch::kMaxPtes + 10; ++i) b.add(1000 + i, i + 1);
+    ok = ok && b.stats().fullCommits == 1 && b.pending() == 10 && g.flushes == 3;
+    ok = ok && b.commit() == 10 && g.table[1000 + FXE_PteBatch::kMaxPtes + 9] == FXE_PteBatch::kMaxPtes + 10;
+
+    for (uint64_t i = 0; i < FXE_PteBatch::kMaxRuns + 1; ++i) b.add(i * 2, 7);   // all disjoint
+    ok = ok && b.stats().fullCommits == 2 && b.pending() == 1;
+    b.commit();
+
+    b.add(4094, 1); b.add(4095, 2); b.add(4096, 3);          // runs off the table
+    ok = ok && b.commit() == 2 && b.stats().dropped == 1 && g.table[4095] == 2;
+
+    printf("{\"step\":\"PteBatch\",\"ok\":%s,\"ptes\":%llu,\"runs\":%llu,\"commits\":%llu,"
+           "\"fullCommits\":%llu}\n", ok ? "true" : "false",
+           (unsigned long long)b.stats().ptes, (unsigned long long)b.stats().runs,
+           (unsigned long long)b.stats().commits, (unsigned long long)b.stats().fullCommits);
+    if (!ok) gFailures++;
+}
+
+// Large entries go where index and phys are both aligned, 4 KB elsewhere;
+// each large entry sits in the first slot it covers.
+static void TestLargePages() {
+    SimGgtt g(8192);
+    g.sizes = FXE_PAGE_4K | FXE_PAGE_64K | FXE_PAGE_2M;
+    static FXE_PteBatch b;
+    b.init(&g);
+    const uint64_t k64 = 16, k2m = 512;         // 4 KB slots per entry
+
+    // 2 MB aligned on both sides, plus a 64 KB and a 4 KB tail
+    FXE_PteMapInfo a = {};
+    uint32_t n = b.addRun(k2m, 0x40000000, k2m + k64 + 1, &a);
+    b.commit();
+    bool ok = n == 3 && a.ptes == 3 && a.ptesSaved == (k2m - 1) + (k64 - 1) && a.pageSize == FXE_PAGE_2M;
+    ok = ok && g.table[k2m] == g.encode(0x40000000, FXE_PAGE_2M) && g.table[k2m + 1] == 0;
+    ok = ok && g.table[2 * k2m] == g.encode(0x40200000, FXE_PAGE_64K);
+    ok = ok && g.table[2 * k2m + k64] == g.encode(0x40210000, FXE_PAGE_4K);
+
+    // 4 KB entries until index and phys line up, then 64 KB
+    FXE_PteMapInfo c = {};
+    b.addRun(3 * k2m + 8, 0x50008000, 40, &c);
+    b.commit();
+    ok = ok && c.ptes == 8 + 2 && c.pageSize == FXE_PAGE_64K;
+    ok = ok && g.table[3 * k2m + 16] == g.encode(0x50010000, FXE_PAGE_64K);
+    FXE_PteMapInfo e = {};                      // never lined up
+    b.addRun(3 * k2m + 64, 0x50008000, 32, &e);
+    b.commit();
+    ok = ok && e.ptes == 32 && e.ptesSaved == 0;
+
+    // large entries in a row share one store run
+    const uint64_t runsBefore = b.stats().runs;
+    b.addRun(4 * k2m, 0x60000000, 8 * k64);
+    b.commit();
+    ok = ok && b.stats().runs == runsBefore + 1 && b.stats().large64K == 1 + 2 + 8;
+
+    // 4 KB-only tables never see a large entry
+    g.sizes = FXE_PAGE_4K;
+    FXE_PteMapInfo d = {};
+    ok = ok && b.addRun(6 * k2m, 0x40000000, k2m, &d) == k2m && d.ptesSaved == 0;
+    b.commit();
+    ok = ok && FXE_PteBatch::alignFor(FXE_PAGE_4K | FXE_PAGE_64K, 1 << 20) == FXE_PAGE_64K;
+    ok = ok && FXE_PteBatch::alignFor(g.sizes, 8 << 20) == FXE_PAGE_4K;
+
+    printf("{\"step\":\"LargePages\",\"ok\":%s,\"large2M\":%llu,\"large64K\":%llu,\"ptesSaved\":%llu}\n",
+           ok ? "true" : "false", (unsigned long long)b.stats().large2M,
+           (unsigned long long)b.stats().large64K, (unsigned long long)b.stats().ptesSaved);
+    if (!ok) gFailures++;
+}
+
+// PTE writes per map for driver-shaped objects: physically contiguous
+// (the framebuffer), 64 KB-contiguous chunks, and 4 KB scatter. Each
+// object is mapped segment by segment, as ggttMapDeferred() does.
+static void ReportLargePageSavings() {
+    struct Obj { const char* name; uint64_t bytes; uint64_t segBytes; };
+    const Obj objs[] = {
+        { "Framebuffer8M", 8 * kMB, 8 * kMB },
+        { "Surface4M_64KChunks", 4 * kMB, 64 * 1024 },
+        { "Surface1M_Scattered", 1 * kMB, 4096 },
+        { "Batch16K", 16 * 1024, 16 * 1024 },
+    };
+    SimGgtt g(64 * 1024);
+    g.sizes = FXE_PAGE_4K | FXE_PAGE_64K | FXE_PAGE_2M;
+    static FXE_GgttSpace s;
+    static FXE_PteBatch b;
+    s.init(kSpaceBase, g.count << 12);
+    b.init(&g);
+    for (const Obj& o : objs) {
+        uint64_t addr = 0;
+        bool ok = s.alloc(o.bytes, FXE_PteBatch::alignFor(g.sizes, o.bytes), 0, UINT64_MAX, &addr);
+        FXE_PteMapInfo info = {};
+        uint64_t phys = 0x100000000ULL;             // 2 MB aligned; chunks placed 2 MB apart
+        for (uint64_t off = 0; ok && off < o.bytes; off += o.segBytes) {
+            b.addRun((addr + off) >> 12, phys, o.segBytes >> 12, &info);
+            phys += o.segBytes < (2u << 20) ? (2u << 20) : o.segBytes;
+        }
+        b.commit();
+        const uint32_t pages = (uint32_t)(o.bytes >> 12);
+        ok = ok && info.ptes + info.ptesSaved == pages;
+        printf("{\"step\":\"LargePageMap_%s\",\"ok\":%s,\"pages\":%u,\"segments\":%u,"
+               "\"ptes\":%u,\"ptesSaved\":%u,\"pageSizeK\":%u}\n",
+               o.name, ok ? "true" : "false", pages, info.segments, info.ptes, info.ptesSaved,
+               info.pageSize >> 10);
+        if (!ok) gFailures++;
+    }
+}
+
+// Map and unmap groups of `group` objects (1-16 pages each), either with a
+// flush after every object (the old ggttMap/ggttUnmap path) or with one
+// commit per group. Returns PTE writes per second; *flushes and the final
+// table are compared between the two modes.
+static double ReplayPteWrites(SimGgtt& g, uint32_t rounds, uint32_t group, bool batched,
+                              uint64_t seed, uint64_t* flushes) {
+    static FXE_GgttSpace s;
+    static FXE_PteBatch b;
+    s.init(kSpaceBase, g.count << 12);
+    b.init(&g);
+    memset(g.table, 0, g.count * 8);
+    g.flushes = 0;
+    gRng = seed;
+
+    uint64_t addr[64];
+    uint64_t ptes = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (uint32_t o = 0; o < group; ++o) {
+            const uint64_t pages = RandRange(1, 16);
+            addr[o] = 0;
+            if (!s.alloc(pages << 12, &addr[o])) continue;
+            const uint64_t phys = Rand() & 0x0000007FFFFFF000ULL;
+            for (uint64_t p = 0; p < pages; ++p)
+                b.add((addr[o] >> 12) + p, (phys + (p << 12)) | 1);
+            ptes += pages;
+            if (!batched) b.commit();
+        }
+        if (batched) b.commit();
+        // unmap the older half of the group, keep the rest mapped a round
+        for (uint32_t o = 0; o < group; o += 2) {
+            if (!addr[o]) continue;
+            const uint64_t bytes = s.free(addr[o]);
+            b.clear(addr[o] >> 12, bytes >> 12);
+            ptes += bytes >> 12;
+            if (!batched) b.commit();
+        }
+        if (batched) b.commit();
+        for (uint32_t o = 1; o < group; o += 2) {
+            if (!addr[o]) continue;
+            const uint64_t bytes = s.free(addr[o]);
+            b.clear(addr[o] >> 12, bytes >> 12);
+            ptes += bytes >> 12;
+            if (!batched) b.commit();
+        }
+        if (batched) b.commit();
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    *flushes = g.flushes;
+    const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    return ns > 0 ? ptes * 1e9 / ns : 0.0;
+}
+
+static void BenchmarkPteBatch(uint32_t rounds) {
+    const uint32_t group = 8;
+    const uint64_t flushCosts[] = { 0, 500, 2000 };
+    SimGgtt single(64 * 1024), batched(64 * 1024);
+    for (uint64_t cost : flushCosts) {
+        single.flushNs = batched.flushNs = cost;
+        uint64_t singleFlushes = 0, batchedFlushes = 0;
+        const double a = ReplayPteWrites(single, rounds, group, false, 0xB47C, &singleFlushes);
+        const double c = ReplayPteWrites(batched, rounds, group, true, 0xB47C, &batchedFlushes);
+        // same final table; 3 flushes a round instead of 2 per object
+        const bool ok = !memcmp(single.table, batched.table, single.count * 8) &&
+                        batchedFlushes == (uint64_t)rounds * 3 &&
+                        singleFlushes == (uint64_t)rounds * group * 2 &&
+                        (cost == 0 || c > a);
+        printf("{\"step\":\"PteWrites_flush%lluns\",\"ok\":%s,\"rounds\":%u,\"objectsPerCommit\":%u,"
+               "\"perObjectFlushes\":%llu,\"batchedFlushes\":%llu,"
+               "\"perObjectPtesPerSec\":%.0f,\"batchedPtesPerSec\":%.0f,\"speedup\":%.2f}\n",
+               (unsigned long long)cost, ok ? "true" : "false", rounds, group,
+               (unsigned long long)singleFlushes, (unsigned long long)batchedFlushes, a, c,
+               a > 0 ? c / a : 0.0);
+        if (!ok) gFailures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    TestCoalesce();
+    TestPlacement();
+    TestTags();
+    TestEviction();
+    const uint64_t seeds[] = { 1, 0xC0FFEE, 0x5EED5EED };
+    for (uint64_t seed : seeds) {
+        TestFuzz(seed, FXE_GgttSpace::kFirstFit, "first");
+        TestFuzz(seed, FXE_GgttSpace::kBestFit, "best");
+    }
+    TestPteBatch();
+    TestLargePages();
+    ReportLargePageSavings();
+    BenchmarkTraces(argc > 1 ? (uint32_t)atoi(argv[1]) : 200000);
+    BenchmarkPteBatch(argc > 2 ? (uint32_t)atoi(argv[2]) : 20000);
+    BenchmarkSession(argc > 3 ? (uint32_t)atoi(argv[3]) : 200000);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+// Host-side test for the per-process page tables (FXE_Ppgtt.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_ppgtt_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FXE_Ppgtt.hpp"
+
+static int gFailures = 0;
+
+// Table pages are heap blocks at fake physical addresses; freePage()
+// checks that every one comes back empty.
+class HostPages : public FXE_PtPagePlatform {
+public:
+    uint64_t allocated = 0;
+    uint64_t freed = 0;
+    uint64_t nonZeroFrees = 0;      // a page went back with live entries
+    uint32_t failAfter = ~0u;       // refuse allocations past this many
+
+    bool allocPage(FXE_PtPage* out) override {
+        if (allocated >= failAfter) return false;
+        uint64_t* p = (uint64_t*)aligned_alloc(4096, 4096);
+        if (!p) return false;
+        memset(p, 0, 4096);
+        out->cookie = p;
+        out->cpu = p;
+        out->phys = 0x100000000ULL + (++allocated << 12);
+        return true;
+    }
+    void freePage(const FXE_PtPage& page) override {
+        for (uint32_t i = 0; i < FXE_Ppgtt::kEntries; ++i)
+            if (page.cpu[i]) { nonZeroFrees++; break; }
+        freed++;
+        free(page.cookie);
+    }
+};
+
+class HostPlatform : public FXE_PpgttPlatform {
+public:
+    uint64_t invalidations = 0;
+    void* allocMeta(size_t bytes) override { return calloc(1, bytes); }
+    void freeMeta(void* p, size_t) override { free(p); }
+    void invalidateTlb() override { invalidations++; }
+};
+
+static void Report(const char* step, bool ok, const FXE_Ppgtt& vm, const FXE_PtPool& pool) {
+    const FXE_PpgttStats& st = vm.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"tables\":%u,\"peakTables\":%u,\"ptesWritten\":%llu,"
+           "\"ptesCleared\":%llu,\"invalidations\":%llu,\"poolHits\":%llu,\"poolCached\":%u}\n",
+           step, ok ? "true" : "false", st.tables, st.peakTables,
+           (unsigned long long)st.ptesWritten, (unsigned long long)st.ptesCleared,
+           (unsigned long long)st.invalidations, (unsigned long long)pool.stats().hits,
+           pool.stats().cached);
+    if (!ok) gFailures++;
+}
+
+// Tables appear with the first mapping in their range and go with the last.
+static void TestLazyTables() {
+    HostPages pages;
+    HostPlatform plat;
+    static FXE_PtPool pool;
+    static FXE_Ppgtt vm;
+    pool.init(&pages);
+    bool ok = vm.init(&pool, &plat) && vm.stats().tables == 1 && vm.root() != 0;
+
+    uint64_t a = 0, b = 0;
+    ok = ok && vm.bind(4096, 0, &a) && a >= FXE_Ppgtt::kVaBase;
+    ok = ok && vm.map(a, 0x5000, 1) && vm.stats().tables == 4;             // PDP, PD, PT
+    ok = ok && vm.translate(a + 0x123) == 0x5123 && vm.translate(a + 4096) == 0;
+
+    // 3 MB at a 2 MB boundary: one more PT for the second half
+    ok = ok && vm.bind(3 << 20, 2 << 20, &b) && vm.map(b, 0x40000000ULL, (3 << 20) >> 12);
+    ok = ok && vm.stats().tables == 6 && vm.translate(b + (2 << 20)) == 0x40000000ULL + (2 << 20);
+    ok = ok && plat.invalidations == 0 && !vm.commit();                    // new entries: no flush
+
+    ok = ok && vm.unbind(b) == (3u << 20) && vm.stats().tables == 4;
+    ok = ok && pool.stats().cached == 0;                                   // held until the flush
+    ok = ok && vm.commit() && plat.invalidations == 1 && pool.stats().cached == 2;
+    ok = ok && vm.unbind(a) == 4096 && vm.commit() && vm.stats().tables == 1;
+    ok = ok && vm.unbind(a) == 0;
+    vm.destroy();
+    pool.drain();
+    ok = ok && pages.freed == pages.allocated && pages.nonZeroFrees == 0;
+    Report("LazyTables", ok, vm, pool);
+}
+
+// Many unmaps, one invalidation; a full set of emptied tables commits
+// early rather than holding pages.
+static void TestBatchedFlush() {
+    HostPages pages;
+    HostPlatform plat;
+    static FXE_PtPool pool;
+    static FXE_Ppgtt vm;
+    pool.init(&pages);
+    bool ok = vm.init(&pool, &plat);
+
+    static uint64_t va[200];
+    for (uint32_t i = 0; i < 200; ++i)          // each in its own 2 MB: its own PT
+        ok = ok && vm.bind(64 << 10, 2 << 20, &va[i]) && vm.map(va[i], 0x80000000ULL, 16);
+    vm.commit();
+    ok = ok && plat.invalidations == 0;
+    for (uint32_t i = 0; i < 200; ++i) vm.unbind(va[i]);
+    vm.commit();
+    // 200 PTs, their PD and PDP in kMaxDeferred batches
+    ok = ok && plat.invalidations == (200 + 2 + FXE_Ppgtt::kMaxDeferred - 1) / FXE_Ppgtt::kMaxDeferred;
+    ok = ok && vm.stats().tables == 1 && pages.nonZeroFrees == 0;          // the PML4 stays
+    vm.destroy();
+    pool.drain();
+    ok = ok && pages.freed == pages.allocated;
+    Report("BatchedFlush", ok, vm, pool);
+}
+
+// A failed table allocation fails the map; the space stays usable and a
+// destroyed client's tables feed the next one through the shared pool.
+static void TestPoolAndFailure() {
+    HostPages pages;
+    HostPlatform plat;
+    static FXE_PtPool pool;
+    static FXE_Ppgtt a, b;
+    pool.init(&pages);
+    bool ok = a.init(&pool, &plat);
+
+    uint64_t va = 0;
+    pages.failAfter = 2;                        // PML4 + PDP only
+    ok = ok && a.bind(4096, 0, &va) && !a.map(va, 0x1000, 1) && a.stats().failures == 1;
+    pages.failAfter = ~0u;
+    ok = ok && a.map(va, 0x1000, 1) && a.translate(va) == 0x1000;
+    a.destroy();
+
+    const uint64_t before = pages.allocated;
+    ok = ok && b.init(&pool, &plat) && b.bind(4096, 0, &va) && b.map(va, 0x2000, 1);
+    ok = ok && pages.allocated == before && pool.stats().hits >= 4;
+    b.destroy();
+    pool.drain();
+    ok = ok && pages.freed == pages.allocated && pages.nonZeroFrees == 0;
+    Report("PoolAndFailure", ok, b, pool);
+}
+
+// `clients` processes each mapping `perClientMB` in 1 MB objects. In one
+// shared GGTT aperture the total does not fit; each PPGTT holds its own.
+static void TestClientPressure(uint32_t clients, uint32_t perClientMB) {
+    const uint64_t aperture = 4ULL << 30;
+    static FXE_GgttSpace ggtt;
+    ggtt.init(0, aperture);
+    uint64_t ggttFailures = 0;
+    for (uint32_t c = 0; c < clients; ++c)
+        for (uint32_t m = 0; m < perClientMB; ++m) {
+            uint64_t a;
+            if (!ggtt.alloc(1 << 20, &a)) ggttFailures++;
+        }
+
+    HostPages pages;
+    HostPlatform plat;
+    static FXE_PtPool pool;
+    pool.init(&pages);
+    static FXE_Ppgtt vm[16];
+    uint64_t vmFailures = 0, tables = 0;
+    for (uint32_t c = 0; c < clients && c < 16; ++c) {
+        if (!vm[c].init(&pool, &plat)) { vmFailures++; continue; }
+        for (uint32_t m = 0; m < perClientMB; ++m) {
+            uint64_t a;
+            if (!vm[c].bind(1 << 20, 0, &a) || !vm[c].map(a, (uint64_t)m << 20, 256)) vmFailures++;
+        }
+        vm[c].commit();
+        tables += vm[c].stats().tables;
+    }
+    for (uint32_t c = 0; c < clients && c < 16; ++c) vm[c].destroy();
+    pool.drain();
+
+    const bool ok = ggttFailures > 0 && vmFailures == 0 && pages.freed == pages.allocated;
+    printf("{\"step\":\"ClientPressure\",\"ok\":%s,\"clients\":%u,\"perClientMB\":%u,"
+           "\"ggttFailures\":%llu,\"ppgttFailures\":%llu,\"tablePages\":%llu,\"tableKB\":%llu}\n",
+           ok ? "true" : "false", clients, perClientMB, (unsigned long long)ggttFailures,
+           (unsigned long long)vmFailures, (unsigned long long)tables,
+           (unsigned long long)(tables * 4));
+    if (!ok) gFailures++;
+}
+
+int main() {
+    TestLazyTables();
+    TestBatchedFlush();
+    TestPoolAndFailure();
+    TestClientPressure(8, 768);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,349 @@
+// Host-side test for ring-buffer space accounting (FXE_RingSpace.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_ring_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FXE_RingSpace.hpp"
+
+static int gFailures = 0;
+
+static const uint32_t kBatchStart = (0x31u << 23) | (1 << 8);
+static const uint32_t kBatchEnd   = (0x0Au << 23);
+
+// A command streamer that consumes `rate` dwords per step between its
+// head and the published tail and checks what it reads: MI_NOOPs are
+// skipped, every batch packet must be whole, contiguous and carry the
+// next id.
+struct SimEngine {
+    uint32_t* ring = nullptr;
+    uint32_t  size = 0;         // bytes
+    uint32_t  head = 0;
+    uint32_t  tail = 0;
+    uint32_t  expect = 0;       // next packet id
+    uint64_t  executed = 0;
+    uint64_t  bad = 0;          // out of order, torn or garbage
+    uint64_t  credit = 0;       // dwords the engine may still consume
+
+    void step(uint32_t rate) {
+        credit = rate == ~0u ? ~0ULL : credit + rate;
+        while (credit && head != tail) {
+            const uint32_t d = ring[head >> 2];
+            if (d != 0 && d == kBatchStart && head + 16 <= size) {
+                if (credit < 4) break;
+                const uint32_t id = ring[(head >> 2) + 1];
+                if (id != expect || ring[(head >> 2) + 3] != kBatchEnd) bad++;
+                expect = id + 1;
+                executed++;
+                head = (head + 16) % size;
+                credit -= 4;
+                continue;
+            }
+            if (d != 0) bad++;
+            head = (head + 4) % size;
+            credit--;
+        }
+        if (head == tail) credit = 0;
+    }
+};
+
+class SimRing : public FXE_RingPlatform {
+public:
+    SimEngine* engine = nullptr;
+    uint32_t rate = 4;          // dwords consumed per back-off
+    uint32_t maxAttempts = ~0u;
+    uint64_t tailWrites = 0;
+
+    uint32_t readHead() override { return engine->head; }
+    void writeTail(uint32_t tail) override {
+        engine->tail = tail;
+        tailWrites++;
+    }
+    bool waitForSpace(uint32_t attempt) override {
+        if (attempt >= maxAttempts) return false;
+        engine->step(rate);
+        return true;
+    }
+};
+
+static void Emit(uint32_t* p, uint32_t id) {
+    p[0] = kBatchStart;
+    p[1] = id;
+    p[2] = 0;
+    p[3] = kBatchEnd;
+}
+
+static void Report(const char* step, bool ok, const FXE_RingSpace& r, const SimEngine& e) {
+    const FXE_RingStats& st = r.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"reserves\":%llu,\"commits\":%llu,\"headReads\":%llu,"
+           "\"waits\":%llu,\"wraps\":%llu,\"padDwords\":%llu,\"timeouts\":%llu,\"peakUsed\":%u,"
+           "\"executed\":%llu,\"bad\":%llu}\n",
+           step, ok ? "true" : "false", (unsigned long long)st.reserves,
+           (unsigned long long)st.commits, (unsigned long long)st.headReads,
+           (unsigned long long)st.waits, (unsigned long long)st.wraps,
+           (unsigned long long)st.padDwords, (unsigned long long)st.timeouts, st.peakUsed,
+           (unsigned long long)e.executed, (unsigned long long)e.bad);
+    if (!ok) gFailures++;
+}
+
+// Several packets, one tail write; an empty ring needs no head read.
+static void TestCommit() {
+    static uint32_t mem[1024];
+    SimEngine e;
+    e.ring = mem;
+    e.size = sizeof(mem);
+    SimRing plat;
+    plat.engine = &e;
+    static FXE_RingSpace r;
+    r.init(&plat, mem, sizeof(mem));
+
+    bool ok = true;
+    for (uint32_t i = 0; i < 8; ++i) {
+        uint32_t* p = r.reserve(4);
+        ok = ok && p;
+        if (p) Emit(p, i);
+    }
+    ok = ok && plat.tailWrites == 0 && r.commit() && plat.tailWrites == 1 && !r.commit();
+    ok = ok && r.tail() == 8 * 16 && r.stats().headReads == 0;
+
+    uint32_t* p = r.reserve(3);                 // odd: padded to a qword
+    ok = ok && p && p[3] == FXE_RingSpace::kNoop && r.stats().padDwords == 1;
+    if (p) { p[0] = 0; p[1] = 0; p[2] = 0; }
+    ok = ok && r.commit() && r.tail() == 8 * 16 + 16;
+    ok = ok && !r.reserve(0) && !r.reserve(1024) && r.stats().tooLarge == 2;
+    e.step(~0u);
+    ok = ok && e.executed == 8 && e.bad == 0 && e.head == e.tail;
+    Report("Commit", ok, r, e);
+}
+
+// A packet that does not fit before the end starts at 0 behind MI_NOOPs.
+static void TestWrap() {
+    static uint32_t mem[64];                    // 256 bytes
+    SimEngine e;
+    e.ring = mem;
+    e.size = sizeof(mem);
+    SimRing plat;
+    plat.engine = &e;
+    static FXE_RingSpace r;
+    r.init(&plat, mem, sizeof(mem));
+
+    bool ok = true;
+    for (uint32_t i = 0; i < 5; ++i) {          // 80 bytes, then 6 dwords of filler
+        uint32_t* p = r.reserve(4);
+        if (p) Emit(p, i);
+    }
+    uint32_t* f = r.reserve(6);
+    ok = ok && f;
+    if (f) memset(f, 0, 24);
+    r.commit();
+    e.step(~0u);                                // engine idle at 104
+    for (uint32_t i = 5; i < 14; ++i) {         // 9 more: 144 bytes fit before the end
+        uint32_t* p = r.reserve(4);
+        ok = ok && p;
+        if (p) Emit(p, i);
+    }
+    ok = ok && r.stats().wraps == 0;
+    uint32_t* w = r.reserve(4);                 // 8 bytes left before the end
+    ok = ok && w == mem && r.stats().wraps == 1 && mem[62] == 0 && mem[63] == 0;
+    if (w) Emit(w, 14);
+    r.commit();
+    e.step(~0u);
+    ok = ok && e.executed == 15 && e.bad == 0 && e.head == 16;
+    Report("Wrap", ok, r, e);
+}
+
+// A stuck engine: the reservation gives up and nothing it has not read
+// is touched.
+static void TestStall() {
+    static uint32_t mem[256];
+    SimEngine e;
+    e.ring = mem;
+    e.size = sizeof(mem);
+    SimRing plat;
+    plat.engine = &e;
+    plat.rate = 0;
+    plat.maxAttempts = 100;
+    static FXE_RingSpace r;
+    r.init(&plat, mem, sizeof(mem));
+
+    uint32_t n = 0;
+    for (uint32_t* p; (p = r.reserve(4)); ++n) Emit(p, n);
+    r.commit();
+    const uint32_t tail = r.tail();
+    bool ok = n == (sizeof(mem) - FXE_RingSpace::kGap) / 16 && r.stats().timeouts == 1;
+    ok = ok && r.stats().waits == 100 && !r.reserve(4) && r.tail() == tail;
+    e.step(~0u);
+    ok = ok && e.executed == n && e.bad == 0;
+    Report("Stall", ok, r, e);
+}
+
+// Commits inside plug()/unplug() share one tail write; a plugged batch
+// bigger than the ring publishes what it has to make room.
+static void TestPlug() {
+    static uint32_t mem[64];                    // 256 bytes
+    SimEngine e;
+    e.ring = mem;
+    e.size = sizeof(mem);
+    SimRing plat;
+    plat.engine = &e;
+    static FXE_RingSpace r;
+    r.init(&plat, mem, sizeof(mem));
+
+    bool ok = true;
+    r.plug();
+    r.plug();                                   // nested
+    for (uint32_t i = 0; i < 8; ++i) {
+        uint32_t* p = r.reserve(4);
+        if (p) Emit(p, i);
+        ok = ok && r.commitDeferred(0) == FXE_RING_DEFERRED;
+    }
+    ok = ok && !r.unplug(0) && plat.tailWrites == 0 && r.unplug(0) && plat.tailWrites == 1;
+    e.step(~0u);
+    ok = ok && e.executed == 8;
+
+    r.plug();
+    for (uint32_t i = 8; i < 48; ++i) {         // 640 bytes through a 256-byte ring
+        uint32_t* p = r.reserve(4);
+        ok = ok && p;
+        if (p) Emit(p, i);
+        r.commitDeferred(0);
+    }
+    r.unplug(0);
+    e.step(~0u);
+    ok = ok && e.executed == 48 && e.bad == 0 && r.stats().flushedByWait > 0;
+    ok = ok && r.stats().timeouts == 0 && plat.tailWrites < 48;
+    Report("Plug", ok, r, e);
+}
+
+// Submissions every `intervalNs` with a coalescing window: a quiet ring
+// publishes at once, a busy one writes the tail about once a window and
+// no packet waits longer than the window for it. A timer fires at the
+// deadline; the engine keeps up.
+struct TimedRing : public SimRing {
+    uint64_t now = 0;
+    uint64_t oldest = 0;        // submit time of the oldest unpublished packet
+    uint32_t unpublished = 0;
+    uint64_t maxLatency = 0;
+    void writeTail(uint32_t tail) override {
+        SimRing::writeTail(tail);
+        if (unpublished && now - oldest > maxLatency) maxLatency = now - oldest;
+        unpublished = 0;
+        engine->step(~0u);
+    }
+};
+
+static void TestCoalesce(uint64_t intervalNs, uint32_t packets) {
+    const uint64_t window = 50000;
+    static uint32_t mem[1024];
+    SimEngine e;
+    e.ring = mem;
+    e.size = sizeof(mem);
+    TimedRing plat;
+    plat.engine = &e;
+    static FXE_RingSpace r;
+    r.init(&plat, mem, sizeof(mem));
+    r.setCoalesce(window, 16);
+
+    for (uint32_t i = 0; i < packets; ++i) {
+        plat.now = 1000000 + i * intervalNs;
+        if (r.pending() && r.deadline() <= plat.now) {
+            const uint64_t submitted = plat.now;
+            plat.now = r.deadline();            // the timer
+            r.flushDue(plat.now);
+            plat.now = submitted;
+        }
+        uint32_t* p = r.reserve(4);
+        if (p) Emit(p, i);
+        if (!plat.unpublished++) plat.oldest = plat.now;
+        r.commitDeferred(plat.now);
+    }
+    plat.now = r.deadline();
+    r.flushDue(plat.now);
+
+    const bool sparse = intervalNs >= window;
+    const bool ok = e.executed == packets && e.bad == 0 && plat.maxLatency <= window &&
+                    (sparse ? plat.tailWrites == packets : plat.tailWrites * 4 < packets);
+    printf("{\"step\":\"Coalesce\",\"ok\":%s,\"intervalNs\":%llu,\"packets\":%u,\"tailWrites\":%llu,"
+           "\"coalesced\":%llu,\"maxLatencyNs\":%llu}\n",
+           ok ? "true" : "false", (unsigned long long)intervalNs, packets,
+           (unsigned long long)plat.tailWrites, (unsigned long long)r.stats().coalesced,
+           (unsigned long long)plat.maxLatency);
+    if (!ok) gFailures++;
+}
+
+// The old pushDword ring: writes wrap without looking at the head and the
+// tail is written after every packet.
+struct LegacyRing {
+    uint32_t* ring;
+    uint32_t  size;
+    uint32_t  write = 0;
+    void push(uint32_t d) {
+        ring[(write >> 2) % (size >> 2)] = d;
+        write += 4;
+        if (write >= size) write = 0;
+    }
+};
+
+// A burst of `packets` submissions against an engine that consumes
+// `rate` dwords for every packet queued. When it falls behind the old
+// ring overwrites what the engine has not read yet and the reserved ring
+// waits for it; when it keeps up the cached head spares most head reads.
+static void TestBurst(uint32_t packets, uint32_t rate) {
+    static uint32_t memA[1024], memB[1024];
+    SimEngine legacyEngine;
+    legacyEngine.ring = memA;
+    legacyEngine.size = sizeof(memA);
+    LegacyRing legacy = { memA, (uint32_t)sizeof(memA) };
+    for (uint32_t i = 0; i < packets; ++i) {
+        legacy.push(kBatchStart);
+        legacy.push(i);
+        legacy.push(0);
+        legacy.push(kBatchEnd);
+        legacyEngine.tail = legacy.write;
+        legacyEngine.step(rate);
+    }
+    legacyEngine.step(~0u);
+
+    SimEngine e;
+    e.ring = memB;
+    e.size = sizeof(memB);
+    SimRing plat;
+    plat.engine = &e;
+    plat.rate = rate;
+    static FXE_RingSpace r;
+    r.init(&plat, memB, sizeof(memB));
+    for (uint32_t i = 0; i < packets; ++i) {
+        uint32_t* p = r.reserve(4);
+        if (p) Emit(p, i);
+        r.commit();
+        e.step(rate);
+    }
+    e.step(~0u);
+
+    const uint64_t lost = packets - legacyEngine.executed + legacyEngine.bad;
+    const bool behind = rate < 4;
+    const bool ok = e.executed == packets && e.bad == 0 && (behind ? lost > 0 : lost == 0) &&
+                    (behind || r.stats().headReads * 16 < r.stats().reserves);
+    printf("{\"step\":\"Burst\",\"ok\":%s,\"packets\":%u,\"rate\":%u,\"legacyExecuted\":%llu,"
+           "\"legacyLostOrTorn\":%llu,\"executed\":%llu,\"bad\":%llu,\"headReads\":%llu,"
+           "\"waits\":%llu,\"wraps\":%llu,\"peakUsed\":%u}\n",
+           ok ? "true" : "false", packets, rate, (unsigned long long)legacyEngine.executed,
+           (unsigned long long)lost, (unsigned long long)e.executed, (unsigned long long)e.bad,
+           (unsigned long long)r.stats().headReads, (unsigned long long)r.stats().waits,
+           (unsigned long long)r.stats().wraps, r.stats().peakUsed);
+    if (!ok) gFailures++;
+}
+
+int main() {
+    TestCommit();
+    TestWrap();
+    TestStall();
+    TestPlug();
+    TestCoalesce(5000, 10000);
+    TestCoalesce(200000, 1000);
+    TestBurst(20000, 2);
+    TestBurst(20000, 6);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+// Host-side test for the execlist scheduling core (FXE_Sched.hpp).
+// Builds without IOKit: clang++ -std=c++17 -I../FakeIrisXE fxe_sched_host_test.cpp
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FXE_Sched.hpp"
+
+// Minimal engine: each request has a fixed amount of work (ns); a running
+// port advances its request's ring head 1:1 with elapsed time. A preempt
+// lands after kPreemptLatencyNs and reports the head reached so far.
+struct SimJob {
+    uint32_t ctxId;
+    uint32_t priority;
+    uint64_t workNs;
+    uint64_t doneNs;
+    uint64_t finishedAt;
+    int32_t  slot;
+    bool     finished;
+};
+
+struct SimEngine {
+    static const uint64_t kPreemptLatencyNs = 50000;
+
+    FXE_Scheduler sched;
+    SimJob   jobs[FXE_Scheduler::kCapacity];
+    uint32_t jobCount = 0;
+    int32_t  slotToJob[FXE_Scheduler::kCapacity];
+    uint64_t now = 0;
+    uint64_t preemptAt[FXE_Scheduler::kPorts];
+    bool     preemptPending[FXE_Scheduler::kPorts];
+    bool     headMismatch = false;
+
+    void init() {
+        sched.init();
+        memset(jobs, 0, sizeof(jobs));
+        for (auto& s : slotToJob) s = -1;
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            preemptAt[p] = 0;
+            preemptPending[p] = false;
+        }
+    }
+
+    int submit(uint32_t ctxId, uint32_t priority, uint64_t workNs) {
+        SimJob& j = jobs[jobCount];
+        j = SimJob();
+        j.ctxId = ctxId;
+        j.priority = priority;
+        j.workNs = workNs;
+        j.slot = sched.enqueue(ctxId, priority, jobCount + 1, 0, 0);
+        if (j.slot < 0) return -1;
+        slotToJob[j.slot] = (int32_t)jobCount;
+        kick();
+        return (int)jobCount++;
+    }
+
+    void kick() {
+        for (;;) {
+            int port = sched.freePort();
+            int32_t slot = sched.pickNext();
+            if (port < 0 || slot < 0) break;
+            // A resubmitted request must resume exactly where it was saved.
+            SimJob& j = jobs[slotToJob[slot]];
+            if (sched.request(slot).ringHead != (uint32_t)(j.doneNs / 1000)) headMismatch = true;
+            sched.start((uint32_t)port, slot, now);
+        }
+        uint32_t mask = sched.collectPreemptions(now);
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            if (mask & (1u << p)) {
+                preemptPending[p] = true;
+                preemptAt[p] = now + kPreemptLatencyNs;
+            }
+        }
+    }
+
+    // Advance by dt, delivering completions / preempt CSBs in order.
+    void step(uint64_t dt) {
+        now += dt;
+        for (uint32_t p = 0; p < FXE_Scheduler::kPorts; ++p) {
+            int32_t slot = sched.port(p).req;
+            if (slot < 0) continue;
+            SimJob& j = jobs[slotToJob[slot]];
+            j.doneNs += dt;
+            if (j.doneNs >= j.workNs) {
+                j.doneNs = j.workNs;
+                j.finished = true;
+                j.finishedAt = now;
+                preemptPending[p] = false;
+                slotToJob[sched.complete(p)] = -1;
+            } else if (preemptPending[p] && now >= preemptAt[p]) {
+                preemptPending[p] = false;
+                sched.preempted(p, (uint32_t)(j.doneNs / 1000));
+            }
+        }
+        kick();
+    }
+
+    bool runUntilIdle(uint64_t dt, uint64_t limitNs) {
+        while (!sched.idle() && now < limitNs) step(dt);
+        return sched.idle();
+    }
+};
+
+static int gFailures = 0;
+
+static void Report(const char* step, bool ok, const SimEngine& e) {
+    const FXE_SchedStats& st = e.sched.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"completed\":%llu,\"preemptQuantum\":%llu,"
+           "\"preemptPriority\":%llu,\"resubmitted\":%llu,\"timeNs\":%llu}\n",
+           step, ok ? "true" : "false",
+           (unsigned long long)st.completed,
+           (unsigned long long)st.preemptQuantum,
+           (unsigned long long)st.preemptPriority,
+           (unsigned long long)st.resubmitted,
+           (unsigned long long)e.now);
+    if (!ok) gFailures++;
+}
+
+// Two long low-priority jobs own both ports; a high-priority job arrives
+// and must run without waiting for either to finish.
+static void TestPriorityPreempt() {
+    SimEngine e;
+    e.init();
+    e.submit(1, FXE_SCHED_PRIO_LOW, 50000000);
+    e.submit(2, FXE_SCHED_PRIO_LOW, 50000000);
+    e.step(100000);
+    int hi = e.submit(3, FXE_SCHED_PRIO_HIGH, 1000000);
+    bool ok = e.runUntilIdle(10000, 1000000000ULL);
+    const SimJob& h = e.jobs[hi];
+    ok = ok && h.finished && h.finishedAt < 2000000;
+    ok = ok && e.sched.stats().preemptPriority >= 1 && !e.headMismatch;
+    ok = ok && e.jobs[0].finished && e.jobs[1].finished;
+    Report("PriorityPreempt", ok, e);
+}
+
+// Three equal-band hogs on two ports: timeslicing must rotate the waiter
+// in within one quantum instead of starving it behind the others.
+static void TestTimeslice() {
+    SimEngine e;
+    e.init();
+    e.submit(1, FXE_SCHED_PRIO_NORMAL, 20000000);
+    e.submit(2, FXE_SCHED_PRIO_NORMAL, 20000000);
+    e.submit(3, FXE_SCHED_PRIO_NORMAL, 20000000);
+    const uint64_t quantum = e.sched.quantumNs(FXE_SCHED_PRIO_NORMAL);
+
+    uint64_t startedThird = 0;
+    while (!e.sched.idle() && e.now < 1000000000ULL) {
+        e.step(10000);
+        if (!startedThird && e.jobs[2].doneNs) startedThird = e.now;
+    }
+    bool ok = e.sched.idle() && startedThird && startedThird <= quantum + 2 * SimEngine::kPreemptLatencyNs;
+    ok = ok && e.sched.stats().preemptQuantum >= 3 && !e.headMismatch;
+    for (uint32_t i = 0; i < 3; ++i) ok = ok && e.jobs[i].finished && e.jobs[i].doneNs == e.jobs[i].workNs;
+    Report("Timeslice", ok, e);
+}
+
+// Realtime has no quantum: a waiting realtime job is not allowed to slice
+// another realtime job, and lower bands never displace it.
+static void TestRealtimeNotSliced() {
+    SimEngine e;
+    e.init();
+    e.submit(1, FXE_SCHED_PRIO_REALTIME, 10000000);
+    e.submit(2, FXE_SCHED_PRIO_REALTIME, 10000000);
+    e.submit(3, FXE_SCHED_PRIO_REALTIME, 1000000);
+    e.submit(4, FXE_SCHED_PRIO_HIGH, 1000000);
+    bool ok = e.runUntilIdle(10000, 1000000000ULL);
+    ok = ok && e.sched.stats().preemptQuantum == 0 && e.sched.stats().preemptPriority == 0;
+    ok = ok && e.jobs[2].finishedAt >= e.jobs[0].workNs;
+    Report("RealtimeNotSliced", ok, e);
+}
+
+// Faults and cancels free their slots; the table never leaks.
+static void TestFaultCancel() {
+    SimEngine e;
+    e.init();
+    e.submit(1, FXE_SCHED_PRIO_NORMAL, 5000000);
+    e.submit(2, FXE_SCHED_PRIO_NORMAL, 5000000);
+    int q = e.submit(3, FXE_SCHED_PRIO_NORMAL, 5000000);
+    int32_t port = e.sched.portForCtx(1);
+    bool ok = port >= 0 && e.sched.fault((uint32_t)port) >= 0;
+    e.kick();
+    ok = ok && e.sched.portForCtx(3) >= 0;
+    ok = ok && !e.sched.cancel(e.jobs[q].slot); // running requests cannot be cancelled
+    ok = ok && e.runUntilIdle(10000, 1000000000ULL);
+    ok = ok && e.sched.used() == 0 && e.sched.stats().faulted == 1;
+
+    // Fill the table, cancel a queued request, and reuse its slot.
+    e.init();
+    for (uint32_t i = 0; i < FXE_Scheduler::kCapacity; ++i) e.sched.enqueue(10 + i, FXE_SCHED_PRIO_LOW, i, 0, 0);
+    ok = ok && e.sched.enqueue(99, FXE_SCHED_PRIO_LOW, 99, 0, 0) < 0;
+    ok = ok && e.sched.cancel(5) && e.sched.enqueue(99, FXE_SCHED_PRIO_LOW, 99, 0, 0) == 5;
+    Report("FaultCancel", ok, e);
+}
+
+int main() {
+    TestPriorityPreempt();
+    TestTimeslice();
+    TestRealtimeNotSliced();
+    TestFaultCancel();
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}
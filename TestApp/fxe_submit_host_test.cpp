@@ -0,0 +1,274 @@
+// Host-side test for in-flight submission tracking (FXE_SubmitRing.hpp,
+// FXE_FencePage.hpp).
+// Builds without IOKit: clang++ -std=c++17 -O2 -I../FakeIrisXE fxe_submit_host_test.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "FXE_SubmitRing.hpp"
+#include "FXE_FencePage.hpp"
+#include "FXE_BatchPool.hpp"
+
+static int gFailures = 0;
+
+static void Report(const char* step, bool ok, const FXE_SubmitRing& r) {
+    const FXE_SubmitRingStats& st = r.stats();
+    printf("{\"step\":\"%s\",\"ok\":%s,\"pushed\":%llu,\"retired\":%llu,\"full\":%llu,"
+           "\"outOfOrder\":%llu,\"peak\":%u,\"inFlight\":%u}\n",
+           step, ok ? "true" : "false", (unsigned long long)st.pushed,
+           (unsigned long long)st.retired, (unsigned long long)st.full,
+           (unsigned long long)st.outOfOrder, st.peak, r.count());
+    if (!ok) gFailures++;
+}
+
+static void* Tag(uint64_t seq, uint32_t which) { return (void*)(uintptr_t)(seq * 4 + which); }
+
+// Entries come back oldest first and only up to the completed seqno.
+static void TestOrder() {
+    static FXE_SubmitRing r;
+    r.init();
+    bool ok = true;
+    for (uint64_t s = 1; s <= 10; ++s)
+        ok = ok && r.push(s, Tag(s, 2), Tag(s, 0), Tag(s, 1));
+
+    FXE_Submission out[16];
+    uint32_t n = r.retire(4, out, 16);
+    ok = ok && n == 4;
+    for (uint32_t i = 0; i < n; ++i)
+        ok = ok && out[i].seq == i + 1 && out[i].batch == Tag(i + 1, 2) &&
+             out[i].master == Tag(i + 1, 0) && out[i].tail == Tag(i + 1, 1);
+    ok = ok && r.retire(4, out, 16) == 0 && r.oldest() == 5;
+
+    n = r.retire(10, out, 3);                   // bounded batch
+    ok = ok && n == 3 && out[0].seq == 5 && out[2].seq == 7;
+    n = r.retire(10, out, 16);
+    ok = ok && n == 3 && out[2].seq == 10 && r.count() == 0 && r.oldest() == 0;
+    Report("Order", ok, r);
+}
+
+// Skipped seqnos are fine; one completion can cover a gap and several
+// entries. Pushes must stay in increasing order.
+static void TestGaps() {
+    static FXE_SubmitRing r;
+    r.init();
+    bool ok = r.push(1, Tag(1, 2), Tag(1, 0), Tag(1, 1)) && r.push(2, Tag(2, 2), Tag(2, 0), Tag(2, 1)) &&
+              r.push(4, Tag(4, 2), Tag(4, 0), Tag(4, 1)) && r.push(5, Tag(5, 2), Tag(5, 0), Tag(5, 1));
+    ok = ok && !r.push(5, nullptr, nullptr, nullptr) && !r.push(3, nullptr, nullptr, nullptr);
+
+    FXE_Submission out[16];
+    ok = ok && r.retire(3, out, 16) == 2 && out[1].seq == 2;
+    ok = ok && r.retire(5, out, 16) == 2 && out[0].seq == 4 && out[1].seq == 5;
+    ok = ok && r.stats().outOfOrder == 2 && r.stats().pushed == 4 && r.stats().retired == 4;
+    Report("Gaps", ok, r);
+}
+
+// A submission that never reached the engine is taken back and its
+// seqno pushed again; older entries are untouched.
+static void TestPopBack() {
+    static FXE_SubmitRing r;
+    r.init();
+    FXE_Submission s;
+    bool ok = !r.popBack(&s);
+    ok = ok && r.push(1, Tag(1, 2), Tag(1, 0), Tag(1, 1)) && r.push(2, Tag(2, 2), Tag(2, 0), Tag(2, 1));
+    ok = ok && r.popBack(&s) && s.seq == 2 && s.batch == Tag(2, 2) && r.count() == 1;
+    ok = ok && r.push(2, Tag(2, 2), nullptr, nullptr) && r.count() == 2;
+
+    FXE_Submission out[16];
+    ok = ok && r.retire(2, out, 16) == 2 && out[0].seq == 1 && out[1].seq == 2 && !out[1].master;
+    ok = ok && r.stats().pushed == 2 && r.stats().retired == 2;
+    Report("PopBack", ok, r);
+}
+
+// A full ring refuses the push and takes it once something retires;
+// drain() empties it whatever the seqnos.
+static void TestFull() {
+    static FXE_SubmitRing r;
+    r.init();
+    bool ok = true;
+    for (uint64_t s = 1; s <= FXE_SubmitRing::kCapacity; ++s)
+        ok = ok && r.push(s, Tag(s, 2), Tag(s, 0), Tag(s, 1));
+    ok = ok && r.full() && !r.push(FXE_SubmitRing::kCapacity + 1, nullptr, nullptr, nullptr) && r.stats().full == 1;
+
+    FXE_Submission out[16];
+    ok = ok && r.retire(1, out, 16) == 1 && r.push(FXE_SubmitRing::kCapacity + 1, nullptr, nullptr, nullptr);
+
+    uint32_t drained = 0, n;
+    while ((n = r.drain(out, 16)) != 0) drained += n;
+    ok = ok && drained == FXE_SubmitRing::kCapacity && r.count() == 0 &&
+         r.stats().peak == FXE_SubmitRing::kCapacity;
+    Report("Full", ok, r);
+}
+
+// The engine executes tail batches in order and the CPU only sees an
+// interrupt every `perIrq` completions. The old tracking stored a 32-bit
+// seqno into one dword, retired the entry whose seqno matched it exactly
+// and zeroed the dword in the IRQ handler: every completion the interrupt
+// coalesced leaked its entry. The fence page slot only grows, so one read
+// retires everything at or below it.
+static void TestCoalescedIrq(uint32_t submissions, uint32_t perIrq) {
+    static uint8_t page[4096];
+    memset(page, 0, sizeof(page));
+    const uint64_t slotGpu = 0x10000 + FXE_FencePage::offset(FXE_FencePage::kRcs);
+
+    static FXE_SubmitRing r;
+    r.init();
+    uint32_t legacyDword = 0;
+    uint32_t legacyPending = 0, legacyRetired = 0;
+    uint64_t retired = 0, nextSeq = 1, executed = 0;
+    bool ok = true;
+
+    FXE_Submission out[16];
+    while (executed < submissions) {
+        // submit as long as the ring takes it
+        while (nextSeq <= submissions && r.push(nextSeq, Tag(nextSeq, 2), Tag(nextSeq, 0), Tag(nextSeq, 1))) {
+            nextSeq++;
+            legacyPending++;
+        }
+
+        // execute a few tail batches: decode the store the kext emits
+        for (uint32_t i = 0; i < perIrq && executed < nextSeq - 1; ++i) {
+            uint32_t cs[FXE_FencePage::kStoreDwords];
+            const uint64_t seq = ++executed;
+            FXE_FencePage::emitStore(cs, slotGpu, seq);
+            const uint64_t gpu = cs[1] | ((uint64_t)cs[2] << 32);
+            uint64_t v = cs[3] | ((uint64_t)cs[4] << 32);
+            ok = ok && gpu == slotGpu && (cs[0] >> 23) == 0x20 && (cs[0] & 0xFF) == FXE_FencePage::kStoreDwords - 2;
+            memcpy(page + (gpu - 0x10000), &v, sizeof(v));
+            legacyDword = (uint32_t)seq;
+        }
+
+        // one interrupt
+        if (legacyDword) {
+            legacyRetired++;
+            legacyPending--;
+            legacyDword = 0;
+        }
+        const uint64_t done = FXE_FencePage::completed(page, FXE_FencePage::kRcs);
+        uint32_t n;
+        while ((n = r.retire(done, out, 16)) != 0) {
+            for (uint32_t i = 0; i < n; ++i)
+                ok = ok && out[i].seq == retired + 1 + i && FXE_FencePage::passed(done, out[i].seq);
+            retired += n;
+        }
+    }
+
+    ok = ok && retired == submissions && r.count() == 0 &&
+         (perIrq > 1 ? legacyPending > 0 : legacyPending == 0);
+    printf("{\"step\":\"CoalescedIrq\",\"ok\":%s,\"submissions\":%u,\"perIrq\":%u,"
+           "\"retired\":%llu,\"legacyRetired\":%u,\"legacyLeaked\":%u,\"peak\":%u}\n",
+           ok ? "true" : "false", submissions, perIrq, (unsigned long long)retired,
+           legacyRetired, legacyPending, r.stats().peak);
+    if (!ok) gFailures++;
+}
+
+// Chain pool chunks on heap blocks; fences are RCS seqnos read back from
+// a host fence page, as in the kext.
+class ChainPlatform : public FXE_BatchPoolPlatform {
+public:
+    const uint8_t* page = nullptr;
+    uint32_t allocated = 0;
+
+    bool allocChunk(uint32_t bytes, void** cookie, void** cpu, uint64_t* gpu) override {
+        void* p = malloc(bytes);
+        if (!p) return false;
+        *cookie = p;
+        *cpu = p;
+        *gpu = 0x100000ULL * (++allocated);
+        return true;
+    }
+    void releaseChunk(void* cookie) override { free(cookie); }
+    bool fenceDone(const FXE_Fence& f) override {
+        return FXE_FencePage::passed(FXE_FencePage::completed(page, FXE_FencePage::kRcs), f.seqno);
+    }
+};
+
+// Every submission carves its master and tail from the chain pool and is
+// tracked until the engine, `lag` submissions behind, completes it. The
+// chunks are reused as the fence page moves, so a long session stays at
+// a fixed footprint instead of two 4K GEMs per submission in flight.
+static void TestChainPool(uint32_t submissions, uint32_t lag) {
+    static uint8_t page[4096];
+    memset(page, 0, sizeof(page));
+    ChainPlatform plat;
+    plat.page = page;
+    static FXE_BatchPool pool;
+    pool.init(&plat, 64 * 1024);
+    static FXE_SubmitRing r;
+    r.init();
+
+    bool ok = true;
+    uint64_t completed = 0, retired = 0;
+    FXE_Submission out[16];
+    for (uint64_t seq = 1; seq <= submissions; ++seq) {
+        FXE_BatchSlice s;
+        ok = ok && pool.alloc(128, &s);
+        if (!ok) break;
+        FXE_FencePage::emitStore((uint32_t*)s.cpu + 16, 0x10000, seq);
+        FXE_Fence f = {};
+        f.seqno = seq;
+        pool.commit(s, f);
+        ok = ok && r.push(seq, Tag(seq, 2), nullptr, nullptr);
+
+        if (seq > lag) {
+            completed = seq - lag;
+            memcpy(page + FXE_FencePage::offset(FXE_FencePage::kRcs), &completed, sizeof(completed));
+        }
+        if (seq % 8 == 0) {
+            uint32_t n;
+            while ((n = r.retire(completed, out, 16)) != 0) retired += n;
+        }
+    }
+    completed = submissions;
+    memcpy(page + FXE_FencePage::offset(FXE_FencePage::kRcs), &completed, sizeof(completed));
+    uint32_t n;
+    while ((n = r.retire(completed, out, 16)) != 0) retired += n;
+
+    const FXE_BatchPoolStats& st = pool.stats();
+    ok = ok && retired == submissions && st.exhausted == 0 && st.chunkAllocs <= 2;
+    printf("{\"step\":\"ChainPool\",\"ok\":%s,\"submissions\":%u,\"lag\":%u,\"chunks\":%u,"
+           "\"rewinds\":%llu,\"exhausted\":%llu,\"standalonePagesAvoided\":%llu,\"peakInFlight\":%u}\n",
+           ok ? "true" : "false", submissions, lag, st.chunks, (unsigned long long)st.rewinds,
+           (unsigned long long)st.exhausted, 2ULL * submissions, r.stats().peak);
+    pool.drain();
+    if (!ok) gFailures++;
+}
+
+// Steady-state cost of a push and its retirement.
+static void TestThroughput(uint32_t ops) {
+    static FXE_SubmitRing r;
+    r.init();
+    FXE_Submission out[16];
+    uint64_t seq = 0, retired = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ops; ++i) {
+        ++seq;
+        r.push(seq, Tag(seq, 2), Tag(seq, 0), Tag(seq, 1));
+        if (r.count() >= 64) retired += r.retire(seq - 32, out, 16);
+    }
+    uint32_t n;
+    while ((n = r.drain(out, 16)) != 0) retired += n;
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ops;
+    const bool ok = retired == ops && r.stats().full == 0;
+    printf("{\"step\":\"Throughput\",\"ok\":%s,\"ops\":%u,\"nsPerSubmission\":%.2f}\n",
+           ok ? "true" : "false", ops, ns);
+    if (!ok) gFailures++;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t ops = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 0) : 1000000;
+    TestOrder();
+    TestGaps();
+    TestPopBack();
+    TestFull();
+    TestCoalescedIrq(1000, 1);
+    TestCoalescedIrq(1000, 4);
+    TestCoalescedIrq(5000, 40);
+    TestChainPool(100000, 1);
+    TestChainPool(100000, 200);
+    TestThroughput(ops);
+    printf("{\"step\":\"Summary\",\"ok\":%s,\"failures\":%d}\n", gFailures ? "false" : "true", gFailures);
+    return gFailures ? 1 : 0;
+}